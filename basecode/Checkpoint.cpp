@@ -0,0 +1,185 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2024 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include <cstring>
+#include "header.h"
+#include "Checkpoint.h"
+
+/// Size of the stream buffers. Big vectors bypass them anyway.
+static const size_t CHECKPOINT_BUFFER_SIZE = 1 << 22;
+
+///////////////////////////////////////////////////////////////////////////
+// CheckpointWriter
+///////////////////////////////////////////////////////////////////////////
+
+CheckpointWriter::CheckpointWriter( const string& fname )
+	: buf_( CHECKPOINT_BUFFER_SIZE )
+{
+	// The buffer has to be set before the file is opened.
+	fs_.rdbuf()->pubsetbuf( &buf_[0], buf_.size() );
+	fs_.open( fname.c_str(), ios::out | ios::binary | ios::trunc );
+}
+
+bool CheckpointWriter::good() const
+{
+	return fs_.is_open() && fs_.good();
+}
+
+void CheckpointWriter::write( const void* data, size_t n )
+{
+	const char* p = reinterpret_cast< const char* >( data );
+	if ( blockStart_.empty() )
+		fs_.write( p, n );
+	else
+		block_.insert( block_.end(), p, p + n );
+}
+
+void CheckpointWriter::putString( const string& s )
+{
+	put< unsigned long >( s.size() );
+	write( s.data(), s.size() );
+}
+
+void CheckpointWriter::beginBlock()
+{
+	unsigned long len = 0; // Filled in by endBlock.
+	const char* p = reinterpret_cast< const char* >( &len );
+	blockStart_.push_back( block_.size() );
+	block_.insert( block_.end(), p, p + sizeof( len ) );
+}
+
+void CheckpointWriter::endBlock()
+{
+	assert( blockStart_.size() > 0 );
+	size_t start = blockStart_.back();
+	blockStart_.pop_back();
+	unsigned long len = block_.size() - start - sizeof( unsigned long );
+	memcpy( &block_[ start ], &len, sizeof( len ) );
+	if ( blockStart_.empty() ) {
+		fs_.write( &block_[0], block_.size() );
+		block_.clear();
+		// Do not hold on to the memory of one huge block.
+		if ( block_.capacity() > CHECKPOINT_BUFFER_SIZE )
+			vector< char >().swap( block_ );
+	}
+}
+
+bool CheckpointWriter::close()
+{
+	if ( !fs_.is_open() )
+		return false;
+	fs_.flush();
+	bool ret = fs_.good();
+	fs_.close();
+	return ret && !fs_.fail();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// CheckpointReader
+///////////////////////////////////////////////////////////////////////////
+
+CheckpointReader::CheckpointReader( const string& fname )
+	: buf_( CHECKPOINT_BUFFER_SIZE ), good_( false ), size_( 0 ), pos_( 0 )
+{
+	fs_.rdbuf()->pubsetbuf( &buf_[0], buf_.size() );
+	fs_.open( fname.c_str(), ios::in | ios::binary );
+	if ( fs_.is_open() ) {
+		fs_.seekg( 0, ios::end );
+		size_ = fs_.tellg();
+		fs_.seekg( 0, ios::beg );
+		good_ = fs_.good();
+	}
+}
+
+bool CheckpointReader::good() const
+{
+	return good_;
+}
+
+void CheckpointReader::fail()
+{
+	good_ = false;
+}
+
+unsigned long CheckpointReader::remaining()
+{
+	if ( !good_ )
+		return 0;
+	return size_ - pos_;
+}
+
+void CheckpointReader::read( void* data, size_t n )
+{
+	if ( !good_ )
+		return;
+	fs_.read( reinterpret_cast< char* >( data ), n );
+	pos_ += fs_.gcount();
+	if ( static_cast< size_t >( fs_.gcount() ) != n || !fs_.good() )
+		good_ = false;
+}
+
+string CheckpointReader::getString()
+{
+	unsigned long n = get< unsigned long >();
+	if ( !good_ || n > remaining() ) {
+		good_ = false;
+		return "";
+	}
+	string ret( n, '\0' );
+	if ( n > 0 )
+		read( &ret[0], n );
+	return ret;
+}
+
+void CheckpointReader::beginBlock()
+{
+	unsigned long len = get< unsigned long >();
+	if ( !good_ || len > remaining() ) {
+		good_ = false;
+		blockEnd_.push_back( size_ );
+		return;
+	}
+	blockEnd_.push_back( pos_ + len );
+}
+
+bool CheckpointReader::endBlock()
+{
+	assert( blockEnd_.size() > 0 );
+	unsigned long end = blockEnd_.back();
+	blockEnd_.pop_back();
+	if ( !good_ )
+		return false;
+	if ( pos_ == end )
+		return true;
+	fs_.seekg( end );
+	pos_ = end;
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Hooks
+///////////////////////////////////////////////////////////////////////////
+
+map< string, CheckpointHook >& checkpointHooks()
+{
+	static map< string, CheckpointHook > hooks;
+	return hooks;
+}
+
+const CheckpointHook* findCheckpointHook( const Cinfo* c )
+{
+	const map< string, CheckpointHook >& hooks = checkpointHooks();
+	for ( ; c; c = c->baseCinfo() ) {
+		map< string, CheckpointHook >::const_iterator i =
+			hooks.find( c->name() );
+		if ( i != hooks.end() )
+			return &i->second;
+	}
+	return 0;
+}
@@ -0,0 +1,209 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2024 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+#ifndef _CHECKPOINT_H
+#define _CHECKPOINT_H
+
+#include <fstream>
+#include <type_traits>
+
+/**
+ * Binary streams for checkpoint files, which hold the running state of a
+ * simulation so that it can be resumed later. Values are written as they
+ * are in memory, so a restored double is bit for bit the one saved, and
+ * vectors go out in a single write. The files are only meant to be read
+ * back on the same kind of machine.
+ *
+ * Objects that keep state which cannot be reached through their fields,
+ * such as the solvers, provide
+ *	void saveState( CheckpointWriter& w ) const;
+ *	bool loadState( CheckpointReader& r );
+ * and register them for their class with addCheckpointHook. loadState
+ * must read back exactly what saveState wrote, and return false if it
+ * does not fit the object as it is now built.
+ * This header is to be included after header.h.
+ */
+class CheckpointWriter
+{
+	public:
+		CheckpointWriter( const string& fname );
+
+		/// True if everything so far has gone out without error.
+		bool good() const;
+
+		void write( const void* data, size_t n );
+
+		template< class T > void put( const T& v )
+		{
+			static_assert( std::is_trivially_copyable< T >::value,
+				"CheckpointWriter::put needs a plain value" );
+			write( &v, sizeof( T ) );
+		}
+
+		/// Writes the size and then the contents in one go.
+		template< class T > void putVec( const vector< T >& v )
+		{
+			static_assert( std::is_trivially_copyable< T >::value,
+				"CheckpointWriter::putVec needs plain values" );
+			put< unsigned long >( v.size() );
+			if ( v.size() > 0 )
+				write( &v[0], sizeof( T ) * v.size() );
+		}
+
+		void putString( const string& s );
+
+		/**
+		 * Starts a block whose length is filled in by endBlock, so that
+		 * a reader can check it took out as much as was put in. The
+		 * block is put together in memory and goes to the file with its
+		 * length once the outermost block ends, so that the file need
+		 * not seek back.
+		 */
+		void beginBlock();
+		void endBlock();
+
+		/// Flushes and closes the file. Returns good().
+		bool close();
+
+	private:
+		vector< char > buf_;
+		ofstream fs_;
+
+		/// Contents of the open blocks, and where each of them starts.
+		vector< char > block_;
+		vector< size_t > blockStart_;
+};
+
+class CheckpointReader
+{
+	public:
+		CheckpointReader( const string& fname );
+
+		/// True if everything so far was read without running short.
+		bool good() const;
+
+		void read( void* data, size_t n );
+
+		template< class T > T get()
+		{
+			static_assert( std::is_trivially_copyable< T >::value,
+				"CheckpointReader::get needs a plain value" );
+			T ret = T();
+			read( &ret, sizeof( T ) );
+			return ret;
+		}
+
+		template< class T > void get( T& v )
+		{
+			v = get< T >();
+		}
+
+		/**
+		 * Reads a vector written by putVec. Returns false, and leaves v
+		 * alone, if the file is bad.
+		 */
+		template< class T > bool getVec( vector< T >& v )
+		{
+			static_assert( std::is_trivially_copyable< T >::value,
+				"CheckpointReader::getVec needs plain values" );
+			unsigned long n = get< unsigned long >();
+			if ( !good() || n > remaining() / sizeof( T ) ) {
+				fail();
+				return false;
+			}
+			vector< T > temp( n );
+			if ( n > 0 )
+				read( &temp[0], sizeof( T ) * n );
+			if ( !good() )
+				return false;
+			v.swap( temp );
+			return true;
+		}
+
+		/**
+		 * As getVec, but the vector must already have the saved size. It
+		 * is then filled in place, so pointers into it stay valid.
+		 */
+		template< class T > bool getVecInPlace( vector< T >& v )
+		{
+			static_assert( std::is_trivially_copyable< T >::value,
+				"CheckpointReader::getVecInPlace needs plain values" );
+			unsigned long n = get< unsigned long >();
+			if ( !good() || n != v.size() ) {
+				fail();
+				return false;
+			}
+			if ( n > 0 )
+				read( &v[0], sizeof( T ) * n );
+			return good();
+		}
+
+		string getString();
+
+		/**
+		 * Starts a block written by beginBlock. endBlock returns false if
+		 * the block was not read to its end, and skips to the end of it.
+		 */
+		void beginBlock();
+		bool endBlock();
+
+		/// Marks the file as bad.
+		void fail();
+
+	private:
+		/// Bytes left in the file.
+		unsigned long remaining();
+
+		vector< char > buf_;
+		ifstream fs_;
+		bool good_;
+		unsigned long size_;
+
+		/// Position in the file, kept here as tellg costs a system call.
+		unsigned long pos_;
+		vector< unsigned long > blockEnd_;
+};
+
+typedef void ( *SaveStateFunc )( const Eref& e, CheckpointWriter& w );
+typedef bool ( *LoadStateFunc )( const Eref& e, CheckpointReader& r );
+
+struct CheckpointHook
+{
+	SaveStateFunc save;
+	LoadStateFunc load;
+};
+
+template< class T > void saveStateHook( const Eref& e, CheckpointWriter& w )
+{
+	reinterpret_cast< const T* >( e.data() )->saveState( w );
+}
+
+template< class T > bool loadStateHook( const Eref& e, CheckpointReader& r )
+{
+	return reinterpret_cast< T* >( e.data() )->loadState( r );
+}
+
+/// Registry of hooks by class name.
+map< string, CheckpointHook >& checkpointHooks();
+
+/**
+ * Registers the saveState and loadState members of T as the hook for the
+ * named class and for classes derived from it, unless they have their
+ * own. Meant to initialize a static in the file of the class.
+ */
+template< class T > bool addCheckpointHook( const string& className )
+{
+	CheckpointHook h = { &saveStateHook< T >, &loadStateHook< T > };
+	checkpointHooks()[ className ] = h;
+	return true;
+}
+
+/// Finds the hook for the class or its nearest base. NULL if none.
+const CheckpointHook* findCheckpointHook( const Cinfo* c );
+
+#endif // _CHECKPOINT_H
@@ -102,6 +102,13 @@ void DataElement::resize( unsigned int newNumLocalData )
 	numLocalData_ = newNumLocalData;
 }
 
+void DataElement::replaceData( char* d, unsigned int numLocalData )
+{
+	cinfo()->dinfo()->destroyData( data_ );
+	data_ = d;
+	numLocalData_ = numLocalData;
+}
+
 /////////////////////////////////////////////////////////////////////////
 // Zombie stuff
 /////////////////////////////////////////////////////////////////////////
@@ -128,6 +128,14 @@ class DataElement: public Element
 		/// Virtual func.
 		void zombieSwap( const Cinfo* newCinfo );
 
+	protected:
+		/**
+		 * Replaces the local data with the array d, holding
+		 * numLocalData entries. Destroys the old data. Used by derived
+		 * classes when the entries are handed around between nodes.
+		 */
+		void replaceData( char* d, unsigned int numLocalData );
+
 	private:
 
 		/**
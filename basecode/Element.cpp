@@ -470,9 +470,16 @@ void Element::putTargetsInDigest(
 // targetNodes[srcDataId][node]
 {
     const Msg* msg = Msg::getMsg( mfb.mid );
+    const OpFunc* func = fo.func();
     vector< vector < Eref > > erefs;
     if ( msg->e1() == this )
-        msg->targets( erefs );
+    {
+        const OpFunc* batch = msg->batchTargets( func, erefs );
+        if ( batch )
+            func = batch;
+        else
+            msg->targets( erefs );
+    }
     else if ( msg->e2() == this )
         msg->sources( erefs );
     else
@@ -490,9 +497,9 @@ void Element::putTargetsInDigest(
         vector< MsgDigest >& md =
             msgDigest_[ msgBinding_.size() * j + srcNum ];
         // k->func(); erefs[ j ];
-        if ( md.size() == 0 || md.back().func != fo.func() )
+        if ( md.size() == 0 || md.back().func != func )
         {
-            md.push_back( MsgDigest( fo.func(), erefs[j] ) );
+            md.push_back( MsgDigest( func, erefs[j] ) );
             /*
             if ( md.back().targets.size() > 0 )
             	cout << "putTargetsInDigest: " << md.back().targets[0] <<
@@ -10,24 +10,6 @@
 #include "header.h"
 #include "../shell/Shell.h"
 
-Eref::Eref()
-			: e_( 0 ), i_( 0 ), f_( 0 )
-{
-	;
-}
-
-Eref::Eref( const Eref& other )
-			: e_( other.e_ ), i_( other.i_ ), f_( other.f_ )
-{
-	;
-}
-
-Eref::Eref( Element* e, unsigned int index, unsigned int field )
-			: e_( e ), i_( index ), f_( field )
-{
-	;
-}
-
 ostream& operator <<( ostream& s, const Eref& e )
 {
 	if ( e.i_ == 0 ) {
@@ -15,9 +15,21 @@ class Eref
 public:
 
     friend ostream& operator <<( ostream& s, const Eref& e );
-    Eref();
-	Eref( const Eref& other );
-    Eref( Element* e, unsigned int index, unsigned int field = 0 );
+    /**
+     * The constructors are inline because SrcFinfo::send makes an Eref
+     * for every data entry of an ALLDATA target.
+     */
+    Eref()
+        : e_( 0 ), i_( 0 ), f_( 0 )
+    {;}
+
+    Eref( const Eref& other )
+        : e_( other.e_ ), i_( other.i_ ), f_( other.f_ )
+    {;}
+
+    Eref( Element* e, unsigned int index, unsigned int field = 0 )
+        : e_( e ), i_( index ), f_( field )
+    {;}
 
     /**
      * Returns data entry.
@@ -78,12 +78,20 @@ unsigned int LocalDataElement::getNode( unsigned int dataId ) const {
 			return 0; // Sure to have some data on node 0.
 		}
 	}
-	return dataId / numPerNode_;
+	if ( nodeStart_.empty() )
+		return dataId / numPerNode_;
+	if ( dataId >= localDataStart_ &&
+			dataId < localDataStart_ + numLocalData() )
+		return Shell::myNode();
+	return upper_bound( nodeStart_.begin(), nodeStart_.end() - 1, dataId ) -
+		nodeStart_.begin() - 1;
 }
 
 /// Inherited virtual. Returns start DataId on specified node
 unsigned int LocalDataElement::startDataIndex( unsigned int node ) const
 {
+	if ( !nodeStart_.empty() )
+		return nodeStart_[node] < numData_ ? nodeStart_[node] : numData_;
 	if ( numPerNode_ * node < numData_ )
 		return numPerNode_ * node;
 	else
@@ -91,7 +99,9 @@ unsigned int LocalDataElement::startDataIndex( unsigned int node ) const
 }
 
 unsigned int LocalDataElement::rawIndex( unsigned int dataId ) const {
-	return dataId % numPerNode_;
+	if ( nodeStart_.empty() )
+		return dataId % numPerNode_;
+	return dataId - nodeStart_[ getNode( dataId ) ];
 }
 
 // Utility function for computing the data size.
@@ -115,11 +125,37 @@ unsigned int LocalDataElement::setDataSize( unsigned int numData )
 // virtual func, overridden.
 void LocalDataElement::resize( unsigned int newNumData )
 {
+	// Back to equal blocks. The entries keep their raw indices, as before.
+	nodeStart_.clear();
 	DataElement::resize( setDataSize( newNumData ) );
 }
 
+void LocalDataElement::setNodeStart( const vector< unsigned int >& nodeStart )
+{
+	assert( nodeStart.size() == Shell::numNodes() + 1 );
+	assert( nodeStart.front() == 0 && nodeStart.back() == numData_ );
+	unsigned int myNode = Shell::myNode();
+	unsigned int start = nodeStart[ myNode ];
+	unsigned int num = nodeStart[ myNode + 1 ] - start;
+
+	const DinfoBase* d = cinfo()->dinfo();
+	char* temp = d->allocData( num );
+	// Copy over the entries that were here before and stay here.
+	unsigned int begin = max( start, localDataStart_ );
+	unsigned int end = min( start + num, localDataStart_ + numLocalData() );
+	for ( unsigned int i = begin; i < end && !d->isOneZombie(); ++i )
+		d->assignData( temp + ( i - start ) * d->sizeIncrement(), 1,
+				data( i - localDataStart_ ), 1 );
+	replaceData( temp, num );
+
+	nodeStart_ = nodeStart;
+	localDataStart_ = start;
+}
+
 unsigned int LocalDataElement::getNumOnNode( unsigned int node ) const
 {
+	if ( !nodeStart_.empty() )
+		return nodeStart_[ node + 1 ] - nodeStart_[ node ];
 	unsigned int lastUsedNode = numData_ / numPerNode_;
 	if ( lastUsedNode > node )
 		return numPerNode_;
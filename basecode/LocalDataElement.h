@@ -15,7 +15,9 @@ class FuncOrder;
 /**
  * This is the class for handling the local portion of a data element
  * that is distributed over many nodes.
- * Does block-wise partitioning between nodes.
+ * Does block-wise partitioning between nodes. By default the blocks are
+ * of equal size, but the load balancer may assign each node its own
+ * contiguous block through setNodeStart.
  */
 class LocalDataElement: public DataElement
 {
@@ -99,6 +101,17 @@ class LocalDataElement: public DataElement
 		/////////////////////////////////////////////////////////////////
 		unsigned int setDataSize( unsigned int numData );
 
+		/**
+		 * Assigns each node its own block of data entries: node n gets
+		 * entries nodeStart[n] up to nodeStart[n+1]. So there are
+		 * numNodes + 1 entries, starting with 0 and ending with numData.
+		 * Entries that stay on this node keep their contents, entries
+		 * that arrive here are default-constructed and must be filled
+		 * in by the caller. Called on all nodes with the same
+		 * arguments, from Shell::handleRebalance.
+		 */
+		void setNodeStart( const vector< unsigned int >& nodeStart );
+
 	private:
 		/**
 		 * This is the total number of data entries on this Element, in
@@ -119,6 +132,12 @@ class LocalDataElement: public DataElement
 		 * Precomputed value for start index of data on this node.
 		 */
 		unsigned int localDataStart_;
+
+		/**
+		 * Start index of the block on each node, with numData_ at the
+		 * end. Empty when the default equal blocks are in use.
+		 */
+		vector< unsigned int > nodeStart_;
 };
 
 #endif // _LOCAL_DATA_ELEMENT_H
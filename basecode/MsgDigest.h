@@ -17,6 +17,11 @@
  * As a further refinement, if the target DataIndex is ALLDATA, then it
  * means that all data entries in the target are to be iterated over. Note
  * that this does not extend to Field targets.
+ *
+ * The func is always an OpFuncNBase of the argument types of the
+ * SrcFinfo that sends on the digest: SrcFinfo::addMsg checks this, and
+ * makeHopFunc keeps the argument types. So the sends use typedFunc, a
+ * static_cast, rather than a dynamic_cast per digest entry per send.
  */
 class MsgDigest
 {
@@ -24,6 +29,17 @@ class MsgDigest
 		MsgDigest( const OpFunc* f, const vector< Eref >& t )
 				: func( f ), targets( t )
 		{;}
+
+		/**
+		 * Returns func as the OpFunc base class F that the SrcFinfo
+		 * expects. Debug builds check the type.
+		 */
+		template< class F > const F* typedFunc() const
+		{
+			assert( dynamic_cast< const F* >( func ) );
+			return static_cast< const F* >( func );
+		}
+
 		const OpFunc* func;
 		vector< Eref > targets;
 };
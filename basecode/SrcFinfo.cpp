@@ -71,9 +71,7 @@ void SrcFinfo0::send( const Eref& e ) const {
 	const vector< MsgDigest >& md = e.msgDigest( getBindIndex() );
 	for ( vector< MsgDigest >::const_iterator
 		i = md.begin(); i != md.end(); ++i ) {
-		const OpFunc0Base* f =
-			dynamic_cast< const OpFunc0Base* >( i->func );
-		assert( f );
+		const OpFunc0Base* f = i->typedFunc< OpFunc0Base >();
 		for ( vector< Eref >::const_iterator
 			j = i->targets.begin(); j != i->targets.end(); ++j ) {
 			if ( j->dataIndex() == ALLDATA ) {
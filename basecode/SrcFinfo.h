@@ -102,8 +102,7 @@ template < class T > class SrcFinfo1: public SrcFinfo
 			for ( vector< MsgDigest >::const_iterator
 				i = md.begin(); i != md.end(); ++i ) {
 				const OpFunc1Base< T >* f =
-					dynamic_cast< const OpFunc1Base< T >* >( i->func );
-				assert( f );
+					i->typedFunc< OpFunc1Base< T > >();
 				for ( vector< Eref >::const_iterator
 					j = i->targets.begin(); j != i->targets.end(); ++j ) {
 					if ( j->dataIndex() == ALLDATA ) {
@@ -130,8 +129,7 @@ template < class T > class SrcFinfo1: public SrcFinfo
 			for ( vector< MsgDigest >::const_iterator
 				i = md.begin(); i != md.end(); ++i ) {
 				const OpFunc1Base< T >* f =
-					dynamic_cast< const OpFunc1Base< T >* >( i->func );
-				assert( f );
+					i->typedFunc< OpFunc1Base< T > >();
 				for ( vector< Eref >::const_iterator
 					j = i->targets.begin(); j != i->targets.end(); ++j ) {
 					if ( j->element() != tgt.element() )
@@ -168,8 +166,7 @@ template < class T > class SrcFinfo1: public SrcFinfo
 			for ( vector< MsgDigest >::const_iterator
 				i = md.begin(); i != md.end(); ++i ) {
 				const OpFunc1Base< T >* f =
-					dynamic_cast< const OpFunc1Base< T >* >( i->func );
-				assert( f );
+					i->typedFunc< OpFunc1Base< T > >();
 				for ( vector< Eref >::const_iterator
 					j = i->targets.begin(); j != i->targets.end(); ++j ) {
 					if ( j->dataIndex() == ALLDATA ) {
@@ -224,8 +221,7 @@ template < class T1, class T2 > class SrcFinfo2: public SrcFinfo
 			for ( vector< MsgDigest >::const_iterator
 				i = md.begin(); i != md.end(); ++i ) {
 				const OpFunc2Base< T1, T2 >* f =
-					dynamic_cast< const OpFunc2Base< T1, T2 >* >( i->func );
-				assert( f );
+					i->typedFunc< OpFunc2Base< T1, T2 > >();
 				for ( vector< Eref >::const_iterator
 					j = i->targets.begin(); j != i->targets.end(); ++j ) {
 					if ( j->dataIndex() == ALLDATA ) {
@@ -248,8 +244,7 @@ template < class T1, class T2 > class SrcFinfo2: public SrcFinfo
 			for ( vector< MsgDigest >::const_iterator
 				i = md.begin(); i != md.end(); ++i ) {
 				const OpFunc2Base< T1, T2 >* f =
-					dynamic_cast< const OpFunc2Base< T1, T2 >* >( i->func );
-				assert( f );
+					i->typedFunc< OpFunc2Base< T1, T2 > >();
 				for ( vector< Eref >::const_iterator
 					j = i->targets.begin(); j != i->targets.end(); ++j ) {
 					if ( j->element() != tgt.element() )
@@ -302,9 +297,7 @@ template < class T1, class T2, class T3 > class SrcFinfo3: public SrcFinfo
 			for ( vector< MsgDigest >::const_iterator
 				i = md.begin(); i != md.end(); ++i ) {
 				const OpFunc3Base< T1, T2, T3 >* f =
-					dynamic_cast< const OpFunc3Base< T1, T2, T3 >* >(
-									i->func );
-				assert( f );
+					i->typedFunc< OpFunc3Base< T1, T2, T3 > >();
 				for ( vector< Eref >::const_iterator
 					j = i->targets.begin(); j != i->targets.end(); ++j ) {
 					if ( j->dataIndex() == ALLDATA ) {
@@ -354,9 +347,7 @@ template < class T1, class T2, class T3, class T4 > class SrcFinfo4: public SrcF
 			for ( vector< MsgDigest >::const_iterator
 				i = md.begin(); i != md.end(); ++i ) {
 				const OpFunc4Base< T1, T2, T3, T4 >* f =
-					dynamic_cast< const OpFunc4Base< T1, T2, T3, T4 >* >(
-									i->func );
-				assert( f );
+					i->typedFunc< OpFunc4Base< T1, T2, T3, T4 > >();
 				for ( vector< Eref >::const_iterator
 					j = i->targets.begin(); j != i->targets.end(); ++j ) {
 					if ( j->dataIndex() == ALLDATA ) {
@@ -408,9 +399,7 @@ template < class T1, class T2, class T3, class T4, class T5 > class SrcFinfo5: p
 			for ( vector< MsgDigest >::const_iterator
 				i = md.begin(); i != md.end(); ++i ) {
 				const OpFunc5Base< T1, T2, T3, T4, T5 >* f =
-					dynamic_cast<
-					const OpFunc5Base< T1, T2, T3, T4, T5 >* >( i->func );
-				assert( f );
+					i->typedFunc< OpFunc5Base< T1, T2, T3, T4, T5 > >();
 				for ( vector< Eref >::const_iterator
 					j = i->targets.begin(); j != i->targets.end(); ++j ) {
 					if ( j->dataIndex() == ALLDATA ) {
@@ -465,10 +454,7 @@ template < class T1, class T2, class T3, class T4, class T5, class T6 > class Sr
 			for ( vector< MsgDigest >::const_iterator
 				i = md.begin(); i != md.end(); ++i ) {
 				const OpFunc6Base< T1, T2, T3, T4, T5, T6 >* f =
-					dynamic_cast<
-					const OpFunc6Base< T1, T2, T3, T4, T5, T6 >* >(
-									i->func );
-				assert( f );
+					i->typedFunc< OpFunc6Base< T1, T2, T3, T4, T5, T6 > >();
 				for ( vector< Eref >::const_iterator
 					j = i->targets.begin(); j != i->targets.end(); ++j ) {
 					if ( j->dataIndex() == ALLDATA ) {
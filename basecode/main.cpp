@@ -49,6 +49,7 @@ extern void testSynapse();
 extern void testBuiltinsProcess();
 
 extern void testMpiScheduling();
+extern void testMpi();
 extern void testMpiBuiltins();
 extern void testMpiShell();
 extern void testMsg();
@@ -286,6 +287,7 @@ void mpiTests()
     MOOSE_TEST( "testMpiShell", testMpiShell());
     MOOSE_TEST( "testMpiBuiltins", testMpiBuiltins());
     MOOSE_TEST( "testMpiScheduling", testMpiScheduling());
+    MOOSE_TEST( "testMpi", testMpi());
 #endif
 }
 #if ! defined(PYMOOSE) && ! defined(MOOSE_LIB)
@@ -8,6 +8,7 @@
 **********************************************************************/
 #include <stdio.h>
 #include <iomanip>
+#include <chrono>
 
 #include "header.h"
 #include "global.h"
@@ -15,6 +16,7 @@
 #include "SparseMatrix.h"
 
 #include "../msg/OneToOneMsg.h"
+#include "../msg/OneToAllMsg.h"
 #include "../msg/SparseMsg.h"
 #include "../msg/SingleMsg.h"
 
@@ -108,6 +110,65 @@ void testSendMsg()
     delete i2.element();
 }
 
+/**
+ * Messaging microbenchmark. Times SrcFinfo1< double >::send from each of
+ * size Arith entries, first over a OneToOneMsg, which gives one target
+ * per send, and then over a OneToAllMsg from entry 0, which gives an
+ * ALLDATA target that is expanded over all size entries. Reports sends
+ * and target calls per second. Not part of the unit tests; run it with
+ * builds from before and after a change to the send path to compare.
+ */
+void benchmarkSend(unsigned int size, unsigned int numRounds)
+{
+    const Cinfo* ac = Arith::initCinfo();
+    const DestFinfo* df =
+        dynamic_cast<const DestFinfo*>(ac->findFinfo("arg1"));
+    assert(df != 0);
+    FuncId fid = df->getFid();
+
+    Id i1 = Id::nextId();
+    Id i2 = Id::nextId();
+    new GlobalDataElement(i1, ac, "bench1", size);
+    new GlobalDataElement(i2, ac, "bench2", size);
+    Eref e1 = i1.eref();
+    Eref e2 = i2.eref();
+
+    SrcFinfo1<double> s("bench", "");
+    s.setBindIndex(0);
+
+    for(unsigned int pass = 0; pass < 2; ++pass) {
+        Msg* m;
+        unsigned int numSrc;
+        if(pass == 0) {
+            m = new OneToOneMsg(e1, e2, 0);
+            numSrc = size;
+        } else {
+            m = new OneToAllMsg(e1, e2.element(), 0);
+            numSrc = 1;
+        }
+        e1.element()->addMsgAndFunc(m->mid(), fid, s.getBindIndex());
+        s.send(e1, 0.0);  // Digests the messages.
+
+        auto t0 = std::chrono::steady_clock::now();
+        for(unsigned int r = 0; r < numRounds; ++r)
+            for(unsigned int i = 0; i < numSrc; ++i)
+                s.send(Eref(e1.element(), i), r + 0.5 * i);
+        double t = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - t0).count();
+
+        double numSends = double(numRounds) * numSrc;
+        double numCalls = double(numRounds) * size;
+        cout << endl << (pass == 0 ? "OneToOne" : "OneToAll") << ": "
+             << numSends / t << " sends/s, " << numCalls / t
+             << " target calls/s";
+        delete m;
+    }
+    cout << endl;
+
+    delete i1.element();
+    delete i2.element();
+}
+
 // This used to use parent/child msg, but that has other implications
 // as it causes deletion of elements.
 void testCreateMsg()
@@ -10,6 +10,7 @@
 #include "../basecode/header.h"
 #include "CaConcBase.h"
 #include "CaConc.h"
+#include "../basecode/Checkpoint.h"
 
 
 const Cinfo* CaConc::initCinfo()
@@ -41,6 +42,8 @@ const Cinfo* CaConc::initCinfo()
 
 static const Cinfo* caConcCinfo = CaConc::initCinfo();
 
+static const bool caConcHook = addCheckpointHook< CaConc >( "CaConc" );
+
 CaConc::CaConc()
 	: CaConcBase(),
 		Ca_( 0.0 ),
@@ -136,6 +139,21 @@ void CaConc::vProcess( const Eref& e, ProcPtr p )
 	activation_ = 0;
 }
 
+void CaConc::saveState( CheckpointWriter& w ) const
+{
+	w.put( Ca_ );
+	w.put( c_ );
+	w.put( activation_ );
+}
+
+bool CaConc::loadState( CheckpointReader& r )
+{
+	r.get( Ca_ );
+	r.get( c_ );
+	r.get( activation_ );
+	return r.good();
+}
+
 
 void CaConc::vCurrent( const Eref& e, double I )
 {
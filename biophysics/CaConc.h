@@ -11,6 +11,9 @@
 #ifndef _CACONC_H
 #define _CACONC_H
 
+class CheckpointWriter;
+class CheckpointReader;
+
 /**
  * The CaConc object manages calcium dynamics in a single compartment
  * without diffusion. It uses a simple exponential return of Ca
@@ -63,6 +66,10 @@ class CaConc: public CaConcBase
         void vSetFloor( const Eref& e, double val );
         double vGetFloor( const Eref& e ) const;
 
+		/// Saves and restores Ca and the summed current, for checkpoints.
+		void saveState( CheckpointWriter& w ) const;
+		bool loadState( CheckpointReader& r );
+
 		static const Cinfo* initCinfo();
 	private:
 		double Ca_;
@@ -9,6 +9,10 @@
 // #include "../basecode/header.h"
 // #include "ChanBase.h"
 #include "ChanCommon.h"
+#include "../basecode/Checkpoint.h"
+
+// All the channel classes are ChanCommons.
+static const bool chanHook = addCheckpointHook< ChanCommon >( "ChanBase" );
 
 
 ///////////////////////////////////////////////////
@@ -132,3 +136,14 @@ double ChanCommon::getGbar() const
 {
     return Gbar_;
 }
+
+void ChanCommon::saveState( CheckpointWriter& w ) const
+{
+    w.put( Vm_ );
+}
+
+bool ChanCommon::loadState( CheckpointReader& r )
+{
+    r.get( Vm_ );
+    return r.good();
+}
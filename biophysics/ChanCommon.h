@@ -14,6 +14,9 @@
 
 #include "ChanBase.h"
 
+class CheckpointWriter;
+class CheckpointReader;
+
 // #include "../basecode/header.h"
 
 /**
@@ -75,6 +78,13 @@ public:
     /// Utility function to acces Gbar
     double getGbar() const;
 
+    /**
+     * Saves and restores the Vm last sent by the compartment, for
+     * checkpoints. Derived classes with more state extend these.
+     */
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     /// Specify the Class Info static variable for initialization.
     static const Cinfo* initCinfo();
 protected:
@@ -11,6 +11,7 @@
 #include "../randnum/randnum.h"
 #include "CompartmentBase.h"
 #include "Compartment.h"
+#include "../basecode/Checkpoint.h"
 
 using namespace moose;
 const double Compartment::EPSILON = 1.0e-15;
@@ -52,6 +53,9 @@ const Cinfo* Compartment::initCinfo()
 
 static const Cinfo* compartmentCinfo = Compartment::initCinfo();
 
+static const bool compartmentHook =
+    addCheckpointHook< Compartment >( "Compartment" );
+
 
 /*
 const SrcFinfo1< double >* VmOut =
@@ -264,6 +268,25 @@ void Compartment::vRandInject( const Eref& e, double prob, double current)
     }
 }
 
+void Compartment::saveState( CheckpointWriter& w ) const
+{
+    w.put( A_ );
+    w.put( B_ );
+    w.put( Im_ );
+    w.put( lastIm_ );
+    w.put( sumInject_ );
+}
+
+bool Compartment::loadState( CheckpointReader& r )
+{
+    r.get( A_ );
+    r.get( B_ );
+    r.get( Im_ );
+    r.get( lastIm_ );
+    r.get( sumInject_ );
+    return r.good();
+}
+
 /////////////////////////////////////////////////////////////////////
 
 #ifdef DO_UNIT_TESTS
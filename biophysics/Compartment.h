@@ -11,6 +11,9 @@
 #ifndef _COMPARTMENT_H
 #define _COMPARTMENT_H
 
+class CheckpointWriter;
+class CheckpointReader;
+
 /**
  * The Compartment class sets up an asymmetric compartment for
  * branched nerve calculations. Handles electronic structure and
@@ -110,6 +113,13 @@ public:
     void cable();
 
 
+    /**
+     * Saves and restores the terms summed up between steps, for
+     * checkpoints.
+     */
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     /**
      * Initializes the class info.
      */
@@ -48,6 +48,7 @@
 #include "../basecode/header.h"
 #include "DifBufferBase.h"
 #include "DifBuffer.h"
+#include "../basecode/Checkpoint.h"
 #include "../basecode/ElementValueFinfo.h"
 #include "../utility/numutil.h"
 #include <cmath>
@@ -78,6 +79,8 @@ const Cinfo * DifBuffer::initCinfo()
 
 static const Cinfo * difBufferCinfo = DifBuffer::initCinfo();
 
+static const bool difBufferHook = addCheckpointHook< DifBuffer >( "DifBuffer" );
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // Class functions
@@ -444,6 +447,23 @@ void DifBuffer::vProcess( const Eref & e, ProcPtr p )
 
 }
 
+void DifBuffer::saveState( CheckpointWriter& w ) const
+{
+  w.put( Af_ );
+  w.put( Bf_ );
+  w.put( prevFree_ );
+  w.put( prevBound_ );
+}
+
+bool DifBuffer::loadState( CheckpointReader& r )
+{
+  r.get( Af_ );
+  r.get( Bf_ );
+  r.get( prevFree_ );
+  r.get( prevBound_ );
+  return r.good();
+}
+
 void DifBuffer::vReinit( const Eref& e, ProcPtr p )
 {
 
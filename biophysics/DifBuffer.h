@@ -10,6 +10,9 @@
 #ifndef _DifBuffer_h
 #define _DifBuffer_h
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class DifBuffer: public DifBufferBase{
  public:
   DifBuffer();
@@ -63,6 +66,10 @@ class DifBuffer: public DifBufferBase{
   double vGetInnerArea(const Eref& e) const;
 
   void   calculateVolumeArea(const Eref& e);
+  /// Saves and restores the rates summed for the next step, for checkpoints.
+  void saveState( CheckpointWriter& w ) const;
+  bool loadState( CheckpointReader& r );
+
   static const Cinfo * initCinfo();
 
  private:
@@ -11,6 +11,7 @@
 #include "../basecode/header.h"
 #include "DifShellBase.h"
 #include "DifShell.h"
+#include "../basecode/Checkpoint.h"
 
 
 const double DifShell::EPSILON = 1.0e-10;
@@ -46,6 +47,8 @@ const Cinfo* DifShell::initCinfo()
 //Cinfo *object*  corresponding to the class.
 static const Cinfo* difShellCinfo = DifShell::initCinfo();
 
+static const bool difShellHook = addCheckpointHook< DifShell >( "DifShell" );
+
 ////////////////////////////////////////////////////////////////////////////////
 // Class functions
 ////////////////////////////////////////////////////////////////////////////////
@@ -373,6 +376,21 @@ void DifShell::vProcess( const Eref & e, ProcPtr p )
   concentrationOut()->send( e, C_ );
 
 }
+
+void DifShell::saveState( CheckpointWriter& w ) const
+{
+  w.put( dCbyDt_ );
+  w.put( Cmultiplier_ );
+  w.put( prevC_ );
+}
+
+bool DifShell::loadState( CheckpointReader& r )
+{
+  r.get( dCbyDt_ );
+  r.get( Cmultiplier_ );
+  r.get( prevC_ );
+  return r.good();
+}
 void DifShell::vBuffer(const Eref& e,
 			   double kf,
 			   double kb,
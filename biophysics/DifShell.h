@@ -11,6 +11,9 @@
 #ifndef _DIFSHELL_H
 #define _DIFSHELL_H
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class DifShell: public DifShellBase{
  public:
   DifShell();
@@ -76,6 +79,10 @@ class DifShell: public DifShellBase{
 
   void calculateVolumeArea(const Eref& e);
 
+  /// Saves and restores the fluxes summed for the next step, for checkpoints.
+  void saveState( CheckpointWriter& w ) const;
+  bool loadState( CheckpointReader& r );
+
   static const Cinfo * initCinfo();
 
 
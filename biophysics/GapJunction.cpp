@@ -47,6 +47,7 @@
 
 #include "../basecode/header.h"
 #include "GapJunction.h"
+#include "../basecode/Checkpoint.h"
 
 static SrcFinfo2< double, double >* channel1Out()
 {
@@ -167,6 +168,9 @@ const Cinfo* GapJunction::initCinfo()
 
 static const Cinfo * gapJunctionCinfo = GapJunction::initCinfo();
 
+static const bool gapJunctionHook =
+    addCheckpointHook< GapJunction >( "GapJunction" );
+
 GapJunction::GapJunction():Vm1_(0.0), Vm2_(0.0), Gk_(1e-9)
 {
     ;
@@ -203,6 +207,19 @@ void GapJunction::process( const Eref& e, ProcPtr p )
     channel2Out()->send(e, Gk_, Vm1_);
 }
 
+void GapJunction::saveState( CheckpointWriter& w ) const
+{
+    w.put( Vm1_ );
+    w.put( Vm2_ );
+}
+
+bool GapJunction::loadState( CheckpointReader& r )
+{
+    r.get( Vm1_ );
+    r.get( Vm2_ );
+    return r.good();
+}
+
 void GapJunction::reinit( const Eref&, ProcPtr p )
 {
     Vm1_ = 0.0;
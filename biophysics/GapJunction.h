@@ -45,6 +45,9 @@
 
 // Code:
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class GapJunction {
   public:
     GapJunction();
@@ -67,6 +70,10 @@ class GapJunction {
      */
     void reinit( const Eref& e, ProcPtr p );
 
+    /// Saves and restores the Vm of both sides, for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     /**
      * Initializes the class info.
      */
@@ -14,6 +14,7 @@
 #include "HHChannelBase.h"
 #include "HHChannel.h"
 #include "HHGate.h"
+#include "../basecode/Checkpoint.h"
 
 // const double HHChannel::EPSILON = 1.0e-10;
 // const int HHChannel::INSTANT_X = 1;
@@ -67,6 +68,8 @@ const Cinfo* HHChannel::initCinfo() {
 }
 
 static const Cinfo* hhChannelCinfo = HHChannel::initCinfo();
+
+static const bool hhChannelHook = addCheckpointHook<HHChannel>("HHChannel");
 //////////////////////////////////////////////////////////////////////
 
 ///////////////////////////////////////////////////
@@ -352,3 +355,16 @@ void HHChannel::vReinit(const Eref& er, ProcPtr info) {
 
 void HHChannel::vHandleConc(const Eref& e, double conc) { conc_ = conc; }
 
+void HHChannel::saveState(CheckpointWriter& w) const
+{
+    ChanCommon::saveState(w);
+    w.put(conc_);
+}
+
+bool HHChannel::loadState(CheckpointReader& r)
+{
+    if (!ChanCommon::loadState(r)) return false;
+    r.get(conc_);
+    return r.good();
+}
+
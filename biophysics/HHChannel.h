@@ -177,6 +177,10 @@ class HHChannel : public HHChannelBase {
     // bool setGatePower(const Eref& e, double power, double* assignee,
     //                   const string& gateType);
 
+    /// Saves and restores Vm and conc, for checkpoints.
+    void saveState(CheckpointWriter& w) const;
+    bool loadState(CheckpointReader& r);
+
     /////////////////////////////////////////////////////////////
     static const Cinfo* initCinfo();
 
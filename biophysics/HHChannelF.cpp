@@ -9,6 +9,7 @@
 #include "HHChannelBase.h"
 #include "HHGateF.h"
 #include "HHChannelF.h"
+#include "../basecode/Checkpoint.h"
 
 const Cinfo* HHChannelF::initCinfo() {
     static FieldElementFinfo<HHChannelF, HHGateF> gateX(
@@ -56,6 +57,9 @@ const Cinfo* HHChannelF::initCinfo() {
 }
 
 static const Cinfo* hhChannelCinfo = HHChannelF::initCinfo();
+
+static const bool hhChannelFHook = addCheckpointHook<HHChannelF>("HHChannelF");
+
 //////////////////////////////////////////////////////////////////////
 
 ///////////////////////////////////////////////////
@@ -229,6 +233,19 @@ void HHChannelF::vProcess(const Eref& e, ProcPtr info) {
     g_ = 0.0;
 }
 
+void HHChannelF::saveState(CheckpointWriter& w) const
+{
+    ChanCommon::saveState(w);
+    w.put(conc_);
+}
+
+bool HHChannelF::loadState(CheckpointReader& r)
+{
+    if (!ChanCommon::loadState(r)) return false;
+    r.get(conc_);
+    return r.good();
+}
+
 /**
  * Here we get the steady-state values for the gate (the 'instant'
  * calculation) as A_/B_.
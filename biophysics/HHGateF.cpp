@@ -20,13 +20,13 @@ const Cinfo* HHGateF::initCinfo()
         "A",
         "lookupA: Compute the A gate value from a double. "
         "This is done by evaluating the expressions for alpha/beta"
-        " or tau/inf.",
+        " or tau/inf, or by interpolating in the table if useTable is set.",
         &HHGateF::lookupA);
     static ReadOnlyLookupValueFinfo<HHGateF, double, double> B(
         "B",
         "lookupB: Look up the B gate value from a double."
         "This is done by evaluating the expressions for alpha/beta"
-        " or tau/inf.",
+        " or tau/inf, or by interpolating in the table if useTable is set.",
         &HHGateF::lookupB);
 
     static ElementValueFinfo<HHGateF, string> alpha(
@@ -82,16 +82,55 @@ const Cinfo* HHGateF::initCinfo()
         "This requires the expression for `tau` to be defined as well.",
         &HHGateF::setInf, &HHGateF::getInf);
 
+    static ElementValueFinfo<HHGateF, bool> useTable(
+        "useTable",
+        "Flag: when true, sample the expressions once onto an interpolation"
+        " table over [min, max] and look up A and B there instead of"
+        " evaluating the expressions. The table belongs to the gate, so all"
+        " copies of the channel share it. It is resampled whenever the"
+        " expressions or the range change. When false, the default, the"
+        " expressions are evaluated directly, which is slower and not"
+        " thread-safe, but exact.",
+        &HHGateF::setUseTable, &HHGateF::getUseTable);
+
+    static ElementValueFinfo<HHGateF, double> min(
+        "min", "Minimum of the input for the table. Defaults to -0.1.",
+        &HHGateF::setMin, &HHGateF::getMin);
+
+    static ElementValueFinfo<HHGateF, double> max(
+        "max", "Maximum of the input for the table. Defaults to 0.05.",
+        &HHGateF::setMax, &HHGateF::getMax);
+
+    static ElementValueFinfo<HHGateF, unsigned int> divs(
+        "divs",
+        "Divisions of the table. Zero, the default, doubles the divisions"
+        " from 100 until tableError is below 1e-4, up to 25600. Reads back"
+        " the divisions in use once the table is made.",
+        &HHGateF::setDivs, &HHGateF::getDivs);
+
+    static ReadOnlyValueFinfo<HHGateF, double> tableError(
+        "tableError",
+        "Estimate of the error of the table: the largest difference between"
+        " the table and the expressions halfway between the table points,"
+        " relative to the largest magnitude of A or B on the table."
+        " Zero when the table is not in use.",
+        &HHGateF::getTableError);
+
     ///////////////////////////////////////////////////////
     // DestFinfos
     ///////////////////////////////////////////////////////
     static Finfo* HHGateFFinfos[] = {
-        &A,      // ReadOnlyLookupValue
-        &B,      // ReadOnlyLookupValue
-        &alpha,  // Value
-        &beta,   // Value
-        &tau,    // Value
-        &inf,    // Value
+        &A,           // ReadOnlyLookupValue
+        &B,           // ReadOnlyLookupValue
+        &alpha,       // Value
+        &beta,        // Value
+        &tau,         // Value
+        &inf,         // Value
+        &useTable,    // Value
+        &min,         // Value
+        &max,         // Value
+        &divs,        // Value
+        &tableError,  // ReadOnlyValue
     };
 
     static string doc[] = {
@@ -106,7 +145,10 @@ const Cinfo* HHGateF::initCinfo()
         "computes the new value of the state variable and a scaling, "
         "depending on gate power, for the conductance. As opposed to HHGate, "
         "which uses lookup tables for speed, this evaluates explicit "
-        "expressions for accuracy. This is a single variable gate, either "
+        "expressions for accuracy. Setting `useTable` samples the "
+        "expressions onto a table shared by all copies of the channel, for "
+        "speed when the error reported in `tableError` is acceptable. "
+        "This is a single variable gate, either "
         "voltage or concentration. So the expression also allows only one "
         "indpendent variable, which is assumed `v`. See the documentation of "
         "``Function`` class for details on the praser.",
@@ -121,17 +163,38 @@ const Cinfo* HHGateF::initCinfo()
 }
 
 static const Cinfo* hhGateCinfo = HHGateF::initCinfo();
+
+const double HHGateF::tableTolerance = 1e-4;
+const unsigned int HHGateF::minAutoDivs = 100;
+const unsigned int HHGateF::maxAutoDivs = 25600;
+
 ///////////////////////////////////////////////////
 // Core class functions
 ///////////////////////////////////////////////////
-HHGateF::HHGateF() : HHGateBase(0, 0)
+HHGateF::HHGateF()
+    : HHGateBase(0, 0),
+      tauInf_(false),
+      useTable_(false),
+      xmin_(-0.1),
+      xmax_(0.05),
+      xdivs_(0),
+      tableDivs_(0),
+      invDx_(0.0),
+      tableError_(0.0)
 {
     cerr << "Warning: HHGateF::HHGateF(): this should never be called" << endl;
 }
 
 HHGateF::HHGateF(Id originalChanId, Id originalGateId)
-    : HHGateBase(originalChanId, originalGateId)
-
+    : HHGateBase(originalChanId, originalGateId),
+      tauInf_(false),
+      useTable_(false),
+      xmin_(-0.1),
+      xmax_(0.05),
+      xdivs_(0),
+      tableDivs_(0),
+      invDx_(0.0),
+      tableError_(0.0)
 {
     symTab_.add_variable("v", v_);
     symTab_.add_variable("alpha", alphav_);
@@ -163,6 +226,14 @@ HHGateF& HHGateF::operator=(const HHGateF& rhs)
     parser_.compile(alphaExpr_, alpha_);
     parser_.compile(betaExpr_, beta_);
     tauInf_ = rhs.tauInf_;
+    useTable_ = rhs.useTable_;
+    xmin_ = rhs.xmin_;
+    xmax_ = rhs.xmax_;
+    xdivs_ = rhs.xdivs_;
+    tableDivs_ = rhs.tableDivs_;
+    invDx_ = rhs.invDx_;
+    tableError_ = rhs.tableError_;
+    table_ = rhs.table_;
     return *this;
 }
 
@@ -172,6 +243,11 @@ HHGateF& HHGateF::operator=(const HHGateF& rhs)
 
 double HHGateF::lookupA(double v) const
 {
+    if(!table_.empty()) {
+        double A, B;
+        lookupTable(v, &A, &B);
+        return A;
+    }
     // TODO: check for divide by zero?
     v_ = v;
     return tauInf_ ? beta_.value() / alpha_.value() : alpha_.value();
@@ -179,6 +255,11 @@ double HHGateF::lookupA(double v) const
 
 double HHGateF::lookupB(double v) const
 {
+    if(!table_.empty()) {
+        double A, B;
+        lookupTable(v, &A, &B);
+        return B;
+    }
     // TODO: check for divide by zero?
     v_ = v;
     return tauInf_ ? 1.0 / alpha_.value() : alpha_.value() + beta_.value();
@@ -186,12 +267,131 @@ double HHGateF::lookupB(double v) const
 
 void HHGateF::lookupBoth(double v, double* A, double* B) const
 {
-    *A = lookupA(v);
-    *B = lookupB(v);
+    if(table_.empty())
+        evaluate(v, A, B);
+    else
+        lookupTable(v, A, B);
     // cerr << "# HHGateF::lookupBoth: v=" << v << ", A=" << *A << ", B="<< *B
     // << endl;
 }
 
+void HHGateF::evaluate(double v, double* A, double* B) const
+{
+    v_ = v;
+    double a = alpha_.value();
+    double b = beta_.value();
+    if(tauInf_) {
+        *A = b / a;
+        *B = 1.0 / a;
+    }
+    else {
+        *A = a;
+        *B = a + b;
+    }
+}
+
+void HHGateF::evaluateFinite(double v, double* A, double* B) const
+{
+    // Expressions like x / (exp(x) - 1) give 0/0 or rounding noise at and
+    // next to x = 0. Take the average of the two sides if the value at v
+    // is not finite or does not lie between them.
+    double h = 1e-6 * (xmax_ - xmin_);
+    double A0, B0, A1, B1;
+    evaluate(v, A, B);
+    evaluate(v - h, &A0, &B0);
+    evaluate(v + h, &A1, &B1);
+    if(!isSmooth(*A, A0, A1) || !isSmooth(*B, B0, B1)) {
+        *A = 0.5 * (A0 + A1);
+        *B = 0.5 * (B0 + B1);
+    }
+}
+
+bool HHGateF::isSmooth(double y, double y0, double y1)
+{
+    if(!std::isfinite(y))
+        return false;
+    double mid = 0.5 * (y0 + y1);
+    return fabs(y - mid) <= 1e-6 * (fabs(y0) + fabs(y1)) + fabs(y1 - y0);
+}
+
+void HHGateF::lookupTable(double v, double* A, double* B) const
+{
+    const double* p;
+    if(v <= xmin_) {
+        p = &table_[0];
+        *A = p[0];
+        *B = p[1];
+        return;
+    }
+    if(v >= xmax_) {
+        p = &table_[2 * tableDivs_];
+        *A = p[0];
+        *B = p[1];
+        return;
+    }
+    double x = (v - xmin_) * invDx_;
+    unsigned int i = static_cast<unsigned int>(x);
+    if(i >= tableDivs_)
+        i = tableDivs_ - 1;
+    double f = x - i;
+    p = &table_[2 * i];
+    *A = p[0] + (p[2] - p[0]) * f;
+    *B = p[1] + (p[3] - p[1]) * f;
+}
+
+void HHGateF::sampleTable(unsigned int divs)
+{
+    double dx = (xmax_ - xmin_) / divs;
+    tableDivs_ = divs;
+    invDx_ = 1.0 / dx;
+    table_.resize(2 * (divs + 1));
+    double scaleA = 0.0, scaleB = 0.0;
+    for(unsigned int i = 0; i <= divs; ++i) {
+        double* p = &table_[2 * i];
+        evaluateFinite(xmin_ + i * dx, p, p + 1);
+        scaleA = std::max(scaleA, fabs(p[0]));
+        scaleB = std::max(scaleB, fabs(p[1]));
+    }
+
+    // Linear interpolation is worst halfway between the points.
+    double errA = 0.0, errB = 0.0;
+    for(unsigned int i = 0; i < divs; ++i) {
+        double A, B;
+        evaluate(xmin_ + (i + 0.5) * dx, &A, &B);
+        const double* p = &table_[2 * i];
+        if(std::isfinite(A))
+            errA = std::max(errA, fabs(0.5 * (p[0] + p[2]) - A));
+        if(std::isfinite(B))
+            errB = std::max(errB, fabs(0.5 * (p[1] + p[3]) - B));
+    }
+    tableError_ = std::max(scaleA > 0.0 ? errA / scaleA : 0.0,
+                           scaleB > 0.0 ? errB / scaleB : 0.0);
+}
+
+void HHGateF::updateTable()
+{
+    table_.clear();
+    tableDivs_ = 0;
+    tableError_ = 0.0;
+    if(!useTable_ || alphaExpr_.empty() || betaExpr_.empty())
+        return;
+    if(xmax_ <= xmin_) {
+        cerr << "Error: HHGateF::updateTable: max must be greater than min."
+                " Evaluating the expressions instead.\n";
+        return;
+    }
+
+    if(xdivs_ > 0) {
+        sampleTable(xdivs_);
+        return;
+    }
+    for(unsigned int divs = minAutoDivs;; divs *= 2) {
+        sampleTable(divs);
+        if(tableError_ <= tableTolerance || divs >= maxAutoDivs)
+            break;
+    }
+}
+
 void HHGateF::setAlpha(const Eref& e, const string expr)
 {
     if(checkOriginal(e.id(), "alpha")) {
@@ -203,6 +403,7 @@ void HHGateF::setAlpha(const Eref& e, const string expr)
         tauInf_ = false;
         alphaExpr_ = expr;
         parser_.compile(alphaExpr_, alpha_);
+        updateTable();
     }
 }
 
@@ -222,6 +423,7 @@ void HHGateF::setBeta(const Eref& e, const string expr)
         tauInf_ = false;
         betaExpr_ = expr;
         parser_.compile(betaExpr_, beta_);
+        updateTable();
     }
 }
 
@@ -241,6 +443,7 @@ void HHGateF::setTau(const Eref& e, const string expr)
         tauInf_ = true;
         alphaExpr_ = expr;
         parser_.compile(alphaExpr_, alpha_);
+        updateTable();
     }
 }
 
@@ -260,6 +463,7 @@ void HHGateF::setInf(const Eref& e, const string expr)
         tauInf_ = true;
         betaExpr_ = expr;
         parser_.compile(betaExpr_, beta_);
+        updateTable();
     }
 }
 
@@ -267,3 +471,60 @@ string HHGateF::getInf(const Eref& e) const
 {
     return tauInf_ ? betaExpr_ : "";
 }
+
+void HHGateF::setUseTable(const Eref& e, bool val)
+{
+    if(checkOriginal(e.id(), "useTable")) {
+        useTable_ = val;
+        updateTable();
+    }
+}
+
+bool HHGateF::getUseTable(const Eref& e) const
+{
+    return useTable_;
+}
+
+void HHGateF::setMin(const Eref& e, double val)
+{
+    if(checkOriginal(e.id(), "min")) {
+        xmin_ = val;
+        updateTable();
+    }
+}
+
+double HHGateF::getMin(const Eref& e) const
+{
+    return xmin_;
+}
+
+void HHGateF::setMax(const Eref& e, double val)
+{
+    if(checkOriginal(e.id(), "max")) {
+        xmax_ = val;
+        updateTable();
+    }
+}
+
+double HHGateF::getMax(const Eref& e) const
+{
+    return xmax_;
+}
+
+void HHGateF::setDivs(const Eref& e, unsigned int val)
+{
+    if(checkOriginal(e.id(), "divs")) {
+        xdivs_ = val;
+        updateTable();
+    }
+}
+
+unsigned int HHGateF::getDivs(const Eref& e) const
+{
+    return table_.empty() ? xdivs_ : tableDivs_;
+}
+
+double HHGateF::getTableError() const
+{
+    return tableError_;
+}
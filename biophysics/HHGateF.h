@@ -31,11 +31,14 @@
  * pointer on the HHChannel. HHGateFs are typically shared. This means that
  * when you make a copy or a vector of an HHChannel, there is only a single
  * HHGateF created, and its pointer is used by all the copies.
- * The lookup functions are thread-safe.
  * Field assignment to the HHGateF should be possible only from the
  * original HHChannel, but all the others do have read permission.
  * Whereas HHGate uses interpolation tables, HHGateF uses direct
  * formula evaluation, hence slower but possibly more accurate.
+ * Setting useTable samples the expressions once onto an interpolation
+ * table, which is then used by every channel sharing the gate. The
+ * table lookups are thread-safe. Direct evaluation is not, because the
+ * parser reads its variables from mutable members of the gate.
  */
 
 class HHGateF : public HHGateBase {
@@ -52,6 +55,7 @@ public:
      * see if they are legal. Also tracks its own Id.
      */
     HHGateF(Id originalChanId, Id originalGateId);
+    virtual ~HHGateF() {}
     /// HHGates remain shared between copies of a channel, so it
     /// should never be copied. Yet we need to define this because
     /// eprtk parser deletes its copy assignment, which deletes
@@ -96,6 +100,18 @@ public:
     /// Set the expression for evaluating inf
     void setInf(const Eref& e, const string expr);
     string getInf(const Eref& e) const;
+    /// Switch between the table and direct evaluation
+    void setUseTable(const Eref& e, bool val);
+    bool getUseTable(const Eref& e) const;
+    /// Range and divisions of the table. Zero divs picks them by error.
+    void setMin(const Eref& e, double val);
+    double getMin(const Eref& e) const;
+    void setMax(const Eref& e, double val);
+    double getMax(const Eref& e) const;
+    void setDivs(const Eref& e, unsigned int val);
+    unsigned int getDivs(const Eref& e) const;
+    /// Largest relative error of the table against the expressions
+    double getTableError() const;
 
     /////////////////////////////////////////////////////////////////
     // Utility funcs
@@ -103,6 +119,27 @@ public:
     static const Cinfo* initCinfo();
 
 protected:
+    /// Evaluates the expressions at v, bypassing the table.
+    void evaluate(double v, double* A, double* B) const;
+    /// Evaluates at v, stepping around a point where the expressions
+    /// are not finite, such as 0/0. Used to fill tables.
+    void evaluateFinite(double v, double* A, double* B) const;
+    /// Whether y, taken between y0 and y1, is finite and lies between
+    /// them, give or take rounding.
+    static bool isSmooth(double y, double y0, double y1);
+    /// Interpolates A and B from the table.
+    void lookupTable(double v, double* A, double* B) const;
+    /// Samples the expressions onto the table, if it is in use.
+    virtual void updateTable();
+    /// Fills a table of divs divisions and measures its error.
+    void sampleTable(unsigned int divs);
+
+    /// Relative error up to which divisions are added to the table
+    static const double tableTolerance;
+    /// Bounds on the divisions picked automatically, along each input
+    static const unsigned int minAutoDivs;
+    static const unsigned int maxAutoDivs;
+
     /// Whether the gate is expressed in tau-inf form. If false, it is
     /// alpha-beta form
     bool tauInf_;
@@ -121,6 +158,19 @@ protected:
     /// Store the user-specified expression strings
     string alphaExpr_;
     string betaExpr_;
+
+    /// Whether lookups should use the table
+    bool useTable_;
+    double xmin_;
+    double xmax_;
+    /// Divisions asked for. Zero picks them by tableTolerance.
+    unsigned int xdivs_;
+    /// Divisions of the table in use
+    unsigned int tableDivs_;
+    double invDx_;
+    double tableError_;
+    /// A and B, interleaved. Empty when lookups evaluate the expressions.
+    vector<double> table_;
 };
 
 #endif  // _HHGateF_h
@@ -35,12 +35,33 @@ const Cinfo* HHGateF2D::initCinfo()
         " is the transition rate from open to closed state.",
         &HHGateF2D::lookupB);
 
+    static ElementValueFinfo<HHGateF2D, double> cmin(
+        "cmin",
+        "Minimum of the second input, `c`, for the table. Defaults to 0."
+        " The range of `v` is given by min and max.",
+        &HHGateF2D::setCmin, &HHGateF2D::getCmin);
+
+    static ElementValueFinfo<HHGateF2D, double> cmax(
+        "cmax", "Maximum of the second input, `c`, for the table. Defaults"
+        " to 1.",
+        &HHGateF2D::setCmax, &HHGateF2D::getCmax);
+
+    static ElementValueFinfo<HHGateF2D, unsigned int> cdivs(
+        "cdivs",
+        "Divisions of the table along `c`. If this or divs is zero, both"
+        " are picked together: starting from 25 each way, they are doubled"
+        " until tableError is below 1e-4, up to 400.",
+        &HHGateF2D::setCdivs, &HHGateF2D::getCdivs);
+
     ///////////////////////////////////////////////////////
     // DestFinfos
     ///////////////////////////////////////////////////////
     static Finfo* HHGateF2DFinfos[] = {
-        &A,  // ReadOnlyLookupValue
-        &B,  // ReadOnlyLookupValue
+        &A,      // ReadOnlyLookupValue
+        &B,      // ReadOnlyLookupValue
+        &cmin,   // Value
+        &cmax,   // Value
+        &cdivs,  // Value
     };
 
     static string doc[] = {
@@ -87,15 +108,25 @@ const Cinfo* HHGateF2D::initCinfo()
 }
 
 static const Cinfo* hhGate2DCinfo = HHGateF2D::initCinfo();
+
+const unsigned int HHGateF2D::minAutoDivs2D = 25;
+const unsigned int HHGateF2D::maxAutoDivs2D = 400;
+
 ///////////////////////////////////////////////////
 HHGateF2D::HHGateF2D()
+    : cmin_(0.0), cmax_(1.0), cdivs_(0), tableCdivs_(0), invDc_(0.0)
 {
     cerr << "Warning: HHGateF2D::HHGateF2D(): this should never be called"
          << endl;
 }
 
 HHGateF2D::HHGateF2D(Id originalChanId, Id originalGateId)
-    : HHGateF(originalChanId, originalGateId)
+    : HHGateF(originalChanId, originalGateId),
+      cmin_(0.0),
+      cmax_(1.0),
+      cdivs_(0),
+      tableCdivs_(0),
+      invDc_(0.0)
 {
     symTab_.add_variable("c", conc_);
     symTab_.add_variable("alpha", alphav_);
@@ -128,6 +159,19 @@ HHGateF2D& HHGateF2D::operator=(const HHGateF2D& rhs)
     parser_.compile(alphaExpr_, alpha_);
     parser_.compile(betaExpr_, beta_);
     tauInf_ = rhs.tauInf_;
+    useTable_ = rhs.useTable_;
+    xmin_ = rhs.xmin_;
+    xmax_ = rhs.xmax_;
+    xdivs_ = rhs.xdivs_;
+    tableDivs_ = rhs.tableDivs_;
+    invDx_ = rhs.invDx_;
+    tableError_ = rhs.tableError_;
+    table_ = rhs.table_;
+    cmin_ = rhs.cmin_;
+    cmax_ = rhs.cmax_;
+    cdivs_ = rhs.cdivs_;
+    tableCdivs_ = rhs.tableCdivs_;
+    invDc_ = rhs.invDc_;
     return *this;
 }
 
@@ -147,6 +191,11 @@ double HHGateF2D::lookupA(vector<double> v) const
                 "lookup 2D table. "
                 "Using only first 2.\n";
     }
+    if(!table_.empty()) {
+        double A, B;
+        lookupTable(v[0], v[1], &A, &B);
+        return A;
+    }
     v_ = v[0];
     conc_ = v[1];
     return tauInf_ ? beta_.value() / alpha_.value() : alpha_.value();
@@ -165,14 +214,187 @@ double HHGateF2D::lookupB(vector<double> v) const
                 "lookup 2D table. "
                 "Using only first 2.\n";
     }
-
+    if(!table_.empty()) {
+        double A, B;
+        lookupTable(v[0], v[1], &A, &B);
+        return B;
+    }
+    v_ = v[0];
+    conc_ = v[1];
     return tauInf_ ? 1.0 / alpha_.value() : alpha_.value() + beta_.value();
 }
 
 void HHGateF2D::lookupBoth(double v, double c, double* A, double* B) const
 {
-    *A = lookupA(vector<double>{v, c});
-    *B = lookupB(vector<double>{v, c});
+    if(table_.empty())
+        evaluate(v, c, A, B);
+    else
+        lookupTable(v, c, A, B);
     // cerr << "HHGateF2D::lookupBoth(" << v << ", " << c << ",*A=" << * A << ",
     // *B="<< * B << ")" << endl;
 }
+
+void HHGateF2D::evaluate(double v, double c, double* A, double* B) const
+{
+    v_ = v;
+    conc_ = c;
+    double a = alpha_.value();
+    double b = beta_.value();
+    if(tauInf_) {
+        *A = b / a;
+        *B = 1.0 / a;
+    }
+    else {
+        *A = a;
+        *B = a + b;
+    }
+}
+
+void HHGateF2D::evaluateFinite(double v, double c, double* A,
+                               double* B) const
+{
+    // As in HHGateF::evaluateFinite, along the diagonal of the cell.
+    double h = 1e-6 * (xmax_ - xmin_);
+    double k = 1e-6 * (cmax_ - cmin_);
+    double A0, B0, A1, B1;
+    evaluate(v, c, A, B);
+    evaluate(v - h, c - k, &A0, &B0);
+    evaluate(v + h, c + k, &A1, &B1);
+    if(!isSmooth(*A, A0, A1) || !isSmooth(*B, B0, B1)) {
+        *A = 0.5 * (A0 + A1);
+        *B = 0.5 * (B0 + B1);
+    }
+}
+
+void HHGateF2D::lookupTable(double v, double c, double* A, double* B) const
+{
+    if(v < xmin_)
+        v = xmin_;
+    else if(v > xmax_)
+        v = xmax_;
+    if(c < cmin_)
+        c = cmin_;
+    else if(c > cmax_)
+        c = cmax_;
+
+    double x = (v - xmin_) * invDx_;
+    double y = (c - cmin_) * invDc_;
+    unsigned int ix = static_cast<unsigned int>(x);
+    unsigned int iy = static_cast<unsigned int>(y);
+    if(ix >= tableDivs_)
+        ix = tableDivs_ - 1;
+    if(iy >= tableCdivs_)
+        iy = tableCdivs_ - 1;
+    double xf = x - ix;
+    double yf = y - iy;
+
+    // c varies fastest. Interpolate along v, and then along c.
+    unsigned int stride = 2 * (tableCdivs_ + 1);
+    const double* p00 = &table_[ix * stride + 2 * iy];
+    const double* p10 = p00 + stride;
+    double a = p00[0] + (p10[0] - p00[0]) * xf;
+    double b = p00[2] + (p10[2] - p00[2]) * xf;
+    *A = a + (b - a) * yf;
+    a = p00[1] + (p10[1] - p00[1]) * xf;
+    b = p00[3] + (p10[3] - p00[3]) * xf;
+    *B = a + (b - a) * yf;
+}
+
+void HHGateF2D::sampleTable(unsigned int xdivs, unsigned int cdivs)
+{
+    double dx = (xmax_ - xmin_) / xdivs;
+    double dc = (cmax_ - cmin_) / cdivs;
+    tableDivs_ = xdivs;
+    tableCdivs_ = cdivs;
+    invDx_ = 1.0 / dx;
+    invDc_ = 1.0 / dc;
+    table_.resize(2 * (xdivs + 1) * (cdivs + 1));
+    double scaleA = 0.0, scaleB = 0.0;
+    for(unsigned int ix = 0; ix <= xdivs; ++ix)
+        for(unsigned int iy = 0; iy <= cdivs; ++iy) {
+            double* p = &table_[2 * (ix * (cdivs + 1) + iy)];
+            evaluateFinite(xmin_ + ix * dx, cmin_ + iy * dc, p, p + 1);
+            scaleA = std::max(scaleA, fabs(p[0]));
+            scaleB = std::max(scaleB, fabs(p[1]));
+        }
+
+    // Bilinear interpolation is worst at the middle of each cell.
+    double errA = 0.0, errB = 0.0;
+    for(unsigned int ix = 0; ix < xdivs; ++ix)
+        for(unsigned int iy = 0; iy < cdivs; ++iy) {
+            double v = xmin_ + (ix + 0.5) * dx;
+            double c = cmin_ + (iy + 0.5) * dc;
+            double A, B, tA, tB;
+            evaluate(v, c, &A, &B);
+            lookupTable(v, c, &tA, &tB);
+            if(std::isfinite(A))
+                errA = std::max(errA, fabs(tA - A));
+            if(std::isfinite(B))
+                errB = std::max(errB, fabs(tB - B));
+        }
+    tableError_ = std::max(scaleA > 0.0 ? errA / scaleA : 0.0,
+                           scaleB > 0.0 ? errB / scaleB : 0.0);
+}
+
+void HHGateF2D::updateTable()
+{
+    table_.clear();
+    tableDivs_ = tableCdivs_ = 0;
+    tableError_ = 0.0;
+    if(!useTable_ || alphaExpr_.empty() || betaExpr_.empty())
+        return;
+    if(xmax_ <= xmin_ || cmax_ <= cmin_) {
+        cerr << "Error: HHGateF2D::updateTable: max must be greater than min,"
+                " and cmax than cmin. Evaluating the expressions instead.\n";
+        return;
+    }
+
+    if(xdivs_ > 0 && cdivs_ > 0) {
+        sampleTable(xdivs_, cdivs_);
+        return;
+    }
+    for(unsigned int divs = minAutoDivs2D;; divs *= 2) {
+        sampleTable(divs, divs);
+        if(tableError_ <= tableTolerance || divs >= maxAutoDivs2D)
+            break;
+    }
+}
+
+void HHGateF2D::setCmin(const Eref& e, double val)
+{
+    if(checkOriginal(e.id(), "cmin")) {
+        cmin_ = val;
+        updateTable();
+    }
+}
+
+double HHGateF2D::getCmin(const Eref& e) const
+{
+    return cmin_;
+}
+
+void HHGateF2D::setCmax(const Eref& e, double val)
+{
+    if(checkOriginal(e.id(), "cmax")) {
+        cmax_ = val;
+        updateTable();
+    }
+}
+
+double HHGateF2D::getCmax(const Eref& e) const
+{
+    return cmax_;
+}
+
+void HHGateF2D::setCdivs(const Eref& e, unsigned int val)
+{
+    if(checkOriginal(e.id(), "cdivs")) {
+        cdivs_ = val;
+        updateTable();
+    }
+}
+
+unsigned int HHGateF2D::getCdivs(const Eref& e) const
+{
+    return table_.empty() ? cdivs_ : tableCdivs_;
+}
@@ -30,10 +30,36 @@ public:
      * lookup
      */
     void lookupBoth(double v, double c, double* A, double* B) const;
+    /// Range and divisions of the table along c. Those along v are the
+    /// min, max and divs of HHGateF.
+    void setCmin(const Eref& e, double val);
+    double getCmin(const Eref& e) const;
+    void setCmax(const Eref& e, double val);
+    double getCmax(const Eref& e) const;
+    void setCdivs(const Eref& e, unsigned int val);
+    unsigned int getCdivs(const Eref& e) const;
     static const Cinfo* initCinfo();
 
+protected:
+    /// Samples the expressions onto the 2-D table, if it is in use.
+    void updateTable() override;
+
 private:
+    void evaluate(double v, double c, double* A, double* B) const;
+    void evaluateFinite(double v, double c, double* A, double* B) const;
+    void lookupTable(double v, double c, double* A, double* B) const;
+    void sampleTable(unsigned int xdivs, unsigned int cdivs);
+
+    /// Bounds on the divisions picked automatically, along each input
+    static const unsigned int minAutoDivs2D;
+    static const unsigned int maxAutoDivs2D;
+
     mutable double conc_;
+    double cmin_;
+    double cmax_;
+    unsigned int cdivs_;
+    unsigned int tableCdivs_;
+    double invDc_;
 };
 
 // Used by solver, readcell, etc.
@@ -10,6 +10,7 @@
 #include <queue>
 #include "../basecode/header.h"
 #include "IntFire.h"
+#include "../basecode/Checkpoint.h"
 
 static SrcFinfo1< double > *spikeOut() {
 	static SrcFinfo1< double > spikeOut(
@@ -100,6 +101,8 @@ const Cinfo* IntFire::initCinfo()
 
 static const Cinfo* intFireCinfo = IntFire::initCinfo();
 
+static const bool intFireHook = addCheckpointHook< IntFire >( "IntFire" );
+
 IntFire::IntFire()
 	: Vm_( 0.0 ), thresh_( 0.0 ), tau_( 1.0 ),
 		refractoryPeriod_( 0.1 ), lastSpike_( -0.1 ),
@@ -132,6 +135,19 @@ void IntFire::process( const Eref &e, ProcPtr p )
 	}
 }
 
+void IntFire::saveState( CheckpointWriter& w ) const
+{
+	w.put( lastSpike_ );
+	w.put( activation_ );
+}
+
+bool IntFire::loadState( CheckpointReader& r )
+{
+	r.get( lastSpike_ );
+	r.get( activation_ );
+	return r.good();
+}
+
 void IntFire::reinit( const Eref& e, ProcPtr p )
 {
 	Vm_ = 0.0;
@@ -10,6 +10,9 @@
 #ifndef _INT_FIRE_H
 #define _INT_FIRE_H
 
+class CheckpointWriter;
+class CheckpointReader;
+
 
 class IntFire
 {
@@ -45,6 +48,11 @@ class IntFire
 		void process( const Eref& e, ProcPtr p );
 		void reinit( const Eref&  e, ProcPtr p );
 
+		/// Saves and restores the last spike and the activation,
+		/// for checkpoints.
+		void saveState( CheckpointWriter& w ) const;
+		bool loadState( CheckpointReader& r );
+
 		static const Cinfo* initCinfo();
 	private:
 		double Vm_; // State variable: Membrane potential. Resting pot is 0.
@@ -30,6 +30,7 @@
 
 #include "../basecode/header.h"
 #include "IzhikevichNrn.h"
+#include "../basecode/Checkpoint.h"
 
 
 static SrcFinfo1< double >* spikeOut()
@@ -270,6 +271,9 @@ const Cinfo* IzhikevichNrn::initCinfo()
 
 static const Cinfo * IzhikevichNrnCinfo = IzhikevichNrn::initCinfo();
 
+static const bool IzhikevichNrnHook =
+    addCheckpointHook< IzhikevichNrn >( "IzhikevichNrn" );
+
 IzhikevichNrn::IzhikevichNrn():
         alpha_(40000.0), // 0.04 physiological unit
         beta_(5000.0), // 5 physiological unit
@@ -486,6 +490,25 @@ void IzhikevichNrn::process(const Eref& eref, ProcPtr proc)
     }
 }
 
+void IzhikevichNrn::saveState( CheckpointWriter& w ) const
+{
+    w.put( Vm_ );
+    w.put( u_ );
+    w.put( sum_inject_ );
+    w.put( Im_ );
+    w.put( savedVm_ );
+}
+
+bool IzhikevichNrn::loadState( CheckpointReader& r )
+{
+    r.get( Vm_ );
+    r.get( u_ );
+    r.get( sum_inject_ );
+    r.get( Im_ );
+    r.get( savedVm_ );
+    return r.good();
+}
+
 void IzhikevichNrn::reinit(const Eref& eref, ProcPtr proc)
 {
     sum_inject_ = 0.0;
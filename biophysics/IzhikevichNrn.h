@@ -32,6 +32,9 @@
 #ifndef _IZHIKEVICHNRN_H
 #define _IZHIKEVICHNRN_H
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class IzhikevichNrn
 {
   public:
@@ -90,6 +93,10 @@ class IzhikevichNrn
     void process(const Eref& eref, ProcPtr proc );
     void reinit(const Eref& eref, ProcPtr proc );
 
+    /// Saves and restores Vm, u and the summed input, for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     static const Cinfo * initCinfo();
 
 
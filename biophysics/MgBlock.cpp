@@ -11,6 +11,7 @@
 #include "ChanBase.h"
 #include "ChanCommon.h"
 #include "MgBlock.h"
+#include "../basecode/Checkpoint.h"
 
 const double EPSILON = 1.0e-12;
 
@@ -83,6 +84,8 @@ const Cinfo* MgBlock::initCinfo()
 
 static const Cinfo* MgBlockCinfo = MgBlock::initCinfo();
 
+static const bool MgBlockHook = addCheckpointHook< MgBlock >( "MgBlock" );
+
 ///////////////////////////////////////////////////
 // Constructor
 ///////////////////////////////////////////////////
@@ -160,6 +163,20 @@ void MgBlock::vProcess( const Eref& e, ProcPtr info )
 	sendProcessMsgs( e, info );
 }
 
+void MgBlock::saveState( CheckpointWriter& w ) const
+{
+	ChanCommon::saveState( w );
+	w.put( origGk_ );
+}
+
+bool MgBlock::loadState( CheckpointReader& r )
+{
+	if ( !ChanCommon::loadState( r ) )
+		return false;
+	r.get( origGk_ );
+	return r.good();
+}
+
 void MgBlock::vReinit( const Eref& e, ProcPtr info )
 {
 	Zk_ = 0;
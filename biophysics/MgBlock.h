@@ -63,6 +63,10 @@ class MgBlock: public ChanCommon
 // 		void channelFunc( double Vm );
 		void origChannel( const Eref& e, double Gk, double Ek );
 
+		/// Saves and restores Vm and the unblocked Gk, for checkpoints.
+		void saveState( CheckpointWriter& w ) const;
+		bool loadState( CheckpointReader& r );
+
 		static const Cinfo* initCinfo();
 	private:
 		/// charge
@@ -11,6 +11,7 @@
 #include "../randnum/randnum.h"
 
 #include "RandSpike.h"
+#include "../basecode/Checkpoint.h"
 
 ///////////////////////////////////////////////////////
 // MsgSrc definitions
@@ -122,6 +123,9 @@ const Cinfo* RandSpike::initCinfo()
 
 static const Cinfo* spikeGenCinfo = RandSpike::initCinfo();
 
+static const bool randSpikeHook =
+    addCheckpointHook< RandSpike >( "RandSpike" );
+
 RandSpike::RandSpike()
     :
     rate_( 0.0 ),
@@ -196,6 +200,25 @@ bool RandSpike::getDoPeriodic() const
     return doPeriodic_;
 }
 
+/**
+ * realRate_ depends on the order in which rate and refractT were set,
+ * so it goes out with the rest. The random numbers come from the global
+ * generator, which is saved on its own.
+ */
+void RandSpike::saveState( CheckpointWriter& w ) const
+{
+    w.put( lastEvent_ );
+    w.put( realRate_ );
+    w.put( fired_ );
+}
+
+bool RandSpike::loadState( CheckpointReader& r )
+{
+    r.get( lastEvent_ );
+    r.get( realRate_ );
+    r.get( fired_ );
+    return r.good();
+}
 
 //////////////////////////////////////////////////////////////////
 // RandSpike::Dest function definitions.
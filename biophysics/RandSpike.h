@@ -10,6 +10,9 @@
 #ifndef _RANDSPIKE_H
 #define _RANDSPIKE_H
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class RandSpike
 {
 public:
@@ -39,6 +42,9 @@ public:
     void process( const Eref& e, ProcPtr p );
     void reinit( const Eref& e, ProcPtr p );
 
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     //////////////////////////////////////////////////////////////////
     static const Cinfo* initCinfo();
 private:
@@ -9,6 +9,7 @@
 
 #include "../basecode/header.h"
 #include "SpikeGen.h"
+#include "../basecode/Checkpoint.h"
 
 	///////////////////////////////////////////////////////
 	// MsgSrc definitions
@@ -124,6 +125,8 @@ const Cinfo* SpikeGen::initCinfo()
 
 static const Cinfo* spikeGenCinfo = SpikeGen::initCinfo();
 
+static const bool spikeGenHook = addCheckpointHook< SpikeGen >( "SpikeGen" );
+
 SpikeGen::SpikeGen()
 	: threshold_(0.0),
       refractT_(0.0),
@@ -226,6 +229,21 @@ void SpikeGen::handleVm( double val )
 	V_ = val;
 }
 
+void SpikeGen::saveState( CheckpointWriter& w ) const
+{
+	w.put( lastEvent_ );
+	w.put( V_ );
+	w.put( fired_ );
+}
+
+bool SpikeGen::loadState( CheckpointReader& r )
+{
+	r.get( lastEvent_ );
+	r.get( V_ );
+	r.get( fired_ );
+	return r.good();
+}
+
 /////////////////////////////////////////////////////////////////////
 
 #ifdef DO_UNIT_TESTS
@@ -11,6 +11,7 @@
 #include "ChanBase.h"
 #include "ChanCommon.h"
 #include "SynChan.h"
+#include "../basecode/Checkpoint.h"
 
 const double& SynE() {
 	static const double SynE = exp(1.0);
@@ -92,6 +93,8 @@ const Cinfo* SynChan::initCinfo()
 
 static const Cinfo* synChanCinfo = SynChan::initCinfo();
 
+static const bool synChanHook = addCheckpointHook< SynChan >( "SynChan" );
+
 SynChan::SynChan()
 	:
 	tau1_( 1.0e-3 ), tau2_( 1.0e-3 ),
@@ -254,3 +257,21 @@ void SynChan::activation( double val )
 {
 	activation_ += val;
 }
+
+void SynChan::saveState( CheckpointWriter& w ) const
+{
+	ChanCommon::saveState( w );
+	w.put( X_ );
+	w.put( Y_ );
+	w.put( activation_ );
+}
+
+bool SynChan::loadState( CheckpointReader& r )
+{
+	if ( !ChanCommon::loadState( r ) )
+		return false;
+	r.get( X_ );
+	r.get( Y_ );
+	r.get( activation_ );
+	return r.good();
+}
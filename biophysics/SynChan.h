@@ -63,6 +63,10 @@ class SynChan: public ChanCommon
 		 */
 		/* void innerAddSpike( unsigned int synIndex, const double time ); */
 
+		/// Saves and restores Vm, X, Y and activation, for checkpoints.
+		void saveState( CheckpointWriter& w ) const;
+		bool loadState( CheckpointReader& r );
+
 		static const Cinfo* initCinfo();
 	protected: // Used by NMDAChan
 
@@ -48,6 +48,7 @@
 #include "../basecode/header.h"
 #include "../basecode/Dinfo.h"
 #include "VClamp.h"
+#include "../basecode/Checkpoint.h"
 
 using namespace moose;
 
@@ -193,6 +194,8 @@ const Cinfo * VClamp::initCinfo()
 
 static const Cinfo * vclampCinfo = VClamp::initCinfo();
 
+static const bool vclampHook = addCheckpointHook< VClamp >( "VClamp" );
+
 VClamp::VClamp(): vIn_(0.0), command_(0.0), current_(0.0), mode_(0), ti_(0.0), td_(-1.0),
                   Kp_(0.0),
                   tau_(0.0),
@@ -310,6 +313,33 @@ void VClamp::process(const Eref& e, ProcPtr p)
     currentOut()->send(e, current_);
 }
 
+void VClamp::saveState( CheckpointWriter& w ) const
+{
+    w.put( vIn_ );
+    w.put( command_ );
+    w.put( current_ );
+    w.put( cmdIn_ );
+    w.put( oldCmdIn_ );
+    w.put( e_ );
+    w.put( e1_ );
+    w.put( e2_ );
+    w.put( v1_ );
+}
+
+bool VClamp::loadState( CheckpointReader& r )
+{
+    r.get( vIn_ );
+    r.get( command_ );
+    r.get( current_ );
+    r.get( cmdIn_ );
+    r.get( oldCmdIn_ );
+    r.get( e_ );
+    r.get( e1_ );
+    r.get( e2_ );
+    r.get( v1_ );
+    return r.good();
+}
+
 void VClamp::reinit(const Eref& e, ProcPtr p)
 {
 
@@ -46,6 +46,9 @@
 
 #ifndef _VCLAMP_H
 #define _VCLAMP_H
+
+class CheckpointWriter;
+class CheckpointReader;
 namespace moose
 {
     class VClamp
@@ -73,6 +76,11 @@ namespace moose
         void process(const Eref& e, ProcPtr p);
         void reinit(const Eref& e, ProcPtr p);
 
+        /// Saves and restores the filtered command and the error terms,
+        /// for checkpoints.
+        void saveState( CheckpointWriter& w ) const;
+        bool loadState( CheckpointReader& r );
+
         static const Cinfo* initCinfo();
 
         // finfo used to send out injection current to compartment
@@ -10,6 +10,7 @@
 #include <queue>
 #include "../basecode/header.h"
 #include "Arith.h"
+#include "../basecode/Checkpoint.h"
 
 static SrcFinfo1< double > *output() {
 	static SrcFinfo1< double > output(
@@ -113,6 +114,8 @@ const Cinfo* Arith::initCinfo()
 
 static const Cinfo* arithCinfo = Arith::initCinfo();
 
+static const bool arithHook = addCheckpointHook< Arith >( "Arith" );
+
 Arith::Arith()
 	: function_( "sum" ),
 	output_( 0.0 ),
@@ -135,6 +138,21 @@ void Arith::process( const Eref& e, ProcPtr p )
 	arg3_ = 0.0;
 }
 
+void Arith::saveState( CheckpointWriter& w ) const
+{
+	w.put( arg1_ );
+	w.put( arg2_ );
+	w.put( arg3_ );
+}
+
+bool Arith::loadState( CheckpointReader& r )
+{
+	r.get( arg1_ );
+	r.get( arg2_ );
+	r.get( arg3_ );
+	return r.good();
+}
+
 void Arith::reinit( const Eref& e, ProcPtr p )
 {
 	// cout << "reinit: " << e.element()->getName() << ", " << e.objId() << arg3_ << endl;
@@ -9,6 +9,9 @@
 #ifndef _ARITH_H
 #define _ARITH_H
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class Arith
 {
 	friend void testCopyMsgOps();
@@ -51,6 +54,11 @@ class Arith
 		////////////////////////////////////////////////////////////////
 
 		double getArg1() const;
+
+		/// Saves and restores the arguments, for checkpoints.
+		void saveState( CheckpointWriter& w ) const;
+		bool loadState( CheckpointReader& r );
+
 		////////////////////////////////////////////////////////////////
 
 		static const Cinfo* initCinfo();
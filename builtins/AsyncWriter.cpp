@@ -0,0 +1,239 @@
+/***
+ *       Filename:  AsyncWriter.cpp
+ *
+ *    Description:  Write table data to files on a background thread.
+ *
+ *        License:  GNU GPL2
+ */
+
+#include "../basecode/global.h"
+#include "../basecode/header.h"
+#include "../utility/cnpy.hpp"
+#include "AsyncWriter.h"
+
+#include <thread>
+#include <cstdlib>
+
+const size_t AsyncWriter::blockSize = 8192;
+const size_t AsyncWriter::maxBacklog = 16 * 8192;
+const size_t AsyncWriter::maxOpenFiles = 256;
+
+struct AsyncStream
+{
+    string path;
+    bool isNpy;
+    size_t numCols;
+    bool keepOpen;          /// False if there were too many files open.
+    fstream fs;
+    vector<double> front;   /// Filled by the simulation thread.
+    vector<double> back;    /// Emptied by the writer thread.
+    bool busy;              /// True while back is queued or being written.
+    size_t numRows;         /// Rows on disk.
+    size_t headerRows;      /// Rows according to the npy header.
+};
+
+static void syncAllAtExit()
+{
+    AsyncWriter::instance().syncAll();
+}
+
+AsyncWriter& AsyncWriter::instance()
+{
+    // Never deleted: Tables may still be closing their streams while the
+    // static objects are torn down.
+    static AsyncWriter* writer = new AsyncWriter();
+    return *writer;
+}
+
+AsyncWriter::AsyncWriter() : numOpenFiles_(0)
+{
+    thread t(&AsyncWriter::run, this);
+    t.detach();
+    atexit(syncAllAtExit);
+}
+
+AsyncStream* AsyncWriter::open(const string& filepath, const string& format,
+        const vector<string>& columns)
+{
+    if(columns.empty())
+        return NULL;
+
+    AsyncStream* s = new AsyncStream();
+    s->path = filepath;
+    s->isNpy = ("npy" == format || "npz" == format);
+    if(! s->isNpy && "csv" != format && "dat" != format)
+        LOG( moose::warning, "Unsupported format " << format
+                << ". Use npy or csv. Falling back to default csv" );
+    s->numCols = columns.size();
+    s->busy = false;
+    s->numRows = 0;
+    s->headerRows = 0;
+
+    s->fs.open(filepath, fstream::in | fstream::out | fstream::trunc | fstream::binary);
+    if(! s->fs.is_open())
+    {
+        LOG( moose::warning, "Failed to open " << filepath );
+        delete s;
+        return NULL;
+    }
+
+    if(s->isNpy)
+        cnpy2::writeHeader(s->fs, columns, vector<size_t>(1, 0));
+    else
+    {
+        string headerText = "";
+        for(auto it = columns.cbegin(); it != columns.cend(); it++)
+            headerText += *it + ' ';
+        headerText += '\n';
+        s->fs << headerText;
+    }
+
+    lock_guard<mutex> lock(mutex_);
+    s->keepOpen = numOpenFiles_ < maxOpenFiles;
+    if(s->keepOpen)
+        numOpenFiles_++;
+    else
+        s->fs.close();
+    streams_.push_back(s);
+    return s;
+}
+
+void AsyncWriter::append(AsyncStream* s, const double* data, size_t n)
+{
+    s->front.insert(s->front.end(), data, data + n);
+    if(s->front.size() < blockSize)
+        return;
+
+    unique_lock<mutex> lock(mutex_);
+    // If the writer is still busy with the last block, keep filling this one
+    // for a while rather than wait.
+    if(s->busy && s->front.size() < maxBacklog)
+        return;
+    done_.wait(lock, [s] { return ! s->busy; });
+    handOver(s);
+}
+
+void AsyncWriter::append(AsyncStream* s, const vector<double>& data)
+{
+    append(s, data.data(), data.size());
+}
+
+void AsyncWriter::handOver(AsyncStream* s)
+{
+    s->back.swap(s->front);
+    s->busy = true;
+    queue_.push_back(s);
+    work_.notify_one();
+}
+
+void AsyncWriter::sync(AsyncStream* s)
+{
+    unique_lock<mutex> lock(mutex_);
+    done_.wait(lock, [s] { return ! s->busy; });
+    if(! s->front.empty())
+    {
+        handOver(s);
+        done_.wait(lock, [s] { return ! s->busy; });
+    }
+    lock.unlock();
+    finishFile(s);
+}
+
+void AsyncWriter::close(AsyncStream* s)
+{
+    sync(s);
+    lock_guard<mutex> lock(mutex_);
+    if(s->keepOpen)
+    {
+        s->fs.close();
+        numOpenFiles_--;
+    }
+    streams_.erase(find(streams_.begin(), streams_.end(), s));
+    delete s;
+}
+
+void AsyncWriter::syncAll()
+{
+    vector<AsyncStream*> streams;
+    {
+        lock_guard<mutex> lock(mutex_);
+        streams = streams_;
+    }
+    for(auto s : streams)
+        sync(s);
+}
+
+void AsyncWriter::finishFile(AsyncStream* s)
+{
+    if(! s->keepOpen)
+    {
+        if(! s->isNpy || s->numRows == s->headerRows)
+            return;
+        s->fs.open(s->path, fstream::in | fstream::out | fstream::binary);
+        if(! s->fs.is_open())
+            return;
+    }
+    if(s->isNpy && s->numRows > s->headerRows)
+    {
+        // The header was written with room for the shape to grow.
+        cnpy2::changeHeaderShape(s->fs, (s->numRows - s->headerRows) * s->numCols,
+                s->numCols);
+        s->headerRows = s->numRows;
+    }
+    s->fs.flush();
+    if(! s->keepOpen)
+        s->fs.close();
+}
+
+void AsyncWriter::writeBlock(AsyncStream* s)
+{
+    if(! s->keepOpen)
+    {
+        s->fs.open(s->path, fstream::in | fstream::out | fstream::binary);
+        if(! s->fs.is_open())
+        {
+            LOG( moose::warning, "Failed to open " << s->path );
+            s->back.clear();
+            return;
+        }
+    }
+
+    size_t numRows = s->back.size() / s->numCols;
+    s->fs.seekp(0, ios_base::end);
+    if(s->isNpy)
+        s->fs.write(reinterpret_cast<const char*>(s->back.data()),
+                sizeof(double) * numRows * s->numCols);
+    else
+    {
+        string text = "";
+        for(size_t i = 0; i < numRows * s->numCols; i += s->numCols)
+        {
+            for(size_t ii = 0; ii < s->numCols; ii++)
+                text += moose::toString(s->back[i + ii]) + ' ';
+            // At the end of each row, replace the delimiter by a newline.
+            *(text.end() - 1) = '\n';
+        }
+        s->fs << text;
+    }
+    s->numRows += numRows;
+    s->back.clear();
+
+    if(! s->keepOpen)
+        s->fs.close();
+}
+
+void AsyncWriter::run()
+{
+    unique_lock<mutex> lock(mutex_);
+    while(true)
+    {
+        work_.wait(lock, [this] { return ! queue_.empty(); });
+        AsyncStream* s = queue_.front();
+        queue_.pop_front();
+        lock.unlock();
+        writeBlock(s);
+        lock.lock();
+        s->busy = false;
+        done_.notify_all();
+    }
+}
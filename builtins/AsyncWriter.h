@@ -0,0 +1,108 @@
+/***
+ *       Filename:  AsyncWriter.h
+ *
+ *    Description:  Write table data to files on a background thread.
+ *
+ *        License:  GNU GPL2
+ */
+
+#ifndef  AsyncWriter_INC
+#define  AsyncWriter_INC
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+/// A stream of rows going to one file. Opaque outside AsyncWriter.
+struct AsyncStream;
+
+/**
+ * @brief Writes streams of rows to csv or npy files on a background thread.
+ *
+ * Table and Streamer used to open the file, write a block and close it again
+ * on every write event, and for npy files to rewrite the header shape each
+ * time, all on the simulation thread. Here each stream has two buffers. The
+ * simulation thread copies rows into the front buffer. When that is full it
+ * is swapped with the back buffer, which the writer thread then puts on
+ * disk. The file is kept open for the whole run, and the npy header shape is
+ * only fixed up on sync or close.
+ *
+ * Only one thread should call in for any one stream. Different streams may
+ * be fed from different threads. If there are too many files for them all
+ * to stay open, the rest are opened for each block, as before.
+ */
+class AsyncWriter
+{
+public:
+    /// The single writer, started on first use.
+    static AsyncWriter& instance();
+
+    /**
+     * @brief Creates the file at filepath and writes the header with the
+     * given column names.
+     *
+     * @param format npy, or csv/dat.
+     *
+     * @return The new stream, or NULL if the file could not be made.
+     */
+    AsyncStream* open(const string& filepath, const string& format,
+            const vector<string>& columns);
+
+    /**
+     * @brief Appends n values, that is n / columns.size() rows, to the
+     * stream. Only copies them into a buffer, unless the writer has fallen
+     * far behind.
+     */
+    void append(AsyncStream* s, const double* data, size_t n);
+
+    void append(AsyncStream* s, const vector<double>& data);
+
+    /**
+     * @brief Waits till everything appended so far is on disk, and makes
+     * the file complete. The stream stays open.
+     */
+    void sync(AsyncStream* s);
+
+    /// Syncs and closes the stream, and deletes it.
+    void close(AsyncStream* s);
+
+    /// Syncs all streams. Called at exit.
+    void syncAll();
+
+    /// Number of values in the front buffer before it is handed over.
+    static const size_t blockSize;
+
+    /// Number of values in the front buffer before append waits.
+    static const size_t maxBacklog;
+
+    /// Number of files kept open across writes.
+    static const size_t maxOpenFiles;
+
+private:
+    AsyncWriter();
+
+    /// Hands the front buffer over to the writer. Needs the lock.
+    void handOver(AsyncStream* s);
+
+    /// Puts the back buffer on disk. Runs on the writer thread.
+    void writeBlock(AsyncStream* s);
+
+    /// Brings the npy header up to date, and flushes the file.
+    void finishFile(AsyncStream* s);
+
+    void run();
+
+    mutex mutex_;
+    condition_variable work_;   /// Signals the writer that a block is queued.
+    condition_variable done_;   /// Signals that a block is on disk.
+    deque<AsyncStream*> queue_;
+    vector<AsyncStream*> streams_;
+    size_t numOpenFiles_;
+};
+
+#endif   /* ----- #ifndef AsyncWriter_INC  ----- */
@@ -20,6 +20,7 @@
 
 #include "Variable.h"
 #include "Function.h"
+#include "../basecode/Checkpoint.h"
 
 #include "../ksolve/RateTerm.h"
 #include "../basecode/SparseMatrix.h"
@@ -426,6 +427,8 @@ constant 'pi'.
 
 static const Cinfo * functionCinfo = Function::initCinfo();
 
+static const bool functionHook = addCheckpointHook<Function>("Function");
+
 Function::Function():
     valid_(true)
     , numVar_(0)
@@ -954,7 +957,39 @@ void Function::reinit(const Eref &e, ProcPtr p)
     }
     }
 }
-    
+
+void Function::saveState(CheckpointWriter& w) const
+{
+    w.put(t_);
+    w.put(value_);
+    w.put(lastValue_);
+    w.put(rate_);
+    vector<double> x(xs_.size());
+    for (size_t i = 0; i < xs_.size(); ++i)
+        x[i] = xs_[i]->getValue();
+    vector<double> y(ys_.size());
+    for (size_t i = 0; i < ys_.size(); ++i)
+        y[i] = *ys_[i];
+    w.putVec(x);
+    w.putVec(y);
+}
+
+bool Function::loadState(CheckpointReader& r)
+{
+    r.get(t_);
+    r.get(value_);
+    r.get(lastValue_);
+    r.get(rate_);
+    vector<double> x(xs_.size());
+    vector<double> y(ys_.size());
+    if (!r.getVecInPlace(x) || !r.getVecInPlace(y))
+        return false;
+    for (size_t i = 0; i < xs_.size(); ++i)
+        xs_[i]->setValue(x[i]);
+    for (size_t i = 0; i < ys_.size(); ++i)
+        *ys_[i] = y[i];
+    return r.good();
+}
 
 void Function::clearAll()
 {
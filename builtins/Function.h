@@ -11,6 +11,8 @@
 class Variable;
 class Eref;
 class Cinfo;
+class CheckpointWriter;
+class CheckpointReader;
 
 namespace moose { 
     class MooseParser;
@@ -92,6 +94,11 @@ public:
     void process(const Eref& e, ProcPtr p);
     void reinit(const Eref& e, ProcPtr p);
 
+    /// Saves and restores the values of the variables and the last value,
+    /// for checkpoints.
+    void saveState(CheckpointWriter& w) const;
+    bool loadState(CheckpointReader& r);
+
     // This is also used as callback.
     void addVariable(const string& name);
 
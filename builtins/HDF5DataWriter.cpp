@@ -52,8 +52,10 @@ const Cinfo * HDF5DataWriter::initCinfo()
 
     static ValueFinfo< HDF5DataWriter, unsigned int> flushLimit(
       "flushLimit",
-      "Buffer size limit for flushing the data from memory to file. Default"
-      " is 4M doubles.",
+      "Maximum number of steps to buffer in memory before the data is"
+      " written to file. The buffer is handed to a background writer"
+      " thread every flushLimit steps, or sooner so that it holds no more"
+      " than chunkSize steps and 4M values in all. Default is 4M.",
       &HDF5DataWriter::setFlushLimit,
       &HDF5DataWriter::getFlushLimit);
 
@@ -74,10 +76,10 @@ const Cinfo * HDF5DataWriter::initCinfo()
         " `get{Fieldname}` of other objects where `fieldname` is the"
         " target value field of type double. The HDF5DataWriter collects the"
         " current values of the fields in all the targets at each time step in"
-        " a local buffer. When the buffer size exceeds `flushLimit` (default"
-        " 4M), it will write the data into the HDF5 file specified in its"
-        " `filename` field (default moose_output.h5). You can explicitly force"
-        " writing by calling the `flush` function."
+        " a local buffer. When the buffer is full (see `flushLimit`), a"
+        " background thread writes the data into the HDF5 file specified in"
+        " its `filename` field (default moose_output.h5). You can explicitly"
+        " force writing by calling the `flush` function."
         "\n"
         "The dataset location in the output file replicates the MOOSE element"
         " tree structure. Thus, if you record the Vm field from"
@@ -102,7 +104,9 @@ const Cinfo * HDF5DataWriter::initCinfo()
 
 static const Cinfo * hdf5dataWriterCinfo = HDF5DataWriter::initCinfo();
 
-HDF5DataWriter::HDF5DataWriter(): flushLimit_(4*1024*1024), steps_(0)
+const size_t HDF5DataWriter::MAX_BUFFER_SIZE = 4*1024*1024;
+
+HDF5DataWriter::HDF5DataWriter(): flushLimit_(4*1024*1024), blockSteps_(1), steps_(0)
 {
 }
 
@@ -117,6 +121,13 @@ void HDF5DataWriter::close()
         return;
     }
     this->flush();
+    lock_guard< recursive_mutex > lock(hdf5Mutex());
+    for (unsigned int ii = 0; ii < datasets_.size(); ++ii){
+        if (datasets_[ii] >= 0){
+            H5Dclose(datasets_[ii]);
+        }
+    }
+    datasets_.clear();
     for (map < string, hid_t >::iterator ii = nodemap_.begin();
          ii != nodemap_.end(); ++ii){
         if (ii->second >= 0){
@@ -128,6 +139,7 @@ void HDF5DataWriter::close()
             }
         }
     }
+    nodemap_.clear();
     HDF5WriterBase::close();
 }
 
@@ -138,22 +150,57 @@ void HDF5DataWriter::flush()
                 "Filehandle invalid. Cannot write data." << endl;
         return;
     }
-
-    for (unsigned int ii = 0; ii < datasets_.size(); ++ii){
-        herr_t status = appendToDataset(datasets_[ii], data_[ii]);
-        data_[ii].clear();
-        if (status < 0){
-            cerr << "Warning: appending data for object " << src_[ii]
-                 << " returned status " << status << endl;
-        }
-    }
+    queueBuffer();
+    syncWrites();
+    lock_guard< recursive_mutex > lock(hdf5Mutex());
     HDF5WriterBase::flush();
     H5Fflush(filehandle_, H5F_SCOPE_LOCAL);
 }
 
 /**
-   Write data to datasets in HDF5 file. Clear all data in the table
-   objects associated with this object. */
+   Number of steps to buffer for numSources sources. A whole chunk
+   along time when possible, but no more than flushLimit steps or
+   MAX_BUFFER_SIZE values.
+ */
+unsigned int HDF5DataWriter::blockSteps(size_t numSources) const
+{
+    size_t steps = min(flushLimit_, chunkSize_);
+    if (numSources > 0){
+        steps = min(steps, MAX_BUFFER_SIZE / numSources);
+    }
+    return max< size_t >(steps, 1);
+}
+
+/**
+   Hand the buffered steps over to the writer thread, which appends
+   each source's values to its dataset. */
+void HDF5DataWriter::queueBuffer()
+{
+    if (steps_ == 0 || datasets_.empty()){
+        return;
+    }
+    vector< double > block(buffer_.size());
+    block.swap(buffer_);
+    hsize_t width = blockSteps_;
+    hsize_t steps = steps_;
+    vector< hid_t > datasets = datasets_;
+    vector< ObjId > src = src_;
+    queueWrite([datasets, src, width, steps, block = std::move(block)]() {
+        for (unsigned int ii = 0; ii < datasets.size(); ++ii){
+            herr_t status = appendToDataset(datasets[ii],
+                                            &block[ii * width], steps);
+            if (status < 0){
+                cerr << "Warning: appending data for object " << src[ii]
+                     << " returned status " << status << endl;
+            }
+        }
+    });
+    steps_ = 0;
+}
+
+/**
+   Collect the values of all sources in the buffer, and hand it over
+   to the writer thread when full. */
 void HDF5DataWriter::process(const Eref & e, ProcPtr p)
 {
     if (filehandle_ < 0){
@@ -162,29 +209,26 @@ void HDF5DataWriter::process(const Eref & e, ProcPtr p)
 
     vector <double> dataBuf;
         requestOut()->send(e, &dataBuf);
-    for (unsigned int ii = 0; ii < dataBuf.size(); ++ii){
-        data_[ii].push_back(dataBuf[ii]);
+    unsigned int numSrc = min(dataBuf.size(), datasets_.size());
+    for (unsigned int ii = 0; ii < numSrc; ++ii){
+        buffer_[ii * blockSteps_ + steps_] = dataBuf[ii];
     }
     ++steps_;
-    if (steps_ >= flushLimit_){
-        steps_ = 0;
-        for (unsigned int ii = 0; ii < datasets_.size(); ++ii){
-            herr_t status = appendToDataset(datasets_[ii], data_[ii]);
-            data_[ii].clear();
-            if (status < 0){
-                cerr << "Warning: appending data for object " << src_[ii]
-                     << " returned status " << status << endl;
-            }
-        }
+    if (steps_ >= blockSteps_){
+        queueBuffer();
     }
 }
 
 void HDF5DataWriter::reinit(const Eref & e, ProcPtr p)
 {
-    steps_ = 0;
-    for (unsigned int ii = 0; ii < data_.size(); ++ii){
-        H5Dclose(datasets_[ii]);
+    // TODO: what to do when reinit is called? Close the existing file
+    // and open a new one in append mode? Or keep adding to the
+    // current file?
+    if (filehandle_ >= 0 ){
+        close();
     }
+    steps_ = 0;
+    buffer_.clear();
     data_.clear();
     src_.clear();
     func_.clear();
@@ -194,18 +238,13 @@ void HDF5DataWriter::reinit(const Eref & e, ProcPtr p)
                                                                 src_,
                                                                 func_);
     assert(numTgt ==  src_.size());
-    // TODO: what to do when reinit is called? Close the existing file
-    // and open a new one in append mode? Or keep adding to the
-    // current file?
     if (filename_.empty()){
         filename_ = "moose_data.h5";
     }
-    if (filehandle_ > 0 ){
-        close();
-    }
     if (numTgt == 0){
         return;
     }
+    lock_guard< recursive_mutex > lock(hdf5Mutex());
     openFile();
     for (unsigned int ii = 0; ii < src_.size(); ++ii){
         string varname = func_[ii];
@@ -227,7 +266,8 @@ void HDF5DataWriter::reinit(const Eref & e, ProcPtr p)
         hid_t dataset_id = getDataset(path);
         datasets_.push_back(dataset_id);
     }
-    data_.resize(src_.size());
+    blockSteps_ = blockSteps(src_.size());
+    buffer_.assign(src_.size() * blockSteps_, 0.0);
 }
 
 /**
@@ -288,6 +328,9 @@ hid_t HDF5DataWriter::getDataset(string path)
              << exists << " for path \""
              << path << "\"" << endl;
     }
+    if (prev_id >= 0 && prev_id != filehandle_){
+        H5Gclose(prev_id);
+    }
     return dataset_id;
 }
 
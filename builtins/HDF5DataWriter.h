@@ -42,6 +42,7 @@
 class HDF5DataWriter: public HDF5WriterBase
 {
   public:
+    static const size_t MAX_BUFFER_SIZE;
     HDF5DataWriter();
     virtual ~HDF5DataWriter();
     void setFlushLimit(unsigned int limit);
@@ -57,11 +58,17 @@ class HDF5DataWriter: public HDF5WriterBase
     // Maps the paths of data sources to vectors storing the data
     // locally
     vector <ObjId> src_;
-    vector <vector < double > > data_;
+    vector <vector < double > > data_; // Only used by NSDFWriter.
+    // Values of all sources for blockSteps_ steps, stored source by
+    // source so that each goes to its dataset in one piece.
+    vector < double > buffer_;
+    unsigned int blockSteps_;
     vector <string> func_;
     vector <hid_t> datasets_;
     unsigned long steps_;
     hid_t getDataset(string path);
+    unsigned int blockSteps(size_t numSources) const;
+    void queueBuffer();
 };
 #endif // _HDF5DATAWRITER_H
 #endif // USE_HDF5
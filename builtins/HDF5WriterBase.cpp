@@ -33,6 +33,9 @@
 #include <algorithm>
 #include <string>
 #include <fstream>
+#include <deque>
+#include <thread>
+#include <condition_variable>
 
 #include "hdf5.h"
 
@@ -130,7 +133,7 @@ hid_t HDF5WriterBase::createDoubleDataset(hid_t parent_id, std::string name, hsi
     hid_t chunk_params = H5Pcreate(H5P_DATASET_CREATE);
     status = H5Pset_chunk(chunk_params, 1, chunk_dims);
     assert( status >= 0 );
-    if (compressor_ == "zlib"){
+    if (compressor_ == "zlib" && compression_ > 0){
         status = H5Pset_deflate(chunk_params, compression_);
     } else if (compressor_ == "szip"){
         // this needs more study
@@ -164,7 +167,7 @@ hid_t HDF5WriterBase::createStringDataset(hid_t parent_id, string name, hsize_t
     hid_t chunk_params = H5Pcreate(H5P_DATASET_CREATE);
     status = H5Pset_chunk(chunk_params, 1, chunk_dims);
     assert( status >= 0 );
-    if (compressor_ == "zlib"){
+    if (compressor_ == "zlib" && compression_ > 0){
         status = H5Pset_deflate(chunk_params, compression_);
     } else if (compressor_ == "szip"){
         // this needs more study
@@ -187,51 +190,108 @@ hid_t HDF5WriterBase::createStringDataset(hid_t parent_id, string name, hsize_t
    Append a vector to a specified dataset and return the error status
    of the write operation. */
 herr_t HDF5WriterBase::appendToDataset(hid_t dataset_id, const vector< double >& data)
+{
+    return appendToDataset(dataset_id, data.data(), data.size());
+}
+
+herr_t HDF5WriterBase::appendToDataset(hid_t dataset_id, const double* data, hsize_t size)
 {
     herr_t status;
     if (dataset_id < 0){
         return -1;
     }
+    if (size == 0){
+        return 0;
+    }
     hid_t filespace = H5Dget_space(dataset_id);
     if (filespace < 0){
         return -1;
     }
-    if (data.size() == 0){
+    hsize_t start = H5Sget_simple_extent_npoints(filespace);
+    H5Sclose(filespace);
+    hsize_t newsize = start + size;
+    status = H5Dset_extent(dataset_id, &newsize);
+    if (status < 0){
+        return status;
+    }
+    filespace = H5Dget_space(dataset_id);
+    hid_t memspace = H5Screate_simple(1, &size, NULL);
+    H5Sselect_hyperslab(filespace, H5S_SELECT_SET, &start, NULL,
+                        &size, NULL);
+    status = H5Dwrite(dataset_id, H5T_NATIVE_DOUBLE, memspace, filespace,
+                      H5P_DEFAULT, data);
+    H5Sclose(memspace);
+    H5Sclose(filespace);
+    return status;
+}
+
+/**
+   Append `steps` columns to a 2D dataset of rows x time in a single
+   write. `data` holds `width` values per row, of which the first
+   `steps` are filled.
+ */
+herr_t HDF5WriterBase::appendToDataset2D(hid_t dataset_id, const double* data,
+                                         hsize_t rows, hsize_t width, hsize_t steps)
+{
+    if (dataset_id < 0){
+        return -1;
+    }
+    if (rows == 0 || steps == 0){
         return 0;
     }
-    hsize_t size = H5Sget_simple_extent_npoints(filespace) + data.size();
-    status = H5Dset_extent(dataset_id, &size);
+    hid_t filespace = H5Dget_space(dataset_id);
+    if (filespace < 0){
+        return -1;
+    }
+    hsize_t dims[2];
+    herr_t status = H5Sget_simple_extent_dims(filespace, dims, NULL);
+    H5Sclose(filespace);
+    if (status < 0 || dims[0] != rows){
+        return -1;
+    }
+    hsize_t newdims[2] = {rows, dims[1] + steps};
+    status = H5Dset_extent(dataset_id, newdims);
     if (status < 0){
         return status;
     }
     filespace = H5Dget_space(dataset_id);
-    hsize_t size_increment = data.size();
-    hid_t memspace = H5Screate_simple(1, &size_increment, NULL);
-    hsize_t start = size - data.size();
-    H5Sselect_hyperslab(filespace, H5S_SELECT_SET, &start, NULL,
-                        &size_increment, NULL);
+    hsize_t start[2] = {0, dims[1]};
+    hsize_t count[2] = {rows, steps};
+    H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, NULL, count, NULL);
+    hsize_t memdims[2] = {rows, width};
+    hid_t memspace = H5Screate_simple(2, memdims, NULL);
+    hsize_t memstart[2] = {0, 0};
+    H5Sselect_hyperslab(memspace, H5S_SELECT_SET, memstart, NULL, count, NULL);
     status = H5Dwrite(dataset_id, H5T_NATIVE_DOUBLE, memspace, filespace,
-                      H5P_DEFAULT, &data[0]);
+                      H5P_DEFAULT, data);
+    H5Sclose(memspace);
+    H5Sclose(filespace);
     return status;
 }
 
 
 /**
    Create a 2D dataset under parent with name. It will have specified
-   number of rows and unlimited columns.
+   number of rows and unlimited columns. Chunks are `steps` columns
+   wide (chunkSize if 0) and have as many rows as fit in
+   MAX_CHUNK_VALUES, so a write of `steps` columns fills whole chunks.
  */
-hid_t HDF5WriterBase::createDataset2D(hid_t parent, string name, unsigned int rows)
+hid_t HDF5WriterBase::createDataset2D(hid_t parent, string name, unsigned int rows, hsize_t steps)
 {
     if (parent < 0){
         return 0;
     }
     herr_t status;
     // we need chunking here to allow extensibility
-    hsize_t chunkdims[] = {rows, chunkSize_};
+    if (steps == 0){
+        steps = chunkSize_;
+    }
+    hsize_t chunkRows = std::max< hsize_t >(1, MAX_CHUNK_VALUES / steps);
+    hsize_t chunkdims[] = {std::max< hsize_t >(1, std::min< hsize_t >(rows, chunkRows)), steps};
     hid_t chunk_params = H5Pcreate(H5P_DATASET_CREATE);
     status = H5Pset_chunk(chunk_params, 2, chunkdims);
     assert(status >= 0);
-    if (compressor_ == "zlib"){
+    if (compressor_ == "zlib" && compression_ > 0){
         status = H5Pset_deflate(chunk_params, compression_);
     } else if (compressor_ == "szip"){
         // this needs more study
@@ -248,6 +308,101 @@ hid_t HDF5WriterBase::createDataset2D(hid_t parent, string name, unsigned int ro
     return dset;
 }
 
+////////////////////////////////////////////////////////////
+// Background writes
+////////////////////////////////////////////////////////////
+
+/**
+   Jobs waiting for the writer thread. A job is only taken off the
+   queue by a thread holding hdf5Mutex(), so once a thread holds it, no
+   job is half done.
+ */
+struct WriteQueue
+{
+    mutex lock;
+    condition_variable work;
+    deque< function< void() > > jobs;
+};
+
+static WriteQueue& writeQueue()
+{
+    // Never deleted: writers may still be closing at exit.
+    static WriteQueue* queue = new WriteQueue();
+    return *queue;
+}
+
+recursive_mutex& HDF5WriterBase::hdf5Mutex()
+{
+    static recursive_mutex* h5mutex = new recursive_mutex();
+    return *h5mutex;
+}
+
+static void runWrites()
+{
+    WriteQueue& queue = writeQueue();
+    while (true){
+        {
+            unique_lock< mutex > lock(queue.lock);
+            queue.work.wait(lock, [&queue] { return !queue.jobs.empty(); });
+        }
+        lock_guard< recursive_mutex > h5lock(HDF5WriterBase::hdf5Mutex());
+        function< void() > job;
+        {
+            lock_guard< mutex > lock(queue.lock);
+            if (queue.jobs.empty()){
+                continue; // run by syncWrites meanwhile
+            }
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        job();
+    }
+}
+
+static bool startWriter()
+{
+    thread writer(runWrites);
+    writer.detach();
+    atexit(HDF5WriterBase::syncWrites);
+    return true;
+}
+
+void HDF5WriterBase::queueWrite(function< void() > job)
+{
+    static bool started = startWriter();
+    (void)started;
+    WriteQueue& queue = writeQueue();
+    size_t numQueued;
+    {
+        lock_guard< mutex > lock(queue.lock);
+        queue.jobs.push_back(std::move(job));
+        numQueued = queue.jobs.size();
+    }
+    queue.work.notify_one();
+    // Do not let the buffers pile up if the disk cannot keep pace.
+    if (numQueued > MAX_QUEUED_WRITES){
+        syncWrites();
+    }
+}
+
+void HDF5WriterBase::syncWrites()
+{
+    WriteQueue& queue = writeQueue();
+    lock_guard< recursive_mutex > h5lock(hdf5Mutex());
+    while (true){
+        function< void() > job;
+        {
+            lock_guard< mutex > lock(queue.lock);
+            if (queue.jobs.empty()){
+                return;
+            }
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        job();
+    }
+}
+
 /**
    Iterate through the path->value map of scalar attributes of type
    `A` and write to HDF5 file handle `file_id`.
@@ -429,10 +584,19 @@ const Cinfo* HDF5WriterBase::initCinfo()
 
   static ValueFinfo< HDF5WriterBase, unsigned int> compression(
       "compression",
-      "Compression level for array data. Defaults to 6.",
+      "Compression level for array data. 0 disables compression. Defaults to 6.",
       &HDF5WriterBase::setCompression,
       &HDF5WriterBase::getCompression);
 
+  static ValueFinfo< HDF5WriterBase, unsigned int> chunkCacheSize(
+      "chunkCacheSize",
+      "Size in bytes of the chunk cache of each dataset. Data is normally"
+      " written a whole chunk at a time, but an explicit flush leaves partly"
+      " filled chunks, which stay in the cache if it is big enough. 0 keeps"
+      " the HDF5 default of 1 MB. Defaults to 0.",
+      &HDF5WriterBase::setChunkCacheSize,
+      &HDF5WriterBase::getChunkCacheSize);
+
   static LookupValueFinfo< HDF5WriterBase, string, string  > sattr(
       "stringAttr",
       "String attributes. The key is attribute name, value is attribute value"
@@ -491,6 +655,7 @@ const Cinfo* HDF5WriterBase::initCinfo()
     &chunkSize,
     &compressor,
     &compression,
+    &chunkCacheSize,
     &sattr,
     &dattr,
     &lattr,
@@ -522,6 +687,8 @@ const Cinfo* HDF5WriterBase::initCinfo()
 }
 
 const hssize_t HDF5WriterBase::CHUNK_SIZE = 1024; // default chunk size
+const hsize_t HDF5WriterBase::MAX_CHUNK_VALUES = 128 * 1024; // 1 MB of doubles
+const size_t HDF5WriterBase::MAX_QUEUED_WRITES = 4;
 
 
 HDF5WriterBase::HDF5WriterBase():
@@ -530,7 +697,8 @@ HDF5WriterBase::HDF5WriterBase():
         openmode_(H5F_ACC_EXCL),
         chunkSize_(CHUNK_SIZE),
         compressor_("zlib"),
-        compression_(6)
+        compression_(6),
+        chunkCacheSize_(0)
 {
 }
 
@@ -570,6 +738,7 @@ bool HDF5WriterBase::isOpen() const
 
 herr_t HDF5WriterBase::openFile()
 {
+    lock_guard< recursive_mutex > lock(hdf5Mutex());
     herr_t status = 0;
     if (filehandle_ >= 0){
         cout << "Warning: closing already open file and opening " << filename_ <<  endl;
@@ -583,6 +752,11 @@ herr_t HDF5WriterBase::openFile()
     hid_t fapl_id = H5Pcreate(H5P_FILE_ACCESS);
     // Ensure that all open objects are closed before the file is closed
     H5Pset_fclose_degree(fapl_id, H5F_CLOSE_STRONG);
+    if (chunkCacheSize_ > 0){
+        // Default chunk cache for all datasets in the file. Chunks that
+        // have been written in full are evicted first.
+        H5Pset_cache(fapl_id, 0, 12421, chunkCacheSize_, 1.0);
+    }
     ifstream infile(filename_.c_str());
     bool fexists = infile.good();
     infile.close();
@@ -595,8 +769,10 @@ herr_t HDF5WriterBase::openFile()
              << " for appending to it, mode=" << H5F_ACC_TRUNC
              << " for overwriting it. mode=" << H5F_ACC_EXCL
              << " requires the file does not exist." << endl;
+        H5Pclose(fapl_id);
         return -1;
     }
+    H5Pclose(fapl_id);
     if (filehandle_ < 0){
         cerr << "Error: Could not open file for writing: " << filename_ << endl;
         status = -1;
@@ -647,6 +823,16 @@ unsigned int HDF5WriterBase::getCompression() const
     return compression_;
 }
 
+void HDF5WriterBase::setChunkCacheSize(unsigned int bytes)
+{
+    chunkCacheSize_ = bytes;
+}
+
+unsigned int HDF5WriterBase::getChunkCacheSize() const
+{
+    return chunkCacheSize_;
+}
+
 
 // Subclasses should reimplement this for flushing data content to
 // file.
@@ -666,6 +852,7 @@ void HDF5WriterBase::flushAttributes()
     if (filehandle_ < 0){
         return;
     }
+    lock_guard< recursive_mutex > lock(hdf5Mutex());
     // Write all scalar attributes
     writeScalarAttributesFromMap< string >(filehandle_, sattr_);
     writeScalarAttributesFromMap< double >(filehandle_, dattr_);
@@ -682,6 +869,8 @@ void HDF5WriterBase::close()
         return;
     }
     flush();
+    syncWrites();
+    lock_guard< recursive_mutex > lock(hdf5Mutex());
     herr_t status = H5Fclose(filehandle_);
     filehandle_ = -1;
     if (status < 0){
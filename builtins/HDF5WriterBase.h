@@ -32,6 +32,8 @@
 #ifndef _HDF5IO_H
 #define _HDF5IO_H
 #include <typeinfo>
+#include <functional>
+#include <mutex>
 
 hid_t require_attribute(hid_t file_id, string path,
                         hid_t data_type, hid_t data_id);
@@ -42,6 +44,8 @@ class HDF5WriterBase
 {
   public:
     static const hssize_t CHUNK_SIZE;
+    static const hsize_t MAX_CHUNK_VALUES;
+    static const size_t MAX_QUEUED_WRITES;
     HDF5WriterBase();
     virtual ~HDF5WriterBase();
     void setFilename(string filename);
@@ -55,6 +59,8 @@ class HDF5WriterBase
     string getCompressor() const;
     void setCompression(unsigned int level);
     unsigned int getCompression() const;
+    void setChunkCacheSize(unsigned int bytes);
+    unsigned int getChunkCacheSize() const;
     void setStringAttr(string name, string value);
     void setDoubleAttr(string name, double value);
     void setLongAttr(string name, long value);
@@ -75,16 +81,30 @@ class HDF5WriterBase
 
     static const Cinfo* initCinfo();
 
+    /// Held around all calls into the HDF5 library, which need not be
+    /// thread safe.
+    static std::recursive_mutex& hdf5Mutex();
+    /// Run all jobs queued for the writer thread to completion.
+    static void syncWrites();
+
   protected:
     friend void testCreateStringDataset();
+    friend void testAppendToDataset2D();
+
+    /// Run job on the background writer thread, after all jobs queued
+    /// before it. The job must own the data it writes.
+    static void queueWrite(std::function< void() > job);
 
     herr_t openFile();
     // C++ sucks - does not allow template specialization inside class
     hid_t createDoubleDataset(hid_t parent, std::string name, hsize_t size=0, hsize_t maxsize=H5S_UNLIMITED);
     hid_t createStringDataset(hid_t parent, std::string name, hsize_t size=0, hsize_t maxsize=H5S_UNLIMITED);
 
-    herr_t appendToDataset(hid_t dataset, const vector<double>& data);
-    hid_t createDataset2D(hid_t parent, string name, unsigned int rows);
+    static herr_t appendToDataset(hid_t dataset, const vector<double>& data);
+    static herr_t appendToDataset(hid_t dataset, const double* data, hsize_t size);
+    static herr_t appendToDataset2D(hid_t dataset, const double* data,
+                                    hsize_t rows, hsize_t width, hsize_t steps);
+    hid_t createDataset2D(hid_t parent, string name, unsigned int rows, hsize_t steps=0);
 
     /// map from element path to nodes in hdf5file.  Multiple MOOSE
     /// tables can be written to the single file corresponding to a
@@ -106,6 +126,7 @@ class HDF5WriterBase
     unsigned int chunkSize_;
     string compressor_; // can be zlib or szip
     unsigned int compression_;
+    unsigned int chunkCacheSize_; // bytes, 0 for the HDF5 default
 
 };
 
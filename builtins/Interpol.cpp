@@ -49,6 +49,7 @@
 #include "../utility/numutil.h"
 #include "TableBase.h"
 #include "Interpol.h"
+#include "../basecode/Checkpoint.h"
 
 
 static SrcFinfo1< double >* lookupOut()
@@ -145,6 +146,8 @@ const Cinfo * Interpol::initCinfo()
 
 static const Cinfo * interpolCinfo = Interpol::initCinfo();
 
+static const bool interpolHook = addCheckpointHook< Interpol >( "Interpol" );
+
 Interpol::Interpol(): xmin_(0.0), xmax_(1.0)
 {
 }
@@ -197,6 +200,19 @@ void Interpol::process( const Eref& e, ProcPtr p )
     lookupOut()->send( e, y_ );
 }
 
+void Interpol::saveState( CheckpointWriter& w ) const
+{
+    w.put( x_ );
+    w.put( y_ );
+}
+
+bool Interpol::loadState( CheckpointReader& r )
+{
+    r.get( x_ );
+    r.get( y_ );
+    return r.good();
+}
+
 void Interpol::reinit( const Eref& e, ProcPtr p )
 {
     x_ = 0.0;
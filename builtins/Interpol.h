@@ -48,6 +48,9 @@
 #ifndef _INTERPOL_H
 #define _INTERPOL_H
 
+class CheckpointWriter;
+class CheckpointReader;
+
 /**
  * 1 Dimensional table, with interpolation. The internal vector is
  * accessed like this: table_[ xIndex ] with the x-coordinate used as
@@ -75,6 +78,10 @@ class Interpol: public TableBase
     void reinit( const Eref& e, ProcPtr p );
 
 
+    /// Saves and restores the input and output, for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     static const Cinfo* initCinfo();
     static const unsigned int MAX_DIVS;
   protected:
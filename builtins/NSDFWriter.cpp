@@ -175,6 +175,7 @@ void NSDFWriter::close()
         return;
     }
     flush();
+    lock_guard< recursive_mutex > lock(hdf5Mutex());
     closeUniformData();
     if (uniformGroup_ >= 0){
         H5Gclose(uniformGroup_);
@@ -475,6 +476,7 @@ hid_t NSDFWriter::getEventDataset(string srcPath, string srcField)
 
 void NSDFWriter::flush()
 {
+    lock_guard< recursive_mutex > lock(hdf5Mutex());
     // We need to update the tend on each write since we do not know
     // when the simulation is getting over and when it is just paused.
     writeScalarAttr<string>(filehandle_, "tend", iso_time(NULL));
@@ -545,6 +547,7 @@ void NSDFWriter::reinit(const Eref& eref, const ProcPtr proc)
     if (filename_.empty()){
         filename_ = "moose_data.nsdf.h5";
     }
+    lock_guard< recursive_mutex > lock(hdf5Mutex());
     openFile();
     writeScalarAttr<string>(filehandle_, "created", iso_time(0));
     writeScalarAttr<string>(filehandle_, "tstart", iso_time(0));
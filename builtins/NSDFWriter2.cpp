@@ -189,6 +189,7 @@ void NSDFWriter2::close()
         return;
     }
     flush();
+    lock_guard< recursive_mutex > lock(hdf5Mutex());
     closeUniformData();
     if (uniformGroup_ >= 0){
         H5Gclose(uniformGroup_);
@@ -214,6 +215,7 @@ void NSDFWriter2::closeUniformData()
 	for ( vector< Block >::iterator ii = blocks_.begin(); ii != blocks_.end(); ++ii ) {
 		if ( ii->dataset >= 0 ) {
 			H5Dclose( ii->dataset );
+			ii->dataset = -1;
 		}
 		/**
 		ii->hasMsg = false;
@@ -299,7 +301,7 @@ void NSDFWriter2::openUniformData(const Eref &eref)
 		// So I need to replace path with a string with the slashes
         bb->container = require_group(uniformGroup_, bb->nsdfContainerPath);
         bb->relPathContainer = require_group(bb->container,bb->nsdfRelPath);
-       	hid_t dataset = createDataset2D(bb->relPathContainer, bb->field.c_str(), bb->data.size());
+       	hid_t dataset = createDataset2D(bb->relPathContainer, bb->field.c_str(), bb->objVec.size(), blockSteps_);
 		bb->dataset = dataset;
        	writeScalarAttr<string>(dataset, "field", bb->field);
        	H5Gclose(bb->container);
@@ -370,7 +372,9 @@ void NSDFWriter2::innerCreateMaps( const char* const mapSrcStr )
 		*/
         status = H5Dclose(ds);
         status = H5Tclose(memtype);
+        status = H5Gclose(container);
     }
+    H5Gclose(uniformMapContainer);
 }
 
 void NSDFWriter2::closeEventData()
@@ -385,6 +389,10 @@ void NSDFWriter2::closeEventData()
     eventDatasets_.clear();
     eventSrc_.clear();
     eventSrcFields_.clear();
+    // The datasets in these were closed above.
+    eventSrcDataset_.clear();
+    classFieldToEvent_.clear();
+    classFieldToEventSrc_.clear();
 }
 
 /**
@@ -477,7 +485,9 @@ void NSDFWriter2::createEventMap()
         status = H5Tclose(ftype);
         status = H5Tclose(memtype);
         status = H5Dclose(ds);
+        status = H5Gclose(classGroup);
     }
+    H5Gclose(eventMapContainer);
 }
 
 /**
@@ -504,6 +514,7 @@ hid_t NSDFWriter2::getEventDataset(string srcPath, string srcField)
     stringstream dsetname;
     dsetname << source.id.value() <<"_" << source.dataIndex << "_" << source.fieldIndex;
     hid_t dataset = createDoubleDataset(container, dsetname.str().c_str());
+    H5Gclose(container);
     classFieldToEvent_[className + "/" + srcField].push_back(dataset);
     classFieldToEventSrc_[className + "/" + srcField].push_back(srcPath);
     status = writeScalarAttr<string>(dataset, "source", srcPath);
@@ -514,60 +525,58 @@ hid_t NSDFWriter2::getEventDataset(string srcPath, string srcField)
     return dataset;
 }
 
-void NSDFWriter2::flush()
+/**
+   Hand the buffered uniform data and event times over to the writer
+   thread. Each block goes into its 2D dataset in a single write.
+ */
+void NSDFWriter2::queueBlocks()
 {
-    // We need to update the tend on each write since we do not know
-    // when the simulation is getting over and when it is just paused.
-    writeScalarAttr<string>(filehandle_, "tend", iso_time(NULL));
-
-    // append all uniform data
+    if (filehandle_ < 0){
+        return;
+    }
+    vector< hid_t > blockDatasets;
+    vector< vector< double > > blockData;
 	for ( vector< Block >::iterator bit = blocks_.begin(); (steps_ > 0) && (bit != blocks_.end()); bit++ ) {
-		assert( steps_ == bit->data[0].size() );
-        double* buffer = (double*)calloc(bit->data.size() * steps_, sizeof(double));
-        for (unsigned int ii = 0; ii < bit->data.size(); ++ii){
-            for (unsigned int jj = 0; jj < steps_; ++jj){
-                buffer[ii * steps_ + jj] = bit->data[ii][jj];
+        blockDatasets.push_back(bit->dataset);
+        blockData.push_back(vector< double >(bit->data.size()));
+        blockData.back().swap(bit->data);
+    }
+    vector< hid_t > eventDatasets;
+    vector< vector< double > > eventData;
+    for (unsigned int ii = 0; ii < eventSrc_.size(); ++ii){
+        if (events_[ii].size() > 0){
+            eventDatasets.push_back(eventDatasets_[ii]);
+            eventData.push_back(vector< double >());
+            eventData.back().swap(events_[ii]);
+        }
+    }
+    hid_t file = filehandle_;
+    hsize_t width = blockSteps_;
+    hsize_t steps = steps_;
+    queueWrite([file, width, steps, blockDatasets, eventDatasets,
+                blockData = std::move(blockData),
+                eventData = std::move(eventData)]() {
+        // We need to update the tend on each write since we do not know
+        // when the simulation is getting over and when it is just paused.
+        writeScalarAttr<string>(file, "tend", iso_time(NULL));
+        for (unsigned int ii = 0; ii < blockDatasets.size(); ++ii){
+            herr_t status = appendToDataset2D(blockDatasets[ii],
+                    blockData[ii].data(), blockData[ii].size() / width,
+                    width, steps);
+            if (status < 0){
+                cout << "Error: NSDFWriter2::flush(): Failed to write data\n";
             }
-            bit->data[ii].clear();
         }
-        hid_t filespace = H5Dget_space(bit->dataset);
-        if (filespace < 0){
-			cout << "Error: NSDFWriter2::flush(): Failed to open filespace\n";
-            break;
+        for (unsigned int ii = 0; ii < eventDatasets.size(); ++ii){
+            appendToDataset(eventDatasets[ii], eventData[ii]);
         }
-        hsize_t dims[2];
-        hsize_t maxdims[2];
-        // retrieve current datset dimensions
-        herr_t status = H5Sget_simple_extent_dims(filespace, dims, maxdims);
-        hsize_t newdims[] = {dims[0], dims[1] + steps_}; // new column count
-        status = H5Dset_extent(bit->dataset, newdims); // extend dataset to new column count
-		if ( status < 0 ) {
-			cout << "Error: NSDFWriter2::flush(): Fail to extend dataset\n";
-            break;
-		}
-        H5Sclose(filespace);
-        filespace = H5Dget_space(bit->dataset); // get the updated filespace
-        hsize_t start[2] = {0, dims[1]};
-        dims[1] = steps_; // change dims for memspace & hyperslab
-        hid_t memspace = H5Screate_simple(2, dims, NULL);
-        H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, NULL, dims, NULL);
-        status = H5Dwrite(bit->dataset, H5T_NATIVE_DOUBLE,  memspace, filespace, H5P_DEFAULT, buffer);
-		if ( status < 0 ) {
-			cout << "Error: NSDFWriter2::flush(): Failed to write data\n";
-            break;
-		}
-        H5Sclose(memspace);
-        H5Sclose(filespace);
-        free(buffer);
-    }
+    });
 	steps_ = 0;
+}
 
-    // append all event data
-    for (unsigned int ii = 0; ii < eventSrc_.size(); ++ii){
-        appendToDataset(getEventDataset(eventSrc_[ii], eventSrcFields_[ii]),
-                        events_[ii]);
-        events_[ii].clear();
-    }
+void NSDFWriter2::flush()
+{
+    queueBlocks();
     // flush HDF5 nodes.
     HDF5DataWriter::flush();
 }
@@ -586,10 +595,17 @@ void NSDFWriter2::reinit(const Eref& eref, const ProcPtr proc)
     if (filename_.empty()){
         filename_ = "moose_data.nsdf.h5";
     }
+    lock_guard< recursive_mutex > lock(hdf5Mutex());
     openFile();
     writeScalarAttr<string>(filehandle_, "created", iso_time(0));
     writeScalarAttr<string>(filehandle_, "tstart", iso_time(0));
     writeScalarAttr<string>(filehandle_, "nsdf_version", "1.0");
+    unsigned int numObj = 0;
+	for (vector< Block >::iterator bi = blocks_.begin(); bi != blocks_.end(); ++bi)
+		numObj += bi->objVec.size();
+    blockSteps_ = blockSteps(numObj);
+	for (vector< Block >::iterator bi = blocks_.begin(); bi != blocks_.end(); ++bi)
+		bi->data.assign(bi->objVec.size() * blockSteps_, 0.0);
     openUniformData(eref);
 	for (vector< Block >::iterator bi = blocks_.begin(); bi != blocks_.end(); ++bi) {
         writeScalarAttr< double >(bi->dataset, "tstart", 0.0);
@@ -620,17 +636,18 @@ void NSDFWriter2::process(const Eref& eref, ProcPtr proc)
 	// data in block_->objVec order.
 	unsigned int ii = 0;
 	for (unsigned int blockIdx = 0; blockIdx < blocks_.size(); ++blockIdx) {
-		vector< vector< double > >&  bjd = blocks_[blockIdx].data;
-		for ( auto jj = bjd.begin(); jj != bjd.end(); ++jj ) {
-			jj->push_back( uniformData[ mapMsgIdx_[ii] ] );
+		double* column = &blocks_[blockIdx].data[steps_];
+		unsigned int numObj = blocks_[blockIdx].objVec.size();
+		for ( unsigned int jj = 0; jj < numObj; ++jj ) {
+			column[jj * blockSteps_] = uniformData[ mapMsgIdx_[ii] ];
 			ii++;
 		}
 	}
     ++steps_;
-    if (steps_ < flushLimit_){
+    if (steps_ < blockSteps_){
         return;
     }
-    NSDFWriter2::flush();
+    queueBlocks();
  }
 
 NSDFWriter2& NSDFWriter2::operator=( const NSDFWriter2& other)
@@ -778,9 +795,7 @@ bool parseBlockString( const string& val, Block& block )
 		}
 	}
 
-	block.data.resize( block.objVec.size() );
-	for( auto i = block.data.begin(); i != block.data.end(); i++ )
-		i->clear();
+	block.data.clear(); // Allocated on reinit.
 	return true;
 }
 
@@ -834,10 +849,10 @@ void NSDFWriter2::writeStaticCoords()
 		string fieldName = "coords"; // pathTokens[1] is not relevant.
         hid_t container = require_group(staticObjContainer, coordContainer);
         double * buffer = 
-			(double*)calloc(bit->data.size() * 7, sizeof(double));
+			(double*)calloc(bit->objVec.size() * 7, sizeof(double));
 		if ( bit->className.find( "Pool" ) != string::npos ) {
 			meshType = getMeshType(*bit);
-        	for (unsigned int jj = 0; jj < bit->data.size(); ++jj) {
+        	for (unsigned int jj = 0; jj < bit->objVec.size(); ++jj) {
 				ObjId obj = bit->objVec[jj];
             	vector< double > coords = Field< vector< double > >::get( obj, fieldName );
 				// cout << "numCoo = " << coords.size() << ", meshType = " << meshType << endl;
@@ -865,7 +880,7 @@ void NSDFWriter2::writeStaticCoords()
 				}
 			}
 		} else if ( bit->className.find( "Compartment" ) != string::npos ) {
-        	for (unsigned int jj = 0; jj < bit->data.size(); ++jj) {
+        	for (unsigned int jj = 0; jj < bit->objVec.size(); ++jj) {
 				ObjId obj = bit->objVec[jj];
             	vector< double > coords = Field< vector< double > >::get( obj, fieldName );
 				for ( unsigned int kk = 0; kk < 7; ++kk) {
@@ -885,7 +900,7 @@ void NSDFWriter2::writeStaticCoords()
 			}
 		}
         hsize_t dims[2];
-		dims[0] = bit->data.size();
+		dims[0] = bit->objVec.size();
 		dims[1] = 7;
         hid_t memspace = H5Screate_simple(2, dims, NULL);
         hid_t dataspace = H5Screate_simple(2, dims, NULL);
@@ -901,7 +916,14 @@ void NSDFWriter2::writeStaticCoords()
 		if ( status < 0 ) {
 			cout << "Error: Failed to write coords as static entry\n";
 		}
+        H5Sclose(filespace);
+        H5Dclose(dataset);
+        H5Sclose(dataspace);
+        H5Sclose(memspace);
+        H5Gclose(container);
+        free(buffer);
 	}
+    H5Gclose(staticObjContainer);
 }
 
 void NSDFWriter2::writeModelFiles()
@@ -928,6 +950,9 @@ void NSDFWriter2::writeModelFiles()
 			// status = H5Tclose(memtype);
 			status = H5Dwrite(ds, memtype, H5S_ALL, H5S_ALL, H5P_DEFAULT, sources );
 			assert(status >= 0);
+			H5Tclose(memtype);
+			H5Dclose(ds);
+			H5Gclose(fGroup);
 			free( filebuf );
 			free( sources );
 		} else {
@@ -81,7 +81,7 @@ typedef struct {
 	string field;	// Regular MOOSE value field.
 	string getField; // name of call to get the field.
 	string className; // All obj in a block should be of same class.
-	vector< vector< double > > data; // data_[objIdx][timeStep]
+	vector< double > data; // data[objIdx * blockSteps_ + timeStep]
 	vector< ObjId > objVec;
 	hid_t container;	// reference to container
 	hid_t relPathContainer;	// reference to objects on nsdfRelPath
@@ -128,6 +128,7 @@ class NSDFWriter2: public HDF5DataWriter
     void closeUniformData();
     void openEventData(const Eref &eref);
     void closeEventData();
+    void queueBlocks();
     virtual void close();
     void createUniformMap();
     void createStaticMap();
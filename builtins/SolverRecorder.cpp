@@ -0,0 +1,293 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2024 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include "../basecode/header.h"
+#include "../basecode/global.h"
+#include "../ksolve/VoxelPoolsBase.h"
+#include "../ksolve/KsolveBase.h"
+#include "../hsolve/HSolveActive.h"
+#include "../hsolve/HSolve.h"
+#include "SolverRecorder.h"
+
+const Cinfo* SolverRecorder::initCinfo()
+{
+		//////////////////////////////////////////////////////////////
+		// Field Definitions
+		//////////////////////////////////////////////////////////////
+		static ValueFinfo< SolverRecorder, Id > solver(
+			"solver",
+			"Solver to read the values from: a Ksolve, Gsolve, Dsolve "
+			"or HSolve.",
+			&SolverRecorder::setSolver,
+			&SolverRecorder::getSolver
+		);
+		static ValueFinfo< SolverRecorder, vector< ObjId > > targets(
+			"targets",
+			"Objects to record, all handled by the solver. Pools for the "
+			"chemical solvers, compartments or CaConcs for HSolve.",
+			&SolverRecorder::setTargets,
+			&SolverRecorder::getTargets
+		);
+		static ValueFinfo< SolverRecorder, string > field(
+			"field",
+			"Field to record: n or conc for pools, Vm for compartments, "
+			"Ca for CaConcs. If empty, conc for the chemical solvers and "
+			"Vm for HSolve.",
+			&SolverRecorder::setField,
+			&SolverRecorder::getField
+		);
+		static ReadOnlyValueFinfo< SolverRecorder, unsigned int > numTargets(
+			"numTargets",
+			"Number of targets recorded.",
+			&SolverRecorder::getNumTargets
+		);
+		static ReadOnlyValueFinfo< SolverRecorder, unsigned int > numSteps(
+			"numSteps",
+			"Number of steps recorded, including the one on reinit.",
+			&SolverRecorder::getNumSteps
+		);
+		static ReadOnlyLookupValueFinfo< SolverRecorder, unsigned int,
+				vector< double > > vec(
+			"vec",
+			"Recorded values of the target with the given index.",
+			&SolverRecorder::getVec
+		);
+		static ReadOnlyValueFinfo< SolverRecorder, vector< double > > data(
+			"data",
+			"Recorded values of all targets, numTargets values per step.",
+			&SolverRecorder::getData
+		);
+
+		//////////////////////////////////////////////////////////////
+		// MsgDest Definitions
+		//////////////////////////////////////////////////////////////
+		static DestFinfo process( "process",
+			"Handles process call. Records the values of all targets.",
+			new ProcOpFunc< SolverRecorder >( &SolverRecorder::process ) );
+		static DestFinfo reinit( "reinit",
+			"Handles reinit call. Looks up the targets in the solver, "
+			"clears the data and records the initial values.",
+			new ProcOpFunc< SolverRecorder >( &SolverRecorder::reinit ) );
+		static DestFinfo clearVec( "clearVec",
+			"Clears the recorded data.",
+			new OpFunc0< SolverRecorder >( &SolverRecorder::clearVec ) );
+
+		//////////////////////////////////////////////////////////////
+		// SharedFinfo Definitions
+		//////////////////////////////////////////////////////////////
+		static Finfo* procShared[] = {
+			&process, &reinit
+		};
+		static SharedFinfo proc( "proc",
+			"Shared message for process and reinit",
+			procShared, sizeof( procShared ) / sizeof( const Finfo* )
+		);
+
+	static Finfo* solverRecorderFinfos[] = {
+		&solver,		// Value
+		&targets,		// Value
+		&field,			// Value
+		&numTargets,	// ReadOnlyValue
+		&numSteps,		// ReadOnlyValue
+		&vec,			// ReadOnlyLookupValue
+		&data,			// ReadOnlyValue
+		&clearVec,		// DestFinfo
+		&proc			// SharedFinfo
+	};
+
+	static string doc[] = {
+		"Name", "SolverRecorder",
+		"Author", "Upi Bhalla",
+		"Description", "Records a field of many objects handled by a "
+		"solver, reading the values straight from the solver arrays "
+		"rather than sending a request message to each object as a "
+		"Table does."
+	};
+
+	static Dinfo< SolverRecorder > dinfo;
+	static Cinfo solverRecorderCinfo (
+		"SolverRecorder",
+		Neutral::initCinfo(),
+		solverRecorderFinfos,
+		sizeof( solverRecorderFinfos ) / sizeof ( Finfo* ),
+		&dinfo,
+		doc,
+		sizeof( doc ) / sizeof( string )
+	);
+
+	return &solverRecorderCinfo;
+}
+
+static const Cinfo* solverRecorderCinfo = SolverRecorder::initCinfo();
+
+///////////////////////////////////////////////////////////////////////////
+// Inner class funcs
+///////////////////////////////////////////////////////////////////////////
+
+SolverRecorder::SolverRecorder()
+	: field_( "" )
+{
+	;
+}
+
+void SolverRecorder::setSolver( Id solver )
+{
+	solver_ = solver;
+	addr_.clear();
+}
+
+Id SolverRecorder::getSolver() const
+{
+	return solver_;
+}
+
+void SolverRecorder::setTargets( vector< ObjId > targets )
+{
+	targets_ = targets;
+	addr_.clear();
+}
+
+vector< ObjId > SolverRecorder::getTargets() const
+{
+	return targets_;
+}
+
+void SolverRecorder::setField( string field )
+{
+	field_ = field;
+	addr_.clear();
+}
+
+string SolverRecorder::getField() const
+{
+	return field_;
+}
+
+unsigned int SolverRecorder::getNumTargets() const
+{
+	return targets_.size();
+}
+
+unsigned int SolverRecorder::getNumSteps() const
+{
+	if ( addr_.size() == 0 )
+		return 0;
+	return data_.size() / addr_.size();
+}
+
+vector< double > SolverRecorder::getVec( unsigned int i ) const
+{
+	vector< double > ret;
+	unsigned int n = addr_.size();
+	if ( i >= n )
+		return ret;
+	ret.reserve( data_.size() / n );
+	for ( unsigned int j = i; j < data_.size(); j += n )
+		ret.push_back( data_[j] );
+	return ret;
+}
+
+vector< double > SolverRecorder::getData() const
+{
+	return data_;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Dest funcs
+///////////////////////////////////////////////////////////////////////////
+
+void SolverRecorder::findAddresses()
+{
+	addr_.assign( targets_.size(), 0 );
+	scale_.assign( targets_.size(), 1.0 );
+	if ( solver_ == Id() ) {
+		cout << "Warning: SolverRecorder::reinit: no solver assigned\n";
+		return;
+	}
+	const Cinfo* ci = solver_.element()->cinfo();
+	void* data = solver_.eref().data();
+	string field = field_;
+	unsigned int numMissing = 0;
+	if ( ci->isA( "Ksolve" ) || ci->isA( "Gsolve" ) || ci->isA( "Dsolve" ) ){
+		if ( field == "" )
+			field = "conc";
+		if ( field != "n" && field != "conc" ) {
+			cout << "Warning: SolverRecorder::reinit: field '" << field <<
+					"' should be n or conc for " << ci->name() << "\n";
+			return;
+		}
+		KsolveBase* ksolve = reinterpret_cast< KsolveBase* >( data );
+		for ( unsigned int i = 0; i < targets_.size(); ++i ) {
+			if ( !targets_[i].isDataHere() ) // Recorded on its own node.
+				continue;
+			addr_[i] = ksolve->getNaddress( targets_[i].eref() );
+			if ( addr_[i] == 0 )
+				numMissing++;
+			else if ( field == "conc" )
+				scale_[i] = 1.0 /
+					( NA * Field< double >::get( targets_[i], "volume" ) );
+		}
+	} else if ( ci->isA( "HSolve" ) ) {
+		if ( field == "" )
+			field = "Vm";
+		if ( field != "Vm" && field != "Ca" ) {
+			cout << "Warning: SolverRecorder::reinit: field '" << field <<
+					"' should be Vm or Ca for HSolve\n";
+			return;
+		}
+		HSolve* hsolve = reinterpret_cast< HSolve* >( data );
+		for ( unsigned int i = 0; i < targets_.size(); ++i ) {
+			if ( field == "Vm" )
+				addr_[i] = hsolve->getVmAddress( targets_[i].id );
+			else
+				addr_[i] = hsolve->getCaAddress( targets_[i].id );
+			if ( addr_[i] == 0 )
+				numMissing++;
+		}
+	} else {
+		cout << "Warning: SolverRecorder::reinit: '" << solver_.path() <<
+				"' is a " << ci->name() << ", not a solver\n";
+		return;
+	}
+	if ( numMissing > 0 )
+		cout << "Warning: SolverRecorder::reinit: " << numMissing <<
+				" of the targets are not handled by '" << solver_.path() <<
+				"'. Recording 0 for them.\n";
+}
+
+void SolverRecorder::record()
+{
+	static const double zero = 0.0;
+	unsigned int n = addr_.size();
+	data_.resize( data_.size() + n );
+	double* out = &data_[ data_.size() - n ];
+	for ( unsigned int i = 0; i < n; ++i ) {
+		const double* a = addr_[i] ? addr_[i] : &zero;
+		out[i] = *a * scale_[i];
+	}
+}
+
+void SolverRecorder::process( const Eref& e, ProcPtr p )
+{
+	if ( addr_.size() > 0 )
+		record();
+}
+
+void SolverRecorder::reinit( const Eref& e, ProcPtr p )
+{
+	data_.clear();
+	findAddresses();
+	if ( addr_.size() > 0 )
+		record();
+}
+
+void SolverRecorder::clearVec()
+{
+	data_.clear();
+}
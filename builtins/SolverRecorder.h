@@ -0,0 +1,67 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2024 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+#ifndef _SOLVER_RECORDER_H
+#define _SOLVER_RECORDER_H
+
+/**
+ * Records a state variable of many objects that are handled by a solver,
+ * by reading it straight out of the solver's arrays. A Table sends a
+ * request message to each target on every step, which for a zombie ends
+ * in a get call into the solver. Here the address of each value in the
+ * solver is looked up once on reinit, and each step is a single pass
+ * copying the values into one buffer.
+ * Works for pool n or conc in Ksolve, Gsolve and Dsolve, and for Vm of
+ * compartments and Ca of CaConcs in HSolve.
+ */
+class SolverRecorder
+{
+	public:
+		SolverRecorder();
+
+		////////////////////////////////////////////////////////////////
+		// Field assignment stuff.
+		////////////////////////////////////////////////////////////////
+		void setSolver( Id solver );
+		Id getSolver() const;
+		void setTargets( vector< ObjId > targets );
+		vector< ObjId > getTargets() const;
+		void setField( string field );
+		string getField() const;
+		unsigned int getNumTargets() const;
+		unsigned int getNumSteps() const;
+		vector< double > getVec( unsigned int i ) const;
+		vector< double > getData() const;
+
+		////////////////////////////////////////////////////////////////
+		// Dest Func
+		////////////////////////////////////////////////////////////////
+		void process( const Eref& e, ProcPtr p );
+		void reinit( const Eref& e, ProcPtr p );
+		void clearVec();
+
+		////////////////////////////////////////////////////////////////
+		static const Cinfo* initCinfo();
+	private:
+		/// Looks up where the solver keeps the field of each target.
+		void findAddresses();
+		/// Appends the current values of all targets to data_.
+		void record();
+
+		Id solver_;
+		vector< ObjId > targets_;
+		string field_;
+		/// Address of the value of each target in the solver.
+		vector< const double* > addr_;
+		/// Factor to get the field from the value, eg, n to conc.
+		vector< double > scale_;
+		/// Values of all targets at each step, one step after another.
+		vector< double > data_;
+};
+
+#endif // _SOLVER_RECORDER_H
@@ -10,6 +10,7 @@
 #include "../basecode/header.h"
 #include "Stats.h"
 #include "SpikeStats.h"
+#include "../basecode/Checkpoint.h"
 
 const Cinfo* SpikeStats::initCinfo()
 {
@@ -74,6 +75,9 @@ const Cinfo* SpikeStats::initCinfo()
 
 static const Cinfo* spikeStatsCinfo = SpikeStats::initCinfo();
 
+static const bool spikeStatsHook =
+    addCheckpointHook< SpikeStats >( "SpikeStats" );
+
 ///////////////////////////////////////////////////////////////////////////
 // class funcs
 ///////////////////////////////////////////////////////////////////////////
@@ -94,6 +98,22 @@ void SpikeStats::vProcess( const Eref& e, ProcPtr p )
 	Stats::input( rate );
 }
 
+void SpikeStats::saveState( CheckpointWriter& w ) const
+{
+	Stats::saveState( w );
+	w.put( numSpikes_ );
+	w.put( fired_ );
+}
+
+bool SpikeStats::loadState( CheckpointReader& r )
+{
+	if ( !Stats::loadState( r ) )
+		return false;
+	r.get( numSpikes_ );
+	r.get( fired_ );
+	return r.good();
+}
+
 void SpikeStats::vReinit( const Eref& e, ProcPtr p )
 {
 	Stats::vReinit( e, p );
@@ -36,6 +36,10 @@ class SpikeStats: public Stats
 		void vProcess( const Eref& e, ProcPtr p );
 		void vReinit( const Eref& e, ProcPtr p );
 
+		/// Saves and restores the Stats and the spike count, for checkpoints.
+		void saveState( CheckpointWriter& w ) const;
+		bool loadState( CheckpointReader& r );
+
 		////////////////////////////////////////////////////////////////
 		static const Cinfo* initCinfo();
 	private:
@@ -9,6 +9,7 @@
 
 #include "../basecode/header.h"
 #include "Stats.h"
+#include "../basecode/Checkpoint.h"
 
 static SrcFinfo1< vector< double >* > *requestOut() {
 	static SrcFinfo1< vector< double >* > requestOut(
@@ -127,6 +128,8 @@ const Cinfo* Stats::initCinfo()
 
 static const Cinfo* statsCinfo = Stats::initCinfo();
 
+static const bool statsHook = addCheckpointHook< Stats >( "Stats" );
+
 ///////////////////////////////////////////////////////////////////////////
 // Inner class funcs
 ///////////////////////////////////////////////////////////////////////////
@@ -149,6 +152,23 @@ void Stats::process( const Eref& e, ProcPtr p )
 	this->vProcess( e, p );
 }
 
+void Stats::saveState( CheckpointWriter& w ) const
+{
+	w.put( sum_ );
+	w.put( sumsq_ );
+	w.put( num_ );
+	w.putVec( samples_ );
+}
+
+bool Stats::loadState( CheckpointReader& r )
+{
+	r.get( sum_ );
+	r.get( sumsq_ );
+	r.get( num_ );
+	isWindowDirty_ = true;
+	return r.getVecInPlace( samples_ ) && r.good();
+}
+
 void Stats::vProcess( const Eref& e, ProcPtr p )
 {
 	vector< double > v;
@@ -9,6 +9,9 @@
 #ifndef _STATS_H
 #define _STATS_H
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class Stats
 {
 	public:
@@ -49,6 +52,11 @@ class Stats
 		void doWindowCalculation() const;
 		void innerWindowCalculation();
 
+		/// Saves and restores the running sums and the window of samples,
+		/// for checkpoints.
+		void saveState( CheckpointWriter& w ) const;
+		bool loadState( CheckpointReader& r );
+
 		////////////////////////////////////////////////////////////////
 		static const Cinfo* initCinfo();
 	private:
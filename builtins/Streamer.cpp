@@ -153,6 +153,7 @@ Streamer::Streamer()
     tableTick_.resize(0);
     tableDt_.resize(0);
     data_.resize(0);
+    stream_ = NULL;
 }
 
 Streamer& Streamer::operator=( const Streamer& st )
@@ -163,6 +164,8 @@ Streamer& Streamer::operator=( const Streamer& st )
 
 Streamer::~Streamer()
 {
+    if( stream_ )
+        AsyncWriter::instance().close( stream_ );
 }
 
 /**
@@ -244,7 +247,12 @@ void Streamer::reinit(const Eref& e, ProcPtr p)
     // write now.
     currTime_ = 0.0;
     zipWithTime( );
-    StreamerBase::writeToOutFile(datafilePath_, format_, WRITE, data_, columns_);
+    if( stream_ )
+        AsyncWriter::instance().close( stream_ );
+    // The file stays open till the next reinit, or till the Streamer goes.
+    stream_ = AsyncWriter::instance().open( datafilePath_, format_, columns_ );
+    if( stream_ )
+        AsyncWriter::instance().append( stream_, data_ );
     data_.clear( );
 }
 
@@ -255,7 +263,12 @@ void Streamer::reinit(const Eref& e, ProcPtr p)
 void Streamer::cleanUp( )
 {
     zipWithTime( );
-    StreamerBase::writeToOutFile( datafilePath_, format_, APPEND, data_, columns_ );
+    if( stream_ )
+    {
+        AsyncWriter::instance().append( stream_, data_ );
+        // Wait for the writer, so that the file is complete for the user.
+        AsyncWriter::instance().sync( stream_ );
+    }
     data_.clear( );
 }
 
@@ -269,7 +282,9 @@ void Streamer::process(const Eref& e, ProcPtr p)
 {
     // LOG( moose::debug, "Writing Streamer data to file." );
     zipWithTime( );
-    StreamerBase::writeToOutFile( datafilePath_, format_, APPEND, data_, columns_ );
+    // This only copies the rows into the buffer of the writer thread.
+    if( stream_ )
+        AsyncWriter::instance().append( stream_, data_ );
     data_.clear();
     numWriteEvents_ += 1;
 }
@@ -27,6 +27,7 @@
 
 #include "StreamerBase.h"
 #include "Table.h"
+#include "AsyncWriter.h"
 
 using namespace std;
 
@@ -96,6 +97,9 @@ private:
     /*  Keep data in vector */
     vector<double> data_;
 
+    /* Stream to datafilePath_ on the writer thread, open from reinit on. */
+    AsyncStream* stream_;
+
 };
 
 #endif   /* ----- #ifndef Streamer_INC  ----- */
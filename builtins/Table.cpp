@@ -16,6 +16,7 @@
 #include "Table.h"
 #include "../scheduling/Clock.h"
 #include "StreamerBase.h"
+#include "AsyncWriter.h"
 
 static SrcFinfo1< vector< double >* > *requestOut()
 {
@@ -226,18 +227,23 @@ Table::Table() :
     lastN_(0),
     useFileStreamer_(false),
     datafile_(""),
-    format_("csv")
+    format_("csv"),
+    stream_(NULL)
 {
 }
 
 Table::~Table( )
 {
     // Make sure to write to rest of the entries to file before closing down.
-    if( useFileStreamer_ )
+    if( stream_ )
     {
+        {
+            std::lock_guard< std::mutex > lock( streamingMutex() );
+            streaming().erase( this );
+        }
         mergeWithTime( data_ );
-        assert( ! datafile_.empty() );
-        StreamerBase::writeToOutFile( datafile_, format_, APPEND, data_, columns_);
+        AsyncWriter::instance().append( stream_, data_ );
+        AsyncWriter::instance().close( stream_ );
         clearAllVecs();
     }
 }
@@ -272,17 +278,18 @@ void Table::process( const Eref& e, ProcPtr p )
     /*  If we are streaming to a file, let's write to a file. And clean the
      *  vector.
      *  Write at every 5 seconds or whenever size of vector is more than 10k.
+     *  This only hands the data over to the writer thread.
      */
-    if( useFileStreamer_ )
+    if( stream_ )
     {
         if( fmod(lastTime_, 5.0) == 0.0 || getVecSize() >= 10000 )
         {
             mergeWithTime( data_ );
-            StreamerBase::writeToOutFile( datafile_, format_, APPEND, data_, columns_ );
+            AsyncWriter::instance().append( stream_, data_ );
             clearAllVecs();
         }
-        }
     }
+}
 
 void Table::clearAllVecs()
 {
@@ -291,6 +298,34 @@ void Table::clearAllVecs()
     data_.clear();
 }
 
+void Table::flushStream()
+{
+    if( ! stream_ || tvec_.empty() )
+        return;
+    mergeWithTime( data_ );
+    AsyncWriter::instance().append( stream_, data_ );
+    clearAllVecs();
+}
+
+set< Table* >& Table::streaming()
+{
+    static set< Table* > tables;
+    return tables;
+}
+
+std::mutex& Table::streamingMutex()
+{
+    static std::mutex m;
+    return m;
+}
+
+void Table::flushStreams()
+{
+    std::lock_guard< std::mutex > lock( streamingMutex() );
+    for( auto t = streaming().begin(); t != streaming().end(); ++t )
+        (*t)->flushStream();
+}
+
 /**
  * @brief Reinitialize
  *
@@ -340,12 +375,26 @@ void Table::reinit( const Eref& e, ProcPtr p )
 
     tvec_.push_back(lastTime_);
 
+    if( stream_ )
+    {
+        AsyncWriter::instance().close( stream_ );
+        stream_ = NULL;
+    }
     if( useFileStreamer_ )
     {
+        // The file stays open till the next reinit or the end.
+        stream_ = AsyncWriter::instance().open( datafile_, format_, columns_ );
         mergeWithTime( data_ );
-        StreamerBase::writeToOutFile(datafile_, format_, WRITE, data_, columns_);
+        if( stream_ )
+            AsyncWriter::instance().append( stream_, data_ );
         clearAllVecs();
     }
+
+    std::lock_guard< std::mutex > lock( streamingMutex() );
+    if( stream_ )
+        streaming().insert( this );
+    else
+        streaming().erase( this );
 }
 
 //////////////////////////////////////////////////////////////
@@ -10,8 +10,13 @@
 #ifndef _TABLE_H
 #define _TABLE_H
 
+#include <set>
+#include <mutex>
+
 using namespace std;
 
+struct AsyncStream;
+
 /**
  * Receives and records inputs. Handles plot and spiking data in batch mode.
  */
@@ -58,6 +63,14 @@ public:
 
     void clearAllVecs();
 
+    /**
+     * Hands the rows not yet written by every Table that streams to a
+     * file over to the writer. Called at the end of each start, before
+     * the streams are synced, so that the files are complete when start
+     * returns.
+     */
+    static void flushStreams();
+
     //////////////////////////////////////////////////////////////////
     // Dest funcs
     //////////////////////////////////////////////////////////////////
@@ -120,6 +133,18 @@ private:
      */
     string format_;
 
+    /**
+     * @brief Stream to datafile_ on the writer thread, open from reinit on.
+     */
+    AsyncStream* stream_;
+
+    /// Hands the rows not yet written over to stream_.
+    void flushStream();
+
+    /// Tables with an open stream_, for flushStreams.
+    static set< Table* >& streaming();
+    static std::mutex& streamingMutex();
+
 };
 
 #endif	// _TABLE_H
@@ -13,6 +13,7 @@
 #include <fstream>
 #include "TableBase.h"
 #include "TimeTable.h"
+#include "../basecode/Checkpoint.h"
 
 static SrcFinfo1< double > *eventOut() {
     static SrcFinfo1< double > eventOut(
@@ -94,6 +95,8 @@ const Cinfo* TimeTable::initCinfo()
 
 static const Cinfo* timeTableCinfo = TimeTable::initCinfo();
 
+static const bool timeTableHook = addCheckpointHook< TimeTable >( "TimeTable" );
+
 ///////////////////////////////////////////////////
 // Class function definitions
 ///////////////////////////////////////////////////
@@ -203,3 +206,16 @@ void TimeTable::process(const Eref& e, ProcPtr p)
       state_ = 1;
   }
 }
+
+void TimeTable::saveState( CheckpointWriter& w ) const
+{
+  w.put( curPos_ );
+  w.put( state_ );
+}
+
+bool TimeTable::loadState( CheckpointReader& r )
+{
+  r.get( curPos_ );
+  r.get( state_ );
+  return r.good();
+}
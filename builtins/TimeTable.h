@@ -9,6 +9,9 @@
 
 #ifndef _TIME_TABLE_H
 #define _TIME_TABLE_H
+
+class CheckpointWriter;
+class CheckpointReader;
 class TimeTable: public TableBase
 {
   public:
@@ -35,6 +38,11 @@ class TimeTable: public TableBase
      */
     void reinit(const Eref& e, ProcPtr p);
 
+    /// Saves and restores the position in the table and the state,
+    /// for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     static const Cinfo * initCinfo();
 
   private:
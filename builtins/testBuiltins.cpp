@@ -14,6 +14,7 @@
 #include "Arith.h"
 #include "TableBase.h"
 #include "Table.h"
+#include "AsyncWriter.h"
 #include <queue>
 
 #include "../shell/Shell.h"
@@ -270,6 +271,58 @@ void testTable()
 	cout << "." << flush;
 }
 
+/**
+ * Writes rows in small pieces through the writer thread, and checks that
+ * the npy file has them all, with the right shape in its header, and that
+ * the csv file has a line for each.
+ */
+void testAsyncWriter()
+{
+	const unsigned int numRows = 3 * AsyncWriter::blockSize + 7;
+	vector< string > cols = { "time", "a", "b" };
+	AsyncWriter& w = AsyncWriter::instance();
+	AsyncStream* npy = w.open( "_async_writer_test.npy", "npy", cols );
+	AsyncStream* csv = w.open( "_async_writer_test.csv", "csv", cols );
+	assert( npy && csv );
+	vector< double > all;
+	for ( unsigned int i = 0; i < numRows; ++i ) {
+		double row[] = { i * 0.1, sqrt( (double) i ), -1.0 * i };
+		w.append( npy, row, 3 );
+		w.append( csv, row, 3 );
+		all.insert( all.end(), row, row + 3 );
+		if ( i == numRows / 2 )
+			w.sync( npy ); // Header fixed up halfway, then again at close.
+	}
+	w.close( npy );
+	w.close( csv );
+
+	ifstream fnpy( "_async_writer_test.npy", ios::binary );
+	string header;
+	getline( fnpy, header );
+	stringstream shape;
+	shape << "'shape':(" << numRows << ",";
+	assert( header.find( shape.str() ) != string::npos );
+	vector< double > data( all.size() + 1 );
+	fnpy.read( reinterpret_cast< char* >( &data[0] ),
+					sizeof( double ) * data.size() );
+	assert( static_cast< size_t >( fnpy.gcount() ) ==
+			sizeof( double ) * all.size() );
+	for ( unsigned int i = 0; i < all.size(); ++i )
+		assert( data[i] == all[i] );
+	fnpy.close();
+
+	ifstream fcsv( "_async_writer_test.csv" );
+	string line;
+	unsigned int numLines = 0;
+	while ( getline( fcsv, line ) )
+		numLines++;
+	assert( numLines == numRows + 1 );
+	fcsv.close();
+	remove( "_async_writer_test.npy" );
+	remove( "_async_writer_test.csv" );
+	cout << "." << flush;
+}
+
 /**
  * Tests capacity to send a request for a field value to an object
  */
@@ -429,6 +482,7 @@ void testBuiltins()
 {
 	testArith();
 	testTable();
+	testAsyncWriter();
 #if ENABLE_NSDF
         testNSDF();
 #endif
@@ -88,16 +88,73 @@ void testCreateStringDataset()
     H5Fclose(file);
 }
 
+/**
+   Blocks of rows x steps written from the writer thread must end up
+   side by side along time, in the order they were queued.
+ */
+void testAppendToDataset2D()
+{
+    const hsize_t rows = 3;
+    const hsize_t width = 4;
+    HDF5WriterBase writer;
+    string h5Filename = moose::random_string( 10 );
+    hid_t file = H5Fcreate(h5Filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    hid_t dset = writer.createDataset2D(file, "block", rows, width);
+    assert(dset >= 0);
+    // A full block, then a part filled one.
+    hsize_t steps[] = {width, 2};
+    hsize_t t0 = 0;
+    for (unsigned int kk = 0; kk < 2; ++kk){
+        vector< double > block(rows * width, -1.0);
+        for (hsize_t ii = 0; ii < rows; ++ii){
+            for (hsize_t jj = 0; jj < steps[kk]; ++jj){
+                block[ii * width + jj] = ii * 100.0 + t0 + jj;
+            }
+        }
+        hsize_t n = steps[kk];
+        HDF5WriterBase::queueWrite([dset, n, block]() {
+            herr_t status = HDF5WriterBase::appendToDataset2D(
+                    dset, block.data(), rows, width, n);
+            assert(status >= 0);
+        });
+        t0 += n;
+    }
+    HDF5WriterBase::syncWrites();
+    hid_t filespace = H5Dget_space(dset);
+    hsize_t dims[2];
+    H5Sget_simple_extent_dims(filespace, dims, NULL);
+    H5Sclose(filespace);
+    assert(dims[0] == rows);
+    assert(dims[1] == t0);
+    vector< double > data(rows * t0);
+    herr_t status = H5Dread(dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &data[0]);
+    assert(status >= 0);
+    for (hsize_t ii = 0; ii < rows; ++ii){
+        for (hsize_t jj = 0; jj < t0; ++jj){
+            assert(doubleEq(data[ii * t0 + jj], ii * 100.0 + jj));
+        }
+    }
+    H5Dclose(dset);
+    H5Fclose(file);
+    remove(h5Filename.c_str());
+}
+
 #else // dummy function
 void testCreateStringDataset()
 {
     ;
 }
+
+void testAppendToDataset2D()
+{
+    ;
+}
 #endif // USE_HDF5
 
 void testNSDF()
 {
     testCreateStringDataset();
+    testAppendToDataset2D();
 }
 
 //
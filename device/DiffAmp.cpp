@@ -40,6 +40,7 @@
 #include <cfloat>
 
 #include "DiffAmp.h"
+#include "../basecode/Checkpoint.h"
 
 static SrcFinfo1< double >* outputOut()
 {
@@ -144,6 +145,9 @@ const Cinfo* DiffAmp::initCinfo()
 }
 
 static const Cinfo* diffAmpCinfo = DiffAmp::initCinfo();
+
+static const bool diffAmpHook = addCheckpointHook< DiffAmp >( "DiffAmp" );
+
 DiffAmp::DiffAmp():gain_(1.0), saturation_(DBL_MAX), plus_(0), minus_(0), output_(0)
 {
 }
@@ -200,6 +204,21 @@ void DiffAmp::process(const Eref& e, ProcPtr p)
     outputOut()->send(e, output_);
 }
 
+void DiffAmp::saveState( CheckpointWriter& w ) const
+{
+    w.put( plus_ );
+    w.put( minus_ );
+    w.put( output_ );
+}
+
+bool DiffAmp::loadState( CheckpointReader& r )
+{
+    r.get( plus_ );
+    r.get( minus_ );
+    r.get( output_ );
+    return r.good();
+}
+
 void DiffAmp::reinit(const Eref& e, ProcPtr p)
 {
     // What is the right thing to do?? Should we actually do a process step??
@@ -31,6 +31,9 @@
 #ifndef _DIFFAMP_H
 #define _DIFFAMP_H
 
+class CheckpointWriter;
+class CheckpointReader;
+
 #include "../basecode/header.h"
 
 class DiffAmp
@@ -48,6 +51,10 @@ class DiffAmp
     void process(const Eref& e, ProcPtr p);
     void reinit(const Eref& e, ProcPtr p);
 
+    /// Saves and restores the summed inputs and the output, for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     static const Cinfo* initCinfo();
 
   protected:
@@ -40,6 +40,7 @@
 
 #include <cfloat>
 #include "PIDController.h"
+#include "../basecode/Checkpoint.h"
 
 
 static SrcFinfo1< double > * outputOut()
@@ -183,6 +184,9 @@ const Cinfo* PIDController::initCinfo()
 
 static const Cinfo* pidCinfo = PIDController::initCinfo();
 
+static const bool pidHook =
+    addCheckpointHook< PIDController >( "PIDController" );
+
 PIDController::PIDController():
         command_(0),
         saturation_(DBL_MAX),
@@ -306,6 +310,27 @@ void PIDController::process(const Eref& e,  ProcPtr proc )
     outputOut()->send(e, output_);
 }
 
+void PIDController::saveState( CheckpointWriter& w ) const
+{
+    w.put( sensed_ );
+    w.put( output_ );
+    w.put( error_ );
+    w.put( e_integral_ );
+    w.put( e_derivative_ );
+    w.put( e_previous_ );
+}
+
+bool PIDController::loadState( CheckpointReader& r )
+{
+    r.get( sensed_ );
+    r.get( output_ );
+    r.get( error_ );
+    r.get( e_integral_ );
+    r.get( e_derivative_ );
+    r.get( e_previous_ );
+    return r.good();
+}
+
 
 void PIDController::reinit(const Eref& e, ProcPtr proc )
 {
@@ -39,6 +39,9 @@
 #ifndef _PIDCONTROLLER_H
 #define _PIDCONTROLLER_H
 
+class CheckpointWriter;
+class CheckpointReader;
+
 #include "../basecode/header.h"
 
 class PIDController{
@@ -64,6 +67,10 @@ class PIDController{
     double getEPrevious() const;
     void process(const Eref&e, ProcPtr process );
     void reinit(const Eref& e, ProcPtr process );
+    /// Saves and restores the error terms and output, for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     static const Cinfo * initCinfo();
 
   private:
@@ -31,6 +31,7 @@
 
 #include "../basecode/header.h"
 #include "PulseGen.h"
+#include "../basecode/Checkpoint.h"
 
 static SrcFinfo1<double>* outputOut()
 {
@@ -145,6 +146,8 @@ const Cinfo* PulseGen::initCinfo()
 
 static const Cinfo* pulseGenCinfo = PulseGen::initCinfo();
 
+static const bool pulseGenHook = addCheckpointHook< PulseGen >( "PulseGen" );
+
 PulseGen::PulseGen()
 {
     level_.reserve(2);
@@ -423,6 +426,23 @@ void PulseGen::process(const Eref& e, ProcPtr p)
     outputOut()->send(e, output_);
 }
 
+void PulseGen::saveState( CheckpointWriter& w ) const
+{
+    w.put( output_ );
+    w.put( trigTime_ );
+    w.put( prevInput_ );
+    w.put( input_ );
+}
+
+bool PulseGen::loadState( CheckpointReader& r )
+{
+    r.get( output_ );
+    r.get( trigTime_ );
+    r.get( prevInput_ );
+    r.get( input_ );
+    return r.good();
+}
+
 void PulseGen::reinit(const Eref& e, ProcPtr p)
 {
     trigTime_ = -1;
@@ -31,6 +31,9 @@
 
 #ifndef _PULSEGEN_H
 #define _PULSEGEN_H
+
+class CheckpointWriter;
+class CheckpointReader;
 /**
  * PulseGen acts as a pulse generator. It generates square pulses of
  * specified duration and amplitude. Two consecutive pulses are
@@ -115,6 +118,10 @@ public:
 
     void reinit(const Eref& e, ProcPtr p);
 
+    /// Saves and restores the output and the trigger state, for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     /////////////////////////////////////////////////////////////
     static const Cinfo* initCinfo();
 
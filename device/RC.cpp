@@ -39,6 +39,7 @@
 // Code:
 
 #include "RC.h"
+#include "../basecode/Checkpoint.h"
 
 static SrcFinfo1< double >* outputOut()
 {
@@ -121,6 +122,8 @@ const Cinfo* RC::initCinfo()
 
 static const Cinfo* rcCinfo = RC::initCinfo();
 
+static const bool rcHook = addCheckpointHook< RC >( "RC" );
+
 
 RC::RC():
         v0_(0),
@@ -231,6 +234,19 @@ void RC::process(const Eref& e, const ProcPtr proc )
     outputOut()->send(e, state_);
 }
 
+void RC::saveState( CheckpointWriter& w ) const
+{
+	w.put( state_ );
+	w.put( msg_inject_ );
+}
+
+bool RC::loadState( CheckpointReader& r )
+{
+	r.get( state_ );
+	r.get( msg_inject_ );
+	return r.good();
+}
+
 void RC::reinit(const Eref& e, const ProcPtr proc)
 {
 
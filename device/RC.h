@@ -41,6 +41,9 @@
 #ifndef _RC_H
 #define _RC_H
 
+class CheckpointWriter;
+class CheckpointReader;
+
 #include "../basecode/header.h"
 
 class RC{
@@ -58,6 +61,10 @@ class RC{
     void setInjectMsg(double inject);
     void process(const Eref& e, ProcPtr proc);
     void reinit(const Eref& e, ProcPtr proc);
+    /// Saves and restores the state and the summed input, for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     static const Cinfo * initCinfo();
   private:
     double v0_;
@@ -84,6 +84,17 @@ void DiffPoolVec::setPrevVec()
     prev_ = n_;
 }
 
+const vector< double >& DiffPoolVec::getPrevVec() const
+{
+    return prev_;
+}
+
+void DiffPoolVec::setPrevVec( const vector< double >& vec )
+{
+    assert( vec.size() == n_.size() );
+    prev_ = vec;
+}
+
 double DiffPoolVec::getDiffConst() const
 {
     return diffConst_;
@@ -48,6 +48,9 @@ public:
     void setNvec( unsigned int start, unsigned int num,
                   vector< double >::const_iterator q );
     void setPrevVec(); /// Assigns prev_ = n_
+    /// Used by parent solver to save and restore 'prev'
+    const vector< double >& getPrevVec() const;
+    void setPrevVec( const vector< double >& prev );
     void setOps( const vector< Triplet< double > >& ops_,
                  const vector< double >& diagVal_ ); /// Assign operations.
 
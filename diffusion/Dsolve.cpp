@@ -28,6 +28,7 @@
 #include "../shell/Wildcard.h"
 #include "../kinetics/PoolBase.h"
 #include "Dsolve.h"
+#include "../basecode/Checkpoint.h"
 
 #include <thread>
 
@@ -181,6 +182,8 @@ const Cinfo* Dsolve::initCinfo()
 
 static const Cinfo* dsolveCinfo = Dsolve::initCinfo();
 
+static const bool dsolveHook = addCheckpointHook< Dsolve >( "Dsolve" );
+
 // Class definitions
 Dsolve::Dsolve() :
     dt_( -1.0 ),
@@ -1158,6 +1161,15 @@ double Dsolve::getN( const Eref& e ) const
     return 0.0;
 }
 
+const double* Dsolve::getNaddress( const Eref& e ) const
+{
+    unsigned int pid = convertIdToPoolIndex( e );
+    unsigned int vox = e.dataIndex();
+    if ( pid >= pools_.size() || vox >= pools_[ pid ].getNumVoxels() )
+        return 0;
+    return &pools_[ pid ].getNvec()[ vox ];
+}
+
 double Dsolve::getR1( unsigned int reacIdx, const Eref& e ) const
 {
 	// Should not look for a reaction rate in the Dsolve.
@@ -1349,3 +1361,36 @@ double Dsolve::volume( unsigned int i ) const
 {
     return 1.0;
 }
+
+void Dsolve::saveState( CheckpointWriter& w ) const
+{
+    w.put< unsigned int >( pools_.size() );
+    for ( const DiffPoolVec& p : pools_ )
+    {
+        w.putVec( p.getNvec() );
+        w.putVec( p.getPrevVec() );
+    }
+}
+
+bool Dsolve::loadState( CheckpointReader& r )
+{
+    if ( r.get< unsigned int >() != pools_.size() )
+    {
+        cout << "Warning: Dsolve::loadState: number of pools differs\n";
+        return false;
+    }
+    vector< double > n;
+    vector< double > prev;
+    for ( DiffPoolVec& p : pools_ )
+    {
+        if ( !r.getVec( n ) || !r.getVec( prev ) ||
+                n.size() != p.getNvec().size() || prev.size() != n.size() )
+        {
+            r.fail();
+            return false;
+        }
+        p.setNvec( n );
+        p.setPrevVec( prev );
+    }
+    return true;
+}
@@ -129,6 +129,7 @@ public:
     double getConcInit( const Eref& e ) const;
     void setConcInit( const Eref& e, double value );
     double getN( const Eref& e ) const;
+    const double* getNaddress( const Eref& e ) const;
     void setN( const Eref& e, double value );
     double getR1( unsigned int reacIdx, const Eref& e ) const;
 	double getVolumeOfPool( const Eref& e ) const;
@@ -197,6 +198,10 @@ public:
      */
     void print() const;
 
+    /// Saves and restores n and prev of all pools, for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     //////////////////////////////////////////////////////////////////
     static const Cinfo* initCinfo();
 private:
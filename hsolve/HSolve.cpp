@@ -27,6 +27,8 @@
 #include "../biophysics/CaConc.h"
 #include "ZombieHHChannel.h"
 #include "../shell/Shell.h"
+#include "../scheduling/Clock.h"
+#include "../basecode/Checkpoint.h"
 
 #include <chrono>
 using namespace std::chrono;
@@ -155,6 +157,25 @@ const Cinfo* HSolve::initCinfo()
         &HSolve::getCaMax
     );
 
+    static ValueFinfo< HSolve, unsigned int > numThreads(
+        "numThreads",
+        "Number of threads on which the Hines matrix of the cell is solved. "
+        "With more than one, the cell is cut into independent dendritic "
+        "subtrees, which are solved in parallel, and a small trunk of the "
+        "branch points between them, which is solved on one thread. This "
+        "pays off for large cells of thousands of compartments. The results "
+        "agree with those on one thread to round-off. Default is 1.",
+        &HSolve::setNumThreads,
+        &HSolve::getNumThreads
+    );
+
+    static ReadOnlyValueFinfo< HSolve, unsigned int > numSubtrees(
+        "numSubtrees",
+        "Number of subtrees that the cell has been cut into for numThreads "
+        "threads. 0 if the matrix is solved on one thread.",
+        &HSolve::getNumSubtrees
+    );
+
     static Finfo* hsolveFinfos[] =
     {
         &seed,              // Value
@@ -167,6 +188,8 @@ const Cinfo* HSolve::initCinfo()
         &caDiv,             // Value
         &caMin,             // Value
         &caMax,             // Value
+        &numThreads,        // Value
+        &numSubtrees,       // ReadOnlyValue
         &proc,              // Shared
     };
 
@@ -194,6 +217,8 @@ const Cinfo* HSolve::initCinfo()
 
 static const Cinfo* hsolveCinfo = HSolve::initCinfo();
 
+static const bool hsolveHook = addCheckpointHook< HSolve >( "HSolve" );
+
 HSolve::HSolve()
     : dt_( 50e-6 )
 {
@@ -232,6 +257,69 @@ void HSolve::reinit( const Eref& hsolve, ProcPtr p )
     this->HSolveActive::reinit( p );
 }
 
+void HSolve::saveState( CheckpointWriter& w ) const
+{
+    w.putVec( V_ );
+    w.putVec( state_ );
+    w.putVec( ca_ );
+    w.putVec( caActivation_ );
+    vector< double > c( caConc_.size() );
+    for ( unsigned int i = 0; i < caConc_.size(); ++i )
+        c[ i ] = caConc_[ i ].c_;
+    w.putVec( c );
+    w.putVec( current_ );
+    w.putVec( externalCurrent_ );
+    w.putVec( prevExtCurr_ );
+    w.putVec( externalCalcium_ );
+
+    w.put< unsigned int >( inject_.size() );
+    map< unsigned int, InjectStruct >::const_iterator i;
+    for ( i = inject_.begin(); i != inject_.end(); ++i ) {
+        w.put( i->first );
+        w.put( i->second );
+    }
+
+    vector< double > markov;
+    for ( unsigned int i = 0; i < markov_.size(); ++i ) {
+        markov.push_back( markov_[ i ].Gk_ );
+        markov.push_back( markov_[ i ].Ek_ );
+    }
+    w.putVec( markov );
+}
+
+bool HSolve::loadState( CheckpointReader& r )
+{
+    vector< double > c( caConc_.size() );
+    if ( !r.getVecInPlace( V_ ) || !r.getVecInPlace( state_ ) ||
+            !r.getVecInPlace( ca_ ) || !r.getVecInPlace( caActivation_ ) ||
+            !r.getVecInPlace( c ) || !r.getVecInPlace( current_ ) ||
+            !r.getVecInPlace( externalCurrent_ ) ||
+            !r.getVecInPlace( prevExtCurr_ ) ||
+            !r.getVecInPlace( externalCalcium_ ) ) {
+        cout << "Warning: HSolve::loadState: the cell differs\n";
+        return false;
+    }
+    for ( unsigned int i = 0; i < caConc_.size(); ++i )
+        caConc_[ i ].c_ = c[ i ];
+
+    unsigned int numInject = r.get< unsigned int >();
+    map< unsigned int, InjectStruct > inject;
+    for ( unsigned int i = 0; i < numInject && r.good(); ++i ) {
+        unsigned int index = r.get< unsigned int >();
+        inject[ index ] = r.get< InjectStruct >();
+    }
+
+    vector< double > markov( 2 * markov_.size() );
+    if ( !r.getVecInPlace( markov ) )
+        return false;
+    for ( unsigned int i = 0; i < markov_.size(); ++i ) {
+        markov_[ i ].Gk_ = markov[ 2 * i ];
+        markov_[ i ].Ek_ = markov[ 2 * i + 1 ];
+    }
+    inject_.swap( inject );
+    return true;
+}
+
 void HSolve::zombify( Eref hsolve ) const
 {
     vector< Id >::const_iterator i;
@@ -259,6 +347,13 @@ void HSolve::zombify( Eref hsolve ) const
         HHChannelBase::zombify( i->eref().element(),
 						ZombieHHChannel::initCinfo(), hsolve.id() );
 	}
+
+	// MarkovChannels and their solvers are not zombified, only taken off
+	// the clock. HSolve calls them directly.
+    for ( i = markovChanId_.begin(); i != markovChanId_.end(); ++i )
+		i->element()->setTick( -2 );
+    for ( i = markovSolverId_.begin(); i != markovSolverId_.end(); ++i )
+		i->element()->setTick( -2 );
 }
 
 void HSolve::unzombify() const
@@ -276,11 +371,20 @@ void HSolve::unzombify() const
         	CaConcBase::zombify( i->eref().element(), CaConc::initCinfo(), Id() );
 		}
 
-    for ( i = channelId_.begin(); i != channelId_.end(); ++i )
-		if ( i->element() ) {
-        	HHChannelBase::zombify( i->eref().element(),
-						HHChannel::initCinfo(), Id() );
+    for ( unsigned int ichan = 0; ichan < channelId_.size(); ++ichan )
+		if ( channelId_[ ichan ].element() ) {
+        	HHChannelBase::zombify( channelId_[ ichan ].eref().element(),
+						channelCinfo_[ ichan ], Id() );
 		}
+
+    for ( i = markovChanId_.begin(); i != markovChanId_.end(); ++i )
+		if ( i->element() )
+			i->element()->setTick(
+				Clock::lookupDefaultTick( i->element()->cinfo()->name() ) );
+    for ( i = markovSolverId_.begin(); i != markovSolverId_.end(); ++i )
+		if ( i->element() )
+			i->element()->setTick(
+				Clock::lookupDefaultTick( i->element()->cinfo()->name() ) );
 }
 
 void HSolve::setup( Eref hsolve )
@@ -498,6 +602,29 @@ double HSolve::getCaMax() const
     return caMax_;
 }
 
+void HSolve::setNumThreads( unsigned int numThreads )
+{
+    if ( numThreads == 0 )
+    {
+        cerr << "Error: HSolve: numThreads must be at least 1.\n";
+        return;
+    }
+
+    numThreads_ = numThreads;
+    if ( nCompt_ > 0 )
+        split_.setup( *this, numThreads_ );
+}
+
+unsigned int HSolve::getNumThreads() const
+{
+    return numThreads_;
+}
+
+unsigned int HSolve::getNumSubtrees() const
+{
+    return split_.numSubtrees();
+}
+
 const set<string>& HSolve::handledClasses()
 {
     static set<string> classes;
@@ -506,7 +633,11 @@ const set<string>& HSolve::handledClasses()
         classes.insert("CaConc");
         classes.insert("ZombieCaConc");
         classes.insert("HHChannel");
+        classes.insert("HHChannelF");
+        classes.insert("HHChannel2D");
+        classes.insert("HHChannelF2D");
         classes.insert("ZombieHHChannel");
+        classes.insert("MarkovChannel");
         classes.insert("Compartment");
         classes.insert("SymCompartment");
         classes.insert("ZombieCompartment");
@@ -14,6 +14,9 @@
 #include <chrono>
 using namespace std::chrono;
 
+class CheckpointWriter;
+class CheckpointReader;
+
 /**
  * HSolve adapts the integrator HSolveActive into a MOOSE class.
  */
@@ -26,6 +29,13 @@ public:
     void process( const Eref& hsolve, ProcPtr p );
     void reinit( const Eref& hsolve, ProcPtr p );
 
+    /**
+     * Saves and restores the state of the cell: Vm, gate states, Ca and
+     * the currents carried over between steps. For checkpoints.
+     */
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     void setSeed( Id seed );
     Id getSeed() const; 		/**< For searching for compartments:
 								 *   seed is the starting compt.     */
@@ -58,6 +68,10 @@ public:
     void setCaMax( double caMax );
     double getCaMax() const;
 
+    void setNumThreads( unsigned int numThreads );
+    unsigned int getNumThreads() const;
+    unsigned int getNumSubtrees() const;
+
     // Interface functions defined in HSolveInterface.cpp
     double getInitVm( Id id ) const;
     void setInitVm( Id id, double value );
@@ -132,6 +146,9 @@ public:
     //~ const vector< Id >& getCaConcs() const;
     double getCa( Id id ) const;
     void setCa( Id id, double Ca );
+    /// Where Vm and Ca are kept, or NULL if id is not handled here.
+    const double* getVmAddress( Id id ) const;
+    const double* getCaAddress( Id id ) const;
     void iCa( Id id, double iCa ); // Add incoming calcium current.
 
     double getCaBasal( Id id ) const;
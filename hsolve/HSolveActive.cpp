@@ -30,9 +30,24 @@ const int HSolveActive::INSTANT_X = 1;
 const int HSolveActive::INSTANT_Y = 2;
 const int HSolveActive::INSTANT_Z = 4;
 
+const unsigned int HSolveActive::MAX_DIVS_2D = 300;
+
 HSolveActive::HSolveActive()
 {
     caAdvance_ = 1;
+    numThreads_ = 1;
+    gateBatchDirty_ = false;
+
+    /*
+     * Lookup table ranges, for gates given by formulae. The ranges of gates
+     * with tables of their own override these.
+     */
+    vMin_ = -0.1;
+    vMax_ = 0.05;
+    vDiv_ = 3000;
+    caMin_ = 0.0;
+    caMax_ = 0.01;
+    caDiv_ = 3000;
 
     // Default lookup table size
     //~ vDiv_ = 3000;    // for voltage
@@ -43,6 +58,23 @@ HSolveActive::HSolveActive()
 // Solving differential equations
 //////////////////////////////////////////////////////////////////////
 void HSolveActive::step( ProcPtr info )
+{
+    if ( nCompt_ <= 0 )
+        return;
+
+    prepareStep( info );
+    if ( split_.numSubtrees() > 0 )
+        split_.solve( *this );
+    else
+    {
+        HSolvePassive::forwardEliminate();
+        HSolvePassive::backwardSubstitute();
+    }
+    completeStep( info );
+    sendStep( info );
+}
+
+void HSolveActive::prepareStep( ProcPtr info )
 {
     if ( nCompt_ <= 0 )
         return;
@@ -53,12 +85,25 @@ void HSolveActive::step( ProcPtr info )
     }
 
     advanceChannels( info->dt );
+    advanceMarkovChannels();
     calculateChannelCurrents();
     updateMatrix();
-    HSolvePassive::forwardEliminate();
-    HSolvePassive::backwardSubstitute();
+}
+
+void HSolveActive::completeStep( ProcPtr info )
+{
+    if ( nCompt_ <= 0 )
+        return;
+
     advanceCalcium();
     advanceSynChans( info );
+}
+
+void HSolveActive::sendStep( ProcPtr info )
+{
+    if ( nCompt_ <= 0 )
+        return;
+
     sendValues( info );
     sendSpikes( info );
     prevExtCurr_ = externalCurrent_;
@@ -147,6 +192,13 @@ void HSolveActive::updateMatrix()
         ihs += 4;
     }
 
+    vector< MarkovChanStruct >::iterator imarkov;
+    for ( imarkov = markov_.begin(); imarkov != markov_.end(); ++imarkov )
+    {
+        HS_[ 4 * imarkov->compt_ ] += imarkov->Gk_;
+        HS_[ 4 * imarkov->compt_ + 3 ] += imarkov->Gk_ * imarkov->Ek_;
+    }
+
     stage_ = 0;    // Update done.
 }
 
@@ -203,6 +255,17 @@ void HSolveActive::advanceCalcium()
         }
     }
 
+    vector< MarkovChanStruct >::iterator imarkov;
+    for ( imarkov = markov_.begin(); imarkov != markov_.end(); ++imarkov )
+    {
+        if ( !imarkov->caTarget_ )
+            continue;
+
+        double vmid = VMid_[ imarkov->compt_ ];
+        double v = caAdvance_ == 1 ? vmid : 2 * vmid - V_[ imarkov->compt_ ];
+        *imarkov->caTarget_ += imarkov->Gk_ * ( imarkov->Ek_ - v );
+    }
+
     vector< CaConcStruct >::iterator icaconc;
     vector< double >::iterator icaactivation = caActivation_.begin();
     vector< double >::iterator ica = ca_.begin();
@@ -215,123 +278,111 @@ void HSolveActive::advanceCalcium()
     caActivation_.assign( caActivation_.size(), 0.0 );
 }
 
-void HSolveActive::advanceChannels( double dt )
+/**
+ * Finds the rows in the lookup tables for the Vm of each compartment and
+ * the Ca of each pool, for lookupGates.
+ */
+void HSolveActive::findRows()
 {
-    vector< double >::iterator iv;
-    vector< double >::iterator istate = state_.begin();
-    vector< int >::iterator ichannelcount = channelCount_.begin();
-    vector< ChannelStruct >::iterator ichan = channel_.begin();
-    vector< ChannelStruct >::iterator chanBoundary;
-    vector< unsigned int >::iterator icacount = caCount_.begin();
-    vector< double >::iterator ica = ca_.begin();
-    vector< double >::iterator caBoundary;
-    vector< LookupColumn >::iterator icolumn = column_.begin();
-    vector< LookupRow >::iterator icarowcompt;
-    vector< LookupRow* >::iterator icarow = caRow_.begin();
-    vector< double >::iterator iextca = externalCalcium_.begin();
-
-    LookupRow vRow;
-    LookupRow dRow;
-    double C1 = 0.0, C2 = 0.0;
+    if ( !vTable_.empty() && nCompt_ > 0 )
+        vTable_.rows( &V_[ 0 ], nCompt_, &vOffset_[ 0 ], &vFraction_[ 0 ] );
+    if ( !caTable_.empty() && !ca_.empty() )
+        caTable_.rows( &ca_[ 0 ], ca_.size(), &caOffset_[ 0 ], &caFraction_[ 0 ] );
+}
 
-    for ( iv = V_.begin(); iv != V_.end(); ++iv )
+/**
+ * Looks up the rate terms C1 and C2 of each gate in a batch.
+ */
+void HSolveActive::lookupGates( const GateBatch& batch, double* C1, double* C2 )
+{
+    unsigned int n = batch.state.size();
+    const unsigned int* column = &batch.column[ 0 ];
+    const unsigned int* index = &batch.index[ 0 ];
+
+    if ( batch.source == GateBatch::VM )
+        vTable_.lookup( n, column, index,
+                &vOffset_[ 0 ], &vFraction_[ 0 ], C1, C2 );
+    else if ( batch.source == GateBatch::CA_POOL )
+        caTable_.lookup( n, column, index,
+                &caOffset_[ 0 ], &caFraction_[ 0 ], C1, C2 );
+    else if ( batch.source == GateBatch::TABLE_2D )
     {
-	if (!vTable_.empty())
-	    vTable_.row( *iv, vRow );
-        icarowcompt = caRowCompt_.begin();
-        caBoundary = ica + *icacount;
-        for ( ; ica < caBoundary; ++ica )
+        for ( unsigned int i = 0; i < n; ++i )
         {
-            caTable_.row( *ica, *icarowcompt );
-
-            ++icarowcompt;
+            const double* const* input = &input2D_[ 2 * index[ i ] ];
+            table2D_[ column[ i ] ].lookup( *input[ 0 ], *input[ 1 ], C1[ i ], C2[ i ] );
         }
-
-        /*
-         * Optimize by moving "if ( instant )" outside the loop, because it is
-         * rarely used. May also be able to avoid "if ( power )".
-         *
-         * Or not: excellent branch predictors these days.
-         *
-         * Will be nice to test these optimizations.
-         */
-        chanBoundary = ichan + *ichannelcount;
-        for ( ; ichan < chanBoundary; ++ichan )
+    }
+    else
+    {
+        // Ca from a difshell if there is any, else Vm.
+        LookupRow row;
+        LookupColumn col;
+        for ( unsigned int i = 0; i < n; ++i )
         {
-	    if (!caTable_.empty())
-		caTable_.row( *iextca, dRow );
-
-            if ( ichan->Xpower_ > 0.0 )
+            col.column = column[ i ];
+            double ca = externalCalcium_[ index[ i ] ];
+            if ( ca > 0 && !caTable_.empty() )
             {
-                vTable_.lookup( *icolumn, vRow, C1, C2 );
-                //~ *istate = *istate * C1 + C2;
-                //~ *istate = ( C1 + ( 2 - C2 ) * *istate ) / C2;
-                if ( ichan->instant_ & INSTANT_X )
-                    *istate = C1 / C2;
-                else
-                {
-                    double temp = 1.0 + dt / 2.0 * C2;
-                    *istate = ( *istate * ( 2.0 - temp ) + dt * C1 ) / temp;
-                }
-
-                ++icolumn, ++istate;
+                caTable_.row( ca, row );
+                caTable_.lookup( col, row, C1[ i ], C2[ i ] );
             }
-
-            if ( ichan->Ypower_ > 0.0 )
+            else
             {
-                vTable_.lookup( *icolumn, vRow, C1, C2 );
-                //~ *istate = *istate * C1 + C2;
-                //~ *istate = ( C1 + ( 2 - C2 ) * *istate ) / C2;
-                if ( ichan->instant_ & INSTANT_Y )
-                    *istate = C1 / C2;
-                else
-                {
-                    double temp = 1.0 + dt / 2.0 * C2;
-                    *istate = ( *istate * ( 2.0 - temp ) + dt * C1 ) / temp;
-
-                }
-                ++icolumn, ++istate;
+                vTable_.row( V_[ chan2compt_[ index[ i ] ] ], row );
+                vTable_.lookup( col, row, C1[ i ], C2[ i ] );
             }
+        }
+    }
+}
 
-            if ( ichan->Zpower_ > 0.0 )
-            {
-                LookupRow* caRow = *icarow;
-
-                if ( caRow )
-                {
-                    caTable_.lookup( *icolumn, *caRow, C1, C2 );
-
-                }
-                else if (*iextca >0)
-                {
-                    caTable_.lookup( *icolumn, dRow, C1, C2 );
-                }
-                else
-                {
-                    vTable_.lookup( *icolumn, vRow, C1, C2 );
-
-                }
-
-                //~ *istate = *istate * C1 + C2;
-                //~ *istate = ( C1 + ( 2 - C2 ) * *istate ) / C2;
-                if ( ichan->instant_ & INSTANT_Z )
-                    *istate = C1 / C2;
-                else
-                {
-                    double temp = 1.0 + dt / 2.0 * C2;
-                    *istate = ( *istate * ( 2.0 - temp ) + dt * C1 ) / temp;
-                }
+void HSolveActive::advanceChannels( double dt )
+{
+    if ( gateBatchDirty_ )
+        createGateBatches();
 
-                ++icolumn, ++istate, ++icarow;
+    // Rows for all the compartments and pools, once per step.
+    findRows();
 
+    vector< GateBatch >::iterator ibatch;
+    for ( ibatch = gateBatch_.begin(); ibatch != gateBatch_.end(); ++ibatch )
+    {
+        unsigned int n = ibatch->state.size();
+        double* C1 = &gateC1_[ 0 ];
+        double* C2 = &gateC2_[ 0 ];
+        lookupGates( *ibatch, C1, C2 );
+
+        const unsigned int* istate = &ibatch->state[ 0 ];
+        double* state = &state_[ 0 ];
+        if ( ibatch->instant )
+        {
+            for ( unsigned int i = 0; i < n; ++i )
+                state[ istate[ i ] ] = C1[ i ] / C2[ i ];
+        }
+        else
+        {
+            for ( unsigned int i = 0; i < n; ++i )
+            {
+                double temp = 1.0 + dt / 2.0 * C2[ i ];
+                state[ istate[ i ] ] =
+                    ( state[ istate[ i ] ] * ( 2.0 - temp ) + dt * C1[ i ] ) / temp;
             }
-            ++iextca;
         }
-
-        ++ichannelcount, ++icacount;
     }
 }
 
+/**
+ * Advances the MarkovChannels from the Vm at the start of the step, as for
+ * the gates of the other channels. Their conductances go into the matrix
+ * in updateMatrix.
+ */
+void HSolveActive::advanceMarkovChannels()
+{
+    vector< MarkovChanStruct >::iterator imarkov;
+    for ( imarkov = markov_.begin(); imarkov != markov_.end(); ++imarkov )
+        imarkov->advance( V_[ imarkov->compt_ ] );
+}
+
 /**
  * SynChans are currently not under solver's control
  */
@@ -377,6 +428,12 @@ void HSolveActive::sendValues( ProcPtr info )
 
     }
 
+    vector< MarkovChanStruct >::iterator imarkov;
+    for ( imarkov = markov_.begin(); imarkov != markov_.end(); ++imarkov )
+        if ( imarkov->outIk_ )
+            ChanBase::IkOut()->send( imarkov->chan_,
+                ( imarkov->Ek_ - V_[ imarkov->compt_ ] ) * imarkov->Gk_ );
+
     for ( i = outCa_.begin(); i != outCa_.end(); ++i )
         //~ CaConc::concOut()->send(
         CaConcBase::concOut()->send(
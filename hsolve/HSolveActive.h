@@ -24,8 +24,36 @@
 #include "HSolveStruct.h"
 #include "HinesMatrix.h"
 #include "HSolvePassive.h"
+#include "HinesSplit.h"
 #include "RateLookup.h"
 
+/**
+ * A batch of gates that look up the same table in the same way, and are
+ * either all instantaneous or all not. Within a batch the gates are sorted
+ * by type (that is, by column in the table), so that gates of one type are
+ * updated together. advanceChannels goes through each batch in straight
+ * loops with no branches, in place of walking the channels gate by gate.
+ */
+struct GateBatch
+{
+    enum Source
+    {
+        VM,             ///< Looked up on the Vm of a compartment
+        CA_POOL,        ///< Looked up on the Ca of a pool in the solver
+        EXTERNAL_CA,    ///< Z gates on Ca from outside the solver, or Vm
+        TABLE_2D        ///< Gates of 2-D channels, each in its own table
+    };
+
+    Source source;
+    bool instant;
+    vector< unsigned int > state;   ///< Index of each gate in state_
+    vector< unsigned int > column;  /**< Column of each gate in the table.
+        *   For TABLE_2D, the index of the gate's table in table2D_. */
+    vector< unsigned int > index;   /**< Index of the compartment, Ca pool
+        *   or (for EXTERNAL_CA) channel that each gate reads from. For
+        *   TABLE_2D, the gate's pair of inputs in input2D_. */
+};
+
 class HSolveActive: public HSolvePassive
 {
     typedef vector< CurrentStruct >::iterator currentVecIter;
@@ -37,6 +65,19 @@ public:
     void step( ProcPtr info );			///< Equivalent to process
     void reinit( ProcPtr info );
 
+    /**
+     * The three phases of step, for solvers that do the Hines solve of
+     * many cells together (see HinesGroup). prepareStep advances the
+     * channels and fills in the matrix, and completeStep advances the
+     * calcium pools once the new voltages are in. Both only touch this
+     * cell's data, so different cells can run on different threads.
+     * sendStep sends out values and spikes through the cell's messages,
+     * and must be called from the main thread.
+     */
+    void prepareStep( ProcPtr info );
+    void completeStep( ProcPtr info );
+    void sendStep( ProcPtr info );
+
 protected:
     /**
      * Solver parameters: exposed as fields in MOOSE
@@ -67,6 +108,14 @@ protected:
     double                    caMax_;
     int                       caDiv_;
 
+    /**
+     * numThreads_: Number of threads on which the Hines matrix is solved.
+     * With more than one, split_ cuts the cell into dendritic subtrees
+     * that are solved in parallel.
+     */
+    unsigned int              numThreads_;
+    HinesSplit                split_;
+
     /**
      * Internal data structures. Will also be accessed in derived class HSolve.
      */
@@ -99,12 +148,31 @@ protected:
 		*   channels are loaded into this vector before being used. The vector
 		*   is then reused for the next compartment. This vector therefore has
 		*   a size equal to the maximum number of calcium pools across all
-		*   compartments. This is done in HSolveActive::advanceChannels */
+		*   compartments. This is done in HSolveActive::reinitChannels */
 
     vector< LookupRow* >      caRow_;			/**< Points into caRowCompt.
 		*   For each channel, points to the appropriate pool's LookupRow in the
 		*   caRowCompt vector. This value is then used by the channel. Also
-		*   happens in HSolveActive::advanceChannels */
+		*   happens in HSolveActive::reinitChannels */
+
+    vector< LookupTable2D >   table2D_;			///< Tables of the 2-D gates
+    vector< const double* >   input2D_;			/**< Two for each 2-D gate:
+		*   point into V_ or ca_, or at a zero if the gate has only one
+		*   input. */
+
+    vector< GateBatch >       gateBatch_;		///< All gates, in batches
+    ///< that are updated alike. Built
+    ///< after the lookup tables.
+    bool                      gateBatchDirty_;	///< Set when the instant flag
+    ///< of a channel changes, so that
+    ///< the batches are built again
+    ///< before the next use.
+    vector< unsigned int >    vOffset_;			///< Lookup rows for the Vm of
+    vector< double >          vFraction_;		///< each compartment, and for
+    vector< unsigned int >    caOffset_;		///< the Ca of each pool. Filled
+    vector< double >          caFraction_;		///< in each step.
+    vector< double >          gateC1_;			///< Scratch space for the rate
+    vector< double >          gateC2_;			///< terms of a gate batch.
 
     vector< int >             channelCount_;	///< Number of channels in each
     ///< compartment
@@ -123,6 +191,12 @@ protected:
     vector< double >          externalCalcium_; /// calcium from difshells
     vector< Id >              caConcId_;		///< Used for localIndex-ing.
     vector< Id >              channelId_;		///< Used for localIndex-ing.
+    vector< const Cinfo* >    channelCinfo_;	///< Class of each channel,
+    ///< to restore on unzombify.
+    vector< MarkovChanStruct > markov_;		///< MarkovChannels taken over
+    ///< by the solver.
+    vector< Id >              markovChanId_;	///< The MarkovChannels and
+    vector< Id >              markovSolverId_;	///< their MarkovSolvers.
     vector< Id >              gateId_;			///< Used for localIndex-ing.
     //~ vector< vector< Id > >    externalChannelId_;
     vector< unsigned int >    outVm_;			/**< VmOut info.
@@ -145,6 +219,10 @@ private:
     void readSynapses();
     void readExternalChannels();
     void createLookupTables();
+    void createLookupTables2D();
+    LookupTable2D table2D( Id gate, int dep0, int dep1 ) const;
+    void createGateBatches();
+    void readMarkovChannels();
     void manageOutgoingMessages();
 
     void cleanup();
@@ -166,6 +244,9 @@ private:
     void backwardSubstitute();
     void advanceCalcium();
     void advanceChannels( double dt );
+    void findRows();
+    void lookupGates( const GateBatch& batch, double* C1, double* C2 );
+    void advanceMarkovChannels();
     void advanceSynChans( ProcPtr info );
     void sendSpikes( ProcPtr info );
     void sendValues( ProcPtr info );
@@ -173,6 +254,9 @@ private:
     static const int INSTANT_X;
     static const int INSTANT_Y;
     static const int INSTANT_Z;
+
+    /// Most divisions each way in the 2-D tables of HHGateF2D gates.
+    static const unsigned int MAX_DIVS_2D;
 };
 
 #endif // _HSOLVE_ACTIVE_H
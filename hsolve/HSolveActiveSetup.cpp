@@ -24,9 +24,12 @@ void HSolveActive::setup( Id seed, double dt )
     readGates();
     readCalcium();
     createLookupTables();
+    createGateBatches();
     readSynapses(); // Reads SynChans, SpikeGens. Drops process msg for SpikeGens.
     readExternalChannels();
+    readMarkovChannels();
     manageOutgoingMessages(); // Manages messages going out from the cell's components.
+    split_.setup( *this, numThreads_ );
 
     //~ reinit();
     cleanup();
@@ -48,6 +51,11 @@ void HSolveActive::reinit( ProcPtr info )
     reinitCompartments();
     reinitCalcium();
     reinitChannels();
+
+    vector< MarkovChanStruct >::iterator imarkov;
+    for ( imarkov = markov_.begin(); imarkov != markov_.end(); ++imarkov )
+        imarkov->reinit( V_[ imarkov->compt_ ], info );
+
     sendValues( info );
 }
 
@@ -77,88 +85,68 @@ void HSolveActive::reinitCalcium()
 
 void HSolveActive::reinitChannels()
 {
-    vector< double >::iterator iv;
-    vector< double >::iterator istate = state_.begin();
-    vector< int >::iterator ichannelcount = channelCount_.begin();
-    vector< ChannelStruct >::iterator ichan = channel_.begin();
-    vector< ChannelStruct >::iterator chanBoundary;
-    vector< unsigned int >::iterator icacount = caCount_.begin();
-    vector< double >::iterator ica = ca_.begin();
-    vector< double >::iterator caBoundary;
-    vector< LookupColumn >::iterator icolumn = column_.begin();
-    vector< LookupRow >::iterator icarowcompt;
-    vector< LookupRow* >::iterator icarow = caRow_.begin();
-    vector< double>::iterator iextca = externalCalcium_.begin();
-
-    LookupRow vRow;
-    LookupRow dRow;
-    double C1, C2;
-    for ( iv = V_.begin(); iv != V_.end(); ++iv )
-    {
-
-	if (!vTable_.empty())
-	    vTable_.row( *iv, vRow );
-        icarowcompt = caRowCompt_.begin();
-
-        caBoundary = ica + *icacount;
-        for ( ; ica < caBoundary; ++ica )
-        {
-            caTable_.row( *ica, *icarowcompt );
-
-            ++icarowcompt;
-
-        }
-
-        chanBoundary = ichan + *ichannelcount;
-        for ( ; ichan < chanBoundary; ++ichan )
-        {
-
-            if(!caTable_.empty())
-                caTable_.row( *iextca, dRow );
-
-            if ( ichan->Xpower_ > 0.0 )
-            {
-                vTable_.lookup( *icolumn, vRow, C1, C2 );
-
-                *istate = C1 / C2;
-
-                ++icolumn, ++istate;
-            }
-
-            if ( ichan->Ypower_ > 0.0 )
-            {
-                vTable_.lookup( *icolumn, vRow, C1, C2 );
-
-                *istate = C1 / C2;
-
-                ++icolumn, ++istate;
-            }
+    if ( gateBatchDirty_ )
+        createGateBatches();
 
-            if ( ichan->Zpower_ > 0.0 )
-            {
-                LookupRow* caRow = *icarow;
+    // Every gate starts at its steady state, C1 / C2.
+    findRows();
 
-                if ( caRow )
-                {
-                    caTable_.lookup( *icolumn, *caRow, C1, C2 );
-                }
-		else if (*iextca>0)
-		  caTable_.lookup( *icolumn, dRow, C1, C2 );
-                else
-                {
-                    vTable_.lookup( *icolumn, vRow, C1, C2 );
-                }
+    vector< GateBatch >::iterator ibatch;
+    for ( ibatch = gateBatch_.begin(); ibatch != gateBatch_.end(); ++ibatch )
+    {
+        double* C1 = &gateC1_[ 0 ];
+        double* C2 = &gateC2_[ 0 ];
+        lookupGates( *ibatch, C1, C2 );
 
-                *istate = C1 / C2;
+        for ( unsigned int i = 0; i < ibatch->state.size(); ++i )
+            state_[ ibatch->state[ i ] ] = C1[ i ] / C2[ i ];
+    }
+}
 
-                ++icolumn, ++istate, ++icarow;
-            }
+/**
+ * A 2-D channel can only be taken over if each concentration that its
+ * gates read comes from a CaConc, which the solver then takes over as well.
+ * Also, a conc2 pool must send only to HH channels: the zombie channel has
+ * no conc2 field, so nothing else may leave the pool sending to it.
+ */
+static bool readsSolverCalcium( Id channel )
+{
+    if ( !HSolveUtils::is2D( channel ) )
+        return true;
+
+    static const string power[] = { "Xpower", "Ypower", "Zpower" };
+    static const string index[] = { "Xindex", "Yindex", "Zindex" };
+    bool conc1 = false;
+    bool conc2 = false;
+    for ( unsigned int g = 0; g < 3; ++g )
+    {
+        if ( Field< double >::get( channel, power[ g ] ) <= 0.0 )
+            continue;
+
+        int dep0, dep1;
+        HSolveUtils::dependency2D(
+            Field< string >::get( channel, index[ g ] ), dep0, dep1 );
+        conc1 = conc1 || dep0 == 1 || dep1 == 1;
+        conc2 = conc2 || dep0 == 2 || dep1 == 2;
+    }
 
-	    ++iextca;
-        }
+    vector< Id > pool;
+    if ( conc1 && HSolveUtils::caDepend( channel, pool ) == 0 )
+        return false;
 
-        ++ichannelcount, ++icacount;
+    if ( conc2 )
+    {
+        pool.clear();
+        if ( HSolveUtils::targets( channel, "concen2", pool, "CaConc" ) == 0 )
+            return false;
+
+        vector< Id > other;
+        if ( HSolveUtils::targets( pool.front(), "concOut", other,
+                HSolveUtils::hhchannelClasses(), false ) > 0 )
+            return false;
     }
+
+    return true;
 }
 
 void HSolveActive::readHHChannels()
@@ -175,6 +163,21 @@ void HSolveActive::readHHChannels()
     {
         nChannel = HSolveUtils::hhchannels( *icompt, channelId_ );
 
+        // Any 2-D channels that the solver cannot take over stay outside.
+        ichan = channelId_.end() - nChannel;
+        while ( ichan != channelId_.end() )
+        {
+            if ( readsSolverCalcium( *ichan ) )
+            {
+                ++ichan;
+            }
+            else
+            {
+                ichan = channelId_.erase( ichan );
+                --nChannel;
+            }
+        }
+
         // todo: discard channels with Gbar = 0.0
         channelCount_.push_back( nChannel );
 
@@ -189,16 +192,26 @@ void HSolveActive::readHHChannels()
 
             Gbar    = Field< double >::get( *ichan, "Gbar" );
             Ek    = Field< double >::get( *ichan, "Ek" );
-            X    = Field< double >::get( *ichan, "X" );
-            Y    = Field< double >::get( *ichan, "Y" );
-            Z    = Field< double >::get( *ichan, "Z" );
             Xpower    = Field< double >::get( *ichan, "Xpower" );
             Ypower    = Field< double >::get( *ichan, "Ypower" );
             Zpower    = Field< double >::get( *ichan, "Zpower" );
-            instant    = Field< int >::get( *ichan, "instant" );
+            // HHChannelF2D has no state or instant fields: reinit sets it up.
+            if ( ichan->element()->cinfo()->findFinfo( "instant" ) )
+            {
+                X    = Field< double >::get( *ichan, "X" );
+                Y    = Field< double >::get( *ichan, "Y" );
+                Z    = Field< double >::get( *ichan, "Z" );
+                instant    = Field< int >::get( *ichan, "instant" );
+            }
+            else
+            {
+                X = Y = Z = 0.0;
+                instant = 0;
+            }
             double modulation = Field< double >::get( *ichan, "modulation");
 
             current.Ek = Ek;
+            channelCinfo_.push_back( ichan->element()->cinfo() );
 
             channel.Gbar_ = Gbar;
             channel.setPowers( Xpower, Ypower, Zpower );
@@ -245,6 +258,9 @@ void HSolveActive::readGates()
     {
         nGates = HSolveUtils::gates( *ichan, gateId_ );
         gCaDepend_.insert( gCaDepend_.end(), nGates, 0 );
+        // The gates of 2-D channels go in tables of their own.
+        if ( HSolveUtils::is2D( *ichan ) )
+            continue;
         useConcentration = Field< int >::get( *ichan, "useConcentration" );
         if ( useConcentration )
             gCaDepend_.back() = 1;
@@ -278,6 +294,12 @@ void HSolveActive::readCalcium()
                 // No calcium pools fed by this channel.
                 caTargetIndex.push_back( -1 );
 
+            // The conc2 pool of a 2-D channel goes before its conc pool, so
+            // that the conc pool stays last in caConcId.
+            if ( HSolveUtils::is2D( channelId_[ ichan ] ) )
+                HSolveUtils::targets(
+                    channelId_[ ichan ], "concen2", caConcId, "CaConc" );
+
             nDepend = HSolveUtils::caDepend( channelId_[ ichan ], caConcId );
 
 	    if ( nDepend == 0)
@@ -338,6 +360,18 @@ void HSolveActive::readCalcium()
 
 }
 
+static bool isGate2D( Id gate )
+{
+    const string& name = gate.element()->cinfo()->name();
+    return name == "HHGate2D" || name == "HHGateF2D";
+}
+
+/// Gates given by formulae, which have no lookup range of their own.
+static bool isFormulaGate( Id gate )
+{
+    return gate.element()->cinfo()->name() == "HHGateF";
+}
+
 void HSolveActive::createLookupTables()
 {
     vector< Id > caGate;
@@ -345,7 +379,9 @@ void HSolveActive::createLookupTables()
     map< Id, unsigned int > gateSpecies;
 
     for ( unsigned int ig = 0; ig < gateId_.size(); ++ig )
-        if ( gCaDepend_[ ig ] )
+        if ( isGate2D( gateId_[ ig ] ) )
+            continue;
+        else if ( gCaDepend_[ ig ] )
             caGate.push_back( gateId_[ ig ] );
         else
             vGate.push_back( gateId_[ ig ] );
@@ -360,13 +396,19 @@ void HSolveActive::createLookupTables()
      * tables.
      *
      * # of divs is determined by finding the smallest dx (highest density).
+     *
+     * Gates given by formulae have no table, and are evaluated on the range
+     * found here. If there are only such gates, the range set on the solver
+     * is used.
      */
-    vMin_ = numeric_limits< double >::max();
-    vMax_ = numeric_limits< double >::min();
+    double vMin = numeric_limits< double >::max();
+    double vMax = numeric_limits< double >::min();
     double vDx = numeric_limits< double >::max();
-    caMin_ = numeric_limits< double >::max();
-    caMax_ = numeric_limits< double >::min();
+    double caMin = numeric_limits< double >::max();
+    double caMax = numeric_limits< double >::min();
     double caDx = numeric_limits< double >::max();
+    unsigned int nCaTables = 0;
+    unsigned int nVTables = 0;
 
     double min;
     double max;
@@ -375,37 +417,55 @@ void HSolveActive::createLookupTables()
 
     for ( unsigned int ig = 0; ig < caGate.size(); ++ig )
     {
+        if ( isFormulaGate( caGate[ ig ] ) )
+            continue;
+        ++nCaTables;
+
         min = Field< double >::get( caGate[ ig ], "min" );
         max = Field< double >::get( caGate[ ig ], "max" );
         divs = Field< unsigned int >::get( caGate[ ig ], "divs" );
         dx = ( max - min ) / divs;
 
-        if ( min < caMin_ )
-            caMin_ = min;
-        if ( max > caMax_ )
-            caMax_ = max;
+        if ( min < caMin )
+            caMin = min;
+        if ( max > caMax )
+            caMax = max;
         if ( dx < caDx )
             caDx = dx;
     }
-    double caDiv = ( caMax_ - caMin_ ) / caDx;
-    caDiv_ = static_cast< int >( caDiv + 0.5 ); // Round-off to nearest int.
+    if ( nCaTables > 0 )
+    {
+        caMin_ = caMin;
+        caMax_ = caMax;
+        double caDiv = ( caMax_ - caMin_ ) / caDx;
+        caDiv_ = static_cast< int >( caDiv + 0.5 ); // Round-off to nearest int.
+    }
 
     for ( unsigned int ig = 0; ig < vGate.size(); ++ig )
     {
+        if ( isFormulaGate( vGate[ ig ] ) )
+            continue;
+        ++nVTables;
+
         min = Field< double >::get( vGate[ ig ], "min" );
         max = Field< double >::get( vGate[ ig ], "max" );
         divs = Field< unsigned int >::get( vGate[ ig ], "divs" );
         dx = ( max - min ) / divs;
 
-        if ( min < vMin_ )
-            vMin_ = min;
-        if ( max > vMax_ )
-            vMax_ = max;
+        if ( min < vMin )
+            vMin = min;
+        if ( max > vMax )
+            vMax = max;
         if ( dx < vDx )
             vDx = dx;
     }
-    double vDiv = ( vMax_ - vMin_ ) / vDx;
-    vDiv_ = static_cast< int >( vDiv + 0.5 ); // Round-off to nearest int.
+    if ( nVTables > 0 )
+    {
+        vMin_ = vMin;
+        vMax_ = vMax;
+        double vDiv = ( vMax_ - vMin_ ) / vDx;
+        vDiv_ = static_cast< int >( vDiv + 0.5 ); // Round-off to nearest int.
+    }
 
     caTable_ = LookupTable( caMin_, caMax_, caDiv_, caGate.size() );
     vTable_ = LookupTable( vMin_, vMax_, vDiv_, vGate.size() );
@@ -519,7 +579,248 @@ void HSolveActive::createLookupTables()
         }
     }
 
+    createLookupTables2D();
+}
+
+/**
+ * Makes a 2-D table for each gate of the 2-D channels, shared by all the
+ * copies of a prototype that read the same inputs, and points each gate at
+ * its inputs. Sets the gate's entry in column_ to its table.
+ */
+void HSolveActive::createLookupTables2D()
+{
+    static const double noInput = 0.0;
+    static const string indexField[] = { "Xindex", "Yindex", "Zindex" };
+
+    map< Id, unsigned int > poolIndex;
+    for ( unsigned int i = 0; i < caConcId_.size(); ++i )
+        poolIndex[ caConcId_[ i ] ] = i;
+
+    map< pair< Id, int >, unsigned int > tableIndex;
+    unsigned int ig = 0;
+    for ( unsigned int ichan = 0; ichan < channel_.size(); ++ichan )
+    {
+        const ChannelStruct& channel = channel_[ ichan ];
+        double power[] =
+            { channel.Xpower_, channel.Ypower_, channel.Zpower_ };
+        Id chanId = channelId_[ ichan ];
+        bool is2D = HSolveUtils::is2D( chanId );
+
+        // Inputs by dependency: Vm, conc and conc2.
+        const double* input[] =
+            { &V_[ chan2compt_[ ichan ] ], &noInput, &noInput };
+        if ( is2D )
+        {
+            vector< Id > pool;
+            if ( HSolveUtils::caDepend( chanId, pool ) > 0 )
+                input[ 1 ] = &ca_[ poolIndex[ pool.front() ] ];
+            pool.clear();
+            if ( HSolveUtils::targets( chanId, "concen2", pool, "CaConc" ) > 0 )
+                input[ 2 ] = &ca_[ poolIndex[ pool.front() ] ];
+        }
+
+        for ( unsigned int g = 0; g < 3; ++g )
+        {
+            if ( power[ g ] <= 0.0 )
+                continue;
+
+            if ( is2D )
+            {
+                int dep0, dep1;
+                HSolveUtils::dependency2D(
+                    Field< string >::get( chanId, indexField[ g ] ),
+                    dep0, dep1 );
+
+                pair< Id, int > key( gateId_[ ig ], 4 * ( dep0 + 1 ) + dep1 + 1 );
+                if ( tableIndex.find( key ) == tableIndex.end() )
+                {
+                    tableIndex[ key ] = table2D_.size();
+                    table2D_.push_back( table2D( gateId_[ ig ], dep0, dep1 ) );
+                }
+
+                column_[ ig ].column = tableIndex[ key ];
+                input2D_.push_back( dep0 < 0 ? &noInput : input[ dep0 ] );
+                input2D_.push_back( dep1 < 0 ? &noInput : input[ dep1 ] );
+            }
+
+            ++ig;
+        }
+    }
+}
+
+/**
+ * Samples a 2-D gate onto a table. An HHGate2D is sampled on the grid of
+ * its own table. An HHGateF2D, which is given by formulae, is sampled on
+ * the Vm or Ca range of the solver for each of its inputs, with at most
+ * MAX_DIVS_2D divisions each way.
+ */
+LookupTable2D HSolveActive::table2D( Id gate, int dep0, int dep1 ) const
+{
+    double min[ 2 ], max[ 2 ];
+    unsigned int divs[ 2 ];
+    if ( gate.element()->cinfo()->name() == "HHGate2D" )
+    {
+        min[ 0 ] = Field< double >::get( gate, "xmin" );
+        max[ 0 ] = Field< double >::get( gate, "xmax" );
+        divs[ 0 ] = Field< unsigned int >::get( gate, "xdivs" );
+        min[ 1 ] = Field< double >::get( gate, "ymin" );
+        max[ 1 ] = Field< double >::get( gate, "ymax" );
+        divs[ 1 ] = Field< unsigned int >::get( gate, "ydivs" );
+    }
+    else
+    {
+        int dep[] = { dep0, dep1 };
+        for ( unsigned int d = 0; d < 2; ++d )
+        {
+            if ( dep[ d ] == 0 )
+            {
+                min[ d ] = vMin_;
+                max[ d ] = vMax_;
+                divs[ d ] = std::min( ( unsigned int )vDiv_, MAX_DIVS_2D );
+            }
+            else if ( dep[ d ] > 0 )
+            {
+                min[ d ] = caMin_;
+                max[ d ] = caMax_;
+                divs[ d ] = std::min( ( unsigned int )caDiv_, MAX_DIVS_2D );
+            }
+            else
+            {
+                // Not an input: the gate always sees 0 here.
+                min[ d ] = max[ d ] = 0.0;
+                divs[ d ] = 1;
+            }
+        }
+    }
+    for ( unsigned int d = 0; d < 2; ++d )
+        if ( divs[ d ] == 0 )
+            divs[ d ] = 1;
+
+    LookupTable2D table( min[ 0 ], max[ 0 ], divs[ 0 ],
+                         min[ 1 ], max[ 1 ], divs[ 1 ] );
+    vector< double > xy( 2 );
+    for ( unsigned int ix = 0; ix <= divs[ 0 ]; ++ix )
+        for ( unsigned int iy = 0; iy <= divs[ 1 ]; ++iy )
+        {
+            xy[ 0 ] = table.x( ix );
+            xy[ 1 ] = table.y( iy );
+            table.set( ix, iy,
+                LookupField< vector< double >, double >::get( gate, "A", xy ),
+                LookupField< vector< double >, double >::get( gate, "B", xy ) );
+        }
 
+    return table;
+}
+
+/**
+ * Sorts the gates into batches for advanceChannels: one for each source of
+ * the lookup and instant flag. Within a batch the gates are sorted by
+ * column, and then by their order in state_.
+ */
+void HSolveActive::createGateBatches()
+{
+    // (column, state index, source index) of the gates of each batch.
+    typedef vector< pair< unsigned int, pair< unsigned int, unsigned int > > >
+        GateList;
+    GateList gates[ 8 ];
+
+    /*
+     * A channel on a Ca pool reads its row from a slot in caRowCompt_,
+     * which holds the rows of the pools of the compartment being advanced.
+     * Keep track of which pool each slot holds, so the batches read the
+     * same pool as the walk in reinitChannels.
+     */
+    vector< int > slotPool( caRowCompt_.size(), -1 );
+    unsigned int pool = 0;
+
+    const int instantFlag[] = { INSTANT_X, INSTANT_Y, INSTANT_Z };
+    unsigned int istate = 0;
+    unsigned int ichan = 0;
+    unsigned int i2D = 0;
+    vector< LookupRow* >::iterator icarow = caRow_.begin();
+    for ( unsigned int ic = 0; ic < nCompt_; ++ic )
+    {
+        for ( unsigned int k = 0; k < caCount_[ ic ]; ++k )
+            slotPool[ k ] = pool++;
+
+        unsigned int chanBoundary = ichan + channelCount_[ ic ];
+        for ( ; ichan < chanBoundary; ++ichan )
+        {
+            const ChannelStruct& channel = channel_[ ichan ];
+            double power[] =
+                { channel.Xpower_, channel.Ypower_, channel.Zpower_ };
+            bool is2D = HSolveUtils::is2D( channelId_[ ichan ] );
+            for ( unsigned int g = 0; g < 3; ++g )
+            {
+                if ( power[ g ] <= 0.0 )
+                    continue;
+
+                // Every Z gate has a caRow_, even if it is not used.
+                LookupRow* caRow = 0;
+                if ( g == 2 )
+                {
+                    caRow = *icarow;
+                    ++icarow;
+                }
+
+                GateBatch::Source source = GateBatch::VM;
+                unsigned int index = ic;
+                if ( is2D )
+                {
+                    source = GateBatch::TABLE_2D;
+                    index = i2D++;
+                }
+                else if ( g == 2 )
+                {
+                    if ( caRow )
+                    {
+                        source = GateBatch::CA_POOL;
+                        index = slotPool[ caRow - &caRowCompt_[ 0 ] ];
+                    }
+                    else
+                    {
+                        source = GateBatch::EXTERNAL_CA;
+                        index = ichan;
+                    }
+                }
+
+                bool instant = ( channel.instant_ & instantFlag[ g ] ) != 0;
+                gates[ 2 * source + instant ].push_back( make_pair(
+                        column_[ istate ].column, make_pair( istate, index ) ) );
+                ++istate;
+            }
+        }
+    }
+
+    gateBatch_.clear();
+    gateBatchDirty_ = false;
+    unsigned int maxSize = 0;
+    for ( unsigned int b = 0; b < 8; ++b )
+    {
+        if ( gates[ b ].empty() )
+            continue;
+
+        sort( gates[ b ].begin(), gates[ b ].end() );
+        gateBatch_.push_back( GateBatch() );
+        GateBatch& batch = gateBatch_.back();
+        batch.source = GateBatch::Source( b / 2 );
+        batch.instant = b % 2;
+        for ( GateList::iterator i = gates[ b ].begin();
+                i != gates[ b ].end(); ++i )
+        {
+            batch.column.push_back( i->first );
+            batch.state.push_back( i->second.first );
+            batch.index.push_back( i->second.second );
+        }
+        maxSize = max( maxSize, ( unsigned int )gates[ b ].size() );
+    }
+
+    vOffset_.resize( nCompt_ );
+    vFraction_.resize( nCompt_ );
+    caOffset_.resize( ca_.size() );
+    caFraction_.resize( ca_.size() );
+    gateC1_.resize( maxSize );
+    gateC2_.resize( maxSize );
 }
 
 /**
@@ -593,8 +894,83 @@ void HSolveActive::readExternalChannels()
     //~ );
 }
 
+/**
+ * Reads in MarkovChannels whose state is advanced by a MarkovSolver, which
+ * looks it up in tables of matrix exponentials. HSolve takes both of them
+ * off the clock (see HSolve::zombify), and calls them directly each step.
+ * Channels that use other solvers, such as MarkovGslSolver, stay outside
+ * and talk to their compartments through messages.
+ */
+void HSolveActive::readMarkovChannels()
+{
+    vector< string > solverClass;
+    solverClass.push_back( "MarkovSolver" );
+    solverClass.push_back( "MarkovSolverBase" );
+
+    map< Id, unsigned int > poolIndex;
+    for ( unsigned int i = 0; i < caConcId_.size(); ++i )
+        poolIndex[ caConcId_[ i ] ] = i;
+
+    vector< Id > chanId;
+    vector< Id > solverId;
+    vector< Id > other;
+    vector< Id >::iterator ichan;
+    vector< Id >::iterator iother;
+    for ( unsigned int ic = 0; ic < nCompt_; ++ic )
+    {
+        chanId.clear();
+        HSolveUtils::markovchannels( compartmentId_[ ic ], chanId );
+        for ( ichan = chanId.begin(); ichan != chanId.end(); ++ichan )
+        {
+            solverId.clear();
+            if ( HSolveUtils::targets(
+                    *ichan, "handleState", solverId, solverClass ) != 1 )
+                continue;
+
+            MarkovChanStruct markov( ic, ichan->eref(), solverId[ 0 ].eref() );
+
+            // Ligand from a Ca pool in the solver. Any other source goes
+            // on sending its messages to the MarkovSolver.
+            other.clear();
+            HSolveUtils::targets( solverId[ 0 ], "ligandConc", other, "CaConc" );
+            for ( iother = other.begin(); iother != other.end(); ++iother )
+                if ( poolIndex.find( *iother ) != poolIndex.end() )
+                {
+                    markov.ligand_ = &ca_[ poolIndex[ *iother ] ];
+                    break;
+                }
+
+            /*
+             * Current into a Ca pool in the solver goes in directly, unless
+             * the channel also has targets outside, in which case it sends
+             * Ik to all of them, as HHChannels do to targets outside.
+             */
+            other.clear();
+            HSolveUtils::targets( *ichan, "IkOut", other );
+            for ( iother = other.begin(); iother != other.end(); ++iother )
+                if ( poolIndex.find( *iother ) == poolIndex.end() )
+                    markov.outIk_ = true;
+            if ( !markov.outIk_ && !other.empty() )
+                markov.caTarget_ =
+                    &caActivation_[ poolIndex[ other.front() ] ];
+
+            markov_.push_back( markov );
+            markovChanId_.push_back( *ichan );
+            markovSolverId_.push_back( solverId[ 0 ] );
+        }
+    }
+}
+
 void HSolveActive::manageOutgoingMessages()
 {
+    /*
+     * Objects that the solver has taken over, and so need no messages from
+     * the compartments or Ca pools that it sends out on their behalf.
+     */
+    set< Id > internal( channelId_.begin(), channelId_.end() );
+    internal.insert( markovChanId_.begin(), markovChanId_.end() );
+    internal.insert( markovSolverId_.begin(), markovSolverId_.end() );
+
     vector< Id > targets;
     vector< string > filter;
 
@@ -602,48 +978,47 @@ void HSolveActive::manageOutgoingMessages()
      * Going through all comparments, and finding out which ones have external
      * targets through the VmOut msg. External refers to objects that do not
      * belong the cell being managed by this HSolve. We find these by excluding
-     * any HHChannels and SpikeGens from the VmOut targets. These will then
-     * be used in HSolveActive::sendValues() to send out the messages behalf of
-     * the original objects.
+     * any channels taken over and SpikeGens from the VmOut targets. These will
+     * then be used in HSolveActive::sendValues() to send out the messages
+     * behalf of the original objects.
      */
-    filter.push_back( "HHChannel" );
     filter.push_back( "SpikeGen" );
     for ( unsigned int ic = 0; ic < compartmentId_.size(); ++ic )
     {
         targets.clear();
 
-        int nTargets = HSolveUtils::targets(
-                           compartmentId_[ ic ],
-                           "VmOut",
-                           targets,
-                           filter,
-                           false    // include = false. That is, use filter to exclude.
-                       );
+        HSolveUtils::targets(
+            compartmentId_[ ic ],
+            "VmOut",
+            targets,
+            filter,
+            false    // include = false. That is, use filter to exclude.
+        );
 
-        if ( nTargets )
-            outVm_.push_back( ic );
+        for ( unsigned int i = 0; i < targets.size(); ++i )
+            if ( internal.find( targets[ i ] ) == internal.end() )
+            {
+                outVm_.push_back( ic );
+                break;
+            }
     }
 
     /*
      * As before, going through all CaConcs, and finding any which have external
      * targets.
      */
-    filter.clear();
-    filter.push_back( "HHChannel" );
     for ( unsigned int ica = 0; ica < caConcId_.size(); ++ica )
     {
         targets.clear();
 
-        int nTargets = HSolveUtils::targets(
-                           caConcId_[ ica ],
-                           "concOut",
-                           targets,
-                           filter,
-                           false    // include = false. That is, use filter to exclude.
-                       );
+        HSolveUtils::targets( caConcId_[ ica ], "concOut", targets );
 
-        if ( nTargets )
-            outCa_.push_back( ica );
+        for ( unsigned int i = 0; i < targets.size(); ++i )
+            if ( internal.find( targets[ i ] ) == internal.end() )
+            {
+                outCa_.push_back( ica );
+                break;
+            }
     }
 
     filter.clear();
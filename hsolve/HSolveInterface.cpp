@@ -71,6 +71,16 @@ double HSolve::getVm( Id id ) const
     return V_[ index ];
 }
 
+const double* HSolve::getVmAddress( Id id ) const
+{
+    map< Id, unsigned int >::const_iterator i = localIndex_.find( id );
+    // The map also holds CaConcs and channels, indexed in their own arrays.
+    if ( i == localIndex_.end() || i->second >= V_.size() ||
+            compartmentId_[ i->second ] != id )
+        return NULL;
+    return &V_[ i->second ];
+}
+
 void HSolve::setVm( Id id, double value )
 {
     unsigned int index = localIndex( id );
@@ -267,6 +277,9 @@ void HSolve::setPowers(
 {
     unsigned int index = localIndex( id );
     assert( index < channel_.size() );
+    // The gate batches need not be built again: the gates that are on
+    // have their places in state_ from setup, and the power itself is
+    // only used for the conductance.
     channel_[ index ].setPowers( Xpower, Ypower, Zpower );
 }
 
@@ -281,7 +294,10 @@ void HSolve::setInstant( Id id, int instant )
 {
     unsigned int index = localIndex( id );
     assert( index < channel_.size() );
-    channel_[ index ].instant_ = instant;
+    if ( channel_[ index ].instant_ != instant ) {
+        channel_[ index ].instant_ = instant;
+        gateBatchDirty_ = true;
+    }
 }
 
 double HSolve::getHHChannelGbar( Id id ) const
@@ -457,6 +473,15 @@ double HSolve::getCa( Id id ) const
     return ca_[ index ];
 }
 
+const double* HSolve::getCaAddress( Id id ) const
+{
+    map< Id, unsigned int >::const_iterator i = localIndex_.find( id );
+    if ( i == localIndex_.end() || i->second >= ca_.size() ||
+            i->second >= caConcId_.size() || caConcId_[ i->second ] != id )
+        return NULL;
+    return &ca_[ i->second ];
+}
+
 void HSolve::setCa( Id id, double Ca )
 {
     unsigned int index = localIndex( id );
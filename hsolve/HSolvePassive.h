@@ -21,7 +21,11 @@ class HSolvePassive: public HinesMatrix
 {
 #ifdef DO_UNIT_TESTS
 	friend void testHSolvePassive();
+	friend void testHinesGroup();
+	friend void testHinesSplit();
 #endif
+	friend class HinesGroup;
+	friend class HinesSplit;
 
 public:
 	void setup( Id seed, double dt );
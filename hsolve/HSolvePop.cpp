@@ -0,0 +1,347 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include "../basecode/header.h"
+#include "../basecode/global.h"
+#include "../basecode/ElementValueFinfo.h"
+#include "../utility/utility.h"
+#include "../utility/ThreadPool.h"
+#include "../shell/Shell.h"
+#include "../shell/Wildcard.h"
+#include "HSolveStruct.h"
+#include "HinesMatrix.h"
+#include "HSolvePassive.h"
+#include "RateLookup.h"
+#include "HSolveActive.h"
+#include "HSolve.h"
+#include "HinesGroup.h"
+#include "HSolvePop.h"
+
+#include <chrono>
+using namespace std::chrono;
+
+// Largest number of cells whose matrices are solved together. Bigger
+// blocks vectorize a little better, but stop fitting in cache.
+const unsigned int HSOLVEPOP_MAX_BLOCK = 64;
+
+const Cinfo* HSolvePop::initCinfo()
+{
+    static DestFinfo process(
+        "process",
+        "Handles 'process' call: Solver advances all cells by one time-step.",
+        new ProcOpFunc< HSolvePop >( &HSolvePop::process )
+    );
+
+    static DestFinfo reinit(
+        "reinit",
+        "Handles 'reinit' call: Solver reinitializes all cells.",
+        new ProcOpFunc< HSolvePop >( &HSolvePop::reinit )
+    );
+
+    static Finfo* processShared[] =
+    {
+        &process,
+        &reinit
+    };
+
+    static SharedFinfo proc(
+        "proc",
+        "Handles 'reinit' and 'process' calls from a clock.",
+        processShared,
+        sizeof( processShared ) / sizeof( Finfo* )
+    );
+
+    static ElementValueFinfo< HSolvePop, string > target(
+        "target",
+        "Wildcard path to the cells to be taken over, such as "
+        "'/network/cell#' or '/network/##[TYPE=Neuron]'. Each match is "
+        "treated as the 'target' of one HSolve: it can be any container "
+        "that has a single cell under it, or any compartment of the cell. "
+        "An HSolve is created for each cell, as a child of this object. "
+        "Setting the path again replaces them.",
+        &HSolvePop::setPath,
+        &HSolvePop::getPath
+    );
+
+    static ValueFinfo< HSolvePop, double > dt(
+        "dt",
+        "The time-step for this solver. Must be set before 'target'.",
+        &HSolvePop::setDt,
+        &HSolvePop::getDt
+    );
+
+    static ValueFinfo< HSolvePop, unsigned int > numThreads(
+        "numThreads",
+        "Number of threads over which the cells are spread. Values and "
+        "spikes are always sent out from the main thread, in the order "
+        "of the cells.",
+        &HSolvePop::setNumThreads,
+        &HSolvePop::getNumThreads
+    );
+
+    static ReadOnlyValueFinfo< HSolvePop, unsigned int > numCells(
+        "numCells",
+        "Number of cells taken over.",
+        &HSolvePop::getNumCells
+    );
+
+    static ReadOnlyValueFinfo< HSolvePop, unsigned int > numGroups(
+        "numGroups",
+        "Number of groups of cells with the same tree topology. The Hines "
+        "matrices of the cells in a group are solved together.",
+        &HSolvePop::getNumGroups
+    );
+
+    static Finfo* hsolvePopFinfos[] =
+    {
+        &target,            // Value
+        &dt,                // Value
+        &numThreads,        // Value
+        &numCells,          // ReadOnlyValue
+        &numGroups,         // ReadOnlyValue
+        &proc,              // Shared
+    };
+
+    static string doc[] =
+    {
+        "Name",             "HSolvePop",
+        "Author",           "NCBS",
+        "Description",      "HSolvePop: Hines solver for a population of "
+        "neurons. It makes an HSolve for each cell and advances them all "
+        "on its own clock tick. Cells with the same topology have their "
+        "Hines matrices solved together in interleaved arrays, and the "
+        "cells are spread over numThreads threads. Spikes and other "
+        "messages from the cells go out as with separate HSolves.",
+    };
+
+    static Dinfo< HSolvePop > dinfo;
+    static Cinfo hsolvePopCinfo(
+        "HSolvePop",
+        Neutral::initCinfo(),
+        hsolvePopFinfos,
+        sizeof( hsolvePopFinfos ) / sizeof( Finfo* ),
+        &dinfo,
+        doc,
+        sizeof( doc ) / sizeof( string )
+    );
+
+    return &hsolvePopCinfo;
+}
+
+static const Cinfo* hsolvePopCinfo = HSolvePop::initCinfo();
+
+HSolvePop::HSolvePop()
+    : dt_( 50e-6 ), numThreads_( 1 )
+{
+    numThreads_ = moose::getEnvInt( "MOOSE_NUM_THREADS", 1 );
+}
+
+HSolvePop::~HSolvePop()
+{
+    // The HSolves are children of this object, and go along with it.
+    ;
+}
+
+///////////////////////////////////////////////////
+// Dest function definitions
+///////////////////////////////////////////////////
+
+void HSolvePop::process( const Eref& e, ProcPtr p )
+{
+    high_resolution_clock::time_point t0 = high_resolution_clock::now();
+
+    auto advance = [this, p]( size_t b )
+    {
+        const vector< HSolve* >& cells = blockCells_[ b ];
+        for ( unsigned int i = 0; i < cells.size(); ++i )
+            cells[ i ]->prepareStep( p );
+        block_[ b ].solve();
+        for ( unsigned int i = 0; i < cells.size(); ++i )
+            cells[ i ]->completeStep( p );
+    };
+
+    if ( numThreads_ > 1 && block_.size() > 1 )
+        moose::ThreadPool::instance().parallelFor( block_.size(),
+                numThreads_, advance, blockCost_ );
+    else
+        for ( size_t b = 0; b < block_.size(); ++b )
+            advance( b );
+
+    // Messages go out from this thread, so that the objects receiving
+    // them need no locking, and in a fixed order.
+    for ( unsigned int i = 0; i < solver_.size(); ++i )
+        solver_[ i ]->sendStep( p );
+
+    high_resolution_clock::time_point t1 = high_resolution_clock::now();
+    addSolverProf( "HSolvePop", duration_cast<duration<double>>(t1 - t0).count(), 1 );
+}
+
+void HSolvePop::reinit( const Eref& e, ProcPtr p )
+{
+    dt_ = p->dt;
+    for ( unsigned int i = 0; i < solver_.size(); ++i )
+        solver_[ i ]->reinit( solverId_[ i ].eref(), p );
+    makeBlocks();
+}
+
+///////////////////////////////////////////////////
+// Setup
+///////////////////////////////////////////////////
+
+void HSolvePop::clearCells()
+{
+    Shell* shell = reinterpret_cast< Shell* >( Id().eref().data() );
+    for ( unsigned int i = 0; i < solverId_.size(); ++i )
+        if ( solverId_[ i ].element() )
+            shell->doDelete( solverId_[ i ] );
+    solverId_.clear();
+    solver_.clear();
+    group_.clear();
+    block_.clear();
+    blockCells_.clear();
+    blockCost_.clear();
+}
+
+void HSolvePop::makeGroups()
+{
+    group_.clear();
+    for ( unsigned int i = 0; i < solver_.size(); ++i )
+    {
+        vector< vector< unsigned int > >::iterator g;
+        for ( g = group_.begin(); g != group_.end(); ++g )
+            if ( HinesGroup::sameTopology(
+                        *solver_[ g->front() ], *solver_[ i ] ) )
+                break;
+        if ( g == group_.end() )
+            group_.push_back( vector< unsigned int >( 1, i ) );
+        else
+            g->push_back( i );
+    }
+}
+
+void HSolvePop::makeBlocks()
+{
+    blockCells_.clear();
+    blockCost_.clear();
+    unsigned int numThreads = std::max( numThreads_, 1U );
+    for ( unsigned int g = 0; g < group_.size(); ++g )
+    {
+        const vector< unsigned int >& group = group_[ g ];
+        unsigned int size = group.size();
+        // At least one block per thread if there are enough cells.
+        unsigned int numBlocks = std::max(
+                ( size + HSOLVEPOP_MAX_BLOCK - 1 ) / HSOLVEPOP_MAX_BLOCK,
+                std::min( numThreads, size ) );
+        for ( unsigned int b = 0; b < numBlocks; ++b )
+        {
+            vector< HSolve* > cells;
+            unsigned int end = size * ( b + 1 ) / numBlocks;
+            for ( unsigned int i = size * b / numBlocks; i < end; ++i )
+                cells.push_back( solver_[ group[ i ] ] );
+            blockCost_.push_back(
+                    double( cells.size() ) * cells[ 0 ]->getSize() );
+            blockCells_.push_back( cells );
+        }
+    }
+
+    block_.resize( blockCells_.size() );
+    for ( unsigned int b = 0; b < block_.size(); ++b )
+    {
+        vector< HSolvePassive* > cells( blockCells_[ b ].begin(),
+                blockCells_[ b ].end() );
+        block_[ b ].setup( cells );
+    }
+}
+
+///////////////////////////////////////////////////
+// Field function definitions
+///////////////////////////////////////////////////
+
+void HSolvePop::setPath( const Eref& e, string path )
+{
+    if ( dt_ <= 0.0 )
+    {
+        cerr << "Error: HSolvePop::setPath(): Must set 'dt' first.\n";
+        return;
+    }
+
+    clearCells();
+    path_ = path;
+
+    vector< ObjId > cells;
+    wildcardFind( path, cells );
+    Shell* shell = reinterpret_cast< Shell* >( Id().eref().data() );
+    for ( unsigned int i = 0; i < cells.size(); ++i )
+    {
+        ostringstream name;
+        name << "cell" << solverId_.size();
+        Id solverId = shell->doCreate( "HSolve", e.objId(), name.str(), 1 );
+        // This object advances the HSolves, not the clock.
+        solverId.element()->setTick( -1 );
+        HSolve* solver = reinterpret_cast< HSolve* >( solverId.eref().data() );
+        solver->setDt( dt_ );
+        solver->setPath( solverId.eref(), cells[ i ].path() );
+        if ( solver->getSeed() == Id() )
+        {
+            shell->doDelete( solverId );
+            continue;
+        }
+        solverId_.push_back( solverId );
+        solver_.push_back( solver );
+    }
+
+    if ( solver_.empty() )
+        cout << "Warning: HSolvePop::setPath(): No cells found on '"
+             << path << "'.\n";
+
+    makeGroups();
+    makeBlocks();
+}
+
+string HSolvePop::getPath( const Eref& e ) const
+{
+    return path_;
+}
+
+void HSolvePop::setDt( double dt )
+{
+    if ( dt < 0.0 )
+    {
+        cerr << "Error: HSolvePop: 'dt' must be positive.\n";
+        return;
+    }
+
+    dt_ = dt;
+}
+
+double HSolvePop::getDt() const
+{
+    return dt_;
+}
+
+void HSolvePop::setNumThreads( unsigned int numThreads )
+{
+    numThreads_ = numThreads;
+    makeBlocks();
+}
+
+unsigned int HSolvePop::getNumThreads() const
+{
+    return numThreads_;
+}
+
+unsigned int HSolvePop::getNumCells() const
+{
+    return solver_.size();
+}
+
+unsigned int HSolvePop::getNumGroups() const
+{
+    return group_.size();
+}
@@ -0,0 +1,81 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#ifndef _HSOLVE_POP_H
+#define _HSOLVE_POP_H
+
+class HSolve;
+class HinesGroup;
+
+/**
+ * HSolvePop advances a population of neurons with one solver.
+ *
+ * It takes a wildcard path of cells, and makes an HSolve for each one as
+ * a child element. These take over their cells exactly as a standalone
+ * HSolve would, but are taken off the clock: on each tick HSolvePop
+ * advances all of them itself. Cells whose trees have the same topology
+ * are put in groups, and the Hines matrices of each group are solved
+ * side by side in interleaved arrays (see HinesGroup). The groups are
+ * cut into blocks, which are spread over threads. Once all cells have
+ * advanced, their values and spikes are sent out from the main thread
+ * through the usual messages, so SynChans and Tables see no difference.
+ */
+class HSolvePop
+{
+public:
+    HSolvePop();
+    ~HSolvePop();
+
+    void process( const Eref& e, ProcPtr p );
+    void reinit( const Eref& e, ProcPtr p );
+
+    void setPath( const Eref& e, string path );
+    string getPath( const Eref& e ) const;
+
+    void setDt( double dt );
+    double getDt() const;
+
+    void setNumThreads( unsigned int numThreads );
+    unsigned int getNumThreads() const;
+
+    unsigned int getNumCells() const;
+    unsigned int getNumGroups() const;
+
+    static const Cinfo* initCinfo();
+
+private:
+    /// Removes the HSolves of the previous path, if any.
+    void clearCells();
+
+    /// Sorts the cells into groups of the same topology.
+    void makeGroups();
+
+    /// Splits the groups into blocks to be advanced by the threads.
+    void makeBlocks();
+
+    string path_;
+    double dt_;
+    unsigned int numThreads_;
+
+    /// One HSolve for each cell, in the order of the wildcard path.
+    vector< Id > solverId_;
+    vector< HSolve* > solver_;
+
+    /// Indices into solver_ of the cells in each group.
+    vector< vector< unsigned int > > group_;
+
+    /// Blocks of cells from one group, with their interleaved matrices.
+    vector< HinesGroup > block_;
+    vector< vector< HSolve* > > blockCells_;
+
+    /// Expected relative cost of advancing each block.
+    vector< double > blockCost_;
+};
+
+#endif // _HSOLVE_POP_H
@@ -10,6 +10,14 @@
 #include <cmath>
 #include "../basecode/header.h"
 #include "../biophysics/SpikeGen.h"
+#include "../biophysics/ChanBase.h"
+#include "../biophysics/ChanCommon.h"
+#include "../biophysics/MarkovChannel.h"
+#include "../biophysics/MatrixOps.h"
+#include "../biophysics/VectorTable.h"
+#include "../builtins/Interpol2D.h"
+#include "../biophysics/MarkovRateTable.h"
+#include "../biophysics/MarkovSolverBase.h"
 #include "HSolveStruct.h"
 
 void ChannelStruct::setPowers(
@@ -79,6 +87,47 @@ void SpikeGenStruct::send( ProcPtr info  )
 	spike->process( e_, info );
 }
 
+void MarkovChanStruct::reinit( double Vm, ProcPtr info )
+{
+	MarkovChannel* chan = reinterpret_cast< MarkovChannel* >( chan_.data() );
+	MarkovSolverBase* solver =
+		reinterpret_cast< MarkovSolverBase* >( solver_.data() );
+
+	solver->reinit( solver_, info );
+	chan->handleState( chan->getInitialState() );
+	chan->setVm( Vm );
+
+	// Only the open states conduct.
+	Gbars_ = chan->getGbars();
+	if ( Gbars_.size() > chan->getNumOpenStates() )
+		Gbars_.resize( chan->getNumOpenStates() );
+	Ek_ = chan->getEk( chan_ );
+	Gk_ = 0.0;
+}
+
+void MarkovChanStruct::advance( double Vm )
+{
+	MarkovChannel* chan = reinterpret_cast< MarkovChannel* >( chan_.data() );
+	MarkovSolverBase* solver =
+		reinterpret_cast< MarkovSolverBase* >( solver_.data() );
+
+	solver->handleVm( Vm );
+	if ( ligand_ )
+		solver->handleLigandConc( *ligand_ );
+	solver->computeState();
+
+	vector< double > state = solver->getState();
+	Gk_ = 0.0;
+	for ( unsigned int i = 0; i < Gbars_.size(); ++i )
+		Gk_ += Gbars_[ i ] * state[ i ];
+
+	chan->handleState( state );
+	chan->setVm( Vm );
+	chan->setGk( chan_, Gk_ );
+	chan->updateIk();
+	Ek_ = chan->getEk( chan_ );
+}
+
 CaConcStruct::CaConcStruct()
 	:
 		c_( 0.0 ),
@@ -127,6 +127,48 @@ struct SpikeGenStruct
 	void send( ProcPtr info );
 };
 
+/**
+ * A MarkovChannel taken over by the solver, along with the MarkovSolver
+ * that advances its state from tables of matrix exponentials. Neither is
+ * zombified. Both are taken off the clock, and HSolve calls them directly
+ * each step, in place of the messages between them and the compartment.
+ */
+struct MarkovChanStruct
+{
+	MarkovChanStruct( unsigned int compt, Eref chan, Eref solver )
+		:
+		compt_( compt ),
+		ligand_( 0 ),
+		caTarget_( 0 ),
+		outIk_( false ),
+		chan_( chan ),
+		solver_( solver ),
+		Gk_( 0.0 ),
+		Ek_( 0.0 )
+	{ ; }
+
+	unsigned int compt_;	///< Index of parent compartment
+	double* ligand_;		///< Ca pool in the solver that gives the ligand
+							///< conc. 0 if none, or if it comes by message.
+	double* caTarget_;		///< Ca pool in the solver fed by this channel.
+							///< Points into caActivation_.
+	bool outIk_;			///< Send Ik to targets outside the solver?
+	Eref chan_;
+	Eref solver_;
+	vector< double > Gbars_;	///< Conductance of each open state
+	double Gk_;
+	double Ek_;
+
+	/** Sets the initial state, and reads in the conductances. */
+	void reinit( double Vm, ProcPtr info );
+
+	/**
+	 * Advances the state by a step from the given Vm (and ligand conc),
+	 * finds Gk, and writes them all back into the channel.
+	 */
+	void advance( double Vm );
+};
+
 struct SynChanStruct
 {
 	// Index of parent compartment
@@ -61,11 +61,69 @@ int HSolveUtils::channels( Id compartment, vector< Id >& ret )
 	return targets( compartment, "channel", ret );
 }
 
+/**
+ * The channel classes that HSolve takes over as HH channels.
+ */
+const vector< string >& HSolveUtils::hhchannelClasses()
+{
+	static vector< string > classes;
+	if ( classes.empty() ) {
+		classes.push_back( "HHChannel" );
+		classes.push_back( "HHChannelF" );
+		classes.push_back( "HHChannel2D" );
+		classes.push_back( "HHChannelF2D" );
+	}
+	return classes;
+}
+
 int HSolveUtils::hhchannels( Id compartment, vector< Id >& ret )
 {
-	// Request for elements of type "HHChannel" only since
+	// Request for elements of the HH channel types only since
 	// channel messages can lead to synchans as well.
-	return targets( compartment, "channel", ret, "HHChannel" );
+	return targets( compartment, "channel", ret, hhchannelClasses() );
+}
+
+int HSolveUtils::markovchannels( Id compartment, vector< Id >& ret )
+{
+	return targets( compartment, "channel", ret, "MarkovChannel" );
+}
+
+/**
+ * Tells whether a channel is one of the 2-D types, whose gates depend on
+ * two of Vm, conc and conc2.
+ */
+bool HSolveUtils::is2D( Id channel )
+{
+	const string& name = channel.element()->cinfo()->name();
+	return name == "HHChannel2D" || name == "HHChannelF2D";
+}
+
+/**
+ * Finds the inputs of a gate of a 2-D channel from its Xindex, Yindex or
+ * Zindex string, as in HHChannel2D: 0 for Vm, 1 for conc, 2 for conc2,
+ * and -1 for none. dep0 is the first argument of the gate, and dep1 the
+ * second.
+ */
+void HSolveUtils::dependency2D( const string& index, int& dep0, int& dep1 )
+{
+	dep0 = -1;
+	dep1 = -1;
+	if ( index == "VOLT_INDEX" ) {
+		dep0 = 0;
+	} else if ( index == "C1_INDEX" ) {
+		dep0 = 1;
+	} else if ( index == "C2_INDEX" ) {
+		dep0 = 2;
+	} else if ( index == "VOLT_C1_INDEX" ) {
+		dep0 = 0;
+		dep1 = 1;
+	} else if ( index == "VOLT_C2_INDEX" ) {
+		dep0 = 0;
+		dep1 = 2;
+	} else if ( index == "C1_C2_INDEX" ) {
+		dep0 = 1;
+		dep1 = 2;
+	}
 }
 
 /**
@@ -108,7 +166,9 @@ int HSolveUtils::gates(
                 SIMPLE_ASSERT_MSG(gPath == gatePath, errorSS.str().c_str());
 
                 if ( getOriginals ) {
-                    HHGate* g = reinterpret_cast< HHGate* >( gate.eref().data() );
+                    // All the gate types derive from HHGateBase.
+                    HHGateBase* g =
+                        reinterpret_cast< HHGateBase* >( gate.eref().data() );
                     gate = g->originalGateId();
                 }
 
@@ -209,6 +269,21 @@ void HSolveUtils::rates(
 	vector< double >& B )
 {
     // dump("HSolveUtils::rates() has not been tested yet.", "WARN");
+    /*
+     * Gates given by formulae (HHGateF) have no table of their own, so they
+     * are evaluated on each point of the grid.
+     */
+    if ( gateId.element()->cinfo()->name() == "HHGateF" ) {
+        A.resize( grid.size() );
+        B.resize( grid.size() );
+        for ( unsigned int igrid = 0; igrid < grid.size(); ++igrid ) {
+            double x = grid.entry( igrid );
+            A[ igrid ] = LookupField< double, double >::get( gateId, "A", x );
+            B[ igrid ] = LookupField< double, double >::get( gateId, "B", x );
+        }
+        return;
+    }
+
     double min = Field< double >::get( gateId, "min" );
     double max = Field< double >::get( gateId, "max" );
     unsigned int divs = Field< unsigned int >::get( gateId, "divs" );
@@ -31,7 +31,11 @@ public:
     static int adjacent( Id compartment, Id exclude, vector< Id >& ret );
     static int children( Id compartment, vector< Id >& ret );
     static int channels( Id compartment, vector< Id >& ret );
+    static const vector< string >& hhchannelClasses();
     static int hhchannels( Id compartment, vector< Id >& ret );
+    static int markovchannels( Id compartment, vector< Id >& ret );
+    static bool is2D( Id channel );
+    static void dependency2D( const string& index, int& dep0, int& dep1 );
     static int gates( Id channel, vector< Id >& ret, bool getOriginals = true );
     static int spikegens( Id compartment, vector< Id >& ret );
     static int synchans( Id compartment, vector< Id >& ret );
@@ -0,0 +1,493 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include "HSolvePassive.h"
+#include "HinesGroup.h"
+
+HinesGroup::HinesGroup()
+    : nCell_( 0 ), nCompt_( 0 )
+{
+    ;
+}
+
+bool HinesGroup::sameTopology( const HSolvePassive& a,
+        const HSolvePassive& b )
+{
+    if ( a.nCompt_ != b.nCompt_ || a.HJ_.size() != b.HJ_.size() )
+        return false;
+    for ( unsigned int i = 0; i < a.nCompt_; ++i )
+        if ( a.tree_[ i ].children != b.tree_[ i ].children )
+            return false;
+    return true;
+}
+
+void HinesGroup::setup( const vector< HSolvePassive* >& cells )
+{
+    cell_ = cells;
+    nCell_ = cells.size();
+    nCompt_ = 0;
+    junction_.clear();
+    HS_.clear();
+    HJ_.clear();
+    HJCopy_.clear();
+    VMid_.clear();
+    operand_.clear();
+    backOperand_.clear();
+    if ( nCell_ == 0 )
+        return;
+
+    const HSolvePassive& first = *cells[ 0 ];
+    nCompt_ = first.nCompt_;
+    junction_ = first.junction_;
+
+    HS_.resize( first.HS_.size() * nCell_ );
+    HJCopy_.resize( first.HJCopy_.size() * nCell_ );
+    for ( unsigned int c = 0; c < nCell_; ++c )
+    {
+        const HSolvePassive& cell = *cells[ c ];
+        assert( sameTopology( first, cell ) );
+        for ( unsigned int k = 0; k < cell.HS_.size(); ++k )
+            HS_[ k * nCell_ + c ] = cell.HS_[ k ];
+        for ( unsigned int k = 0; k < cell.HJCopy_.size(); ++k )
+            HJCopy_[ k * nCell_ + c ] = cell.HJCopy_[ k ];
+    }
+    HJ_ = HJCopy_;
+    VMid_.assign( nCompt_ * nCell_, 0.0 );
+
+    for ( unsigned int i = 0; i < first.operand_.size(); ++i )
+        operand_.push_back( interleaved( first, &*first.operand_[ i ] ) );
+    for ( unsigned int i = 0; i < first.backOperand_.size(); ++i )
+        backOperand_.push_back(
+                interleaved( first, &*first.backOperand_[ i ] ) );
+}
+
+double* HinesGroup::interleaved( const HSolvePassive& cell, const double* p )
+{
+    const vector< double >* src[] = { &cell.HS_, &cell.HJ_, &cell.VMid_ };
+    vector< double >* dest[] = { &HS_, &HJ_, &VMid_ };
+    for ( unsigned int i = 0; i < 3; ++i )
+    {
+        const vector< double >& v = *src[ i ];
+        if ( !v.empty() && p >= &v[ 0 ] && p < &v[ 0 ] + v.size() )
+            return &( *dest[ i ] )[ ( p - &v[ 0 ] ) * nCell_ ];
+    }
+    assert( 0 );
+    return 0;
+}
+
+unsigned int HinesGroup::size() const
+{
+    return nCell_;
+}
+
+unsigned int HinesGroup::numCompartments() const
+{
+    return nCompt_;
+}
+
+void HinesGroup::solve()
+{
+    if ( nCell_ == 0 || nCompt_ == 0 )
+        return;
+
+    gather();
+    forwardEliminate();
+    backwardSubstitute();
+    scatter();
+}
+
+/**
+ * Of the Hines matrix, the elimination only changes the diagonal and the
+ * right-hand side, which updateMatrix refills each step, and the
+ * junction entries, which are restored from HJCopy_.
+ */
+void HinesGroup::gather()
+{
+    if ( !HJ_.empty() )
+        memcpy( &HJ_[ 0 ], &HJCopy_[ 0 ], sizeof( double ) * HJ_.size() );
+
+    for ( unsigned int c = 0; c < nCell_; ++c )
+    {
+        const vector< double >& hs = cell_[ c ]->HS_;
+        double* ihs = &HS_[ c ];
+        for ( unsigned int ic = 0; ic < nCompt_; ++ic )
+        {
+            ihs[ 0 ] = hs[ 4 * ic ];
+            ihs[ 3 * nCell_ ] = hs[ 4 * ic + 3 ];
+            ihs += 4 * nCell_;
+        }
+    }
+}
+
+/**
+ * Same as HSolvePassive::forwardEliminate, with each operation done for
+ * all cells in turn. Offset k from an operand is entry k * n.
+ */
+void HinesGroup::forwardEliminate()
+{
+    const unsigned int n = nCell_;
+    unsigned int ic = 0;
+    double* ihs = &HS_[ 0 ];
+    vector< double* >::iterator iop = operand_.begin();
+    vector< JunctionStruct >::iterator junction;
+
+    for ( junction = junction_.begin();
+            junction != junction_.end();
+            junction++ )
+    {
+        unsigned int index = junction->index;
+        unsigned int rank = junction->rank;
+
+        for ( ; ic < index; ++ic, ihs += 4 * n )
+        {
+            const double* d = ihs;
+            const double* a = ihs + n;
+            const double* b = ihs + 3 * n;
+            double* d1 = ihs + 4 * n;
+            double* b1 = ihs + 7 * n;
+            for ( unsigned int c = 0; c < n; ++c )
+            {
+                double f = a[ c ] / d[ c ];
+                d1[ c ] -= f * a[ c ];
+                b1[ c ] -= f * b[ c ];
+            }
+        }
+
+        const double* pivot = ihs;
+        const double* b = ihs + 3 * n;
+        if ( rank == 1 )
+        {
+            double* j = *iop;
+            double* s = *( iop + 1 );
+            for ( unsigned int c = 0; c < n; ++c )
+            {
+                double division = j[ n + c ] / pivot[ c ];
+                s[ c ]         -= division * j[ c ];
+                s[ 3 * n + c ] -= division * b[ c ];
+            }
+
+            iop += 3;
+        }
+        else if ( rank == 2 )
+        {
+            double* j = *iop;
+            double* s0 = *( iop + 1 );
+            double* s1 = *( iop + 3 );
+            for ( unsigned int c = 0; c < n; ++c )
+            {
+                double division = j[ n + c ] / pivot[ c ];
+                s0[ c ]         -= division * j[ c ];
+                j[ 4 * n + c ]  -= division * j[ 2 * n + c ];
+                s0[ 3 * n + c ] -= division * b[ c ];
+
+                division        = j[ 3 * n + c ] / pivot[ c ];
+                j[ 5 * n + c ]  -= division * j[ c ];
+                s1[ c ]         -= division * j[ 2 * n + c ];
+                s1[ 3 * n + c ] -= division * b[ c ];
+            }
+
+            iop += 5;
+        }
+        else
+        {
+            vector< double* >::iterator
+            end = iop + 3 * rank * ( rank + 1 );
+            for ( ; iop < end; iop += 3 )
+            {
+                double* target = *iop;
+                const double* above = *( iop + 1 );
+                const double* left = *( iop + 2 );
+                for ( unsigned int c = 0; c < n; ++c )
+                    target[ c ] -= left[ c ] / pivot[ c ] * above[ c ];
+            }
+        }
+
+        ++ic, ihs += 4 * n;
+    }
+
+    for ( ; ic < nCompt_ - 1; ++ic, ihs += 4 * n )
+    {
+        const double* d = ihs;
+        const double* a = ihs + n;
+        const double* b = ihs + 3 * n;
+        double* d1 = ihs + 4 * n;
+        double* b1 = ihs + 7 * n;
+        for ( unsigned int c = 0; c < n; ++c )
+        {
+            double f = a[ c ] / d[ c ];
+            d1[ c ] -= f * a[ c ];
+            b1[ c ] -= f * b[ c ];
+        }
+    }
+}
+
+/**
+ * Same as HSolvePassive::backwardSubstitute, which walks the operands
+ * in reverse, and leaves the new voltages for scatter() to apply.
+ */
+void HinesGroup::backwardSubstitute()
+{
+    const unsigned int n = nCell_;
+    int ic = nCompt_ - 1;
+    vector< double* >::reverse_iterator iop = operand_.rbegin();
+    vector< double* >::reverse_iterator ibop = backOperand_.rbegin();
+    vector< JunctionStruct >::reverse_iterator junction;
+
+    const double* d = &HS_[ 4 * ic * n ];
+    const double* a;
+    const double* b = d + 3 * n;
+    double* vmid = &VMid_[ ic * n ];
+    for ( unsigned int c = 0; c < n; ++c )
+        vmid[ c ] = b[ c ] / d[ c ];
+    --ic;
+
+    for ( junction = junction_.rbegin();
+            junction != junction_.rend();
+            junction++ )
+    {
+        int index = junction->index;
+        int rank = junction->rank;
+
+        for ( ; ic > index; --ic )
+        {
+            d = &HS_[ 4 * ic * n ];
+            a = d + n;
+            b = d + 3 * n;
+            vmid = &VMid_[ ic * n ];
+            for ( unsigned int c = 0; c < n; ++c )
+                vmid[ c ] = ( b[ c ] - a[ c ] * vmid[ n + c ] ) / d[ c ];
+        }
+
+        d = &HS_[ 4 * ic * n ];
+        b = d + 3 * n;
+        vmid = &VMid_[ ic * n ];
+        if ( rank == 1 )
+        {
+            const double* v = *iop;
+            const double* j = *( iop + 2 );
+            for ( unsigned int c = 0; c < n; ++c )
+                vmid[ c ] = ( b[ c ] - v[ c ] * j[ c ] ) / d[ c ];
+
+            iop += 3;
+        }
+        else if ( rank == 2 )
+        {
+            const double* v0 = *iop;
+            const double* v1 = *( iop + 2 );
+            const double* j = *( iop + 4 );
+            for ( unsigned int c = 0; c < n; ++c )
+                vmid[ c ] = ( b[ c ]
+                              - v0[ c ] * j[ 2 * n + c ]
+                              - v1[ c ] * j[ c ]
+                            ) / d[ c ];
+
+            iop += 5;
+        }
+        else
+        {
+            for ( unsigned int c = 0; c < n; ++c )
+                vmid[ c ] = b[ c ];
+            for ( int i = 0; i < rank; ++i )
+            {
+                const double* v = *ibop;
+                const double* j = *( ibop + 1 );
+                for ( unsigned int c = 0; c < n; ++c )
+                    vmid[ c ] -= v[ c ] * j[ c ];
+                ibop += 2;
+            }
+            for ( unsigned int c = 0; c < n; ++c )
+                vmid[ c ] /= d[ c ];
+
+            iop += 3 * rank * ( rank + 1 );
+        }
+        --ic;
+    }
+
+    for ( ; ic >= 0; --ic )
+    {
+        d = &HS_[ 4 * ic * n ];
+        a = d + n;
+        b = d + 3 * n;
+        vmid = &VMid_[ ic * n ];
+        for ( unsigned int c = 0; c < n; ++c )
+            vmid[ c ] = ( b[ c ] - a[ c ] * vmid[ n + c ] ) / d[ c ];
+    }
+}
+
+void HinesGroup::scatter()
+{
+    for ( unsigned int c = 0; c < nCell_; ++c )
+    {
+        HSolvePassive& cell = *cell_[ c ];
+        const double* ivmid = &VMid_[ c ];
+        for ( unsigned int ic = 0; ic < nCompt_; ++ic )
+        {
+            cell.VMid_[ ic ] = *ivmid;
+            cell.V_[ ic ] = 2 * *ivmid - cell.V_[ ic ];
+            ivmid += nCell_;
+        }
+        cell.stage_ = 2;    // Backward substitution done.
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+#ifdef DO_UNIT_TESTS
+
+#include <sstream>
+#include "../shell/Shell.h"
+
+/**
+ * Solves copies of a cell with different passive properties, as one
+ * group and one by one, and compares the voltages.
+ */
+void testHinesGroup()
+{
+    Shell* shell = reinterpret_cast< Shell* >( Id().eref().data() );
+
+    /*
+     * Two of the cells from testHSolvePassive: one with junctions of
+     * rank 1, 2 and 3, and one with a junction of rank 5.
+     */
+    int childArray_1[ ] =
+    {
+        /* c0  */  -1,
+        /* c1  */  -1, 0,
+        /* c2  */  -1, 1,
+        /* c3  */  -1,
+        /* c4  */  -1, 3,
+        /* c5  */  -1,
+        /* c6  */  -1, 5,
+        /* c7  */  -1, 4, 6,
+        /* c8  */  -1, 7,
+        /* c9  */  -1, 8,
+        /* c10 */  -1,
+        /* c11 */  -1, 10,
+        /* c12 */  -1,
+        /* c13 */  -1, 12,
+        /* c14 */  -1, 11, 13,
+        /* c15 */  -1, 14, 16,
+        /* c16 */  -1, 17,
+        /* c17 */  -1, 2, 9, 18,
+        /* c18 */  -1, 19,
+        /* c19 */  -1,
+    };
+    int childArray_2[ ] =
+    {
+        /* c0  */  -1,
+        /* c1  */  -1,
+        /* c2  */  -1,
+        /* c3  */  -1, 4,
+        /* c4  */  -1, 0, 1, 2, 5, 6,
+        /* c5  */  -1,
+        /* c6  */  -1,
+    };
+    int* childArray[] = { childArray_1, childArray_2 };
+    unsigned int childArraySize[] =
+    {
+        sizeof( childArray_1 ) / sizeof( int ),
+        sizeof( childArray_2 ) / sizeof( int )
+    };
+
+    const unsigned int numCopies = 5;
+    const double dt = 1e-3;
+    vector< Id > neutrals;
+    vector< vector< HSolvePassive > > single( 2 );
+    vector< vector< HSolvePassive > > member( 2 );
+    for ( unsigned int cell = 0; cell < 2; ++cell )
+    {
+        int* array = childArray[ cell ];
+        unsigned int arraySize = childArraySize[ cell ];
+        int nCompt = count( array, array + arraySize, -1 );
+        single[ cell ].resize( numCopies );
+        member[ cell ].resize( numCopies );
+
+        for ( unsigned int copy = 0; copy < numCopies; ++copy )
+        {
+            ostringstream cellName;
+            cellName << "n" << cell << "_" << copy;
+            Id n = shell->doCreate( "Neutral", Id(), cellName.str(), 1 );
+            neutrals.push_back( n );
+
+            vector< Id > c( nCompt );
+            for ( int i = 0; i < nCompt; ++i )
+            {
+                ostringstream name;
+                name << "c" << i;
+                c[ i ] = shell->doCreate( "Compartment", n, name.str(), 1 );
+                double x = 1.0 + 0.1 * copy;
+                Field< double >::set( c[ i ], "Ra", ( 15.0 + 3.0 * i ) * x );
+                Field< double >::set( c[ i ], "Rm", 45.0 + 15.0 * i * x );
+                Field< double >::set( c[ i ], "Cm", 0.5 + 0.2 * i / x );
+                Field< double >::set( c[ i ], "Em", -0.06 );
+                Field< double >::set( c[ i ], "initVm", -0.06 );
+                Field< double >::set( c[ i ], "Vm",
+                        -0.06 + 0.01 * i - 0.005 * copy );
+            }
+
+            int parent = -1;
+            for ( unsigned int a = 0; a < arraySize; ++a )
+                if ( array[ a ] == -1 )
+                    ++parent;
+                else
+                    shell->doAddMsg( "Single", c[ parent ], "axial",
+                            c[ array[ a ] ], "raxial" );
+
+            single[ cell ][ copy ].setup( c[ 0 ], dt );
+            member[ cell ][ copy ].setup( c[ 0 ], dt );
+        }
+    }
+
+    ASSERT( HinesGroup::sameTopology( member[ 0 ][ 0 ], member[ 0 ][ 3 ] ),
+            "Hines group: topology" );
+    ASSERT( !HinesGroup::sameTopology( member[ 0 ][ 0 ], member[ 1 ][ 0 ] ),
+            "Hines group: topology" );
+
+    for ( unsigned int cell = 0; cell < 2; ++cell )
+    {
+        vector< HSolvePassive* > cells;
+        for ( unsigned int copy = 0; copy < numCopies; ++copy )
+            cells.push_back( &member[ cell ][ copy ] );
+        HinesGroup group;
+        group.setup( cells );
+        ASSERT( group.size() == numCopies, "Hines group: setup" );
+
+        for ( int pass = 0; pass < 3; ++pass )
+        {
+            for ( unsigned int copy = 0; copy < numCopies; ++copy )
+            {
+                single[ cell ][ copy ].solve();
+                member[ cell ][ copy ].updateMatrix();
+            }
+            group.solve();
+
+            for ( unsigned int copy = 0; copy < numCopies; ++copy )
+            {
+                const HSolvePassive& s = single[ cell ][ copy ];
+                const HSolvePassive& m = member[ cell ][ copy ];
+                for ( unsigned int i = 0; i < s.getSize(); ++i )
+                {
+                    ostringstream error;
+                    error << "Hines group: Pass " << pass << " Cell# "
+                          << cell << " copy " << copy << " V(" << i << ")";
+                    ASSERT( fabs( s.getVMid( i ) - m.getVMid( i ) ) <=
+                            1e-12 * fabs( s.getVMid( i ) ), error.str() );
+                    ASSERT( fabs( s.V_[ i ] - m.V_[ i ] ) <=
+                            1e-12 * fabs( s.V_[ i ] ), error.str() );
+                }
+            }
+        }
+    }
+
+    for ( unsigned int i = 0; i < neutrals.size(); ++i )
+        shell->doDelete( neutrals[ i ] );
+    cout << "." << flush;
+}
+
+#endif // DO_UNIT_TESTS
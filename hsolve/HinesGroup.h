@@ -0,0 +1,90 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#ifndef _HINES_GROUP_H
+#define _HINES_GROUP_H
+
+/**
+ * Solves the Hines matrices of a group of cells with identical tree
+ * topology side by side.
+ *
+ * The matrices of the cells share their pattern of junctions and
+ * operands, so the group keeps a single copy of it, and stores the
+ * matrix entries and mid-step voltages interleaved: entry k of cell c
+ * is at k * size() + c. Every step of the forward elimination and
+ * backward substitution then becomes a loop across the cells over
+ * contiguous memory, which the compiler vectorizes, in place of a chain
+ * of dependent divisions within one cell.
+ *
+ * The cells remain ordinary HSolvePassive objects that own their
+ * channels, voltages and messages. Each step they fill in their own
+ * matrices as usual; solve() gathers the entries that change, does the
+ * elimination for all cells at once, and writes VMid and V back into
+ * each cell. The arithmetic is done in the same order as in
+ * HSolvePassive, so the results match those of solving each cell alone.
+ */
+class HinesGroup
+{
+public:
+    HinesGroup();
+
+    /// True if the Hines matrices of a and b have the same structure.
+    static bool sameTopology( const HSolvePassive& a,
+            const HSolvePassive& b );
+
+    /**
+     * Takes on a set of cells, all with the same topology. Must be
+     * called again if any of their passive properties change.
+     */
+    void setup( const vector< HSolvePassive* >& cells );
+
+    /**
+     * Solves the matrix equations of all the cells, which must already
+     * have been updated for this time-step, and leaves the new Vm in
+     * each cell.
+     */
+    void solve();
+
+    /// Number of cells in the group.
+    unsigned int size() const;
+
+    /// Number of compartments in each cell.
+    unsigned int numCompartments() const;
+
+private:
+    void gather();
+    void forwardEliminate();
+    void backwardSubstitute();
+    void scatter();
+
+    /**
+     * Converts an operand of the first cell, which points into its
+     * HS_, HJ_ or VMid_, into a pointer to the same entry of cell 0
+     * in the interleaved arrays.
+     */
+    double* interleaved( const HSolvePassive& cell, const double* p );
+
+    vector< HSolvePassive* > cell_;
+    unsigned int nCell_;
+    unsigned int nCompt_;
+
+    vector< JunctionStruct > junction_;
+
+    /// Interleaved copies of HS_, HJ_, HJCopy_ and VMid_ of the cells.
+    vector< double > HS_;
+    vector< double > HJ_;
+    vector< double > HJCopy_;
+    vector< double > VMid_;
+
+    /// As in HinesMatrix, but pointing into the interleaved arrays.
+    vector< double* > operand_;
+    vector< double* > backOperand_;
+};
+
+#endif // _HINES_GROUP_H
@@ -0,0 +1,467 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include "HSolvePassive.h"
+#include "HinesSplit.h"
+#include "../utility/ThreadPool.h"
+
+HinesSplit::HinesSplit()
+    : numThreads_( 1 ), trunkSize_( 0 )
+{
+    ;
+}
+
+void HinesSplit::setup( const HSolvePassive& cell, unsigned int numThreads )
+{
+    const unsigned int n = cell.nCompt_;
+    numThreads_ = numThreads;
+    subtree_.clear();
+    trunk_.clear();
+    cost_.clear();
+    operandStart_.clear();
+    backOperandStart_.clear();
+    trunkSize_ = n;
+    if ( numThreads < 2 || n < 2 || cell.tree_.size() != n )
+        return;
+
+    unsigned int op = 0;
+    unsigned int backOp = 0;
+    vector< JunctionStruct >::const_iterator junction;
+    for ( junction = cell.junction_.begin();
+            junction != cell.junction_.end();
+            ++junction )
+    {
+        unsigned int rank = junction->rank;
+        operandStart_.push_back( op );
+        backOperandStart_.push_back( backOp );
+        if ( rank == 1 )
+            op += 3;
+        else if ( rank == 2 )
+            op += 5;
+        else
+        {
+            op += 3 * rank * ( rank + 1 );
+            backOp += 2 * rank;
+        }
+    }
+
+    /*
+     * The rows that eliminating each row changes, as set up in
+     * HinesMatrix::makeJunctions: the next row, or the later members of
+     * its junction. next is the lowest of these, which is the parent of
+     * the row in the elimination tree, and reach the highest.
+     */
+    vector< unsigned int > next( n );
+    vector< unsigned int > reach( n );
+    for ( unsigned int i = 0; i < n; ++i )
+        next[ i ] = reach[ i ] = min( i + 1, n - 1 );
+    for ( unsigned int i = 0; i < n; ++i )
+    {
+        const vector< unsigned int >& c = cell.tree_[ i ].children;
+        if ( c.empty() )
+            continue;
+        if ( c.size() == 1 && ( c[ 0 ] == i + 1 || c[ 0 ] + 1 == i ) )
+            continue;
+
+        vector< unsigned int > group( c );
+        group.push_back( i );
+        sort( group.begin(), group.end() );
+        for ( unsigned int k = 0; k + 1 < group.size(); ++k )
+        {
+            next[ group[ k ] ] = group[ k + 1 ];
+            reach[ group[ k ] ] = group.back();
+        }
+    }
+
+    // Size, lowest row and furthest reach of the subtree under each row.
+    vector< vector< unsigned int > > below( n );
+    vector< unsigned int > size( n, 1 );
+    vector< unsigned int > low( n );
+    vector< unsigned int > far( reach );
+    for ( unsigned int i = 0; i < n; ++i )
+        low[ i ] = i;
+    for ( unsigned int i = 0; i + 1 < n; ++i )
+    {
+        unsigned int p = next[ i ];
+        if ( p <= i )
+            return;    // Not in Hines' order.
+        below[ p ].push_back( i );
+        size[ p ] += size[ i ];
+        low[ p ] = min( low[ p ], low[ i ] );
+        far[ p ] = max( far[ p ], far[ i ] );
+    }
+
+    /*
+     * Starting from the root, subtrees that are too large for one task
+     * are cut below their root, which goes into the trunk. A subtree can
+     * only be a task if its rows are contiguous and none of them other
+     * than the root reaches past the root. Unbranched stretches are not
+     * cut through if they would put much of the subtree into the trunk.
+     */
+    const unsigned int limit = max( n / ( 4 * numThreads ), 2U );
+    vector< unsigned int > root;
+    vector< unsigned int > stack( 1, n - 1 );
+    while ( !stack.empty() )
+    {
+        unsigned int c = stack.back();
+        stack.pop_back();
+        if ( size[ c ] < 2 )
+            continue;
+
+        bool task = ( size[ c ] == c - low[ c ] + 1 );
+        for ( unsigned int k = 0; k < below[ c ].size(); ++k )
+            task = task && far[ below[ c ][ k ] ] <= c;
+
+        if ( task && size[ c ] > limit )
+        {
+            unsigned int b = c;
+            unsigned int chain = 0;
+            while ( below[ b ].size() == 1 )
+            {
+                b = below[ b ][ 0 ];
+                ++chain;
+            }
+            task = below[ b ].empty() || chain > size[ c ] / 4;
+        }
+
+        if ( task )
+            root.push_back( c );
+        else
+            stack.insert( stack.end(), below[ c ].begin(), below[ c ].end() );
+    }
+
+    if ( root.size() < 2 )
+        return;
+
+    // The trunk is everything outside the subtrees, including their roots.
+    sort( root.begin(), root.end() );
+    unsigned int begin = 0;
+    trunkSize_ = 0;
+    for ( unsigned int k = 0; k < root.size(); ++k )
+    {
+        unsigned int r = root[ k ];
+        if ( low[ r ] > begin )
+        {
+            trunk_.push_back( makeSegment( cell, begin, low[ r ] ) );
+            trunkSize_ += low[ r ] - begin;
+        }
+        subtree_.push_back( makeSegment( cell, low[ r ], r ) );
+        cost_.push_back( size[ r ] );
+        begin = r;
+    }
+    trunk_.push_back( makeSegment( cell, begin, n ) );
+    trunkSize_ += n - begin;
+}
+
+HinesSplit::Segment HinesSplit::makeSegment( const HSolvePassive& cell,
+        unsigned int begin, unsigned int end ) const
+{
+    Segment s;
+    s.begin = begin;
+    s.end = end;
+    s.jBegin = s.jEnd = 0;
+    for ( unsigned int j = 0; j < cell.junction_.size(); ++j )
+    {
+        unsigned int index = cell.junction_[ j ].index;
+        if ( index < begin )
+            s.jBegin = j + 1;
+        if ( index < end )
+            s.jEnd = j + 1;
+    }
+    return s;
+}
+
+unsigned int HinesSplit::numSubtrees() const
+{
+    return subtree_.size();
+}
+
+unsigned int HinesSplit::trunkSize() const
+{
+    return trunkSize_;
+}
+
+void HinesSplit::solve( HSolvePassive& cell ) const
+{
+    moose::ThreadPool& pool = moose::ThreadPool::instance();
+
+    pool.parallelFor( subtree_.size(), numThreads_,
+            [this, &cell]( size_t i )
+            {
+                forwardEliminate( cell, subtree_[ i ] );
+            }, cost_ );
+    for ( unsigned int k = 0; k < trunk_.size(); ++k )
+        forwardEliminate( cell, trunk_[ k ] );
+    cell.stage_ = 1;
+
+    for ( unsigned int k = trunk_.size(); k-- > 0; )
+        backwardSubstitute( cell, trunk_[ k ] );
+    pool.parallelFor( subtree_.size(), numThreads_,
+            [this, &cell]( size_t i )
+            {
+                backwardSubstitute( cell, subtree_[ i ] );
+            }, cost_ );
+    cell.stage_ = 2;
+}
+
+/**
+ * Same as HSolvePassive::forwardEliminate, for the rows of one segment.
+ * The last row of the matrix is not eliminated.
+ */
+void HinesSplit::forwardEliminate( HSolvePassive& cell,
+        const Segment& seg ) const
+{
+    typedef HSolvePassive::vdIterator vdIterator;
+
+    const unsigned int end = min( seg.end, cell.nCompt_ - 1 );
+    vector< double >::iterator ihs = cell.HS_.begin() + 4 * seg.begin;
+    unsigned int junction = seg.jBegin;
+
+    double pivot;
+    double division;
+    for ( unsigned int ic = seg.begin; ic < end; ++ic, ihs += 4 )
+    {
+        if ( junction == seg.jEnd || cell.junction_[ junction ].index != ic )
+        {
+            *( ihs + 4 ) -= *( ihs + 1 ) / *ihs **( ihs + 1 );
+            *( ihs + 7 ) -= *( ihs + 1 ) / *ihs **( ihs + 3 );
+            continue;
+        }
+
+        unsigned int rank = cell.junction_[ junction ].rank;
+        vector< vdIterator >::const_iterator iop =
+            cell.operand_.begin() + operandStart_[ junction ];
+        ++junction;
+
+        pivot = *ihs;
+        if ( rank == 1 )
+        {
+            vdIterator j = *iop;
+            vdIterator s = *( iop + 1 );
+
+            division    = *( j + 1 ) / pivot;
+            *( s )     -= division **j;
+            *( s + 3 ) -= division **( ihs + 3 );
+        }
+        else if ( rank == 2 )
+        {
+            vdIterator j = *iop;
+            vdIterator s;
+
+            s           = *( iop + 1 );
+            division    = *( j + 1 ) / pivot;
+            *( s )     -= division **j;
+            *( j + 4 ) -= division **( j + 2 );
+            *( s + 3 ) -= division **( ihs + 3 );
+
+            s           = *( iop + 3 );
+            division    = *( j + 3 ) / pivot;
+            *( j + 5 ) -= division **j;
+            *( s )     -= division **( j + 2 );
+            *( s + 3 ) -= division **( ihs + 3 );
+        }
+        else
+        {
+            vector< vdIterator >::const_iterator
+            last = iop + 3 * rank * ( rank + 1 );
+            for ( ; iop < last; iop += 3 )
+                **iop -= **( iop + 2 ) / pivot ***( iop + 1 );
+        }
+    }
+}
+
+/**
+ * Same as HSolvePassive::backwardSubstitute, for the rows of one segment,
+ * which are taken from the top down. The operands are the same, but read
+ * forwards from the junction's own entries.
+ */
+void HinesSplit::backwardSubstitute( HSolvePassive& cell,
+        const Segment& seg ) const
+{
+    typedef HSolvePassive::vdIterator vdIterator;
+
+    const unsigned int last = cell.nCompt_ - 1;
+    vector< double >& VMid = cell.VMid_;
+    vector< double >& V = cell.V_;
+    unsigned int junction = seg.jEnd;
+
+    for ( unsigned int ic = seg.end; ic-- > seg.begin; )
+    {
+        const double* hs = &cell.HS_[ 4 * ic ];
+        double& vmid = VMid[ ic ];
+
+        if ( ic == last )
+            vmid = hs[ 3 ] / hs[ 0 ];
+        else if ( junction > seg.jBegin &&
+                cell.junction_[ junction - 1 ].index == ic )
+        {
+            --junction;
+            unsigned int rank = cell.junction_[ junction ].rank;
+            vector< vdIterator >::const_iterator op =
+                cell.operand_.begin() + operandStart_[ junction ];
+
+            if ( rank == 1 )
+                vmid = ( hs[ 3 ] - *op[ 2 ] **op[ 0 ] ) / hs[ 0 ];
+            else if ( rank == 2 )
+                vmid = ( hs[ 3 ]
+                         - *op[ 4 ] * op[ 0 ][ 2 ]
+                         - *op[ 2 ] * op[ 0 ][ 0 ]
+                       ) / hs[ 0 ];
+            else
+            {
+                vector< vdIterator >::const_iterator bop =
+                    cell.backOperand_.begin() + backOperandStart_[ junction ];
+                vmid = hs[ 3 ];
+                for ( unsigned int k = rank; k-- > 0; )
+                    vmid -= *bop[ 2 * k + 1 ] **bop[ 2 * k ];
+                vmid /= hs[ 0 ];
+            }
+        }
+        else
+            vmid = ( hs[ 3 ] - hs[ 1 ] * VMid[ ic + 1 ] ) / hs[ 0 ];
+
+        V[ ic ] = 2 * vmid - V[ ic ];
+    }
+}
+
+#ifdef DO_UNIT_TESTS
+
+#include <sstream>
+#include "../shell/Shell.h"
+
+/**
+ * Solves cells split into subtrees on several threads, and compares the
+ * voltages with those of the sequential solver.
+ */
+void testHinesSplit()
+{
+    Shell* shell = reinterpret_cast< Shell* >( Id().eref().data() );
+
+    /*
+     * The first cell is the one from testHSolvePassive with junctions of
+     * rank 1, 2 and 3. The second has 600 compartments: a soma with five
+     * dendrites, each of which branches every few compartments.
+     */
+    int childArray_1[ ] =
+    {
+        /* c0  */  -1,
+        /* c1  */  -1, 0,
+        /* c2  */  -1, 1,
+        /* c3  */  -1,
+        /* c4  */  -1, 3,
+        /* c5  */  -1,
+        /* c6  */  -1, 5,
+        /* c7  */  -1, 4, 6,
+        /* c8  */  -1, 7,
+        /* c9  */  -1, 8,
+        /* c10 */  -1,
+        /* c11 */  -1, 10,
+        /* c12 */  -1,
+        /* c13 */  -1, 12,
+        /* c14 */  -1, 11, 13,
+        /* c15 */  -1, 14, 16,
+        /* c16 */  -1, 17,
+        /* c17 */  -1, 2, 9, 18,
+        /* c18 */  -1, 19,
+        /* c19 */  -1,
+    };
+    const unsigned int nCompt_1 = 20;
+    const unsigned int nCompt_2 = 600;
+
+    vector< vector< pair< int, int > > > edges( 2 );
+    int parent = -1;
+    for ( unsigned int a = 0; a < sizeof( childArray_1 ) / sizeof( int ); ++a )
+        if ( childArray_1[ a ] == -1 )
+            ++parent;
+        else
+            edges[ 0 ].push_back( make_pair( parent, childArray_1[ a ] ) );
+    for ( unsigned int i = 1; i < nCompt_2; ++i )
+    {
+        parent = i - 1;
+        if ( i <= 5 )
+            parent = 0;
+        else if ( i % 5 == 0 || i % 7 == 0 )
+            parent = i * 2 / 3;
+        edges[ 1 ].push_back( make_pair( parent, i ) );
+    }
+    unsigned int nCompt[] = { nCompt_1, nCompt_2 };
+
+    const double dt = 1e-3;
+    vector< Id > neutrals;
+    for ( unsigned int cell = 0; cell < 2; ++cell )
+    {
+        ostringstream cellName;
+        cellName << "n" << cell;
+        Id n = shell->doCreate( "Neutral", Id(), cellName.str(), 1 );
+        neutrals.push_back( n );
+
+        vector< Id > c( nCompt[ cell ] );
+        for ( unsigned int i = 0; i < nCompt[ cell ]; ++i )
+        {
+            ostringstream name;
+            name << "c" << i;
+            c[ i ] = shell->doCreate( "Compartment", n, name.str(), 1 );
+            Field< double >::set( c[ i ], "Ra", 15.0 + 3.0 * ( i % 17 ) );
+            Field< double >::set( c[ i ], "Rm", 45.0 + 15.0 * ( i % 13 ) );
+            Field< double >::set( c[ i ], "Cm", 0.5 + 0.2 * ( i % 11 ) );
+            Field< double >::set( c[ i ], "Em", -0.06 );
+            Field< double >::set( c[ i ], "initVm", -0.06 );
+            Field< double >::set( c[ i ], "Vm", -0.06 + 0.001 * ( i % 23 ) );
+        }
+        for ( unsigned int e = 0; e < edges[ cell ].size(); ++e )
+            shell->doAddMsg( "Single", c[ edges[ cell ][ e ].first ], "axial",
+                    c[ edges[ cell ][ e ].second ], "raxial" );
+
+        HSolvePassive single;
+        single.setup( c[ 0 ], dt );
+
+        HinesSplit split;
+        split.setup( single, 1 );
+        ASSERT( split.numSubtrees() == 0, "Hines split: 1 thread" );
+
+        for ( unsigned int numThreads = 2; numThreads <= 4; ++numThreads )
+        {
+            HSolvePassive parallel;
+            parallel.setup( c[ 0 ], dt );
+            split.setup( parallel, numThreads );
+            ASSERT( split.numSubtrees() >= 2, "Hines split: subtrees" );
+            ASSERT( split.trunkSize() < nCompt[ cell ] / 2,
+                    "Hines split: trunk" );
+
+            HSolvePassive sequential;
+            sequential.setup( c[ 0 ], dt );
+            for ( int pass = 0; pass < 3; ++pass )
+            {
+                sequential.solve();
+                parallel.updateMatrix();
+                split.solve( parallel );
+
+                for ( unsigned int i = 0; i < nCompt[ cell ]; ++i )
+                {
+                    const HSolvePassive& s = sequential;
+                    const HSolvePassive& p = parallel;
+                    ostringstream error;
+                    error << "Hines split: Pass " << pass << " Cell# "
+                          << cell << " threads " << numThreads
+                          << " V(" << i << ")";
+                    ASSERT( fabs( s.getVMid( i ) - p.getVMid( i ) ) <=
+                            1e-12 * fabs( s.getVMid( i ) ), error.str() );
+                    ASSERT( fabs( s.V_[ i ] - p.V_[ i ] ) <=
+                            1e-12 * fabs( s.V_[ i ] ), error.str() );
+                }
+            }
+        }
+    }
+
+    for ( unsigned int i = 0; i < neutrals.size(); ++i )
+        shell->doDelete( neutrals[ i ] );
+    cout << "." << flush;
+}
+
+#endif // DO_UNIT_TESTS
@@ -0,0 +1,98 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#ifndef _HINES_SPLIT_H
+#define _HINES_SPLIT_H
+
+/**
+ * Solves the Hines matrix of one large cell on several threads.
+ *
+ * In Hines' ordering a row is only ever eliminated into rows with higher
+ * indices, and these lie on the path from the row towards the root of
+ * the elimination tree. So the rows of a dendritic subtree can be
+ * eliminated without waiting for anything outside it, and independently
+ * of other subtrees, as long as none of its rows reach past its root.
+ * Reversing the depth-first walk that numbers the compartments leaves
+ * each such subtree in a contiguous block of rows, ending at its root.
+ *
+ * setup cuts the tree, built from the children in TreeNodeStruct, into
+ * a number of such subtrees and a trunk of the remaining rows: the
+ * roots of the subtrees and the branch points between them. solve then
+ * eliminates the subtrees in parallel, up to but not including their
+ * roots, and the trunk (a small reduced system, in the same order as the
+ * full solver) on the calling thread. The back-substitution goes the
+ * other way: trunk first, then the subtrees in parallel.
+ *
+ * The trunk rows receive the updates from the subtrees in a different
+ * order than in HSolvePassive, so the results agree with those of the
+ * sequential solver to round-off, not bit for bit.
+ */
+class HinesSplit
+{
+public:
+    HinesSplit();
+
+    /**
+     * Cuts the matrix of the cell into subtrees to be solved on up to
+     * numThreads threads. With 1 thread, or if the tree cannot be cut,
+     * there are no subtrees and the cell should be solved as usual. Must
+     * be called again if the structure of the cell changes.
+     */
+    void setup( const HSolvePassive& cell, unsigned int numThreads );
+
+    /**
+     * Solves the matrix equations of the cell, which must already have
+     * been updated for this time-step, and leaves the new Vm in the cell.
+     */
+    void solve( HSolvePassive& cell ) const;
+
+    /// Number of subtrees solved in parallel. 0 if the split is not in use.
+    unsigned int numSubtrees() const;
+
+    /// Number of rows that are solved sequentially, on the calling thread.
+    unsigned int trunkSize() const;
+
+private:
+    /**
+     * A block of rows [begin, end), and the junctions [jBegin, jEnd)
+     * among them.
+     */
+    struct Segment
+    {
+        unsigned int begin;
+        unsigned int end;
+        unsigned int jBegin;
+        unsigned int jEnd;
+    };
+
+    Segment makeSegment( const HSolvePassive& cell,
+            unsigned int begin, unsigned int end ) const;
+
+    void forwardEliminate( HSolvePassive& cell, const Segment& s ) const;
+    void backwardSubstitute( HSolvePassive& cell, const Segment& s ) const;
+
+    unsigned int numThreads_;
+
+    /// Rows of each subtree, without its root.
+    vector< Segment > subtree_;
+
+    /// Rows of the trunk, in ascending order.
+    vector< Segment > trunk_;
+
+    unsigned int trunkSize_;
+
+    /// Number of rows in each subtree, to balance the threads.
+    vector< double > cost_;
+
+    /// Offsets of each junction's entries in operand_ and backOperand_.
+    vector< unsigned int > operandStart_;
+    vector< unsigned int > backOperandStart_;
+};
+
+#endif // _HINES_SPLIT_H
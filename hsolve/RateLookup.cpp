@@ -107,3 +107,227 @@ void LookupTable::lookup(
 	b = *( bp + 1 );
 	C2 = a + ( b - a ) * row.fraction;
 }
+
+void LookupTable::rows(
+	const double* x,
+	unsigned int n,
+	unsigned int* offset,
+	double* fraction ) const
+{
+	// Same arithmetic as row(), so that the results are identical.
+	for ( unsigned int i = 0; i < n; ++i ) {
+		double xi = x[ i ] < min_ ? min_ : ( x[ i ] > max_ ? max_ : x[ i ] );
+		double div = ( xi - min_ ) / dx_;
+		unsigned int integer = ( unsigned int )( div );
+
+		fraction[ i ] = div - integer;
+		offset[ i ] = integer * nColumns_;
+	}
+}
+
+void LookupTable::lookup(
+	unsigned int n,
+	const unsigned int* column,
+	const unsigned int* source,
+	const unsigned int* offset,
+	const double* fraction,
+	double* C1,
+	double* C2 ) const
+{
+	const double* table = &( table_.front() );
+	unsigned int nColumns = nColumns_;
+
+	for ( unsigned int i = 0; i < n; ++i ) {
+		const double* ap = table + offset[ source[ i ] ] + column[ i ];
+		const double* bp = ap + nColumns;
+		double f = fraction[ source[ i ] ];
+
+		C1[ i ] = ap[ 0 ] + ( bp[ 0 ] - ap[ 0 ] ) * f;
+		C2[ i ] = ap[ 1 ] + ( bp[ 1 ] - ap[ 1 ] ) * f;
+	}
+}
+
+LookupTable2D::LookupTable2D(
+	double xMin, double xMax, unsigned int xDivs,
+	double yMin, double yMax, unsigned int yDivs )
+{
+	// At least one division each way, so that there are 4 points to
+	// interpolate between.
+	xDivs_ = xDivs > 0 ? xDivs : 1;
+	yDivs_ = yDivs > 0 ? yDivs : 1;
+	xMin_ = xMin;
+	xMax_ = xMax;
+	yMin_ = yMin;
+	yMax_ = yMax;
+	dx_ = ( xMax - xMin ) / xDivs_;
+	dy_ = ( yMax - yMin ) / yDivs_;
+
+	table_.resize( 2 * ( xDivs_ + 1 ) * ( yDivs_ + 1 ) );
+}
+
+void LookupTable2D::set( unsigned int ix, unsigned int iy, double C1, double C2 )
+{
+	unsigned int i = 2 * ( ix * ( yDivs_ + 1 ) + iy );
+	table_[ i ] = C1;
+	table_[ i + 1 ] = C2;
+}
+
+double LookupTable2D::x( unsigned int ix ) const
+{
+	return xMin_ + ix * dx_;
+}
+
+double LookupTable2D::y( unsigned int iy ) const
+{
+	return yMin_ + iy * dy_;
+}
+
+void LookupTable2D::lookup( double x, double y, double& C1, double& C2 ) const
+{
+	if ( x < xMin_ )
+		x = xMin_;
+	else if ( x > xMax_ )
+		x = xMax_;
+	if ( y < yMin_ )
+		y = yMin_;
+	else if ( y > yMax_ )
+		y = yMax_;
+
+	// A zero-width range (a variable the gate does not depend on) has
+	// dx_ = 0, and always gives the first point.
+	double xDiv = dx_ > 0.0 ? ( x - xMin_ ) / dx_ : 0.0;
+	double yDiv = dy_ > 0.0 ? ( y - yMin_ ) / dy_ : 0.0;
+	unsigned int ix = ( unsigned int )( xDiv );
+	unsigned int iy = ( unsigned int )( yDiv );
+	if ( ix >= xDivs_ )
+		ix = xDivs_ - 1;
+	if ( iy >= yDivs_ )
+		iy = yDivs_ - 1;
+	double xf = xDiv - ix;
+	double yf = yDiv - iy;
+
+	unsigned int stride = 2 * ( yDivs_ + 1 );
+	const double* p00 = &table_[ 0 ] + ix * stride + 2 * iy;
+	const double* p10 = p00 + stride;
+
+	// Interpolate along x on rows iy and iy + 1, and then along y.
+	double a, b;
+	a = p00[ 0 ] + ( p10[ 0 ] - p00[ 0 ] ) * xf;
+	b = p00[ 2 ] + ( p10[ 2 ] - p00[ 2 ] ) * xf;
+	C1 = a + ( b - a ) * yf;
+
+	a = p00[ 1 ] + ( p10[ 1 ] - p00[ 1 ] ) * xf;
+	b = p00[ 3 ] + ( p10[ 3 ] - p00[ 3 ] ) * xf;
+	C2 = a + ( b - a ) * yf;
+}
+
+#ifdef DO_UNIT_TESTS
+
+#include <cmath>
+#include <map>
+#include <sstream>
+#include "HinesMatrix.h"
+
+/**
+ * Checks that the batched rows() and lookup() give exactly the same
+ * numbers as row() and lookup(), on either side of the range as well.
+ */
+void testLookupTable()
+{
+	unsigned int nDivs = 100;
+	unsigned int nSpecies = 3;
+	LookupTable table( -0.1, 0.05, nDivs, nSpecies );
+	for ( unsigned int species = 0; species < nSpecies; ++species ) {
+		vector< double > C1( nDivs + 1 );
+		vector< double > C2( nDivs + 1 );
+		for ( unsigned int i = 0; i <= nDivs; ++i ) {
+			C1[ i ] = sin( 0.1 * i + species );
+			C2[ i ] = 2.0 + cos( 0.07 * i * ( species + 1 ) );
+		}
+		table.addColumns( species, C1, C2 );
+	}
+
+	vector< double > x;
+	for ( double v = -0.12; v < 0.07; v += 0.0013 )
+		x.push_back( v );
+	x.push_back( 0.05 );
+	unsigned int n = x.size();
+
+	vector< unsigned int > offset( n );
+	vector< double > fraction( n );
+	table.rows( &x[ 0 ], n, &offset[ 0 ], &fraction[ 0 ] );
+
+	// Each value of x is looked up once in each column.
+	vector< unsigned int > column;
+	vector< unsigned int > source;
+	for ( unsigned int species = 0; species < nSpecies; ++species )
+		for ( unsigned int i = 0; i < n; ++i ) {
+			LookupColumn c;
+			table.column( species, c );
+			column.push_back( c.column );
+			source.push_back( i );
+		}
+	vector< double > C1( column.size() );
+	vector< double > C2( column.size() );
+	table.lookup( column.size(), &column[ 0 ], &source[ 0 ],
+		&offset[ 0 ], &fraction[ 0 ], &C1[ 0 ], &C2[ 0 ] );
+
+	for ( unsigned int i = 0; i < column.size(); ++i ) {
+		LookupRow row;
+		LookupColumn c;
+		c.column = column[ i ];
+		double c1, c2;
+		table.row( x[ source[ i ] ], row );
+		table.lookup( c, row, c1, c2 );
+
+		ostringstream error;
+		error << "Error in batched lookup at x = " << x[ source[ i ] ]
+		      << ", column " << column[ i ];
+		ASSERT( C1[ i ] == c1 && C2[ i ] == c2, error.str() );
+	}
+
+	cout << "." << flush;
+}
+
+/**
+ * Bilinear interpolation is exact for a function of the form
+ * a + b x + c y + d x y, so the 2-D table should give it back anywhere in
+ * the range, and its edge values outside. A zero-width range should always
+ * give the first point.
+ */
+void testLookupTable2D()
+{
+	LookupTable2D table( -0.1, 0.05, 30, 0.0, 2.0, 20 );
+	for ( unsigned int ix = 0; ix <= 30; ++ix )
+		for ( unsigned int iy = 0; iy <= 20; ++iy ) {
+			double x = table.x( ix );
+			double y = table.y( iy );
+			table.set( ix, iy, 1.0 + 2.0 * x + 3.0 * y + 4.0 * x * y, x - y );
+		}
+
+	double C1, C2;
+	for ( double x = -0.12; x < 0.07; x += 0.0017 )
+		for ( double y = -0.3; y < 2.3; y += 0.07 ) {
+			double xc = x < -0.1 ? -0.1 : ( x > 0.05 ? 0.05 : x );
+			double yc = y < 0.0 ? 0.0 : ( y > 2.0 ? 2.0 : y );
+			table.lookup( x, y, C1, C2 );
+
+			ostringstream error;
+			error << "Error in 2-D lookup at ( " << x << ", " << y << " )";
+			ASSERT( fabs( C1 - ( 1.0 + 2.0 * xc + 3.0 * yc + 4.0 * xc * yc ) ) < 1e-12 &&
+			        fabs( C2 - ( xc - yc ) ) < 1e-12, error.str() );
+		}
+
+	LookupTable2D flat( -0.1, 0.05, 10, 0.0, 0.0, 1 );
+	for ( unsigned int ix = 0; ix <= 10; ++ix ) {
+		flat.set( ix, 0, flat.x( ix ), 1.0 );
+		flat.set( ix, 1, 100.0, 100.0 );
+	}
+	flat.lookup( 0.01, 5.0, C1, C2 );
+	ASSERT( fabs( C1 - 0.01 ) < 1e-12 && C2 == 1.0,
+		"Error in 2-D lookup on a zero-width range" );
+
+	cout << "." << flush;
+}
+
+#endif // DO_UNIT_TESTS
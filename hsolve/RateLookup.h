@@ -62,6 +62,31 @@ public:
 		double& C1,
 		double& C2 );
 
+	/**
+	 * Batched form of row(): finds the row of each of the n values in x,
+	 * as an offset into the table, along with the leftover fraction.
+	 */
+	void rows(
+		const double* x,
+		unsigned int n,
+		unsigned int* offset,
+		double* fraction ) const;
+
+	/**
+	 * Batched form of lookup(), for n gates. Gate i is looked up in
+	 * column[ i ] on row offset[ source[ i ] ], with fraction
+	 * fraction[ source[ i ] ], as returned by rows(). The loop has no
+	 * branches, so that the compiler can vectorize it.
+	 */
+	void lookup(
+		unsigned int n,
+		const unsigned int* column,
+		const unsigned int* source,
+		const unsigned int* offset,
+		const double* fraction,
+		double* C1,
+		double* C2 ) const;
+
     bool empty() const {
 	return table_.empty();
     }
@@ -78,4 +103,45 @@ private:
 	unsigned int         nColumns_;		///< (# columns) = 2 * (# species)
 };
 
+/**
+ * Lookup table for a gate of two variables, as in HHChannel2D. Holds C1
+ * and C2 on a regular grid over x and y, and interpolates bilinearly
+ * between the four surrounding points. Values outside the range are
+ * clamped to its edges.
+ */
+class LookupTable2D
+{
+public:
+	LookupTable2D() { ; }
+
+	LookupTable2D(
+		double xMin,
+		double xMax,
+		unsigned int xDivs,
+		double yMin,
+		double yMax,
+		unsigned int yDivs );
+
+	/// Sets C1 and C2 on grid point ( ix, iy ). ix <= xDivs, iy <= yDivs.
+	void set( unsigned int ix, unsigned int iy, double C1, double C2 );
+
+	/// x and y of grid point ( ix, iy ).
+	double x( unsigned int ix ) const;
+	double y( unsigned int iy ) const;
+
+	void lookup( double x, double y, double& C1, double& C2 ) const;
+
+private:
+	vector< double >     table_;		///< C1 and C2 at each point, with
+										///< y varying fastest.
+	double               xMin_;
+	double               xMax_;
+	double               dx_;
+	unsigned int         xDivs_;
+	double               yMin_;
+	double               yMax_;
+	double               dy_;
+	unsigned int         yDivs_;
+};
+
 #endif // _RATE_LOOKUP_H
@@ -20,6 +20,10 @@ using namespace std;
 
 extern void testHinesMatrix(); // Defined in HinesMatrix.cpp
 extern void testHSolvePassive(); // Defined in HSolvePassive.cpp
+extern void testHinesGroup(); // Defined in HinesGroup.cpp
+extern void testHinesSplit(); // Defined in HinesSplit.cpp
+extern void testLookupTable(); // Defined in RateLookup.cpp
+extern void testLookupTable2D(); // Defined in RateLookup.cpp
 extern void testHSolveUtils(); // Defined in HSolveUtils.cpp
 extern void runRallpackBenchmarks();                 /* Defined in RallPacks.cpp */
 
@@ -28,6 +32,10 @@ void testHSolve()
 	testHSolveUtils();
 	testHinesMatrix();
 	testHSolvePassive();
+	testHinesGroup();
+	testHinesSplit();
+	testLookupTable();
+	testLookupTable2D();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -12,6 +12,7 @@
 #include "../biophysics/CompartmentBase.h"
 #include "../biophysics/Compartment.h"
 #include "IntFireBase.h"
+#include "../basecode/Checkpoint.h"
 
 using namespace moose;
 SrcFinfo1< double >* IntFireBase::spikeOut()
@@ -104,6 +105,9 @@ const Cinfo* IntFireBase::initCinfo()
 
 static const Cinfo* intFireBaseCinfo = IntFireBase::initCinfo();
 
+static const bool intFireBaseHook =
+    addCheckpointHook< IntFireBase >( "IntFireBase" );
+
 //////////////////////////////////////////////////////////////////
 // Here we put the Compartment class functions.
 //////////////////////////////////////////////////////////////////
@@ -172,3 +176,21 @@ void IntFireBase::activation( double v )
 {
     activation_ += v;
 }
+
+void IntFireBase::saveState( CheckpointWriter& w ) const
+{
+    Compartment::saveState( w );
+    w.put( activation_ );
+    w.put( lastEvent_ );
+    w.put( fired_ );
+}
+
+bool IntFireBase::loadState( CheckpointReader& r )
+{
+    if ( !Compartment::loadState( r ) )
+        return false;
+    r.get( activation_ );
+    r.get( lastEvent_ );
+    r.get( fired_ );
+    return r.good();
+}
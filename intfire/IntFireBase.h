@@ -53,6 +53,10 @@ public:
     /// Message src for outgoing spikes.
     static SrcFinfo1< double >* spikeOut();
 
+    /// Saves and restores the Compartment terms and spike state.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     /**
      * Initializes the class info.
      */
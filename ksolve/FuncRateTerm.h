@@ -63,6 +63,11 @@ class FuncRate: public ExternReac
         void setExpr( const string& s ) {
             func_->setExpr( s );
         }
+
+        /// See FuncTerm::setNumThreads. The copies in each voxel share func_.
+        void setNumThreads( unsigned int n ) {
+            func_->setNumThreads( n );
+        }
         const string& getExpr() const {
             return func_->getExpr();
         }
@@ -25,38 +25,66 @@ using namespace std;
 
 #include "FuncTerm.h"
 #include "../utility/numutil.h"
+#include "../utility/ThreadPool.h"
 
 FuncTerm::FuncTerm():
-    reactantIndex_(1, 0) , volScale_(1.0) , target_(~0U) , args_(nullptr)
+    reactantIndex_(1, 0) , volScale_(1.0) , target_(~0U) , numThreads_(1)
 {
 }
 
 FuncTerm::~FuncTerm()
 {
-    if(args_)
-        delete[] args_;
 }
 
 void FuncTerm::setReactantIndex( const vector< unsigned int >& mol )
 {
     reactantIndex_ = mol;
-    if ( args_ )
+    evals_.clear();
+    for ( unsigned int i = 0; i < numThreads_; ++i )
     {
-        delete[] args_;
-        parser_.ClearAll();
+        evals_.emplace_back( new Evaluator() );
+        bindArgs( *evals_.back() );
     }
+    setExpr(expr_);
+}
 
-    args_ = new double[mol.size()+1];
-    for ( unsigned int i = 0; i < mol.size(); ++i )
-    {
-        args_[i] = 0.0;
-        parser_.DefineVar( 'x'+to_string(i), &args_[i] );
-    }
+void FuncTerm::bindArgs( Evaluator& e ) const
+{
+    e.args.assign( reactantIndex_.size() + 1, 0.0 );
+    for ( unsigned int i = 0; i < reactantIndex_.size(); ++i )
+        e.parser.DefineVar( 'x'+to_string(i), &e.args[i] );
 
     // Define a 't' variable even if we don't always use it.
-    args_[mol.size()] = 0.0;
-    parser_.DefineVar( "t", &args_[mol.size()] );
-    setExpr(expr_);
+    e.parser.DefineVar( "t", &e.args[reactantIndex_.size()] );
+}
+
+void FuncTerm::setNumThreads( unsigned int n )
+{
+    n = std::max( n, 1U );
+    if ( n == numThreads_ )
+        return;
+    numThreads_ = n;
+    if ( !evals_.empty() )
+        setReactantIndex( reactantIndex_ );
+}
+
+unsigned int FuncTerm::getNumThreads() const
+{
+    return numThreads_;
+}
+
+FuncTerm::Evaluator* FuncTerm::evaluator() const
+{
+    if ( evals_.empty() )
+        return nullptr;
+    size_t slot = moose::ThreadPool::slot();
+    // The solver sets numThreads before it goes parallel, so this
+    // should not happen. Sharing the first evaluator is the old,
+    // unsafe behaviour.
+    assert( slot < evals_.size() );
+    if ( slot >= evals_.size() )
+        slot = 0;
+    return evals_[ slot ].get();
 }
 
 const vector< unsigned int >& FuncTerm::getReactantIndex() const
@@ -87,8 +115,16 @@ void FuncTerm::setExpr( const string& expr )
 
     try
     {
-        if(! parser_.SetExpr(expr))
-            MOOSE_WARN("Failed to set expression: '" << expr << "'");
+        // All evaluators compile the same expression, so if one fails
+        // they all do.
+        for ( auto& e : evals_ )
+        {
+            if(! e->parser.SetExpr(expr))
+            {
+                MOOSE_WARN("Failed to set expression: '" << expr << "'");
+                break;
+            }
+        }
         expr_ = expr;
     }
     catch(moose::Parser::exception_type &e)
@@ -125,13 +161,13 @@ double FuncTerm::getVolScale() const
 
 const FuncTerm& FuncTerm::operator=( const FuncTerm& other )
 {
-    args_ = nullptr;  // other is still using it.
     expr_ = other.expr_;
     volScale_ = other.volScale_;
     target_ = other.target_;
-    reactantIndex_ = other.reactantIndex_;
-    parser_ = other.parser_;
-    setReactantIndex(reactantIndex_);
+    numThreads_ = other.numThreads_;
+    // Compile afresh rather than share the expressions of other, whose
+    // variables point to its own args.
+    setReactantIndex(other.reactantIndex_);
     return *this;
 }
 
@@ -141,17 +177,19 @@ const FuncTerm& FuncTerm::operator=( const FuncTerm& other )
  */
 double FuncTerm::operator() ( const double* S, double t ) const
 {
-    if ( ! args_ )
+    Evaluator* e = evaluator();
+    if ( ! e )
         return 0.0;
 
+    double* args = &e->args[0];
     unsigned int i = 0;
     for ( i = 0; i < reactantIndex_.size(); ++i )
-        args_[i] = S[reactantIndex_[i]];
-    args_[i] = t;
+        args[i] = S[reactantIndex_[i]];
+    args[i] = t;
 
     try
     {
-        return parser_.Eval() * volScale_;
+        return e->parser.Eval() * volScale_;
     }
     catch (moose::Parser::exception_type &e )
     {
@@ -162,17 +200,19 @@ double FuncTerm::operator() ( const double* S, double t ) const
 
 void FuncTerm::evalPool( double* S, double t ) const
 {
-    if ( !args_ || target_ == ~0U )
+    Evaluator* e = evaluator();
+    if ( !e || target_ == ~0U )
         return;
 
+    double* args = &e->args[0];
     unsigned int i;
     for ( i = 0; i < reactantIndex_.size(); ++i )
-        args_[i] = S[reactantIndex_[i]];
-    args_[i] = t;
+        args[i] = S[reactantIndex_[i]];
+    args[i] = t;
 
     try
     {
-        S[ target_] = parser_.Eval() * volScale_;
+        S[ target_] = e->parser.Eval() * volScale_;
         //assert(! std::isnan(S[target_]));
     }
     catch ( moose::Parser::exception_type & e )
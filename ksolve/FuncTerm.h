@@ -10,6 +10,7 @@
 #ifndef _FUNC_TERM_H
 #define _FUNC_TERM_H
 
+#include <memory>
 #include "../builtins/MooseParser.h"
 
 class FuncTerm
@@ -41,7 +42,34 @@ public:
     void setVolScale( double vs );
     double getVolScale() const;
 
+    /**
+     * Sets the number of threads that may evaluate this FuncTerm at
+     * once. Each thread gets its own compiled expression and argument
+     * buffer, picked by moose::ThreadPool::slot(). Must not be called
+     * while an evaluation is under way.
+     */
+    void setNumThreads( unsigned int n );
+    unsigned int getNumThreads() const;
+
 private:
+    /**
+     * A compiled expression with the argument buffer that its variables
+     * point to. An exprtk expression reads its variables through these
+     * pointers, so it cannot be shared by threads working on different
+     * voxels.
+     */
+    struct Evaluator
+    {
+        vector< double > args;
+        moose::MooseParser parser;
+    };
+
+    /// Defines the variables x0, x1, ... and t of e on its args.
+    void bindArgs( Evaluator& e ) const;
+
+    /// The evaluator of the calling thread, or 0 if there are no args.
+    Evaluator* evaluator() const;
+
     // Look up reactants in the S vec.
     vector< unsigned int > reactantIndex_;
 
@@ -53,10 +81,11 @@ private:
     double volScale_;
     unsigned int target_; /// Index of the entity to be updated by Func
 
-    double* args_;
-
     string expr_;
-    moose::MooseParser parser_;
+
+    /// One evaluator per thread. Empty until the reactants are set.
+    vector< std::unique_ptr< Evaluator > > evals_;
+    unsigned int numThreads_;
 };
 
 #endif // _FUNC_TERM_H
@@ -26,31 +26,16 @@
 #include "Stoich.h"
 #include "GssaVoxelPools.h"
 #include "Gsolve.h"
+#include "../basecode/Checkpoint.h"
 
 #include <chrono>
 #include <algorithm>
 
-#ifdef USE_BOOST_ASYNC
-#define BOOST_THREAD_PROVIDES_FUTURE
-#include <boost/thread.hpp>
-#include <boost/thread/future.hpp>
-#endif
-
-#include <future>
-#include <atomic>
-#include <thread>
-#include <functional>
+#include "../utility/ThreadPool.h"
 
 
 #define SIMPLE_ROUNDING 0
 
-// When set use std::async rather than std::thread. This is slightly faster
-// (roughly 3% with gcc7).
-#define USING_ASYNC 1
-#if USING_ASYNC
-#define THREAD_LAUNCH_POLICY std::launch::async
-#endif
-
 const unsigned int OFFNODE = ~0;
 
 const Cinfo* Gsolve::initCinfo()
@@ -147,6 +132,63 @@ const Cinfo* Gsolve::initCinfo()
         &Gsolve::setClockedUpdate,
         &Gsolve::getClockedUpdate
     );
+    static ValueFinfo< Gsolve, string > method(
+        "method",
+        "Stochastic simulation engine. Options are:\n"
+        "direct: Gillespie direct method. This is the default. "
+        "Each event draws one random number to pick the reaction and "
+        "another for the waiting time.\n"
+        "nrm: Gibson-Bruck next reaction method. A putative firing "
+        "time is kept for every reaction in an indexed priority queue, "
+        "and after each event only the reactions that depend on the "
+        "one that fired are updated. Needs one random number per "
+        "event, and is faster for large, sparsely coupled systems.\n"
+        "tauleap: Adaptive explicit tau-leaping (Cao, Gillespie and "
+        "Petzold 2006). Reactions that could exhaust a reactant within "
+        "a few firings are critical and are fired exactly, while the "
+        "rest are leaped over with Poisson numbers of firings. The "
+        "step is controlled by leapEpsilon. Approximate, but much "
+        "faster when some pools have high copy numbers.\n"
+        "The direct and nrm methods are exact. All methods use the "
+        "same per-voxel seeds. The change takes effect at the next "
+        "reinit.",
+        &Gsolve::setMethod,
+        &Gsolve::getMethod
+    );
+
+    static ValueFinfo< Gsolve, double > leapEpsilon(
+        "leapEpsilon",
+        "Error control parameter for the tauleap method. Each leap is "
+        "chosen so that the expected relative change in the propensity "
+        "of any reaction is at most leapEpsilon. Smaller values are "
+        "more accurate but take shorter leaps. Default: 0.03.",
+        &Gsolve::setLeapEpsilon,
+        &Gsolve::getLeapEpsilon
+    );
+
+    static ReadOnlyLookupValueFinfo<
+    Gsolve, unsigned int, vector< double > > leapStats(
+        "leapStats",
+        "Statistics of the tauleap method in the specified voxel, since "
+        "reinit: [number of leaps, number of reactions fired by exact "
+        "steps, number of leaps rejected because a pool went negative, "
+        "mean leap duration].",
+        &Gsolve::getLeapStats
+    );
+
+    static ValueFinfo< Gsolve, string > selectionMethod(
+        "selectionMethod",
+        "Method used to pick which reaction fires next. Options are:\n"
+        "linear: Scan the propensities of all reactions in order. "
+        "This is the default, and is fastest for small systems.\n"
+        "tree: Search a binary partial-sum tree of propensities, which "
+        "is updated incrementally as reactions fire. This takes log "
+        "time in the number of reactions, and is much faster for "
+        "systems with hundreds or thousands of reactions per voxel.",
+        &Gsolve::setSelectionMethod,
+        &Gsolve::getSelectionMethod
+    );
+
     static ReadOnlyLookupValueFinfo<
     Gsolve, unsigned int, vector< unsigned int > > numFire(
         "numFire",
@@ -215,7 +257,11 @@ const Cinfo* Gsolve::initCinfo()
         // Here we put new fields that were not there in the Ksolve.
         &useRandInit,      // Value
         &useClockedUpdate, // Value
+        &method,           // Value
+        &leapEpsilon,      // Value
+        &selectionMethod,  // Value
         &numFire,          // ReadOnlyLookupValue
+        &leapStats,        // ReadOnlyLookupValue
     };
 
     static Dinfo< Gsolve > dinfo;
@@ -232,6 +278,8 @@ const Cinfo* Gsolve::initCinfo()
 
 static const Cinfo* gsolveCinfo = Gsolve::initCinfo();
 
+static const bool gsolveHook = addCheckpointHook< Gsolve >( "Gsolve" );
+
 //////////////////////////////////////////////////////////////
 // Class definitions
 //////////////////////////////////////////////////////////////
@@ -371,6 +419,13 @@ vector< unsigned int > Gsolve::getNumFire( unsigned int voxel) const
     return dummy;
 }
 
+vector< double > Gsolve::getLeapStats( unsigned int voxel) const
+{
+    if ( voxel < pools_.size() )
+        return pools_[ voxel ].leapStats();
+    return vector< double >( 4, 0.0 );
+}
+
 
 bool Gsolve::getRandInit() const
 {
@@ -403,6 +458,80 @@ void Gsolve::setClockedUpdate( bool val )
     useClockedUpdate_ = val;
 }
 
+string Gsolve::getMethod() const
+{
+    if ( sys_.method == GssaSystem::NEXT_REACTION )
+        return "nrm";
+    if ( sys_.method == GssaSystem::TAU_LEAP )
+        return "tauleap";
+    return "direct";
+}
+
+void Gsolve::setMethod( string method )
+{
+    std::transform(method.begin(), method.end(), method.begin(), ::tolower);
+    if ( method == "nrm" || method == "gibson-bruck" )
+    {
+        sys_.method = GssaSystem::NEXT_REACTION;
+    }
+    else if ( method == "tauleap" || method == "tau-leap" )
+    {
+        sys_.method = GssaSystem::TAU_LEAP;
+    }
+    else if ( method == "direct" || method == "gillespie" || method == "gssa" )
+    {
+        sys_.method = GssaSystem::DIRECT;
+    }
+    else
+    {
+        cout << "Warning: Gsolve::setMethod: '" << method <<
+             "' is not known, using default direct\n";
+        sys_.method = GssaSystem::DIRECT;
+    }
+}
+
+double Gsolve::getLeapEpsilon() const
+{
+    return sys_.leapEpsilon;
+}
+
+void Gsolve::setLeapEpsilon( double val )
+{
+    if ( val > 0.0 && val < 1.0 )
+        sys_.leapEpsilon = val;
+    else
+        cout << "Warning: Gsolve::setLeapEpsilon: " << val <<
+             " should be between 0 and 1. Ignored.\n";
+}
+
+string Gsolve::getSelectionMethod() const
+{
+    return sys_.usePropensityTree ? "tree" : "linear";
+}
+
+void Gsolve::setSelectionMethod( string method )
+{
+    std::transform(method.begin(), method.end(), method.begin(), ::tolower);
+    if ( method == "tree" )
+    {
+        sys_.usePropensityTree = true;
+    }
+    else if ( method == "linear" )
+    {
+        sys_.usePropensityTree = false;
+    }
+    else
+    {
+        cout << "Warning: Gsolve::setSelectionMethod: '" << method <<
+             "' is not known, using default linear\n";
+        sys_.usePropensityTree = false;
+    }
+    // Rebuild the selection state of each voxel if we are already running.
+    if ( sys_.isReady )
+        for ( auto i = pools_.begin(); i != pools_.end(); ++i )
+            i->refreshAtot( &sys_ );
+}
+
 
 //////////////////////////////////////////////////////////////
 // Process operations.
@@ -460,41 +589,12 @@ void Gsolve::process( const Eref& e, ProcPtr p )
     }
     else
     {
-        /*-----------------------------------------------------------------------------
-         *  Somewhat complicated computation to compute the number of threads. 1
-         *  thread per (at least) voxel pool is ideal situation.
-         *-----------------------------------------------------------------------------*/
-#if USING_ASYNC
-        vector<std::future<size_t>> vecFutures;
-        for (size_t i = 0; i < numThreads_; i++) 
-            vecFutures.push_back( 
-                std::async( THREAD_LAUNCH_POLICY
-                    , [this, i, p](){ 
-                        return this->advance_chunk(i*this->grainSize_, (i+1)*this->grainSize_, p); 
-                    })
-                );
-        // Block in same order
-        size_t tot = 0;
-        for (auto& fut : vecFutures) tot += fut.get();
-        // We have processed all the pools.
-        assert( tot >= pools_.size() );
-#else
-        vector<std::thread> vecThreads;
-        for (size_t i = 0; i < numThreads_; i++)
-        {
-            // Use lambda. It is roughly 10% faster than std::bind and does not
-            // involve copying data.
-            vecThreads.push_back( 
-                std::thread( 
-                    [this, i, p](){ this->advance_chunk(i*this->grainSize_, (i+1)*this->grainSize_, p); }
-                    )
-                );
-        }
-
-        for( auto &v : vecThreads )
-            v.join();
-#endif
-
+        // Voxels are handed to the persistent worker pool, which
+        // balances them across threads by work stealing. Each thread
+        // evaluates Functions with its own expressions.
+        stoichPtr_->setNumFuncThreads( numThreads_ );
+        moose::ThreadPool::instance().parallelFor( pools_.size(), numThreads_,
+                [this, p]( size_t i ) { pools_[i].advance( p, &sys_ ); } );
     }
 
     if ( useClockedUpdate_ )   // Check if a clocked stim is to be updated
@@ -506,38 +606,10 @@ void Gsolve::process( const Eref& e, ProcPtr p )
         }
         else
         {
-#if USING_ASYNC
-        vector<std::future<size_t>> vecFutures;
-        for (size_t i = 0; i < numThreads_; i++) 
-            vecFutures.push_back( 
-                std::async( THREAD_LAUNCH_POLICY
-                    , [this, i, p](){ 
-                        return this->recalcTimeChunk(i*this->grainSize_, (i+1)*this->grainSize_, p); 
-                    })
-                );
-        // Block in same order
-        size_t tot = 0;
-        for (auto& fut : vecFutures) tot += fut.get();
-        assert( tot >= pools_.size() ); // We have processed all the pools.
-#else
-            vector<std::thread> vecThreads;
-
-            for (size_t i = 0; i < numThreads_; i++)
-            {
-                // Use lambda. It is roughly 10% faster than std::bind and does not
-                // involve copying data.
-                vecThreads.push_back( 
-                        std::thread( 
-                            [this, i, p](){ 
-                                this->recalcTimeChunk(i*this->grainSize_, (i+1)*this->grainSize_, p); 
-                            }
-                        )
-                    );
-            }
-            for( auto &v : vecThreads )
-                v.join();
-#endif
-
+            moose::ThreadPool::instance().parallelFor( pools_.size(),
+                    numThreads_, [this, p]( size_t i ) {
+                        pools_[i].recalcTime( &sys_, p->currTime );
+                    } );
         }
     }
 
@@ -559,30 +631,6 @@ void Gsolve::process( const Eref& e, ProcPtr p )
     }
 }
 
-size_t Gsolve::recalcTimeChunk( const size_t begin, const size_t end, ProcPtr p)
-{
-    assert( begin >= std::min(pools_.size(), end));
-
-    size_t tot = 0;
-    for (size_t i = begin; i < std::min(pools_.size(), end); i++)  {
-        tot += 1;
-        pools_[i].recalcTime( &sys_, p->currTime );
-    }
-    return tot;
-}
-
-size_t Gsolve::advance_chunk( const size_t begin, const size_t end, ProcPtr p )
-{
-    assert( begin <= std::min(end, pools_.size()) );
-    size_t tot = 0;
-    for (size_t i = begin; i < std::min(end, pools_.size() ); i++)
-    {
-        pools_[i].advance( p, &sys_ );
-        tot += 1;
-    }
-    return tot;
-}
-
 void Gsolve::reinit( const Eref& e, ProcPtr p )
 {
     if ( !stoichPtr_ )
@@ -648,6 +696,7 @@ void Gsolve::rebuildGssaSystem()
     fillPoolFuncDep();
     fillIncrementFuncDep();
     makeReacDepsUnique();
+    fillLeapOrders();
     for ( vector< GssaVoxelPools >::iterator
             i = pools_.begin(); i != pools_.end(); ++i )
     {
@@ -921,6 +970,40 @@ void Gsolve::makeReacDepsUnique()
     }
 }
 
+/**
+ * Fill in the highest order of reaction in which each pool is a
+ * reactant, and whether it appears more than once in such a reaction.
+ * These set how much each pool may change in a tau-leap.
+ */
+void Gsolve::fillLeapOrders()
+{
+    unsigned int numPools = stoichPtr_->getNumAllPools();
+    sys_.highestOrder.assign( numPools, 0 );
+    sys_.isMultipleReactant.assign( numPools, false );
+    for ( unsigned int i = 0; i < stoichPtr_->getNumRates(); ++i )
+    {
+        vector< unsigned int > molIndex;
+        unsigned int order = stoichPtr_->rates( i )->getReactants( molIndex );
+        for ( unsigned int j = 0; j < order && j < molIndex.size(); ++j )
+        {
+            unsigned int mol = molIndex[j];
+            if ( mol >= numPools )
+                continue;
+            bool isMultiple = count( molIndex.begin(),
+                    molIndex.begin() + order, mol ) > 1;
+            if ( order > sys_.highestOrder[ mol ] )
+            {
+                sys_.highestOrder[ mol ] = order;
+                sys_.isMultipleReactant[ mol ] = isMultiple;
+            }
+            else if ( order == sys_.highestOrder[ mol ] && isMultiple )
+            {
+                sys_.isMultipleReactant[ mol ] = true;
+            }
+        }
+    }
+}
+
 //////////////////////////////////////////////////////////////
 // Solver ops
 //////////////////////////////////////////////////////////////
@@ -990,6 +1073,15 @@ double Gsolve::getN( const Eref& e ) const
     return 0.0;
 }
 
+const double* Gsolve::getNaddress( const Eref& e ) const
+{
+    unsigned int vox = getVoxelIndex( e );
+    unsigned int pool = getPoolIndex( e );
+    if ( vox != OFFNODE && pool < pools_[vox].size() )
+        return pools_[vox].S() + pool;
+    return 0;
+}
+
 double Gsolve::getR1( unsigned int reacIdx, const Eref& e ) const
 {
     unsigned int vox = getVoxelIndex( e );
@@ -1163,3 +1255,28 @@ void Gsolve::setNumThreads( unsigned int x )
 {
     numThreads_ = x;
 }
+
+void Gsolve::saveState( CheckpointWriter& w ) const
+{
+    w.putString( rng_.getState() );
+    w.put< unsigned int >( pools_.size() );
+    for ( const GssaVoxelPools& vp : pools_ )
+        vp.saveState( w );
+}
+
+bool Gsolve::loadState( CheckpointReader& r )
+{
+    string rng = r.getString();
+    if ( r.get< unsigned int >() != pools_.size() )
+    {
+        cout << "Warning: Gsolve::loadState: number of voxels differs\n";
+        return false;
+    }
+    for ( GssaVoxelPools& vp : pools_ )
+        if ( !vp.loadState( r ) )
+            return false;
+    if ( !r.good() )
+        return false;
+    rng_.setState( rng );
+    return true;
+}
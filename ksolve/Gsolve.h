@@ -77,6 +77,7 @@ public:
     void fillIncrementFuncDep();
     void insertMathDepReacs(unsigned int mathDepIndex, unsigned int firedReac);
     void makeReacDepsUnique();
+    void fillLeapOrders();
 
     //////////////////////////////////////////////////////////////////
     // Solver interface functions
@@ -84,6 +85,7 @@ public:
     unsigned int getPoolIndex( const Eref& e ) const;
     unsigned int getVoxelIndex( const Eref& e ) const;
     vector< unsigned int > getNumFire( unsigned int voxel) const;
+    vector< double > getLeapStats( unsigned int voxel) const;
 
     /**
      * Inherited. Needed for reac-diff calculations so the Gsolve can
@@ -98,6 +100,7 @@ public:
 
     void setN( const Eref& e, double v );
     double getN( const Eref& e ) const;
+    const double* getNaddress( const Eref& e ) const;
     double getR1( unsigned int reacIdx, const Eref& e ) const;
     void setConcInit( const Eref& e, double v );
     double getConcInit( const Eref& e ) const;
@@ -114,10 +117,6 @@ public:
      */
     void updateRateTerms( unsigned int index );
 
-    // Function for multithreading.
-    size_t advance_chunk( const size_t begin, const size_t end, ProcPtr p );
-    size_t recalcTimeChunk( const size_t begin, const size_t end, ProcPtr p);
-
     //////////////////////////////////////////////////////////////////
     /// Flag: returns true if randomized round to integers is done.
     bool getRandInit() const;
@@ -137,6 +136,24 @@ public:
     unsigned int getNumThreads( ) const;
     void setNumThreads( unsigned int x );
 
+    /// Returns the stochastic engine: "direct" or "nrm".
+    string getMethod() const;
+    /// Assigns the stochastic engine. Takes effect at reinit.
+    void setMethod( string method );
+
+    /// Error control parameter for tau-leaping.
+    double getLeapEpsilon() const;
+    void setLeapEpsilon( double val );
+
+    /// Returns how the next reaction is picked: "linear" or "tree".
+    string getSelectionMethod() const;
+    /// Assigns how the next reaction is picked: "linear" or "tree".
+    void setSelectionMethod( string method );
+
+    /// Saves and restores the state of all voxels, for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     //////////////////////////////////////////////////////////////////
     static const Cinfo* initCinfo();
 private:
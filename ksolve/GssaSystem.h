@@ -20,8 +20,19 @@ class GssaSystem
 {
 public:
     GssaSystem()
-        : stoich(0), useRandInit(true), isReady(false), honorMassConservation(true)
+        : stoich(0), useRandInit(true), isReady(false), honorMassConservation(true),
+        usePropensityTree(false), method(DIRECT),
+        leapEpsilon(0.03), leapCriticalFirings(10)
     {;}
+
+    /// Stochastic engines available to advance each voxel.
+    enum Method
+    {
+        DIRECT,         /// Gillespie direct method.
+        NEXT_REACTION,  /// Gibson-Bruck next reaction method.
+        TAU_LEAP        /// Adaptive explicit tau-leaping.
+    };
+
     vector< vector< unsigned int > > dependency;
     vector< vector< unsigned int > > dependentMathExpn;
     vector< vector< unsigned int > > ratesDependentOnPool;
@@ -53,6 +64,50 @@ public:
      * the sum of molecules is does not differ more than 1.0 molecules.
      */
     bool honorMassConservation = true;
+
+    /**
+     * Flag: True when the next reaction is picked by searching a binary
+     * partial-sum tree of propensities (log time) rather than by a
+     * linear scan over all reaction velocities. The tree pays off for
+     * systems with more than a few hundred reactions per voxel.
+     */
+    bool usePropensityTree = false;
+
+    /**
+     * Stochastic engine. The direct method draws two random numbers per
+     * event, one to pick the reaction and one for the waiting time.
+     * The next reaction method keeps a putative firing time for every
+     * reaction in an indexed priority queue, and only updates the
+     * times of the reactions in the dependency list of the one that
+     * fired. It needs one random number per event.
+     */
+    Method method = DIRECT;
+
+    /**
+     * Error control parameter for tau-leaping (Cao, Gillespie and
+     * Petzold 2006). The leap is chosen so that the expected relative
+     * change in the propensity of any reaction is below leapEpsilon.
+     */
+    double leapEpsilon = 0.03;
+
+    /**
+     * A reaction is critical, and is fired exactly rather than leaped,
+     * if it can fire fewer than this many times before exhausting one
+     * of its reactants. Keeps the rare pools exact.
+     */
+    double leapCriticalFirings = 10;
+
+    /**
+     * Highest order of any reaction in which each pool is a reactant.
+     * Zero if it is not a reactant. Used for tau-leap step selection.
+     */
+    vector< unsigned int > highestOrder;
+
+    /**
+     * Flag per pool: True if the pool appears more than once as a
+     * reactant in a reaction of its highest order, as in 2A -> B.
+     */
+    vector< bool > isMultipleReactant;
 };
 
 #endif	// _GSSA_SYSTEM_H
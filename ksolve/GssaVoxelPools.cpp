@@ -20,6 +20,7 @@
 #include "Stoich.h"
 #include "GssaSystem.h"
 #include "GssaVoxelPools.h"
+#include "../basecode/Checkpoint.h"
 
 /**
  * The SAFETY_FACTOR Protects against the total propensity exceeding
@@ -38,9 +39,20 @@
  */
 const double SAFETY_FACTOR = 1.0 + 1.0e-9;
 
+/**
+ * Tau-leaping is only worthwhile if the leap covers several events.
+ * If the selected leap is below EXACT_STEP_RATIO / atot, we do up to
+ * NUM_EXACT_STEPS exact events instead (Cao, Gillespie, Petzold 2006).
+ */
+const double EXACT_STEP_RATIO = 10.0;
+const unsigned int NUM_EXACT_STEPS = 100;
+
 
 // Class definitions
-GssaVoxelPools::GssaVoxelPools(): VoxelPoolsBase(), t_( 0.0 ), atot_( 0.0 )
+GssaVoxelPools::GssaVoxelPools():
+    VoxelPoolsBase(), t_( 0.0 ), atot_( 0.0 ), usePropensityTree_( false ),
+    useNextReaction_( false ), tLast_( 0.0 ), useTauLeap_( false ),
+    numLeaps_( 0 ), numExactSteps_( 0 ), numRejectedLeaps_( 0 ), sumTau_( 0.0 )
 {;}
 
 GssaVoxelPools::~GssaVoxelPools()
@@ -84,6 +96,13 @@ void GssaVoxelPools::updateDependentMathExpn(
 void GssaVoxelPools::updateDependentRates(
     const vector< unsigned int >& deps, const Stoich* stoich )
 {
+    if ( usePropensityTree_ )
+    {
+        for ( auto i = deps.cbegin(); i != deps.end(); ++i )
+            tree_.update( *i, fabs( v_[ *i ] = getReacVelocity( *i, S() ) ) );
+        atot_ = tree_.total();
+        return;
+    }
     for ( auto i = deps.cbegin(); i != deps.end(); ++i )
     {
         atot_ -= fabs( v_[ *i ] );
@@ -95,6 +114,11 @@ void GssaVoxelPools::updateDependentRates(
 unsigned int GssaVoxelPools::pickReac()
 {
     double r = rng_.uniform( ) * atot_;
+
+    // Slepoy, Thompson and Plimpton 2008 style log-time lookup.
+    if ( usePropensityTree_ )
+        return tree_.find( r );
+
     double sum = 0.0;
 
     // This is an inefficient way to do it. Can easily get to
@@ -120,6 +144,7 @@ void GssaVoxelPools::setNumReac( unsigned int n )
     v_.clear();
     v_.resize( n, 0.0 );
     numFire_.resize( n, 0 );
+    tree_.resize( n );
 }
 
 /**
@@ -131,11 +156,30 @@ bool GssaVoxelPools::refreshAtot( const GssaSystem* g )
 {
     g->stoich->updateFuncs( varS(), t_ );
     updateReacVelocities( g, S(), v_ );
-    atot_ = 0;
-    for ( auto i = v_.cbegin(); i != v_.cend(); ++i )
-        atot_ += fabs(*i);
+    usePropensityTree_ = g->usePropensityTree;
+    if ( usePropensityTree_ )
+    {
+        // The tree total is recomputed exactly on each update, so it
+        // does not need the SAFETY_FACTOR.
+        tree_.build( v_ );
+        atot_ = tree_.total();
+    }
+    else
+    {
+        atot_ = 0;
+        for ( auto i = v_.cbegin(); i != v_.cend(); ++i )
+            atot_ += fabs(*i);
 
-    atot_ *= SAFETY_FACTOR;
+        atot_ *= SAFETY_FACTOR;
+    }
+
+    if ( useNextReaction_ )
+    {
+        // Propensities may have changed arbitrarily, so the old putative
+        // times are no longer valid. Redraw them from the current time.
+        resetPutativeTimes( tLast_ );
+        t_ = queue_.topTime();
+    }
 
     // Check if the system is in a stuck state. If so, terminate.
     if ( atot_ <= 0.0 )
@@ -150,6 +194,18 @@ bool GssaVoxelPools::refreshAtot( const GssaSystem* g )
  */
 void GssaVoxelPools::recalcTime( const GssaSystem* g, double currTime )
 {
+    if ( useTauLeap_ )
+    {
+        // Propensities are recomputed at the start of every leap.
+        refreshAtot( g );
+        return;
+    }
+    if ( useNextReaction_ )
+    {
+        tLast_ = currTime;
+        refreshAtot( g );
+        return;
+    }
     refreshAtot( g );
     assert( t_ > currTime );
     t_ = currTime;
@@ -161,6 +217,16 @@ void GssaVoxelPools::recalcTime( const GssaSystem* g, double currTime )
 
 void GssaVoxelPools::advance( const ProcInfo* p, const GssaSystem* g )
 {
+    if ( useNextReaction_ )
+    {
+        advanceNextReaction( p, g );
+        return;
+    }
+    if ( useTauLeap_ )
+    {
+        advanceTauLeap( p, g );
+        return;
+    }
     double nextt = p->currTime;
     while ( t_ < nextt )
     {
@@ -210,6 +276,290 @@ void GssaVoxelPools::advance( const ProcInfo* p, const GssaSystem* g )
     }
 }
 
+//////////////////////////////////////////////////////////////
+// Next reaction method
+//////////////////////////////////////////////////////////////
+
+double GssaVoxelPools::putativeTime( double t, double a )
+{
+    if ( a <= 0.0 )
+        return numeric_limits< double >::infinity();
+    double r = rng_.uniform();
+    while ( r <= 0.0 )
+        r = rng_.uniform();
+    return t - log( r ) / a;
+}
+
+void GssaVoxelPools::resetPutativeTimes( double t )
+{
+    vector< double > times( v_.size() );
+    for ( unsigned int i = 0; i < v_.size(); ++i )
+        times[i] = putativeTime( t, fabs( v_[i] ) );
+    queue_.build( times );
+}
+
+void GssaVoxelPools::updateDependentTimes(
+    const vector< unsigned int >& deps, unsigned int fired )
+{
+    for ( auto i = deps.cbegin(); i != deps.end(); ++i )
+    {
+        if ( *i == fired )
+            continue;
+        double aOld = fabs( v_[ *i ] );
+        double aNew = fabs( v_[ *i ] = getReacVelocity( *i, S() ) );
+        if ( aOld > 0.0 && aNew > 0.0 )
+        {
+            // Gibson-Bruck: rescale the remaining waiting time rather
+            // than drawing a new random number.
+            queue_.update( *i, t_ + ( aOld / aNew ) * ( queue_.time( *i ) - t_ ) );
+        }
+        else
+        {
+            queue_.update( *i, putativeTime( t_, aNew ) );
+        }
+    }
+    v_[ fired ] = getReacVelocity( fired, S() );
+    queue_.update( fired, putativeTime( t_, fabs( v_[ fired ] ) ) );
+}
+
+void GssaVoxelPools::advanceNextReaction( const ProcInfo* p, const GssaSystem* g )
+{
+    double nextt = p->currTime;
+    while ( t_ < nextt )
+    {
+        unsigned int rindex = queue_.top();
+        assert( rindex < v_.size() );
+
+        double sign = std::copysign( 1, v_[rindex] );
+        g->transposeN.fireReac( rindex, Svec(), sign );
+        numFire_[rindex]++;
+        tLast_ = t_;
+
+        g->stoich->updateFuncs( varS(), t_ );
+        updateDependentTimes( g->dependency[ rindex ], rindex );
+        t_ = queue_.topTime();
+    }
+    tLast_ = nextt;
+}
+
+//////////////////////////////////////////////////////////////
+// Tau leaping
+//////////////////////////////////////////////////////////////
+
+double GssaVoxelPools::selectLeap( const GssaSystem* g )
+{
+    unsigned int numVar = g->stoich->getNumVarPools() +
+        g->stoich->getNumProxyPools();
+    mu_.assign( size(), 0.0 );
+    sigma2_.assign( size(), 0.0 );
+    for ( unsigned int j = 0; j < v_.size(); ++j )
+    {
+        if ( !critical_[j] && v_[j] != 0.0 )
+            g->transposeN.addLeapMoments( j, fabs( v_[j] ),
+                    std::copysign( 1, v_[j] ), mu_, sigma2_ );
+    }
+
+    const double* s = S();
+    double tau = numeric_limits< double >::infinity();
+    for ( unsigned int i = 0; i < numVar && i < g->highestOrder.size(); ++i )
+    {
+        unsigned int hor = g->highestOrder[i];
+        if ( hor == 0 || ( mu_[i] == 0.0 && sigma2_[i] == 0.0 ) )
+            continue;
+        // g_i from Cao, Gillespie and Petzold 2006, eqn 27.
+        double gi = hor;
+        if ( g->isMultipleReactant[i] )
+        {
+            if ( hor == 2 && s[i] > 1.0 )
+                gi = 2.0 + 1.0 / ( s[i] - 1.0 );
+            else if ( hor >= 3 && s[i] > 2.0 )
+                gi = 3.0 + 1.0 / ( s[i] - 1.0 ) + 2.0 / ( s[i] - 2.0 );
+        }
+        double bound = std::max( g->leapEpsilon * s[i] / gi, 1.0 );
+        if ( mu_[i] != 0.0 )
+            tau = std::min( tau, bound / fabs( mu_[i] ) );
+        if ( sigma2_[i] > 0.0 )
+            tau = std::min( tau, bound * bound / sigma2_[i] );
+    }
+    return tau;
+}
+
+unsigned int GssaVoxelPools::exactSteps( const GssaSystem* g, double nextt,
+        unsigned int maxSteps )
+{
+    unsigned int numFired = 0;
+    if ( !refreshAtot( g ) )
+    {
+        t_ = nextt;
+        return 0;
+    }
+    while ( numFired < maxSteps && t_ < nextt )
+    {
+        if ( atot_ <= 0.0 )
+        {
+            t_ = nextt;
+            break;
+        }
+        double r = rng_.uniform();
+        while ( r <= 0.0 )
+            r = rng_.uniform();
+        double dt = -log( r ) / atot_;
+        // By memorylessness, an event past nextt can simply be dropped.
+        if ( t_ + dt >= nextt )
+        {
+            t_ = nextt;
+            break;
+        }
+        t_ += dt;
+
+        unsigned int rindex = pickReac();
+        if ( rindex >= v_.size() )
+        {
+            // Roundoff in atot. Recalculate and redraw.
+            t_ -= dt;
+            if ( !refreshAtot( g ) )
+            {
+                t_ = nextt;
+                break;
+            }
+            continue;
+        }
+        double sign = std::copysign( 1, v_[rindex] );
+        g->transposeN.fireReac( rindex, Svec(), sign );
+        numFire_[rindex]++;
+        ++numFired;
+        g->stoich->updateFuncs( varS(), t_ );
+        updateDependentRates( g->dependency[ rindex ], g->stoich );
+    }
+    return numFired;
+}
+
+void GssaVoxelPools::advanceTauLeap( const ProcInfo* p, const GssaSystem* g )
+{
+    double nextt = p->currTime;
+    unsigned int numReac = v_.size();
+    unsigned int numVar = g->stoich->getNumVarPools() +
+        g->stoich->getNumProxyPools();
+    critical_.resize( numReac );
+    leapFire_.resize( numReac );
+
+    while ( t_ < nextt )
+    {
+        g->stoich->updateFuncs( varS(), t_ );
+        updateReacVelocities( g, S(), v_ );
+        double a0 = 0.0;
+        double a0c = 0.0;
+        for ( unsigned int j = 0; j < numReac; ++j )
+        {
+            double a = fabs( v_[j] );
+            a0 += a;
+            critical_[j] = ( a > 0.0 && g->transposeN.maxFirings( j, S(),
+                        std::copysign( 1, v_[j] ) ) < g->leapCriticalFirings );
+            if ( critical_[j] )
+                a0c += a;
+        }
+        if ( a0 <= 0.0 )   // reac system is stuck, will not advance.
+        {
+            t_ = nextt;
+            g->stoich->updateFuncs( varS(), t_ );
+            return;
+        }
+
+        double tau1 = selectLeap( g );
+        if ( tau1 < EXACT_STEP_RATIO / a0 )
+        {
+            numExactSteps_ += exactSteps( g, nextt, NUM_EXACT_STEPS );
+            continue;
+        }
+
+        // Waiting time for the next critical reaction.
+        double tau2 = numeric_limits< double >::infinity();
+        if ( a0c > 0.0 )
+        {
+            double r = rng_.uniform();
+            while ( r <= 0.0 )
+                r = rng_.uniform();
+            tau2 = -log( r ) / a0c;
+        }
+
+        sSave_ = Svec();
+        while ( true )
+        {
+            double tau = std::min( tau1, nextt - t_ );
+            bool fireCritical = ( tau2 <= tau );
+            if ( fireCritical )
+                tau = tau2;
+
+            for ( unsigned int j = 0; j < numReac; ++j )
+            {
+                leapFire_[j] = 0.0;
+                if ( critical_[j] || v_[j] == 0.0 )
+                    continue;
+                double k = rng_.poisson( fabs( v_[j] ) * tau );
+                if ( k > 0.0 )
+                {
+                    leapFire_[j] = k;
+                    g->transposeN.leapReac( j, Svec(), std::copysign( k, v_[j] ) );
+                }
+            }
+            if ( fireCritical )
+            {
+                double r = rng_.uniform() * a0c;
+                double sum = 0.0;
+                unsigned int jc = numReac;
+                for ( unsigned int j = 0; j < numReac; ++j )
+                {
+                    if ( critical_[j] )
+                    {
+                        jc = j;
+                        if ( r < ( sum += fabs( v_[j] ) ) )
+                            break;
+                    }
+                }
+                assert( jc < numReac );
+                leapFire_[jc] += 1.0;
+                g->transposeN.leapReac( jc, Svec(), std::copysign( 1, v_[jc] ) );
+            }
+
+            bool isNegative = false;
+            const double* s = S();
+            for ( unsigned int i = 0; i < numVar; ++i )
+            {
+                if ( s[i] < 0.0 )
+                {
+                    isNegative = true;
+                    break;
+                }
+            }
+            if ( !isNegative )
+            {
+                for ( unsigned int j = 0; j < numReac; ++j )
+                    numFire_[j] += static_cast< unsigned int >( leapFire_[j] );
+                t_ += tau;
+                ++numLeaps_;
+                sumTau_ += tau;
+                break;
+            }
+            // Leap overshot: restore and retry with half the step.
+            Svec() = sSave_;
+            tau1 /= 2.0;
+            ++numRejectedLeaps_;
+        }
+    }
+    g->stoich->updateFuncs( varS(), t_ );
+}
+
+vector< double > GssaVoxelPools::leapStats() const
+{
+    vector< double > ret( 4, 0.0 );
+    ret[0] = numLeaps_;
+    ret[1] = numExactSteps_;
+    ret[2] = numRejectedLeaps_;
+    if ( numLeaps_ > 0 )
+        ret[3] = sumTau_ / numLeaps_;
+    return ret;
+}
+
 void GssaVoxelPools::reinit( const GssaSystem* g, int rngSeedOffset )
 {
     rng_.setSeed( moose::getGlobalSeed() + rngSeedOffset );
@@ -249,6 +599,13 @@ void GssaVoxelPools::reinit( const GssaSystem* g, int rngSeedOffset )
     }
 
     t_ = 0.0;
+    tLast_ = 0.0;
+    useNextReaction_ = ( g->method == GssaSystem::NEXT_REACTION );
+    useTauLeap_ = ( g->method == GssaSystem::TAU_LEAP );
+    numLeaps_ = 0;
+    numExactSteps_ = 0;
+    numRejectedLeaps_ = 0;
+    sumTau_ = 0.0;
     refreshAtot( g );
     numFire_.assign( v_.size(), 0 );
 }
@@ -374,3 +731,49 @@ void GssaVoxelPools::xferIn( XferInfo& xf, unsigned int voxelIndex, const GssaSy
     // Does this fix the problem of negative concs?
     refreshAtot( g );
 }
+
+void GssaVoxelPools::saveState( CheckpointWriter& w ) const
+{
+    VoxelPoolsBase::saveState( w );
+    w.put( t_ );
+    w.put( atot_ );
+    w.putVec( v_ );
+    w.putVec( numFire_ );
+    w.putVec( tree_.getSums() );
+    w.put( tLast_ );
+    w.putVec( queue_.getTimes() );
+    w.putVec( queue_.getHeap() );
+    w.put( numLeaps_ );
+    w.put( numExactSteps_ );
+    w.put( numRejectedLeaps_ );
+    w.put( sumTau_ );
+    w.putString( rng_.getState() );
+}
+
+bool GssaVoxelPools::loadState( CheckpointReader& r )
+{
+    if ( !VoxelPoolsBase::loadState( r ) )
+        return false;
+    r.get( t_ );
+    r.get( atot_ );
+    if ( !r.getVecInPlace( v_ ) || !r.getVecInPlace( numFire_ ) )
+        return false;
+    vector< double > sums;
+    if ( !r.getVec( sums ) || !tree_.setSums( sums ) )
+        return false;
+    r.get( tLast_ );
+    vector< double > times;
+    vector< unsigned int > heap;
+    if ( !r.getVec( times ) || !r.getVec( heap ) ||
+            !queue_.setState( times, heap ) )
+        return false;
+    r.get( numLeaps_ );
+    r.get( numExactSteps_ );
+    r.get( numRejectedLeaps_ );
+    r.get( sumTau_ );
+    string rng = r.getString();
+    if ( !r.good() )
+        return false;
+    rng_.setState( rng );
+    return true;
+}
@@ -11,6 +11,8 @@
 #define _GSSA_VOXEL_POOLS_BASE_H
 
 #include "../randnum/RNG.h"
+#include "PropensityTree.h"
+#include "IndexedPriorityQueue.h"
 
 class Stoich;
 
@@ -30,12 +32,64 @@ public:
 
     void updateDependentRates( const vector< unsigned int >& deps, const Stoich* stoich );
 
+    /**
+     * Picks the next reaction to fire, weighted by propensity. Uses
+     * either a linear scan over v_ or a search of the propensity tree,
+     * depending on GssaSystem::usePropensityTree at the last refreshAtot.
+     */
     unsigned int pickReac();
 
     void setNumReac( unsigned int n );
 
     void advance( const ProcInfo* p, const GssaSystem* g );
 
+    /**
+     * Advances the voxel using the Gibson-Bruck next reaction method.
+     * Used in place of the direct method when GssaSystem::method is
+     * NEXT_REACTION.
+     */
+    void advanceNextReaction( const ProcInfo* p, const GssaSystem* g );
+
+    /**
+     * Recomputes the propensities of the reactions in deps after
+     * reaction 'fired' has fired, and rescales their putative times.
+     * The fired reaction gets a fresh putative time.
+     */
+    void updateDependentTimes( const vector< unsigned int >& deps,
+            unsigned int fired );
+
+    /// Draws fresh putative times for all reactions, starting at t.
+    void resetPutativeTimes( double t );
+
+    /**
+     * Advances the voxel by adaptive explicit tau-leaping. Reactions
+     * that are close to exhausting a reactant are treated as critical
+     * and fired exactly, the rest are leaped with Poisson numbers of
+     * firings. Falls back to exact steps when the leap would be too
+     * short to be worthwhile.
+     */
+    void advanceTauLeap( const ProcInfo* p, const GssaSystem* g );
+
+    /**
+     * Returns the largest leap for which the expected change of every
+     * pool keeps the propensities within GssaSystem::leapEpsilon,
+     * considering only the noncritical reactions.
+     */
+    double selectLeap( const GssaSystem* g );
+
+    /**
+     * Fires up to maxSteps reactions exactly using the direct method,
+     * stopping at nextt. Returns the number fired.
+     */
+    unsigned int exactSteps( const GssaSystem* g, double nextt,
+            unsigned int maxSteps );
+
+    /**
+     * Returns the tau-leap statistics since reinit: number of leaps,
+     * number of exact steps, number of rejected leaps, and mean leap.
+     */
+    vector< double > leapStats() const;
+
     vector< unsigned int > numFire() const;
 
     /**
@@ -74,6 +128,14 @@ public:
 
     void setStoich( const Stoich* stoichPtr );
 
+    /**
+     * Saves and restores the pools, propensities, event queue and RNG,
+     * for checkpoints. The next event is then drawn as it would have
+     * been without the break.
+     */
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
 private:
     /// Time at which next event will occur.
     double t_;
@@ -93,6 +155,56 @@ private:
     // Count how many times each reaction has fired.
     vector< unsigned int > numFire_;
 
+    /// Flag: True when pickReac uses tree_ rather than a linear scan.
+    bool usePropensityTree_;
+
+    /**
+     * Partial-sum tree of |v_|, kept in step with v_ when
+     * usePropensityTree_ is set. atot_ is then the tree total.
+     */
+    PropensityTree tree_;
+
+    /// Flag: True when advance uses the next reaction method.
+    bool useNextReaction_;
+
+    /**
+     * Time up to which this voxel has been advanced: the time of the
+     * last event, or the end of the last clock tick. Putative times are
+     * redrawn from here when the propensities change from outside.
+     */
+    double tLast_;
+
+    /// Putative firing times of all reactions, for the next reaction method.
+    IndexedPriorityQueue queue_;
+
+    /// Draws the putative time of a reaction of propensity a, after t.
+    double putativeTime( double t, double a );
+
+    /**
+     * Flag: True when advance uses tau-leaping. In this mode t_ is the
+     * time up to which the voxel has been advanced.
+     */
+    bool useTauLeap_;
+
+    /// Flag per reaction: True if it is critical in the current leap.
+    vector< bool > critical_;
+
+    /// Number of firings of each reaction in the current leap.
+    vector< double > leapFire_;
+
+    /// Scratch: expected change and variance of each pool per unit time.
+    vector< double > mu_;
+    vector< double > sigma2_;
+
+    /// Pool #s before the leap, restored if the leap is rejected.
+    vector< double > sSave_;
+
+    // Tau-leap statistics.
+    unsigned long numLeaps_;
+    unsigned long numExactSteps_;
+    unsigned long numRejectedLeaps_;
+    double sumTau_;
+
     /**
      * @brief RNG.
      */
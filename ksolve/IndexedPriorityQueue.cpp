@@ -0,0 +1,137 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include <vector>
+#include <limits>
+#include <cassert>
+using namespace std;
+
+#include "IndexedPriorityQueue.h"
+
+IndexedPriorityQueue::IndexedPriorityQueue()
+{;}
+
+void IndexedPriorityQueue::build( const vector< double >& times )
+{
+    time_ = times;
+    unsigned int n = times.size();
+    heap_.resize( n );
+    pos_.resize( n );
+    for ( unsigned int i = 0; i < n; ++i )
+    {
+        heap_[i] = i;
+        pos_[i] = i;
+    }
+    for ( unsigned int i = n / 2; i > 0; --i )
+        siftDown( i - 1 );
+}
+
+unsigned int IndexedPriorityQueue::size() const
+{
+    return heap_.size();
+}
+
+unsigned int IndexedPriorityQueue::top() const
+{
+    assert( heap_.size() > 0 );
+    return heap_[0];
+}
+
+double IndexedPriorityQueue::topTime() const
+{
+    if ( heap_.size() == 0 )
+        return numeric_limits< double >::infinity();
+    return time_[ heap_[0] ];
+}
+
+double IndexedPriorityQueue::time( unsigned int i ) const
+{
+    return time_[i];
+}
+
+void IndexedPriorityQueue::update( unsigned int i, double t )
+{
+    assert( i < time_.size() );
+    double old = time_[i];
+    time_[i] = t;
+    if ( t < old )
+        siftUp( pos_[i] );
+    else if ( t > old )
+        siftDown( pos_[i] );
+}
+
+void IndexedPriorityQueue::swapNodes( unsigned int a, unsigned int b )
+{
+    unsigned int ra = heap_[a];
+    unsigned int rb = heap_[b];
+    heap_[a] = rb;
+    heap_[b] = ra;
+    pos_[rb] = a;
+    pos_[ra] = b;
+}
+
+void IndexedPriorityQueue::siftUp( unsigned int node )
+{
+    while ( node > 0 )
+    {
+        unsigned int parent = ( node - 1 ) / 2;
+        if ( !( time_[ heap_[node] ] < time_[ heap_[parent] ] ) )
+            break;
+        swapNodes( node, parent );
+        node = parent;
+    }
+}
+
+void IndexedPriorityQueue::siftDown( unsigned int node )
+{
+    unsigned int n = heap_.size();
+    while ( true )
+    {
+        unsigned int smallest = node;
+        unsigned int left = 2 * node + 1;
+        unsigned int right = left + 1;
+        if ( left < n && time_[ heap_[left] ] < time_[ heap_[smallest] ] )
+            smallest = left;
+        if ( right < n && time_[ heap_[right] ] < time_[ heap_[smallest] ] )
+            smallest = right;
+        if ( smallest == node )
+            break;
+        swapNodes( node, smallest );
+        node = smallest;
+    }
+}
+
+const vector< double >& IndexedPriorityQueue::getTimes() const
+{
+    return time_;
+}
+
+const vector< unsigned int >& IndexedPriorityQueue::getHeap() const
+{
+    return heap_;
+}
+
+bool IndexedPriorityQueue::setState( const vector< double >& times,
+        const vector< unsigned int >& heap )
+{
+    unsigned int n = times.size();
+    if ( heap.size() != n )
+        return false;
+    vector< unsigned int > pos( n, n );
+    for ( unsigned int i = 0; i < n; ++i )
+    {
+        if ( heap[i] >= n || pos[ heap[i] ] != n )
+            return false;
+        pos[ heap[i] ] = i;
+    }
+    time_ = times;
+    heap_ = heap;
+    pos_.swap( pos );
+    return true;
+}
@@ -0,0 +1,71 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#ifndef _INDEXED_PRIORITY_QUEUE_H
+#define _INDEXED_PRIORITY_QUEUE_H
+
+/**
+ * Indexed binary min-heap of putative reaction firing times, as used
+ * by the Gibson-Bruck next reaction method.
+ * Each reaction index has exactly one entry in the heap, and its
+ * position is tracked so that the time of any reaction can be changed
+ * in log time when its propensity changes. The earliest reaction is
+ * always at the top.
+ */
+class IndexedPriorityQueue
+{
+public:
+    IndexedPriorityQueue();
+
+    /// Builds the heap from a vector of times, one per reaction.
+    void build( const vector< double >& times );
+
+    /// Number of reactions in the queue.
+    unsigned int size() const;
+
+    /// Index of the reaction with the earliest time.
+    unsigned int top() const;
+
+    /// Earliest time in the queue. Infinity if the queue is empty.
+    double topTime() const;
+
+    /// Returns the putative time of reaction i.
+    double time( unsigned int i ) const;
+
+    /// Assigns a new time to reaction i and restores the heap order.
+    void update( unsigned int i, double t );
+
+    /// Times and heap order, for checkpoints.
+    const vector< double >& getTimes() const;
+    const vector< unsigned int >& getHeap() const;
+
+    /**
+     * Restores the queue from getTimes and getHeap, keeping the order
+     * of the heap so that ties are broken as before. Returns false if
+     * heap is not an ordering of the reactions.
+     */
+    bool setState( const vector< double >& times,
+            const vector< unsigned int >& heap );
+
+private:
+    void swapNodes( unsigned int a, unsigned int b );
+    void siftUp( unsigned int node );
+    void siftDown( unsigned int node );
+
+    /// Putative firing time of each reaction, indexed by reaction.
+    vector< double > time_;
+
+    /// Heap of reaction indices, ordered by time_.
+    vector< unsigned int > heap_;
+
+    /// Position of each reaction in heap_.
+    vector< unsigned int > pos_;
+};
+
+#endif	// _INDEXED_PRIORITY_QUEUE_H
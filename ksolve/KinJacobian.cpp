@@ -0,0 +1,111 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include "../basecode/header.h"
+#include "../basecode/SparseMatrix.h"
+#include "RateTerm.h"
+#include "RateKernel.h"
+#include "KinSparseMatrix.h"
+#include "KinJacobian.h"
+
+KinJacobian::KinJacobian()
+    : numVar_( 0 ), reacStart_( 1, 0 )
+{;}
+
+unsigned int KinJacobian::numVar() const
+{
+    return numVar_;
+}
+
+unsigned int KinJacobian::numReacEntries() const
+{
+    return reacCol_.size();
+}
+
+const SparseLU& KinJacobian::lu() const
+{
+    return lu_;
+}
+
+void KinJacobian::build( const vector< RateTerm* >& rates,
+        const KinSparseMatrix& N, unsigned int numVar )
+{
+    assert( N.nColumns() == rates.size() );
+    numVar_ = numVar;
+
+    // The unknowns that each reaction velocity depends on.
+    reacStart_.assign( 1, 0 );
+    reacCol_.clear();
+    vector< unsigned int > mol;
+    for ( unsigned int r = 0; r < rates.size(); ++r )
+    {
+        rates[r]->getReactants( mol );
+        sort( mol.begin(), mol.end() );
+        mol.erase( unique( mol.begin(), mol.end() ), mol.end() );
+        for ( unsigned int m : mol )
+            if ( m < numVar )
+                reacCol_.push_back( m );
+        reacStart_.push_back( reacCol_.size() );
+    }
+
+    // Pattern of J = N * dv/dS.
+    vector< vector< unsigned int > > pattern( numVar );
+    for ( unsigned int i = 0; i < numVar; ++i )
+    {
+        const int* entry = 0;
+        const unsigned int* colIndex = 0;
+        unsigned int numEntries = N.getRow( i, &entry, &colIndex );
+        for ( unsigned int j = 0; j < numEntries; ++j )
+        {
+            unsigned int r = colIndex[j];
+            for ( unsigned int p = reacStart_[r]; p < reacStart_[r + 1]; ++p )
+                pattern[i].push_back( reacCol_[p] );
+        }
+        sort( pattern[i].begin(), pattern[i].end() );
+        pattern[i].erase( unique( pattern[i].begin(), pattern[i].end() ),
+                pattern[i].end() );
+    }
+    lu_.analyze( numVar, pattern );
+
+    planJ_.clear();
+    planN_.clear();
+    planV_.clear();
+    for ( unsigned int i = 0; i < numVar; ++i )
+    {
+        const int* entry = 0;
+        const unsigned int* colIndex = 0;
+        unsigned int numEntries = N.getRow( i, &entry, &colIndex );
+        for ( unsigned int j = 0; j < numEntries; ++j )
+        {
+            unsigned int r = colIndex[j];
+            for ( unsigned int p = reacStart_[r]; p < reacStart_[r + 1]; ++p )
+            {
+                planJ_.push_back( lu_.position( i, reacCol_[p] ) );
+                planN_.push_back( entry[j] );
+                planV_.push_back( p );
+            }
+        }
+    }
+}
+
+void KinJacobian::reacDerivatives( const RateKernel& kernel,
+        const double* S, double* dvdS, double* work ) const
+{
+    kernel.derivatives( S, reacStart_, reacCol_, dvdS, work );
+}
+
+void KinJacobian::fill( const double* dvdS, double* J ) const
+{
+    const unsigned int numEntries = lu_.numEntries();
+    for ( unsigned int i = 0; i < numEntries; ++i )
+        J[i] = 0.0;
+    const unsigned int numPlan = planJ_.size();
+    for ( unsigned int i = 0; i < numPlan; ++i )
+        J[ planJ_[i] ] += planN_[i] * dvdS[ planV_[i] ];
+}
@@ -0,0 +1,82 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#ifndef _KIN_JACOBIAN_H
+#define _KIN_JACOBIAN_H
+
+#include "SparseLU.h"
+
+class RateTerm;
+class RateKernel;
+class KinSparseMatrix;
+
+/**
+ * Sparsity structure of the Jacobian of a reaction system, shared by
+ * all the voxels of a Ksolve.
+ *
+ * The Jacobian is J = N * dv/dS, where N is the stoichiometry matrix
+ * and dv/dS holds the derivatives of the reaction velocities with
+ * respect to the pool numbers. dv/dS is stored by reaction, with one
+ * entry for each reactant listed by RateTerm::getReactants. The
+ * product with N is precomputed as a list of (entry of J, entry of
+ * N, entry of dv/dS) triples, so that filling J is a single loop.
+ * J is laid out in the pattern of the SparseLU of I - h*J, so that
+ * it can be copied straight into the factorization.
+ *
+ * Only the first numVar pools, the variable and proxy pools, are
+ * unknowns. Derivatives with respect to the other pools are dropped.
+ */
+class KinJacobian
+{
+public:
+    KinJacobian();
+
+    /**
+     * Sets up the structure for the reaction system of the rates,
+     * with stoichiometry N, in which the first numVar pools vary.
+     */
+    void build( const vector< RateTerm* >& rates, const KinSparseMatrix& N,
+            unsigned int numVar );
+
+    /// Number of unknowns.
+    unsigned int numVar() const;
+
+    /// Number of entries of dv/dS.
+    unsigned int numReacEntries() const;
+
+    /**
+     * Fills in dv/dS for the pool numbers S, using the rate constants
+     * of kernel. work must hold a copy of S.
+     */
+    void reacDerivatives( const RateKernel& kernel, const double* S,
+            double* dvdS, double* work ) const;
+
+    /// Fills in J, in the layout of lu(), from dv/dS.
+    void fill( const double* dvdS, double* J ) const;
+
+    /// Factorization structure of I - h*J.
+    const SparseLU& lu() const;
+
+private:
+    unsigned int numVar_;
+
+    /// dv/dS of reaction r is over the pools
+    /// reacCol_[ reacStart_[r] .. reacStart_[r+1] ).
+    vector< unsigned int > reacStart_;
+    vector< unsigned int > reacCol_;
+
+    /// J[ planJ_[i] ] += planN_[i] * dvdS[ planV_[i] ].
+    vector< unsigned int > planJ_;
+    vector< double > planN_;
+    vector< unsigned int > planV_;
+
+    SparseLU lu_;
+};
+
+#endif	// _KIN_JACOBIAN_H
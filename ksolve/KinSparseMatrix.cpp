@@ -14,6 +14,7 @@
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <limits>
 #include "../basecode/SparseMatrix.h"
 #include "../utility/numutil.h"
 #include "KinSparseMatrix.h"
@@ -125,6 +126,43 @@ const
     }
 }
 
+void KinSparseMatrix::leapReac( unsigned int reacIndex, vector< double >& S,
+                                double numFire ) const
+{
+    assert( ncolumns_ == S.size() && reacIndex < nrows_ );
+    unsigned int rowEnd = rowTruncated_[ reacIndex ];
+    for ( unsigned int i = rowStart_[ reacIndex ]; i < rowEnd; ++i )
+        S[ colIndex_[i] ] += N_[i] * numFire;
+}
+
+double KinSparseMatrix::maxFirings( unsigned int reacIndex, const double* S,
+                                    double direction ) const
+{
+    assert( reacIndex < nrows_ );
+    double ret = numeric_limits< double >::max();
+    unsigned int rowEnd = rowTruncated_[ reacIndex ];
+    for ( unsigned int i = rowStart_[ reacIndex ]; i < rowEnd; ++i )
+    {
+        double change = N_[i] * direction;
+        if ( change < 0.0 )
+            ret = std::min( ret, floor( S[ colIndex_[i] ] / -change ) );
+    }
+    return ret;
+}
+
+void KinSparseMatrix::addLeapMoments( unsigned int reacIndex, double a,
+        double direction, vector< double >& mu, vector< double >& sigma2 ) const
+{
+    assert( reacIndex < nrows_ );
+    unsigned int rowEnd = rowTruncated_[ reacIndex ];
+    for ( unsigned int i = rowStart_[ reacIndex ]; i < rowEnd; ++i )
+    {
+        double change = N_[i] * direction;
+        mu[ colIndex_[i] ] += change * a;
+        sigma2[ colIndex_[i] ] += change * change * a;
+    }
+}
+
 /**
  * This function generates a new internal list of rowEnds, such that
  * they are all less than the maxColumnIndex.
@@ -51,6 +51,31 @@ public:
     void fireReac( unsigned int reacIndex, vector< double >& S,
                    double direction ) const;
 
+    /**
+     * Fires a reaction numFire times at once, as needed for tau-leaping.
+     * Unlike fireReac, this does not clamp the mol #s at zero, so the
+     * caller can detect and reject leaps that overshoot.
+     * The sign of numFire specifies the direction of the reaction.
+     */
+    void leapReac( unsigned int reacIndex, vector< double >& S,
+                   double numFire ) const;
+
+    /**
+     * Returns how many times the reaction can fire in the specified
+     * direction before one of the variable molecules it consumes runs
+     * out. Returns a very large number if it consumes none.
+     */
+    double maxFirings( unsigned int reacIndex, const double* S,
+                       double direction ) const;
+
+    /**
+     * Adds the contribution of a reaction with propensity a to the
+     * expected change mu and its variance sigma2 of each variable
+     * molecule over unit time. Used for tau-leap step size selection.
+     */
+    void addLeapMoments( unsigned int reacIndex, double a, double direction,
+                         vector< double >& mu, vector< double >& sigma2 ) const;
+
     /**
     * This function generates a new internal list of rowEnds, such
     * that they are all less than the maxColumnIndex.
@@ -33,20 +33,24 @@
 #include "../mesh/Boundary.h"
 #include "../mesh/ChemCompt.h"
 #include "Ksolve.h"
+#include "../basecode/Checkpoint.h"
 
 #include <chrono>
 #include <algorithm>
 
-#include <future>
-#include <functional>
-#include <atomic>
-#include <thread>
+#include "../utility/ThreadPool.h"
 
 using namespace std::chrono;
 map< Id, unsigned int > Ksolve::defaultPoolLookup_;
 
 const unsigned int OFFNODE = ~0;
 
+/**
+ * Weight of the latest measurement in the running estimate of the cost
+ * of each voxel, used to balance voxels across threads.
+ */
+const double COST_WEIGHT = 0.25;
+
 const Cinfo* Ksolve::initCinfo()
 {
     ///////////////////////////////////////////////////////
@@ -61,7 +65,14 @@ const Cinfo* Ksolve::initCinfo()
         "rk2: The Runge-Kutta 2,3 embedded fixed dt method"
         "rkck: The Runge-Kutta Cash-Karp (4,5) method"
         "rk8: The Runge-Kutta Prince-Dormand (8,9) method"
-        "lsoda: LSODA method",
+        "lsoda: LSODA method"
+        "batch: Cash-Karp (4,5) adaptive method that advances batchWidth "
+        "voxels in lockstep. Falls back to rk5 per voxel if the reaction "
+        "system has Functions, and to trbdf2 per voxel for a step that "
+        "is too stiff for it."
+        "batchc: As batch, but with fixed Runge-Kutta 4th order substeps"
+        "trbdf2: Implicit TR-BDF2 method with an analytic sparse "
+        "Jacobian, for stiff systems",
         &Ksolve::setMethod,
         &Ksolve::getMethod
     );
@@ -123,6 +134,66 @@ const Cinfo* Ksolve::initCinfo()
         &Ksolve::getNumThreads
     );
 
+    static ValueFinfo< Ksolve, unsigned int > batchWidth(
+        "batchWidth",
+        "Number of neighbouring voxels that the batch and batchc methods "
+        "advance in lockstep. Wider batches vectorize better, but the "
+        "adaptive batch method then takes the smallest step that any "
+        "voxel in the batch needs. Default: 8.",
+        &Ksolve::setBatchWidth,
+        &Ksolve::getBatchWidth
+    );
+
+    static ValueFinfo< Ksolve, bool > useRateKernel(
+        "useRateKernel",
+        "Flag: compute reaction velocities with the flattened rate kernel, "
+        "which groups rate terms by type into flat tables. When false, "
+        "each rate term is evaluated through a virtual call. Both give "
+        "identical results; the flag is there for benchmarking. "
+        "Default: true.",
+        &Ksolve::setUseRateKernel,
+        &Ksolve::getUseRateKernel
+    );
+
+    static ReadOnlyValueFinfo< Ksolve, vector< double > > threadBusyTime(
+        "threadBusyTime",
+        "Wall-clock time in seconds that each thread has spent advancing "
+        "voxels since reinit. Entry 0 is the calling thread.",
+        &Ksolve::getThreadBusyTime
+    );
+
+    static ReadOnlyValueFinfo< Ksolve, vector< double > > threadIdleTime(
+        "threadIdleTime",
+        "Wall-clock time in seconds that each thread has spent waiting "
+        "for the others to finish their voxels since reinit. If the load "
+        "is balanced these are small compared to threadBusyTime.",
+        &Ksolve::getThreadIdleTime
+    );
+
+    static ReadOnlyValueFinfo< Ksolve, vector< double > > voxelCost(
+        "voxelCost",
+        "Running estimate of the wall-clock time in seconds taken to "
+        "advance each voxel by one timestep. Used to spread voxels "
+        "evenly across threads. Only measured when numThreads > 1.",
+        &Ksolve::getVoxelCost
+    );
+
+    static ReadOnlyValueFinfo< Ksolve, unsigned long > numJacobians(
+        "numJacobians",
+        "Number of times the trbdf2 method has computed the Jacobian, "
+        "summed over voxels, since reinit. This includes the steps where "
+        "the batch method falls back on trbdf2.",
+        &Ksolve::getNumJacobians
+    );
+
+    static ReadOnlyValueFinfo< Ksolve, unsigned long > numFactorizations(
+        "numFactorizations",
+        "Number of sparse LU factorizations done by the trbdf2 method, "
+        "summed over voxels, since reinit. Factors are reused across "
+        "steps, so this is usually much smaller than the step count.",
+        &Ksolve::getNumFactorizations
+    );
+
     static ValueFinfo< Ksolve, unsigned int > numPools(
         "numPools",
         "Number of molecular pools in the entire reac-diff system, "
@@ -204,6 +275,13 @@ const Cinfo* Ksolve::initCinfo()
         &epsAbs,                         // Value
         &epsRel ,                        // Value
         &numThreads,                     // Value
+        &batchWidth,                     // Value
+        &useRateKernel,                  // Value
+        &threadBusyTime,                 // ReadOnlyValue
+        &threadIdleTime,                 // ReadOnlyValue
+        &voxelCost,                      // ReadOnlyValue
+        &numJacobians,                   // ReadOnlyValue
+        &numFactorizations,              // ReadOnlyValue
         &compartment,                    // Value
         &numLocalVoxels,                 // ReadOnlyValue
         &nVec,                           // LookupValue
@@ -231,6 +309,8 @@ const Cinfo* Ksolve::initCinfo()
 
 static const Cinfo* ksolveCinfo = Ksolve::initCinfo();
 
+static const bool ksolveHook = addCheckpointHook< Ksolve >( "Ksolve" );
+
 //////////////////////////////////////////////////////////////
 // Class definitions
 //////////////////////////////////////////////////////////////
@@ -241,6 +321,9 @@ Ksolve::Ksolve()
     epsAbs_( 1e-7 ),
     epsRel_( 1e-7 ),
     numThreads_( 1 ),
+    useRateKernel_( true ),
+    batchWidth_( 8 ),
+    numBatchedVoxels_( 0 ),
     pools_( 1 ),
     startVoxel_( 0 ),
     dsolve_(),
@@ -279,6 +362,14 @@ void Ksolve::setMethod( string method )
         return;
     }
 
+    // The batch and implicit methods have their own integrators, so
+    // they do not depend on which ODE library is present.
+    if ( method == "batch" || method == "batchc" || method == "trbdf2" )
+    {
+        method_ = method;
+        return;
+    }
+
 #if USE_GSL
     if ( method == "rk5" || method == "gsl" )
     {
@@ -342,6 +433,60 @@ unsigned int Ksolve::getNumThreads(  ) const
     return numThreads_;
 }
 
+unsigned int Ksolve::getBatchWidth() const
+{
+    return batchWidth_;
+}
+
+void Ksolve::setBatchWidth( unsigned int width )
+{
+    batchWidth_ = std::max( width, 1U );
+    numBatchedVoxels_ = 0; // Rebuild on next process.
+}
+
+bool Ksolve::getUseRateKernel() const
+{
+    return useRateKernel_;
+}
+
+void Ksolve::setUseRateKernel( bool val )
+{
+    useRateKernel_ = val;
+    for ( auto& vp : pools_ )
+        vp.setUseRateKernel( val );
+}
+
+vector< double > Ksolve::getThreadBusyTime() const
+{
+    return threadBusy_;
+}
+
+vector< double > Ksolve::getThreadIdleTime() const
+{
+    return threadIdle_;
+}
+
+vector< double > Ksolve::getVoxelCost() const
+{
+    return voxelCost_;
+}
+
+unsigned long Ksolve::getNumJacobians() const
+{
+    unsigned long ret = 0;
+    for ( const auto& vp : pools_ )
+        ret += vp.getTrBdf2().getNumJacobians();
+    return ret;
+}
+
+unsigned long Ksolve::getNumFactorizations() const
+{
+    unsigned long ret = 0;
+    for ( const auto& vp : pools_ )
+        ret += vp.getTrBdf2().getNumFactorizations();
+    return ret;
+}
+
 Id Ksolve::getStoich() const
 {
     return stoich_;
@@ -581,7 +726,16 @@ void Ksolve::process( const Eref& e, ProcPtr p )
         setBlock( dvalues );
     }
 
-    if( 1 == numThreads_ || 1 == pools_.size() )
+    bool isBatchMethod = ( method_ == "batch" || method_ == "batchc" );
+    if ( isBatchMethod && numBatchedVoxels_ != pools_.size() )
+        buildBatches( p->dt );
+
+    if ( !batches_.empty() )
+    {
+        moose::ThreadPool::instance().parallelFor( batches_.size(), numThreads_,
+                [this, p]( size_t i ) { batches_[i].advance( p ); } );
+    }
+    else if( 1 == numThreads_ || 1 == pools_.size() )
     {
         if( numThreads_ > 1 )
         {
@@ -590,29 +744,45 @@ void Ksolve::process( const Eref& e, ProcPtr p )
             numThreads_ = 1;
         }
 
+        auto t0 = steady_clock::now();
         for ( unsigned int i = 0; i < pools_.size(); i++ )
             pools_[i].advance( p );
+        if ( threadBusy_.size() > 0 )
+            threadBusy_[0] += duration<double>( steady_clock::now() - t0 ).count();
     }
     else
     {
-        std::vector<std::future<size_t>> vecFutures;
-
-        // lambdas is faster than std::bind
-        for (auto interval : intervals_)
+        if ( threadBusy_.size() != numThreads_ )
         {
-            vecFutures.push_back( 
-                    std::async( std::launch::async
-                        , &Ksolve::advance_chunk
-                        , this
-                        , interval.first
-                        , interval.second, p 
-                        )
-                    );
+            threadBusy_.resize( numThreads_, 0.0 );
+            threadIdle_.resize( numThreads_, 0.0 );
+        }
+        voxelCost_.resize( pools_.size(), 0.0 );
+        tickBusy_.assign( numThreads_, 0.0 );
+        // Each thread evaluates Functions with its own expressions.
+        stoichPtr_->setNumFuncThreads( numThreads_ );
+
+        // Voxels are handed to the persistent worker pool. Each thread
+        // starts on a range of about equal cost as measured on earlier
+        // ticks, and then steals from the others.
+        auto t0 = steady_clock::now();
+        moose::ThreadPool::instance().parallelFor( pools_.size(), numThreads_,
+                [this, p]( size_t i ) {
+                    auto t = steady_clock::now();
+                    pools_[i].advance( p );
+                    double dt = duration<double>( steady_clock::now() - t ).count();
+                    tickBusy_[ moose::ThreadPool::slot() ] += dt;
+                    if ( voxelCost_[i] > 0.0 )
+                        voxelCost_[i] += COST_WEIGHT * ( dt - voxelCost_[i] );
+                    else
+                        voxelCost_[i] = dt;
+                }, voxelCost_ );
+        double wall = duration<double>( steady_clock::now() - t0 ).count();
+        for ( size_t i = 0; i < numThreads_; ++i )
+        {
+            threadBusy_[i] += tickBusy_[i];
+            threadIdle_[i] += std::max( 0.0, wall - tickBusy_[i] );
         }
-        size_t tot = 0;
-        for (auto &v : vecFutures )
-            tot += v.get();
-        assert(tot == pools_.size());
     }
 
     // Assemble and send the integrated values off for the Dsolve.
@@ -635,23 +805,6 @@ void Ksolve::process( const Eref& e, ProcPtr p )
     //moose::addSolverProf( "Ksolve", duration_cast<duration<double>> (t1_ - t0_ ).count(), 1 );
 }
 
-void Ksolve::advance_pool( const size_t i, ProcPtr p )
-{
-    pools_[i].advance(p);
-}
-
-size_t Ksolve::advance_chunk( const size_t begin, const size_t end, ProcPtr p )
-{
-    size_t tot = 0;
-    for (size_t i = begin; i < std::min(end, pools_.size()); i++)
-    {
-        pools_[i].advance( p );
-        tot += 1;
-    }
-    return tot;
-}
-
-
 void Ksolve::reinit( const Eref& e, ProcPtr p )
 {
     if ( !stoichPtr_ )
@@ -659,8 +812,18 @@ void Ksolve::reinit( const Eref& e, ProcPtr p )
 
     if ( isBuilt_ )
     {
+        // The batch method falls back on TR-BDF2 for stiff ticks.
+        bool isImplicit = ( method_ == "trbdf2" || method_ == "batch" );
+        if ( isImplicit )
+            jacobian_.build( stoichPtr_->getRateTerms(),
+                    stoichPtr_->getStoichiometryMatrix(),
+                    stoichPtr_->getNumVarPools() +
+                    stoichPtr_->getNumProxyPools() );
         for ( unsigned int i = 0 ; i < pools_.size(); ++i ) {
             pools_[i].setNumVoxels( pools_.size() );
+            pools_[i].setUseRateKernel( useRateKernel_ );
+            if ( isImplicit )
+                pools_[i].setJacobian( &jacobian_, epsAbs_, epsRel_ );
             pools_[i].reinit( p->dt );
 		}
     }
@@ -677,9 +840,37 @@ void Ksolve::reinit( const Eref& e, ProcPtr p )
         cout << "Info: Multi-threaded Ksolve (" << numThreads_ << " threads)."
             << endl;
 
-    // Recompute the partition of interval.
-    intervals_.clear();
-    moose::splitIntervalInNParts(pools_.size(), numThreads_, intervals_);
+    threadBusy_.assign( std::max( numThreads_, size_t( 1 ) ), 0.0 );
+    threadIdle_.assign( threadBusy_.size(), 0.0 );
+    voxelCost_.assign( pools_.size(), 0.0 );
+    buildBatches( p->dt );
+}
+
+void Ksolve::buildBatches( double dt )
+{
+    batches_.clear();
+    numBatchedVoxels_ = pools_.size();
+    if ( method_ != "batch" && method_ != "batchc" )
+        return;
+
+    for ( unsigned int i = 0; i < pools_.size(); i += batchWidth_ )
+    {
+        unsigned int width = std::min( batchWidth_,
+                static_cast< unsigned int >( pools_.size() ) - i );
+        batches_.push_back( VoxelBatch() );
+        VoxelBatch& b = batches_.back();
+        if ( !b.build( &pools_[i], width, stoichPtr_ ) )
+        {
+            cout << "Warning: Ksolve::reinit: method '" << method_ <<
+                 "' cannot batch this reaction system, which has Functions "
+                 "or rate terms that differ between voxels. Advancing each "
+                 "voxel on its own instead.\n";
+            batches_.clear();
+            return;
+        }
+        b.setMethod( method_ == "batch", epsAbs_, epsRel_ );
+        b.reinit( dt );
+    }
 }
 
 //////////////////////////////////////////////////////////////
@@ -761,6 +952,15 @@ double Ksolve::getN( const Eref& e ) const
     return 0.0;
 }
 
+const double* Ksolve::getNaddress( const Eref& e ) const
+{
+    unsigned int vox = getVoxelIndex( e );
+    unsigned int pool = getPoolIndex( e );
+    if ( vox != OFFNODE && pool < pools_[vox].size() )
+        return pools_[vox].S() + pool;
+    return 0;
+}
+
 double Ksolve::getR1( unsigned int reacIdx, const Eref& e ) const
 {
     unsigned int vox = getVoxelIndex( e );
@@ -952,3 +1152,34 @@ void Ksolve::print() const
     cout << "compartment = " << compartment_.path() << endl;
 }
 
+void Ksolve::saveState( CheckpointWriter& w ) const
+{
+    w.put< unsigned int >( pools_.size() );
+    for ( const VoxelPools& vp : pools_ )
+        vp.saveState( w );
+    w.put< unsigned int >( batches_.size() );
+    for ( const VoxelBatch& b : batches_ )
+        b.saveState( w );
+}
+
+bool Ksolve::loadState( CheckpointReader& r )
+{
+    if ( r.get< unsigned int >() != pools_.size() )
+    {
+        cout << "Warning: Ksolve::loadState: number of voxels differs\n";
+        return false;
+    }
+    for ( VoxelPools& vp : pools_ )
+        if ( !vp.loadState( r ) )
+            return false;
+    if ( r.get< unsigned int >() != batches_.size() )
+    {
+        cout << "Warning: Ksolve::loadState: voxel batches differ\n";
+        return false;
+    }
+    for ( VoxelBatch& b : batches_ )
+        if ( !b.loadState( r ) )
+            return false;
+    return r.good();
+}
+
@@ -11,6 +11,8 @@
 #define _KSOLVE_H
 
 #include <chrono>
+#include "VoxelBatch.h"
+#include "KinJacobian.h"
 
 using namespace std::chrono;
 
@@ -65,9 +67,25 @@ public:
     unsigned int getNumThreads( ) const;
     void setNumThreads( unsigned int x );
 
-    size_t advance_chunk( const size_t begin, const size_t end, ProcPtr p );
+    /// Number of voxels advanced in lockstep by the batch methods.
+    unsigned int getBatchWidth() const;
+    void setBatchWidth( unsigned int width );
 
-    void advance_pool( const size_t i, ProcPtr p );
+    /// Flag: use the flattened rate kernel to compute velocities.
+    bool getUseRateKernel() const;
+    void setUseRateKernel( bool val );
+
+    /// Time each thread spent advancing voxels, since reinit.
+    vector< double > getThreadBusyTime() const;
+    /// Time each thread spent waiting for the others, since reinit.
+    vector< double > getThreadIdleTime() const;
+    /// Running estimate of the time to advance each voxel by one step.
+    vector< double > getVoxelCost() const;
+
+    /// Jacobian evaluations by the trbdf2 method, over all voxels.
+    unsigned long getNumJacobians() const;
+    /// LU factorizations by the trbdf2 method, over all voxels.
+    unsigned long getNumFactorizations() const;
 
     /**
      * This does a quick and dirty estimate of the timestep suitable
@@ -101,6 +119,7 @@ public:
     // KsolveBase inherited functions
     void setN( const Eref& e, double v );
     double getN( const Eref& e ) const;
+    const double* getNaddress( const Eref& e ) const;
     double getR1( unsigned int reacIdx, const Eref& e ) const;
 
     void setConcInit( const Eref& e, double v );
@@ -147,6 +166,10 @@ public:
     // for debugging
     void print() const;
 
+    /// Saves and restores the state of all voxels, for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     //////////////////////////////////////////////////////////////////
     static const Cinfo* initCinfo();
 
@@ -162,6 +185,22 @@ private:
     size_t numThreads_;
     size_t grainSize_;
 
+    /// Passed on to all voxels. See VoxelPools::setUseRateKernel.
+    bool useRateKernel_;
+
+    /// Groups of voxels advanced in lockstep by the batch methods.
+    vector< VoxelBatch > batches_;
+    unsigned int batchWidth_;
+
+    /// Number of voxels covered by batches_, to catch changes in pools_.
+    unsigned int numBatchedVoxels_;
+
+    /// Sets up batches_ if method_ is a batch method.
+    void buildBatches( double dt );
+
+    /// Jacobian structure used by the trbdf2 method in every voxel.
+    KinJacobian jacobian_;
+
     /**
      * Each VoxelPools entry handles all the pools in a single voxel.
      * Each entry knows how to update itself in order to complete
@@ -191,7 +230,15 @@ private:
     // Time taken in all process function in us.
     double totalTime_ = 0.0;
 
-    vector<std::pair<size_t, size_t>> intervals_;
+    /// Cumulative busy and idle wall-clock time of each thread, in s.
+    vector< double > threadBusy_;
+    vector< double > threadIdle_;
+
+    /// Busy time of each thread in the current tick.
+    vector< double > tickBusy_;
+
+    /// Smoothed cost of advancing each voxel, used to balance threads.
+    vector< double > voxelCost_;
 
     //high_resolution_clock::time_point t0_, t1_;
 	
@@ -29,6 +29,13 @@ public:
     virtual void setN( const Eref& e, double val ) = 0;
     /// Get # of molecules in given pool and voxel. Varies with time.
     virtual double getN( const Eref& e ) const = 0;
+    /**
+     * Address where the solver keeps the # of molecules in given pool
+     * and voxel, or 0 if it is not kept here. Stays valid until the
+     * solver is rebuilt. Lets a SolverRecorder read it each step.
+     */
+    virtual const double* getNaddress( const Eref& e ) const
+    { return 0; }
 
 	/// Get rate const in a given reac and voxel. Usually fixed but 
 	/// may vary if the reac is controlled by a function.
@@ -0,0 +1,90 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include <vector>
+#include <cmath>
+#include <cassert>
+using namespace std;
+
+#include "PropensityTree.h"
+
+PropensityTree::PropensityTree()
+    : n_( 0 ), numLeaves_( 1 ), sum_( 2, 0.0 )
+{;}
+
+void PropensityTree::resize( unsigned int n )
+{
+    n_ = n;
+    numLeaves_ = 1;
+    while ( numLeaves_ < n )
+        numLeaves_ <<= 1;
+    sum_.assign( 2 * numLeaves_, 0.0 );
+}
+
+unsigned int PropensityTree::size() const
+{
+    return n_;
+}
+
+void PropensityTree::build( const vector< double >& v )
+{
+    if ( v.size() != n_ )
+        resize( v.size() );
+    double* leaf = &sum_[ numLeaves_ ];
+    for ( unsigned int i = 0; i < n_; ++i )
+        leaf[i] = fabs( v[i] );
+    for ( unsigned int k = numLeaves_ - 1; k > 0; --k )
+        sum_[k] = sum_[ 2 * k ] + sum_[ 2 * k + 1 ];
+}
+
+void PropensityTree::update( unsigned int i, double propensity )
+{
+    assert( i < n_ );
+    unsigned int k = numLeaves_ + i;
+    sum_[k] = propensity;
+    for ( k >>= 1; k > 0; k >>= 1 )
+        sum_[k] = sum_[ 2 * k ] + sum_[ 2 * k + 1 ];
+}
+
+double PropensityTree::total() const
+{
+    return sum_[1];
+}
+
+unsigned int PropensityTree::find( double r ) const
+{
+    unsigned int k = 1;
+    while ( k < numLeaves_ )
+    {
+        k <<= 1; // left child
+        if ( !( r < sum_[k] ) )
+        {
+            r -= sum_[k];
+            ++k; // right child
+        }
+    }
+    unsigned int ret = k - numLeaves_;
+    // Roundoff can make r drift past the last nonzero leaf of a subtree.
+    if ( ret >= n_ || sum_[k] <= 0.0 )
+        return n_;
+    return ret;
+}
+
+const vector< double >& PropensityTree::getSums() const
+{
+    return sum_;
+}
+
+bool PropensityTree::setSums( const vector< double >& sums )
+{
+    if ( sums.size() != sum_.size() )
+        return false;
+    sum_ = sums;
+    return true;
+}
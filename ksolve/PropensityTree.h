@@ -0,0 +1,78 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#ifndef _PROPENSITY_TREE_H
+#define _PROPENSITY_TREE_H
+
+/**
+ * Binary partial-sum tree over reaction propensities, used by the
+ * GSSA to pick the next reaction in log time rather than by a linear
+ * scan over all reaction velocities.
+ *
+ * The leaves hold |v| of each reaction, and each internal node holds
+ * the sum of its two children. The tree is stored implicitly in an
+ * array: node k has children 2k and 2k+1, the root is node 1, and the
+ * leaves start at numLeaves_, which is rounded up to a power of two.
+ * Because every internal node is recomputed from its children on each
+ * update, the root does not accumulate the add/subtract roundoff that
+ * a running total would.
+ */
+class PropensityTree
+{
+public:
+    PropensityTree();
+
+    /// Allocates a tree for n reactions, with all propensities zero.
+    void resize( unsigned int n );
+
+    /// Number of reactions held in the tree.
+    unsigned int size() const;
+
+    /**
+     * Rebuilds the whole tree from the vector of reaction velocities.
+     * The propensity of each reaction is taken as fabs( v[i] ).
+     */
+    void build( const vector< double >& v );
+
+    /// Assigns propensity of reaction i and updates all its ancestors.
+    void update( unsigned int i, double propensity );
+
+    /// Total propensity of all reactions.
+    double total() const;
+
+    /**
+     * Returns the index of the reaction whose cumulative propensity
+     * interval contains r, where 0 <= r < total(). Reactions are
+     * ordered by index, so this picks the same reaction as a linear
+     * scan would for the same r. Returns size() if roundoff leads the
+     * search to a reaction with zero propensity, or past the end.
+     */
+    unsigned int find( double r ) const;
+
+    /// The whole tree, for checkpoints.
+    const vector< double >& getSums() const;
+
+    /**
+     * Restores a tree from getSums. Returns false if it is not the
+     * size of this one.
+     */
+    bool setSums( const vector< double >& sums );
+
+private:
+    /// Number of reactions.
+    unsigned int n_;
+
+    /// Offset of the first leaf: smallest power of 2 >= n_.
+    unsigned int numLeaves_;
+
+    /// Implicit binary tree of partial sums, size 2 * numLeaves_.
+    vector< double > sum_;
+};
+
+#endif	// _PROPENSITY_TREE_H
@@ -0,0 +1,237 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include <typeinfo>
+#include <cfloat>
+#include "../basecode/header.h"
+#include "RateTerm.h"
+#include "RateKernel.h"
+
+RateKernel::RateKernel()
+    : numRates_( 0 ), nStart_( 1, 0 )
+{;}
+
+unsigned int RateKernel::size() const
+{
+    return numRates_;
+}
+
+unsigned int RateKernel::numGeneric() const
+{
+    return generic_.size();
+}
+
+/// True for the mass action terms that have their own tables.
+static bool isMassAction( const RateTerm* term )
+{
+    const type_info& t = typeid( *term );
+    return t == typeid( ZeroOrder ) || t == typeid( FirstOrder ) ||
+        t == typeid( SecondOrder ) || t == typeid( NOrder );
+}
+
+bool RateKernel::addHalf( const RateTerm* term, unsigned int out,
+        double sign )
+{
+    const type_info& t = typeid( *term );
+    vector< unsigned int > mol;
+    double k = sign * term->getR1();
+    if ( t == typeid( ZeroOrder ) )
+    {
+        zeroOut_.push_back( out );
+        zeroK_.push_back( k );
+    }
+    else if ( t == typeid( FirstOrder ) )
+    {
+        term->getReactants( mol );
+        firstOut_.push_back( out );
+        firstY_.push_back( mol[0] );
+        firstK_.push_back( k );
+    }
+    else if ( t == typeid( SecondOrder ) )
+    {
+        term->getReactants( mol );
+        secondOut_.push_back( out );
+        secondY1_.push_back( mol[0] );
+        secondY2_.push_back( mol[1] );
+        secondK_.push_back( k );
+    }
+    else if ( t == typeid( NOrder ) )
+    {
+        term->getReactants( mol );
+        nOut_.push_back( out );
+        nIndex_.insert( nIndex_.end(), mol.begin(), mol.end() );
+        nStart_.push_back( nIndex_.size() );
+        nK_.push_back( k );
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void RateKernel::build( const vector< RateTerm* >& rates )
+{
+    *this = RateKernel();
+    numRates_ = rates.size();
+    for ( unsigned int i = 0; i < rates.size(); ++i )
+    {
+        const RateTerm* term = rates[i];
+        const type_info& t = typeid( *term );
+        if ( t == typeid( ExternReac ) )
+            continue; // Always zero.
+        if ( addHalf( term, i, 1.0 ) )
+            continue;
+        if ( t == typeid( BidirectionalReaction ) )
+        {
+            const BidirectionalReaction* br =
+                static_cast< const BidirectionalReaction* >( term );
+            const RateTerm* f = br->getForward();
+            const RateTerm* b = br->getBackward();
+            // Both halves must be flattened, or neither.
+            if ( isMassAction( f ) && isMassAction( b ) )
+            {
+                addHalf( f, i, 1.0 );
+                addHalf( b, i, -1.0 );
+                continue;
+            }
+        }
+        else if ( t == typeid( MMEnzyme1 ) )
+        {
+            vector< unsigned int > mol;
+            term->getReactants( mol );
+            mmOut_.push_back( i );
+            mmEnz_.push_back( mol[0] );
+            mmSub_.push_back( mol[1] );
+            mmKm_.push_back( term->getR1() );
+            mmKcat_.push_back( term->getR2() );
+            continue;
+        }
+        genericOut_.push_back( i );
+        generic_.push_back( term );
+    }
+}
+
+void RateKernel::compute( const double* S, double* v ) const
+{
+    for ( unsigned int i = 0; i < numRates_; ++i )
+        v[i] = 0.0;
+
+    const unsigned int numZero = zeroOut_.size();
+    for ( unsigned int i = 0; i < numZero; ++i )
+        v[ zeroOut_[i] ] += zeroK_[i];
+
+    const unsigned int numFirst = firstOut_.size();
+    for ( unsigned int i = 0; i < numFirst; ++i )
+        v[ firstOut_[i] ] += firstK_[i] * S[ firstY_[i] ];
+
+    const unsigned int numSecond = secondOut_.size();
+    for ( unsigned int i = 0; i < numSecond; ++i )
+        v[ secondOut_[i] ] += secondK_[i] * S[ secondY1_[i] ] * S[ secondY2_[i] ];
+
+    const unsigned int numN = nOut_.size();
+    for ( unsigned int i = 0; i < numN; ++i )
+    {
+        double ret = nK_[i];
+        for ( unsigned int j = nStart_[i]; j < nStart_[i + 1]; ++j )
+            ret *= S[ nIndex_[j] ];
+        v[ nOut_[i] ] += ret;
+    }
+
+    const unsigned int numMM = mmOut_.size();
+    for ( unsigned int i = 0; i < numMM; ++i )
+    {
+        double sub = S[ mmSub_[i] ];
+        v[ mmOut_[i] ] = ( mmKcat_[i] * sub * S[ mmEnz_[i] ] ) / ( mmKm_[i] + sub );
+    }
+
+    const unsigned int numGeneric = generic_.size();
+    for ( unsigned int i = 0; i < numGeneric; ++i )
+        v[ genericOut_[i] ] = ( *generic_[i] )( S );
+}
+
+/// Adds val to the derivative of reaction out with respect to pool.
+static void addDerivative( const vector< unsigned int >& start,
+        const vector< unsigned int >& col, double* jv,
+        unsigned int out, unsigned int pool, double val )
+{
+    for ( unsigned int p = start[out]; p < start[out + 1]; ++p )
+    {
+        if ( col[p] == pool )
+        {
+            jv[p] += val;
+            return;
+        }
+    }
+}
+
+void RateKernel::derivatives( const double* S,
+        const vector< unsigned int >& start,
+        const vector< unsigned int >& col, double* jv, double* work ) const
+{
+    assert( start.size() == numRates_ + 1 );
+    for ( unsigned int p = 0; p < start.back(); ++p )
+        jv[p] = 0.0;
+
+    const unsigned int numFirst = firstOut_.size();
+    for ( unsigned int i = 0; i < numFirst; ++i )
+        addDerivative( start, col, jv, firstOut_[i], firstY_[i], firstK_[i] );
+
+    const unsigned int numSecond = secondOut_.size();
+    for ( unsigned int i = 0; i < numSecond; ++i )
+    {
+        unsigned int out = secondOut_[i];
+        double k = secondK_[i];
+        addDerivative( start, col, jv, out, secondY1_[i], k * S[ secondY2_[i] ] );
+        addDerivative( start, col, jv, out, secondY2_[i], k * S[ secondY1_[i] ] );
+    }
+
+    const unsigned int numN = nOut_.size();
+    for ( unsigned int i = 0; i < numN; ++i )
+    {
+        for ( unsigned int j = nStart_[i]; j < nStart_[i + 1]; ++j )
+        {
+            double ret = nK_[i];
+            for ( unsigned int m = nStart_[i]; m < nStart_[i + 1]; ++m )
+                if ( m != j )
+                    ret *= S[ nIndex_[m] ];
+            addDerivative( start, col, jv, nOut_[i], nIndex_[j], ret );
+        }
+    }
+
+    const unsigned int numMM = mmOut_.size();
+    for ( unsigned int i = 0; i < numMM; ++i )
+    {
+        double sub = S[ mmSub_[i] ];
+        double denom = 1.0 / ( mmKm_[i] + sub );
+        addDerivative( start, col, jv, mmOut_[i], mmEnz_[i],
+                mmKcat_[i] * sub * denom );
+        addDerivative( start, col, jv, mmOut_[i], mmSub_[i],
+                mmKcat_[i] * S[ mmEnz_[i] ] * mmKm_[i] * denom * denom );
+    }
+
+    // Forward differences on the listed reactants of the other terms.
+    const double delta = sqrt( DBL_EPSILON );
+    const unsigned int numGeneric = generic_.size();
+    for ( unsigned int i = 0; i < numGeneric; ++i )
+    {
+        unsigned int out = genericOut_[i];
+        const RateTerm& term = *generic_[i];
+        double v0 = term( work );
+        for ( unsigned int p = start[out]; p < start[out + 1]; ++p )
+        {
+            unsigned int pool = col[p];
+            double orig = work[ pool ];
+            double h = delta * std::max( fabs( orig ), 1.0 );
+            work[ pool ] = orig + h;
+            jv[p] = ( term( work ) - v0 ) / h;
+            work[ pool ] = orig;
+        }
+    }
+}
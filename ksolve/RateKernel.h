@@ -0,0 +1,101 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#ifndef _RATE_KERNEL_H
+#define _RATE_KERNEL_H
+
+class RateTerm;
+
+/**
+ * Flattened form of a vector of RateTerms, used by VoxelPools to
+ * compute reaction velocities without virtual calls or allocation.
+ *
+ * The terms are grouped by type into struct-of-arrays tables of pool
+ * indices and rate constants: zero, first, second and N-th order mass
+ * action, and single-substrate Michaelis-Menten enzymes. A
+ * BidirectionalReaction is split into its two half reactions, with
+ * the rate constant of the backward half negated, so that each table
+ * just accumulates into the velocity of its reaction. The velocities
+ * are identical to those of the virtual RateTerm::operator().
+ *
+ * Terms without a flat form, such as FuncRates and multi-substrate
+ * MMEnzymes, are kept as pointers and called as before. The kernel
+ * holds no ownership of them, and must be rebuilt whenever the rate
+ * terms are replaced or rescaled.
+ */
+class RateKernel
+{
+public:
+    RateKernel();
+
+    /// Compiles the tables from the rate terms of a voxel.
+    void build( const vector< RateTerm* >& rates );
+
+    /**
+     * Fills in v with the velocity of each reaction, given the pool
+     * numbers S. v must have room for one entry per rate term.
+     */
+    void compute( const double* S, double* v ) const;
+
+    /**
+     * Fills in jv with the partial derivatives of each reaction
+     * velocity with respect to its reactants. Row r of jv holds the
+     * derivatives of v[r] with respect to the pools
+     * col[ start[r] .. start[r+1] ), and derivatives with respect to
+     * pools not listed there are dropped. Terms without a flat form
+     * are differentiated by finite differences, for which work must
+     * hold a copy of S. work is unchanged on return.
+     */
+    void derivatives( const double* S, const vector< unsigned int >& start,
+            const vector< unsigned int >& col, double* jv,
+            double* work ) const;
+
+    /// Number of rate terms.
+    unsigned int size() const;
+
+    /// Number of rate terms that are evaluated through a virtual call.
+    unsigned int numGeneric() const;
+
+private:
+    friend class VoxelBatch;
+
+    /// Adds a half reaction to the mass action tables. False if unknown.
+    bool addHalf( const RateTerm* term, unsigned int out, double sign );
+
+    unsigned int numRates_;
+
+    vector< unsigned int > zeroOut_;
+    vector< double > zeroK_;
+
+    vector< unsigned int > firstOut_;
+    vector< unsigned int > firstY_;
+    vector< double > firstK_;
+
+    vector< unsigned int > secondOut_;
+    vector< unsigned int > secondY1_;
+    vector< unsigned int > secondY2_;
+    vector< double > secondK_;
+
+    /// Reactants of term i are nIndex_[ nStart_[i] .. nStart_[i+1] ).
+    vector< unsigned int > nOut_;
+    vector< unsigned int > nStart_;
+    vector< unsigned int > nIndex_;
+    vector< double > nK_;
+
+    vector< unsigned int > mmOut_;
+    vector< unsigned int > mmEnz_;
+    vector< unsigned int > mmSub_;
+    vector< double > mmKm_;
+    vector< double > mmKcat_;
+
+    vector< unsigned int > genericOut_;
+    vector< const RateTerm* > generic_;
+};
+
+#endif	// _RATE_KERNEL_H
@@ -631,6 +631,16 @@ public:
         return backward_->getR1();
     }
 
+    const ZeroOrder* getForward() const
+    {
+        return forward_;
+    }
+
+    const ZeroOrder* getBackward() const
+    {
+        return backward_;
+    }
+
     unsigned int getReactants( vector< unsigned int >& molIndex ) const
     {
         forward_->getReactants( molIndex );
@@ -0,0 +1,198 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include <vector>
+#include <set>
+#include <cmath>
+#include <algorithm>
+#include <cassert>
+using namespace std;
+
+#include "SparseLU.h"
+
+SparseLU::SparseLU()
+    : n_( 0 ), rowStart_( 1, 0 )
+{;}
+
+unsigned int SparseLU::size() const
+{
+    return n_;
+}
+
+unsigned int SparseLU::numEntries() const
+{
+    return col_.size();
+}
+
+void SparseLU::analyze( unsigned int n,
+        const vector< vector< unsigned int > >& pattern )
+{
+    assert( pattern.size() == n );
+    n_ = n;
+
+    // Symbolic elimination on the active submatrix. Each step takes
+    // the diagonal pivot with the fewest updates, (r-1)*(c-1), and
+    // adds the fill-in that its elimination causes. All entries that
+    // ever appear are kept in filled, which becomes the pattern of L+U.
+    vector< set< unsigned int > > rows( n );
+    vector< set< unsigned int > > cols( n );
+    for ( unsigned int i = 0; i < n; ++i )
+    {
+        rows[i].insert( i );
+        cols[i].insert( i );
+        for ( unsigned int j : pattern[i] )
+        {
+            assert( j < n );
+            rows[i].insert( j );
+            cols[j].insert( i );
+        }
+    }
+    vector< set< unsigned int > > filled = rows;
+    vector< bool > done( n, false );
+    perm_.clear();
+    for ( unsigned int step = 0; step < n; ++step )
+    {
+        unsigned int pivot = n;
+        unsigned long best = ~0UL;
+        for ( unsigned int i = 0; i < n; ++i )
+        {
+            if ( done[i] )
+                continue;
+            unsigned long cost = static_cast< unsigned long >(
+                    rows[i].size() - 1 ) * ( cols[i].size() - 1 );
+            if ( cost < best )
+            {
+                best = cost;
+                pivot = i;
+            }
+        }
+        assert( pivot < n );
+        for ( unsigned int r : cols[ pivot ] )
+        {
+            if ( r == pivot )
+                continue;
+            for ( unsigned int c : rows[ pivot ] )
+            {
+                if ( c == pivot )
+                    continue;
+                if ( rows[r].insert( c ).second )
+                {
+                    cols[c].insert( r );
+                    filled[r].insert( c );
+                }
+            }
+        }
+        for ( unsigned int r : cols[ pivot ] )
+            if ( r != pivot )
+                rows[r].erase( pivot );
+        for ( unsigned int c : rows[ pivot ] )
+            if ( c != pivot )
+                cols[c].erase( pivot );
+        done[ pivot ] = true;
+        perm_.push_back( pivot );
+    }
+
+    iperm_.resize( n );
+    for ( unsigned int i = 0; i < n; ++i )
+        iperm_[ perm_[i] ] = i;
+
+    rowStart_.assign( 1, 0 );
+    col_.clear();
+    diag_.resize( n );
+    for ( unsigned int i = 0; i < n; ++i )
+    {
+        vector< unsigned int > row;
+        for ( unsigned int c : filled[ perm_[i] ] )
+            row.push_back( iperm_[c] );
+        sort( row.begin(), row.end() );
+        for ( unsigned int c : row )
+        {
+            if ( c == i )
+                diag_[i] = col_.size();
+            col_.push_back( c );
+        }
+        rowStart_.push_back( col_.size() );
+    }
+}
+
+unsigned int SparseLU::position( unsigned int row, unsigned int col ) const
+{
+    if ( row >= n_ || col >= n_ )
+        return ~0U;
+    unsigned int i = iperm_[ row ];
+    unsigned int c = iperm_[ col ];
+    vector< unsigned int >::const_iterator begin =
+        col_.begin() + rowStart_[i];
+    vector< unsigned int >::const_iterator end =
+        col_.begin() + rowStart_[i + 1];
+    vector< unsigned int >::const_iterator k = lower_bound( begin, end, c );
+    if ( k == end || *k != c )
+        return ~0U;
+    return k - col_.begin();
+}
+
+unsigned int SparseLU::diagonal( unsigned int i ) const
+{
+    return diag_[ iperm_[i] ];
+}
+
+bool SparseLU::factor( double* a, double* work ) const
+{
+    // Row by row: scatter row i into work, subtract multiples of the
+    // rows above it, and gather it back. Because the pattern is closed
+    // under fill-in, every update lands on an entry of row i.
+    for ( unsigned int i = 0; i < n_; ++i )
+    {
+        const unsigned int begin = rowStart_[i];
+        const unsigned int end = rowStart_[i + 1];
+        for ( unsigned int p = begin; p < end; ++p )
+            work[ col_[p] ] = a[p];
+        for ( unsigned int p = begin; p < diag_[i]; ++p )
+        {
+            unsigned int k = col_[p];
+            double l = work[k] / a[ diag_[k] ];
+            work[k] = l;
+            if ( l == 0.0 )
+                continue;
+            for ( unsigned int q = diag_[k] + 1; q < rowStart_[k + 1]; ++q )
+                work[ col_[q] ] -= l * a[q];
+        }
+        for ( unsigned int p = begin; p < end; ++p )
+            a[p] = work[ col_[p] ];
+        double pivot = a[ diag_[i] ];
+        if ( pivot == 0.0 || !std::isfinite( pivot ) )
+            return false;
+    }
+    return true;
+}
+
+void SparseLU::solve( const double* a, double* x, double* work ) const
+{
+    for ( unsigned int i = 0; i < n_; ++i )
+        work[i] = x[ perm_[i] ];
+
+    for ( unsigned int i = 0; i < n_; ++i )
+    {
+        double sum = work[i];
+        for ( unsigned int p = rowStart_[i]; p < diag_[i]; ++p )
+            sum -= a[p] * work[ col_[p] ];
+        work[i] = sum;
+    }
+    for ( unsigned int i = n_; i > 0; --i )
+    {
+        unsigned int r = i - 1;
+        double sum = work[r];
+        for ( unsigned int p = diag_[r] + 1; p < rowStart_[r + 1]; ++p )
+            sum -= a[p] * work[ col_[p] ];
+        work[r] = sum / a[ diag_[r] ];
+    }
+
+    for ( unsigned int i = 0; i < n_; ++i )
+        x[ perm_[i] ] = work[i];
+}
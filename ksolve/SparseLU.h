@@ -0,0 +1,90 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#ifndef _SPARSE_LU_H
+#define _SPARSE_LU_H
+
+/**
+ * Sparse LU factorization without pivoting, for the iteration matrices
+ * I - h*J of the implicit kinetic solvers.
+ *
+ * The work is split in two. analyze() is done once per reaction
+ * system: it picks an elimination order by the Markowitz criterion to
+ * keep fill-in low, and works out the pattern of L+U including all
+ * fill-in. factor() and solve() then only do arithmetic on a value
+ * array laid out in that pattern, which is held by the caller so that
+ * one SparseLU can serve many voxels.
+ *
+ * Pivots are always taken from the diagonal. This is safe for the
+ * matrices I - h*J of kinetic systems when h is not too large, since
+ * their diagonal dominates. factor() reports a failure if a pivot
+ * vanishes, and the integrator then retries with a smaller h.
+ */
+class SparseLU
+{
+public:
+    SparseLU();
+
+    /**
+     * Sets up the elimination order and the filled pattern for an
+     * n x n matrix. pattern[i] lists the columns of the nonzero
+     * entries of row i. The diagonal is always included.
+     */
+    void analyze( unsigned int n,
+            const vector< vector< unsigned int > >& pattern );
+
+    /// Number of rows.
+    unsigned int size() const;
+
+    /// Number of entries of L+U, including fill-in.
+    unsigned int numEntries() const;
+
+    /**
+     * Returns the position in the value array of entry (row, col),
+     * in the original numbering. Returns ~0U if it is not in the
+     * pattern.
+     */
+    unsigned int position( unsigned int row, unsigned int col ) const;
+
+    /// Position of diagonal entry i, in the original numbering.
+    unsigned int diagonal( unsigned int i ) const;
+
+    /**
+     * Factorizes the matrix in a into L and U in place. work needs
+     * room for size() entries. Returns false if a pivot is zero or
+     * not finite.
+     */
+    bool factor( double* a, double* work ) const;
+
+    /**
+     * Solves LU x = b, given the factors from factor(). x holds b on
+     * entry and the solution on return. work needs room for size()
+     * entries.
+     */
+    void solve( const double* a, double* x, double* work ) const;
+
+private:
+    unsigned int n_;
+
+    /// Original index of the i-th row in elimination order.
+    vector< unsigned int > perm_;
+
+    /// Position in elimination order of each original row.
+    vector< unsigned int > iperm_;
+
+    /// Columns of row i of L+U, in elimination order and sorted, are
+    /// col_[ rowStart_[i] .. rowStart_[i+1] ).
+    vector< unsigned int > rowStart_;
+    vector< unsigned int > col_;
+
+    /// Position of the diagonal of each row, in elimination order.
+    vector< unsigned int > diag_;
+};
+
+#endif	// _SPARSE_LU_H
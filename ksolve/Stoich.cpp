@@ -291,7 +291,8 @@ Stoich::Stoich()
       rates_(0),  // No RateTerms yet.
       // uniqueVols_( 1, 1.0 ),
       numVoxels_(1),
-      status_(-1)
+      status_(-1),
+      numFuncThreads_(1)
 {
     ;
 }
@@ -1059,6 +1060,7 @@ void Stoich::installAndUnschedFunc(Id func, Id pool, double volScale)
 
     // Install the FuncTerm
     FuncTerm* ft = new FuncTerm();
+    ft->setNumThreads(numFuncThreads_);
 
     Id ei(func.value() + 1);
 
@@ -1131,6 +1133,7 @@ void Stoich::installAndUnschedFuncRate(Id func, Id pool)
         }
         poolIndex[j] = convertIdToPoolIndex(srcPools[i].first);
     }
+    fr->setNumThreads(numFuncThreads_);
     fr->setFuncArgIndex(poolIndex);
     string expr = Field<string>::get(func, "expr");
     fr->setExpr(expr);
@@ -1169,6 +1172,7 @@ void Stoich::installAndUnschedFuncReac(Id func, Id reac)
     vector<unsigned int> poolIndex(numSrc, 0);
     for(unsigned int i = 0; i < numSrc; ++i)
         poolIndex[i] = convertIdToPoolIndex(srcPools[i]);
+    fr->setNumThreads(numFuncThreads_);
     fr->setFuncArgIndex(poolIndex);
     string expr = Field<string>::get(func, "expr");
     fr->setExpr(expr);
@@ -2002,6 +2006,21 @@ void Stoich::updateFuncs(double* s, double t) const
             (*i)->evalPool(s, t);
 }
 
+void Stoich::setNumFuncThreads(unsigned int n)
+{
+    if(n == numFuncThreads_)
+        return;
+    numFuncThreads_ = n;
+    for(auto i = funcs_.begin(); i != funcs_.end(); ++i)
+        if(*i)
+            (*i)->setNumThreads(n);
+    for(auto i = rates_.begin(); i != rates_.end(); ++i) {
+        FuncRate* fr = dynamic_cast<FuncRate*>(*i);
+        if(fr)
+            fr->setNumThreads(n);
+    }
+}
+
 /**
  * updateJunctionRates:
  * Updates the rates for cross-compartment reactions. These are located
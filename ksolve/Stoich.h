@@ -460,6 +460,13 @@ public:
     /// Updates the function values, within s.
     void updateFuncs(double* s, double t) const;
 
+    /**
+     * Gives every FuncTerm, including those of FuncRates and FuncReacs,
+     * its own expression and arguments for each of n threads, so that
+     * a solver can evaluate functions in several voxels at once.
+     */
+    void setNumFuncThreads(unsigned int n);
+
     /// Updates the rates for cross-compartment reactions.
     /*
     void updateJunctionRates( const double* s,
@@ -710,6 +717,9 @@ private:
      */
     int status_;
 
+    /// Number of threads that each FuncTerm is set up for.
+    unsigned int numFuncThreads_;
+
     //////////////////////////////////////////////////////////////////
     // Off-solver stuff
     //////////////////////////////////////////////////////////////////
@@ -0,0 +1,326 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include "../basecode/header.h"
+#include "../basecode/SparseMatrix.h"
+#include "RateTerm.h"
+#include "KinSparseMatrix.h"
+#include "OdeSystem.h"
+#include "VoxelPoolsBase.h"
+#include "VoxelPools.h"
+#include "XferInfo.h"
+#include "KsolveBase.h"
+#include "Stoich.h"
+#include "KinJacobian.h"
+#include "TrBdf2.h"
+#include "../basecode/Checkpoint.h"
+
+// The TR stage goes to t + gamma*h. Both stages then use d = gamma/2.
+const double TRBDF2_GAMMA = 2.0 - sqrt( 2.0 );
+const double TRBDF2_D = TRBDF2_GAMMA / 2.0;
+
+// BDF2 stage: y1 - d*h*f(y1) = BDF_Z*z - BDF_Y0*y0.
+const double TRBDF2_BDF_Z = 1.0 / ( TRBDF2_GAMMA * ( 2.0 - TRBDF2_GAMMA ) );
+const double TRBDF2_BDF_Y0 = ( 1.0 - TRBDF2_GAMMA ) * ( 1.0 - TRBDF2_GAMMA ) *
+    TRBDF2_BDF_Z;
+
+// Local error is ERR_C * h^3 * y'''.
+const double TRBDF2_ERR_C =
+    ( -3.0 * TRBDF2_GAMMA * TRBDF2_GAMMA + 4.0 * TRBDF2_GAMMA - 2.0 ) /
+    ( 12.0 * ( 2.0 - TRBDF2_GAMMA ) );
+
+const double TRBDF2_SAFETY = 0.9;
+const double TRBDF2_MAX_GROW = 5.0;
+const double TRBDF2_MAX_SHRINK = 0.2;
+const double TRBDF2_HYSTERESIS = 1.2;
+const double TRBDF2_SHRINK_HYSTERESIS = 0.8;
+const unsigned int TRBDF2_MAX_NEWTON_ITERS = 4;
+
+// W is reused for steps that differ from the one it was formed for by
+// up to this fraction. The Newton iteration absorbs the difference.
+const double TRBDF2_REFACTOR_TOL = 1e-3;
+
+// Newton iteration has converged when its update is this fraction of
+// the error tolerance.
+const double TRBDF2_NEWTON_TOL = 0.1;
+
+TrBdf2::TrBdf2()
+    : jac_( 0 ), numPools_( 0 ), numVar_( 0 ),
+    epsAbs_( 1e-7 ), epsRel_( 1e-7 ),
+    h_( 0.0 ), luH_( 0.0 ),
+    isJacobianFresh_( false ), hasJacobian_( false ), kernelVersion_( 0 ),
+    numSteps_( 0 ), numJacobians_( 0 ), numFactorizations_( 0 )
+{;}
+
+void TrBdf2::setup( const KinJacobian* jac, unsigned int numPools,
+        double epsAbs, double epsRel )
+{
+    jac_ = jac;
+    numPools_ = numPools;
+    numVar_ = jac->numVar();
+    epsAbs_ = epsAbs;
+    epsRel_ = epsRel;
+
+    dvdS_.assign( jac->numReacEntries(), 0.0 );
+    J_.assign( jac->lu().numEntries(), 0.0 );
+    lu_.assign( jac->lu().numEntries(), 0.0 );
+    for ( vector< double >* v :
+            { &y0_, &z_, &y1_, &f0_, &f1_, &f2_, &r_, &f_, &work_ } )
+        v->assign( numPools, 0.0 );
+    for ( vector< double >* v : { &delta_, &err_, &luWork_ } )
+        v->assign( numVar_, 0.0 );
+}
+
+void TrBdf2::reinit( double dt )
+{
+    h_ = dt / 10.0;
+    luH_ = 0.0;
+    hasJacobian_ = false;
+    isJacobianFresh_ = false;
+    numSteps_ = 0;
+    numJacobians_ = 0;
+    numFactorizations_ = 0;
+}
+
+void TrBdf2::saveState( CheckpointWriter& w, unsigned int kernelVersion ) const
+{
+    w.put( h_ );
+    w.put( luH_ );
+    w.put( isJacobianFresh_ );
+    w.put< bool >( hasJacobian_ && kernelVersion_ == kernelVersion );
+    w.put( numSteps_ );
+    w.put( numJacobians_ );
+    w.put( numFactorizations_ );
+    w.putVec( dvdS_ );
+    w.putVec( J_ );
+    w.putVec( lu_ );
+}
+
+bool TrBdf2::loadState( CheckpointReader& r, unsigned int kernelVersion )
+{
+    r.get( h_ );
+    r.get( luH_ );
+    r.get( isJacobianFresh_ );
+    r.get( hasJacobian_ );
+    r.get( numSteps_ );
+    r.get( numJacobians_ );
+    r.get( numFactorizations_ );
+    kernelVersion_ = kernelVersion;
+    return r.getVecInPlace( dvdS_ ) && r.getVecInPlace( J_ ) &&
+        r.getVecInPlace( lu_ );
+}
+
+unsigned long TrBdf2::getNumSteps() const
+{
+    return numSteps_;
+}
+
+unsigned long TrBdf2::getNumJacobians() const
+{
+    return numJacobians_;
+}
+
+unsigned long TrBdf2::getNumFactorizations() const
+{
+    return numFactorizations_;
+}
+
+void TrBdf2::rhs( VoxelPools* vp, double t, double* y, double* dydt )
+{
+    vp->getStoich()->updateFuncs( y, t );
+    vp->updateRates( y, dydt );
+}
+
+void TrBdf2::updateJacobian( VoxelPools* vp, const double* y )
+{
+    const RateKernel& kernel = vp->getRateKernel();
+    kernelVersion_ = vp->getRateKernelVersion();
+    std::copy( y, y + numPools_, work_.begin() );
+    jac_->reacDerivatives( kernel, y, &dvdS_[0], &work_[0] );
+    jac_->fill( &dvdS_[0], &J_[0] );
+    ++numJacobians_;
+    hasJacobian_ = true;
+    isJacobianFresh_ = true;
+    luH_ = 0.0;
+}
+
+bool TrBdf2::factorize( double h )
+{
+    const SparseLU& lu = jac_->lu();
+    const unsigned int numEntries = lu.numEntries();
+    const double scale = -TRBDF2_D * h;
+    for ( unsigned int i = 0; i < numEntries; ++i )
+        lu_[i] = scale * J_[i];
+    for ( unsigned int i = 0; i < numVar_; ++i )
+        lu_[ lu.diagonal( i ) ] += 1.0;
+    ++numFactorizations_;
+    if ( !lu.factor( &lu_[0], &luWork_[0] ) )
+    {
+        luH_ = 0.0;
+        return false;
+    }
+    luH_ = h;
+    return true;
+}
+
+double TrBdf2::norm( const double* x, const double* y ) const
+{
+    double sum = 0.0;
+    for ( unsigned int i = 0; i < numVar_; ++i )
+    {
+        double e = x[i] / ( epsAbs_ + epsRel_ * fabs( y[i] ) );
+        sum += e * e;
+    }
+    return sqrt( sum / numVar_ );
+}
+
+bool TrBdf2::newton( VoxelPools* vp, double t, double h, const double* r,
+        double* z )
+{
+    const SparseLU& lu = jac_->lu();
+    const double dh = TRBDF2_D * h;
+    double oldNorm = 0.0;
+    for ( unsigned int iter = 0; iter < TRBDF2_MAX_NEWTON_ITERS; ++iter )
+    {
+        rhs( vp, t, z, &f_[0] );
+        for ( unsigned int i = 0; i < numVar_; ++i )
+            delta_[i] = r[i] + dh * f_[i] - z[i];
+        lu.solve( &lu_[0], &delta_[0], &luWork_[0] );
+        for ( unsigned int i = 0; i < numVar_; ++i )
+            z[i] += delta_[i];
+        double dn = norm( &delta_[0], z );
+        if ( !std::isfinite( dn ) )
+            return false;
+        if ( dn <= TRBDF2_NEWTON_TOL )
+            return true;
+        if ( iter > 0 )
+        {
+            double rate = dn / oldNorm;
+            if ( rate >= 0.9 )
+                return false;
+            if ( dn * rate / ( 1.0 - rate ) <= TRBDF2_NEWTON_TOL )
+                return true;
+        }
+        oldNorm = dn;
+    }
+    return false;
+}
+
+bool TrBdf2::advance( VoxelPools* vp, double t, double tEnd )
+{
+    if ( numVar_ == 0 )
+        return true;
+    assert( vp->size() == numPools_ );
+
+    vector< double >& S = vp->Svec();
+    y0_ = S;
+
+    vp->getRateKernel(); // Brings the kernel version up to date.
+    if ( !hasJacobian_ || kernelVersion_ != vp->getRateKernelVersion() )
+        updateJacobian( vp, &y0_[0] );
+    rhs( vp, t, &y0_[0], &f0_[0] );
+
+    const double minStep = 1e-12 * ( tEnd - t );
+    bool ok = true;
+    while ( t < tEnd )
+    {
+        // Equal steps to the end of the interval, so that the same W
+        // serves the whole interval and the next one too.
+        double numLeft = ceil( ( tEnd - t ) / h_ - 1e-6 );
+        double h = ( tEnd - t ) / std::max( numLeft, 1.0 );
+        bool isLast = ( numLeft <= 1.0 );
+        if ( fabs( h - luH_ ) > TRBDF2_REFACTOR_TOL * h && !factorize( h ) )
+        {
+            h_ = h * TRBDF2_MAX_SHRINK;
+        }
+        else
+        {
+            const double dh = TRBDF2_D * h;
+            // Trapezoidal stage to t + gamma*h, predicted by Euler.
+            for ( unsigned int i = 0; i < numPools_; ++i )
+            {
+                r_[i] = y0_[i] + dh * f0_[i];
+                z_[i] = y0_[i] + TRBDF2_GAMMA * h * f0_[i];
+            }
+            bool converged = newton( vp, t + TRBDF2_GAMMA * h, h,
+                    &r_[0], &z_[0] );
+            if ( converged )
+            {
+                for ( unsigned int i = 0; i < numVar_; ++i )
+                    f1_[i] = ( z_[i] - r_[i] ) / dh;
+                // BDF2 stage to t + h, predicted by extrapolation.
+                for ( unsigned int i = 0; i < numPools_; ++i )
+                {
+                    r_[i] = TRBDF2_BDF_Z * z_[i] - TRBDF2_BDF_Y0 * y0_[i];
+                    y1_[i] = y0_[i] + ( z_[i] - y0_[i] ) / TRBDF2_GAMMA;
+                }
+                for ( unsigned int i = numVar_; i < numPools_; ++i )
+                    y1_[i] = y0_[i];
+                converged = newton( vp, t + h, h, &r_[0], &y1_[0] );
+            }
+            if ( !converged )
+            {
+                // A stale Jacobian is the usual cause, so try a fresh
+                // one before cutting the step.
+                if ( isJacobianFresh_ )
+                    h_ = h * TRBDF2_MAX_SHRINK;
+                else
+                    updateJacobian( vp, &y0_[0] );
+            }
+            else
+            {
+                for ( unsigned int i = 0; i < numVar_; ++i )
+                {
+                    f2_[i] = ( y1_[i] - r_[i] ) / dh;
+                    err_[i] = TRBDF2_ERR_C * 2.0 * h * (
+                            ( f2_[i] - f1_[i] ) / ( 1.0 - TRBDF2_GAMMA ) -
+                            ( f1_[i] - f0_[i] ) / TRBDF2_GAMMA );
+                }
+                // Filtering through W keeps the estimate of the stiff
+                // components from being too pessimistic.
+                jac_->lu().solve( &lu_[0], &err_[0], &luWork_[0] );
+                double errNorm = norm( &err_[0], &y1_[0] );
+                double factor = TRBDF2_MAX_GROW;
+                if ( errNorm > 0.0 )
+                    factor = TRBDF2_SAFETY * pow( errNorm, -1.0 / 3.0 );
+                factor = std::min( TRBDF2_MAX_GROW,
+                        std::max( TRBDF2_MAX_SHRINK, factor ) );
+                if ( errNorm <= 1.0 )
+                {
+                    t = isLast ? tEnd : t + h;
+                    y0_.swap( y1_ );
+                    for ( unsigned int i = 0; i < numVar_; ++i )
+                        f0_[i] = f2_[i];
+                    ++numSteps_;
+                    isJacobianFresh_ = false;
+                    // Hold h unless it has to shrink or can grow by a
+                    // good margin, so that the factors of W stay valid.
+                    if ( factor < TRBDF2_SHRINK_HYSTERESIS )
+                        h_ = std::min( h_, h * factor );
+                    else if ( factor > TRBDF2_HYSTERESIS )
+                        h_ = std::max( h_, h * factor );
+                }
+                else
+                {
+                    h_ = h * factor;
+                }
+            }
+        }
+        if ( !( h_ > minStep ) ) // Also catches NaN.
+        {
+            cerr << "Error: TrBdf2::advance: timestep has gotten too small "
+                 "at time " << t << "\n";
+            h_ = ( tEnd - t ) / 10.0;
+            ok = false;
+            break;
+        }
+    }
+    S = y0_;
+    return ok;
+}
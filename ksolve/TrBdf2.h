@@ -0,0 +1,131 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#ifndef _TR_BDF2_H
+#define _TR_BDF2_H
+
+class KinJacobian;
+class VoxelPools;
+class CheckpointWriter;
+class CheckpointReader;
+
+/**
+ * Implicit integrator for stiff reaction systems, used by VoxelPools
+ * for the "trbdf2" Ksolve method.
+ *
+ * This is the TR-BDF2 method of Bank et al., as analysed by Hosea and
+ * Shampine (Appl. Numer. Math. 20:21-37, 1996). Each step is a
+ * trapezoidal stage to t + gamma*h followed by a BDF2 stage to t + h,
+ * with gamma = 2 - sqrt(2). It is second order and L-stable, and both
+ * stages solve their implicit equations by Newton iteration with the
+ * same matrix W = I - (gamma/2)*h*J.
+ *
+ * The analytic sparse Jacobian J comes from KinJacobian. Both J and
+ * the LU factors of W are kept across steps, and across calls to
+ * advance. J is only recomputed when the Newton iteration fails to
+ * converge or the rate constants change, and W is only refactorized
+ * when h or J changes. The step size is held unless the error
+ * estimate calls for a change of more than about 20%, so steady
+ * stretches run on one factorization.
+ */
+class TrBdf2
+{
+public:
+    TrBdf2();
+
+    /**
+     * Sets up for a voxel with numPools pools in all, whose reaction
+     * system has the Jacobian structure jac.
+     */
+    void setup( const KinJacobian* jac, unsigned int numPools,
+            double epsAbs, double epsRel );
+
+    /// Drops the saved Jacobian and factors, and resets the counters.
+    void reinit( double dt );
+
+    /**
+     * Advances the pools of vp from t to tEnd. Returns false if the
+     * step size became too small.
+     */
+    bool advance( VoxelPools* vp, double t, double tEnd );
+
+    /// Number of accepted steps since reinit.
+    unsigned long getNumSteps() const;
+
+    /// Number of times the Jacobian was computed since reinit.
+    unsigned long getNumJacobians() const;
+
+    /// Number of LU factorizations of W since reinit.
+    unsigned long getNumFactorizations() const;
+
+    /**
+     * Saves and restores the step size, J and the factors of W, for
+     * checkpoints. kernelVersion is that of the voxel's rate kernel now,
+     * so that a J computed from the current rates stays in use.
+     */
+    void saveState( CheckpointWriter& w, unsigned int kernelVersion ) const;
+    bool loadState( CheckpointReader& r, unsigned int kernelVersion );
+
+private:
+    /// dydt = f( t, y ), including the effect of Functions on y.
+    void rhs( VoxelPools* vp, double t, double* y, double* dydt );
+
+    /// Recomputes J at y.
+    void updateJacobian( VoxelPools* vp, const double* y );
+
+    /// Forms and factorizes W for the step h. False on a zero pivot.
+    bool factorize( double h );
+
+    /**
+     * Solves z - d*h*f(z) = r by Newton iteration, starting from z.
+     * Returns false if the iteration does not converge.
+     */
+    bool newton( VoxelPools* vp, double t, double h, const double* r,
+            double* z );
+
+    /// Weighted RMS norm of x over the unknowns, with weights from y.
+    double norm( const double* x, const double* y ) const;
+
+    const KinJacobian* jac_;
+    unsigned int numPools_;
+    unsigned int numVar_;
+    double epsAbs_;
+    double epsRel_;
+
+    /// Step size to try next.
+    double h_;
+
+    /// Step size for which lu_ holds the factors of W. Zero if none.
+    double luH_;
+
+    /// True if J_ was computed at the start of the current step.
+    bool isJacobianFresh_;
+
+    /// True if J_ holds a Jacobian.
+    bool hasJacobian_;
+
+    /// Version of the rate kernel that J_ was computed with.
+    unsigned int kernelVersion_;
+
+    unsigned long numSteps_;
+    unsigned long numJacobians_;
+    unsigned long numFactorizations_;
+
+    /// dv/dS, J and the factors of W.
+    vector< double > dvdS_;
+    vector< double > J_;
+    vector< double > lu_;
+
+    /// Full pool vectors.
+    vector< double > y0_, z_, y1_, f0_, f1_, f2_, r_, f_, work_;
+    /// Unknowns only.
+    vector< double > delta_, err_, luWork_;
+};
+
+#endif	// _TR_BDF2_H
@@ -0,0 +1,433 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include <memory>
+#include "../basecode/header.h"
+#include "../basecode/SparseMatrix.h"
+
+#ifdef USE_GSL
+#include <gsl/gsl_odeiv2.h>
+#endif
+
+#include "OdeSystem.h"
+#include "VoxelPoolsBase.h"
+#include "VoxelPools.h"
+#include "RateTerm.h"
+#include "KinSparseMatrix.h"
+#include "XferInfo.h"
+#include "KsolveBase.h"
+#include "Stoich.h"
+#include "VoxelBatch.h"
+#include "../basecode/Checkpoint.h"
+
+/// Largest step of the fixed step method, as for the rk4c etc. methods.
+const double BATCH_FIXED_DT = 0.1;
+
+/// Limits on the change in the adaptive step size after each step.
+const double BATCH_MAX_GROWTH = 5.0;
+const double BATCH_MAX_SHRINK = 0.2;
+const double BATCH_SAFETY = 0.9;
+
+VoxelBatch::VoxelBatch()
+    : pools_( nullptr ), width_( 0 ), stoich_( nullptr ),
+      numPools_( 0 ), numVar_( 0 ), isBatched_( false ),
+      isAdaptive_( true ), epsAbs_( 1e-7 ), epsRel_( 1e-7 ),
+      h_( 0.0 ), numSteps_( 0 ), warnedStiff_( false )
+{;}
+
+unsigned int VoxelBatch::size() const
+{
+    return width_;
+}
+
+unsigned long VoxelBatch::getNumSteps() const
+{
+    return numSteps_;
+}
+
+void VoxelBatch::saveState( CheckpointWriter& w ) const
+{
+    w.put( h_ );
+    w.put( numSteps_ );
+}
+
+bool VoxelBatch::loadState( CheckpointReader& r )
+{
+    r.get( h_ );
+    r.get( numSteps_ );
+    return r.good();
+}
+
+bool VoxelBatch::sameLayout( const RateKernel& a, const RateKernel& b )
+{
+    return a.numRates_ == b.numRates_ &&
+        a.zeroOut_ == b.zeroOut_ &&
+        a.firstOut_ == b.firstOut_ && a.firstY_ == b.firstY_ &&
+        a.secondOut_ == b.secondOut_ && a.secondY1_ == b.secondY1_ &&
+        a.secondY2_ == b.secondY2_ &&
+        a.nOut_ == b.nOut_ && a.nStart_ == b.nStart_ &&
+        a.nIndex_ == b.nIndex_ &&
+        a.mmOut_ == b.mmOut_ && a.mmEnz_ == b.mmEnz_ &&
+        a.mmSub_ == b.mmSub_ &&
+        a.generic_.empty() && b.generic_.empty();
+}
+
+bool VoxelBatch::build( VoxelPools* pools, unsigned int numVoxels,
+        const Stoich* stoich )
+{
+    pools_ = pools;
+    width_ = numVoxels;
+    stoich_ = stoich;
+    isBatched_ = false;
+    if ( numVoxels == 0 || stoich->getNumFuncs() > 0 )
+        return false;
+
+    numPools_ = pools[0].size();
+    numVar_ = stoich->getNumVarPools() + stoich->getNumProxyPools();
+    layout_ = pools[0].getRateKernel();
+    versions_.assign( width_, ~0U );
+    if ( !refreshConstants() )
+        return false;
+
+    unsigned int n = numPools_ * width_;
+    y_.assign( n, 0.0 );
+    yTmp_.assign( n, 0.0 );
+    yErr_.assign( n, 0.0 );
+    k1_.assign( n, 0.0 );
+    k2_.assign( n, 0.0 );
+    k3_.assign( n, 0.0 );
+    k4_.assign( n, 0.0 );
+    k5_.assign( n, 0.0 );
+    k6_.assign( n, 0.0 );
+    v_.assign( layout_.numRates_ * width_, 0.0 );
+    prod_.assign( width_, 0.0 );
+    isBatched_ = true;
+    return true;
+}
+
+bool VoxelBatch::refreshConstants()
+{
+    const unsigned int W = width_;
+    zeroK_.resize( layout_.zeroK_.size() * W );
+    firstK_.resize( layout_.firstK_.size() * W );
+    secondK_.resize( layout_.secondK_.size() * W );
+    nK_.resize( layout_.nK_.size() * W );
+    mmKm_.resize( layout_.mmKm_.size() * W );
+    mmKcat_.resize( layout_.mmKcat_.size() * W );
+    for ( unsigned int w = 0; w < W; ++w )
+    {
+        const RateKernel& rk = pools_[w].getRateKernel();
+        if ( pools_[w].size() != numPools_ || !sameLayout( rk, layout_ ) )
+            return false;
+        for ( unsigned int i = 0; i < rk.zeroK_.size(); ++i )
+            zeroK_[ i * W + w ] = rk.zeroK_[i];
+        for ( unsigned int i = 0; i < rk.firstK_.size(); ++i )
+            firstK_[ i * W + w ] = rk.firstK_[i];
+        for ( unsigned int i = 0; i < rk.secondK_.size(); ++i )
+            secondK_[ i * W + w ] = rk.secondK_[i];
+        for ( unsigned int i = 0; i < rk.nK_.size(); ++i )
+            nK_[ i * W + w ] = rk.nK_[i];
+        for ( unsigned int i = 0; i < rk.mmKm_.size(); ++i )
+        {
+            mmKm_[ i * W + w ] = rk.mmKm_[i];
+            mmKcat_[ i * W + w ] = rk.mmKcat_[i];
+        }
+        versions_[w] = pools_[w].getRateKernelVersion();
+    }
+    return true;
+}
+
+void VoxelBatch::setMethod( bool isAdaptive, double epsAbs, double epsRel )
+{
+    isAdaptive_ = isAdaptive;
+    epsAbs_ = epsAbs;
+    epsRel_ = epsRel;
+}
+
+void VoxelBatch::reinit( double dt )
+{
+    h_ = dt / 10.0;
+    numSteps_ = 0;
+}
+
+void VoxelBatch::rhs( const double* y, double* dydt )
+{
+    const unsigned int W = width_;
+    const RateKernel& L = layout_;
+    double* v = &v_[0];
+    for ( unsigned int i = 0; i < v_.size(); ++i )
+        v[i] = 0.0;
+
+    for ( unsigned int i = 0; i < L.zeroOut_.size(); ++i )
+    {
+        double* vo = v + L.zeroOut_[i] * W;
+        const double* k = &zeroK_[ i * W ];
+        for ( unsigned int w = 0; w < W; ++w )
+            vo[w] += k[w];
+    }
+    for ( unsigned int i = 0; i < L.firstOut_.size(); ++i )
+    {
+        double* vo = v + L.firstOut_[i] * W;
+        const double* k = &firstK_[ i * W ];
+        const double* s = y + L.firstY_[i] * W;
+        for ( unsigned int w = 0; w < W; ++w )
+            vo[w] += k[w] * s[w];
+    }
+    for ( unsigned int i = 0; i < L.secondOut_.size(); ++i )
+    {
+        double* vo = v + L.secondOut_[i] * W;
+        const double* k = &secondK_[ i * W ];
+        const double* s1 = y + L.secondY1_[i] * W;
+        const double* s2 = y + L.secondY2_[i] * W;
+        for ( unsigned int w = 0; w < W; ++w )
+            vo[w] += k[w] * s1[w] * s2[w];
+    }
+    for ( unsigned int i = 0; i < L.nOut_.size(); ++i )
+    {
+        double* vo = v + L.nOut_[i] * W;
+        const double* k = &nK_[ i * W ];
+        for ( unsigned int w = 0; w < W; ++w )
+            prod_[w] = k[w];
+        for ( unsigned int j = L.nStart_[i]; j < L.nStart_[i + 1]; ++j )
+        {
+            const double* s = y + L.nIndex_[j] * W;
+            for ( unsigned int w = 0; w < W; ++w )
+                prod_[w] *= s[w];
+        }
+        for ( unsigned int w = 0; w < W; ++w )
+            vo[w] += prod_[w];
+    }
+    for ( unsigned int i = 0; i < L.mmOut_.size(); ++i )
+    {
+        double* vo = v + L.mmOut_[i] * W;
+        const double* Km = &mmKm_[ i * W ];
+        const double* kcat = &mmKcat_[ i * W ];
+        const double* sub = y + L.mmSub_[i] * W;
+        const double* enz = y + L.mmEnz_[i] * W;
+        for ( unsigned int w = 0; w < W; ++w )
+            vo[w] = ( kcat[w] * sub[w] * enz[w] ) / ( Km[w] + sub[w] );
+    }
+
+    const KinSparseMatrix& N = stoich_->getStoichiometryMatrix();
+    for ( unsigned int row = 0; row < numVar_; ++row )
+    {
+        double* d = dydt + row * W;
+        for ( unsigned int w = 0; w < W; ++w )
+            d[w] = 0.0;
+        const int* entry = 0;
+        const unsigned int* colIndex = 0;
+        unsigned int numEntries = N.getRow( row, &entry, &colIndex );
+        for ( unsigned int j = 0; j < numEntries; ++j )
+        {
+            const double e = entry[j];
+            const double* vc = v + colIndex[j] * W;
+            for ( unsigned int w = 0; w < W; ++w )
+                d[w] += e * vc[w];
+        }
+    }
+    for ( unsigned int i = numVar_ * W; i < numPools_ * W; ++i )
+        dydt[i] = 0.0;
+}
+
+void VoxelBatch::stepRK4( double h )
+{
+    const unsigned int n = y_.size();
+    double* y = &y_[0];
+    double* yt = &yTmp_[0];
+    rhs( y, &k1_[0] );
+    for ( unsigned int i = 0; i < n; ++i )
+        yt[i] = y[i] + 0.5 * h * k1_[i];
+    rhs( yt, &k2_[0] );
+    for ( unsigned int i = 0; i < n; ++i )
+        yt[i] = y[i] + 0.5 * h * k2_[i];
+    rhs( yt, &k3_[0] );
+    for ( unsigned int i = 0; i < n; ++i )
+        yt[i] = y[i] + h * k3_[i];
+    rhs( yt, &k4_[0] );
+    for ( unsigned int i = 0; i < n; ++i )
+        y[i] += h * ( k1_[i] + 2.0 * ( k2_[i] + k3_[i] ) + k4_[i] ) / 6.0;
+}
+
+double VoxelBatch::stepCashKarp( double h )
+{
+    // Cash-Karp tableau.
+    static const double b21 = 1.0 / 5.0;
+    static const double b31 = 3.0 / 40.0, b32 = 9.0 / 40.0;
+    static const double b41 = 3.0 / 10.0, b42 = -9.0 / 10.0, b43 = 6.0 / 5.0;
+    static const double b51 = -11.0 / 54.0, b52 = 5.0 / 2.0,
+                 b53 = -70.0 / 27.0, b54 = 35.0 / 27.0;
+    static const double b61 = 1631.0 / 55296.0, b62 = 175.0 / 512.0,
+                 b63 = 575.0 / 13824.0, b64 = 44275.0 / 110592.0,
+                 b65 = 253.0 / 4096.0;
+    static const double c1 = 37.0 / 378.0, c3 = 250.0 / 621.0,
+                 c4 = 125.0 / 594.0, c6 = 512.0 / 1771.0;
+    static const double dc1 = c1 - 2825.0 / 27648.0,
+                 dc3 = c3 - 18575.0 / 48384.0,
+                 dc4 = c4 - 13525.0 / 55296.0,
+                 dc5 = -277.0 / 14336.0, dc6 = c6 - 0.25;
+
+    const unsigned int n = y_.size();
+    const double* y = &y_[0];
+    double* yt = &yTmp_[0];
+    rhs( y, &k1_[0] );
+    for ( unsigned int i = 0; i < n; ++i )
+        yt[i] = y[i] + h * b21 * k1_[i];
+    rhs( yt, &k2_[0] );
+    for ( unsigned int i = 0; i < n; ++i )
+        yt[i] = y[i] + h * ( b31 * k1_[i] + b32 * k2_[i] );
+    rhs( yt, &k3_[0] );
+    for ( unsigned int i = 0; i < n; ++i )
+        yt[i] = y[i] + h * ( b41 * k1_[i] + b42 * k2_[i] + b43 * k3_[i] );
+    rhs( yt, &k4_[0] );
+    for ( unsigned int i = 0; i < n; ++i )
+        yt[i] = y[i] + h * ( b51 * k1_[i] + b52 * k2_[i] + b53 * k3_[i] +
+                b54 * k4_[i] );
+    rhs( yt, &k5_[0] );
+    for ( unsigned int i = 0; i < n; ++i )
+        yt[i] = y[i] + h * ( b61 * k1_[i] + b62 * k2_[i] + b63 * k3_[i] +
+                b64 * k4_[i] + b65 * k5_[i] );
+    rhs( yt, &k6_[0] );
+    for ( unsigned int i = 0; i < n; ++i )
+    {
+        yt[i] = y[i] + h * ( c1 * k1_[i] + c3 * k3_[i] + c4 * k4_[i] +
+                c6 * k6_[i] );
+        yErr_[i] = h * ( dc1 * k1_[i] + dc3 * k3_[i] + dc4 * k4_[i] +
+                dc5 * k5_[i] + dc6 * k6_[i] );
+    }
+
+    // Only the variable pools count; the rest do not change.
+    double err = 0.0;
+    for ( unsigned int i = 0; i < numVar_ * width_; ++i )
+    {
+        double scale = epsAbs_ + epsRel_ * fabs( yt[i] );
+        err = std::max( err, fabs( yErr_[i] ) / scale );
+    }
+    return err;
+}
+
+/**
+ * The step size has collapsed, so the system is too stiff here for an
+ * explicit method. The pools still hold the state at the start of the
+ * tick, so the whole tick is done again for each voxel with its own
+ * TR-BDF2 integrator, and the partial batch step is dropped.
+ */
+void VoxelBatch::advanceStiff( const ProcInfo* p )
+{
+    if ( !warnedStiff_ )
+    {
+        cout << "Warning: VoxelBatch::advance: timestep has gotten too "
+             "small at time " << p->currTime - p->dt << ". Using the "
+             "trbdf2 method for ticks that are this stiff.\n";
+        warnedStiff_ = true;
+    }
+    for ( unsigned int w = 0; w < width_; ++w )
+    {
+        if ( !pools_[w].advanceImplicit( p ) )
+        {
+            cerr << "Error: VoxelBatch::advance: TR-BDF2 integration error "
+                 "at time " << p->currTime - p->dt << "\n";
+            assert( 0 );
+        }
+    }
+}
+
+void VoxelBatch::advance( const ProcInfo* p )
+{
+    const unsigned int W = width_;
+    for ( unsigned int w = 0; isBatched_ && w < W; ++w )
+    {
+        pools_[w].getRateKernel(); // Rebuilds it if rates have changed.
+        if ( pools_[w].getRateKernelVersion() != versions_[w] )
+        {
+            if ( !refreshConstants() )
+            {
+                cout << "Warning: VoxelBatch::advance: voxels no longer "
+                     "share rate terms. Advancing them one at a time.\n";
+                isBatched_ = false;
+            }
+            break;
+        }
+    }
+    if ( !isBatched_ )
+    {
+        for ( unsigned int w = 0; w < W; ++w )
+            pools_[w].advance( p );
+        return;
+    }
+
+    for ( unsigned int w = 0; w < W; ++w )
+    {
+        const double* s = pools_[w].S();
+        for ( unsigned int i = 0; i < numPools_; ++i )
+            y_[ i * W + w ] = s[i];
+    }
+
+    double t = p->currTime - p->dt;
+    const double tEnd = p->currTime;
+    if ( isAdaptive_ )
+    {
+        if ( h_ <= 0.0 )
+            h_ = p->dt / 10.0;
+        while ( t < tEnd )
+        {
+            bool isLast = ( t + h_ >= tEnd );
+            double h = isLast ? tEnd - t : h_;
+            double err = stepCashKarp( h );
+            if ( err <= 1.0 )
+            {
+                y_.swap( yTmp_ );
+                t = isLast ? tEnd : t + h;
+                ++numSteps_;
+                double grow = ( err > 0.0 ) ?
+                    BATCH_SAFETY * pow( err, -0.2 ) : BATCH_MAX_GROWTH;
+                double hNew = h * std::min( grow, BATCH_MAX_GROWTH );
+                // A last step cut short to land on tEnd says little
+                // about the step to use on the next tick.
+                if ( !isLast )
+                    h_ = hNew;
+            }
+            else
+            {
+                h_ = h * std::max( BATCH_SAFETY * pow( err, -0.25 ),
+                        BATCH_MAX_SHRINK );
+                if ( !( h_ > 1e-12 * p->dt ) ) // Also catches NaN.
+                {
+                    h_ = p->dt / 10.0;
+                    advanceStiff( p );
+                    return;
+                }
+            }
+        }
+    }
+    else
+    {
+        unsigned int numSteps = static_cast< unsigned int >(
+                ceil( p->dt / BATCH_FIXED_DT - 1e-9 ) );
+        numSteps = std::max( numSteps, 1U );
+        double h = p->dt / numSteps;
+        for ( unsigned int i = 0; i < numSteps; ++i )
+            stepRK4( h );
+        numSteps_ += numSteps;
+    }
+
+    bool clampNegative = !stoich_->getAllowNegative();
+    unsigned int nv = stoich_->getNumVarPools();
+    for ( unsigned int w = 0; w < W; ++w )
+    {
+        double* s = pools_[w].varS();
+        for ( unsigned int i = 0; i < numVar_; ++i )
+            s[i] = y_[ i * W + w ];
+        if ( clampNegative )
+        {
+            for ( unsigned int i = 0; i < nv; ++i )
+                if ( std::signbit( s[i] ) )
+                    s[i] = 0.0;
+        }
+    }
+}
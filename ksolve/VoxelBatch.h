@@ -0,0 +1,137 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#ifndef _VOXEL_BATCH_H
+#define _VOXEL_BATCH_H
+
+#include "RateKernel.h"
+
+class VoxelPools;
+class Stoich;
+class ProcInfo;
+class CheckpointWriter;
+class CheckpointReader;
+
+/**
+ * Advances a set of neighbouring voxels of a Ksolve in lockstep with a
+ * single explicit Runge-Kutta integrator, for the "batch" and "batchc"
+ * methods.
+ *
+ * All voxels of a Ksolve share the Stoich, so their rate terms have
+ * the same structure and differ only in the volume scaling of the rate
+ * constants. The batch keeps the state as [pool][voxel] and the rate
+ * constants as [term][voxel], so the inner loops of the rate and
+ * stoichiometry calculations run across voxels over contiguous memory
+ * and vectorize.
+ *
+ * "batch" uses the adaptive Cash-Karp 4(5) method, with a single step
+ * size for the whole batch set by the voxel with the largest error.
+ * "batchc" uses classical RK4 with a fixed step.
+ *
+ * Batching needs a reac system without Functions, whose rate terms all
+ * have a flat form in the RateKernel.
+ */
+class VoxelBatch
+{
+public:
+    VoxelBatch();
+
+    /**
+     * Sets up the batch to advance numVoxels voxels starting at pools.
+     * Returns false if these voxels cannot be batched.
+     */
+    bool build( VoxelPools* pools, unsigned int numVoxels,
+            const Stoich* stoich );
+
+    /// Selects adaptive (Cash-Karp) or fixed step (RK4) integration.
+    void setMethod( bool isAdaptive, double epsAbs, double epsRel );
+
+    /// Resets the step size.
+    void reinit( double dt );
+
+    /// Advances all voxels of the batch from currTime - dt to currTime.
+    void advance( const ProcInfo* p );
+
+    /// Number of voxels in the batch.
+    unsigned int size() const;
+
+    /// Number of accepted integration steps since reinit.
+    unsigned long getNumSteps() const;
+
+    /// Saves and restores the step size and count, for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
+private:
+    /// True if both kernels have the same terms and pool indices.
+    static bool sameLayout( const RateKernel& a, const RateKernel& b );
+
+    /// Copies the rate constants of each voxel into the [term][voxel] tables.
+    bool refreshConstants();
+
+    /// Rates of change of y, both as [pool][voxel].
+    void rhs( const double* y, double* dydt );
+
+    void stepRK4( double h );
+
+    /// Takes a trial step into yTmp_ and returns the scaled error norm.
+    double stepCashKarp( double h );
+
+    /// Does the tick for each voxel on its own, with TR-BDF2.
+    void advanceStiff( const ProcInfo* p );
+
+    VoxelPools* pools_;
+    unsigned int width_;
+    const Stoich* stoich_;
+    unsigned int numPools_;
+    unsigned int numVar_;
+
+    /// Pool indices of the rate terms, shared by all voxels.
+    RateKernel layout_;
+
+    /// Version of the rate kernel of each voxel when last copied.
+    vector< unsigned int > versions_;
+
+    /// False if the voxels stopped sharing a layout. Then each voxel
+    /// is advanced on its own.
+    bool isBatched_;
+
+    /// Rate constants as [term][voxel].
+    vector< double > zeroK_;
+    vector< double > firstK_;
+    vector< double > secondK_;
+    vector< double > nK_;
+    vector< double > mmKm_;
+    vector< double > mmKcat_;
+
+    bool isAdaptive_;
+    double epsAbs_;
+    double epsRel_;
+
+    /// Current step size of the adaptive method.
+    double h_;
+    unsigned long numSteps_;
+
+    /// True once the fall back to TR-BDF2 has been reported.
+    bool warnedStiff_;
+
+    /// State and scratch space, all as [pool][voxel].
+    vector< double > y_;
+    vector< double > yTmp_;
+    vector< double > yErr_;
+    vector< double > k1_, k2_, k3_, k4_, k5_, k6_;
+
+    /// Reaction velocities as [reac][voxel].
+    vector< double > v_;
+
+    /// One entry per voxel, for N-th order products.
+    vector< double > prod_;
+};
+
+#endif	// _VOXEL_BATCH_H
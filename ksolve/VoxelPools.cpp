@@ -30,15 +30,21 @@ using namespace boost::numeric;
 #include "KsolveBase.h"
 #include "Ksolve.h"
 #include "Stoich.h"
+#include "KinJacobian.h"
+#include "../basecode/Checkpoint.h"
 
 //////////////////////////////////////////////////////////////
 // Class definitions
 
-VoxelPools::VoxelPools() : pLSODA(nullptr)
+VoxelPools::VoxelPools() : stepMethod_( ODE_LIB_STEP ), pLSODA(nullptr),
+    epsAbs_( 1e-6 ), epsRel_( 1e-6 ), useRateKernel_( true ),
+    kernelVersion_( 0 )
 {
 	lsodaState_ = 1;
 #ifdef USE_GSL
     driver_ = 0;
+#elif USE_BOOST_ODE
+    isFixedStep_ = false;
 #endif
 }
 
@@ -52,6 +58,44 @@ VoxelPools::~VoxelPools()
 #endif
 }
 
+#ifdef USE_BOOST_ODE
+/**
+ * Wraps an odeint stepper that takes steps of fixed size. The stepper
+ * and its stage buffers are held in the closure, so they last as long
+ * as the voxel does rather than being built again on every call.
+ */
+template< class Stepper >
+static std::function< void( VoxelPools*, double, double, double ) >
+    fixedStepper()
+{
+    Stepper stepper;
+    return [stepper]( VoxelPools* vp, double t0, double t1, double dt )
+        mutable
+    {
+        odeint::integrate_const( boost::ref( stepper ),
+                [vp]( const vector_type_& y, vector_type_& dydt, const double t ) {
+                    VoxelPools::evalRates( vp, y, dydt );
+                }, vp->Svec(), t0, t1, dt );
+    };
+}
+
+/// As fixedStepper, for an odeint stepper with step size control.
+template< class Stepper >
+static std::function< void( VoxelPools*, double, double, double ) >
+    controlledStepper( double epsAbs, double epsRel )
+{
+    auto stepper = odeint::make_controlled< Stepper >( epsAbs, epsRel );
+    return [stepper]( VoxelPools* vp, double t0, double t1, double dt )
+        mutable
+    {
+        odeint::integrate_adaptive( boost::ref( stepper ),
+                [vp]( const vector_type_& y, vector_type_& dydt, const double t ) {
+                    VoxelPools::evalRates( vp, y, dydt );
+                }, vp->Svec(), t0, t1, dt );
+    };
+}
+#endif // USE_BOOST_ODE
+
 //////////////////////////////////////////////////////////////
 // Solver ops
 //////////////////////////////////////////////////////////////
@@ -59,6 +103,7 @@ void VoxelPools::reinit( double dt )
 {
     VoxelPoolsBase::reinit();
 	lsodaState_ = 1;
+    resolveMethod();
 #ifdef USE_GSL
     if ( !driver_ )
         return;
@@ -68,11 +113,13 @@ void VoxelPools::reinit( double dt )
 
     // If method is LDODA create lSODA object and save the address of this as
     // param (void*).
-    if( getMethod() == "lsoda" )
+    if( stepMethod_ == LSODA_STEP )
     {
         pLSODA.reset(new LSODA());
         pLSODA->param = (void *) this;
+        lsodaOut_.resize( size() + 1 );
     }
+    trbdf2_.reinit( dt );
 }
 
 void VoxelPools::setStoich( Stoich* s, const OdeSystem* ode )
@@ -83,6 +130,7 @@ void VoxelPools::setStoich( Stoich* s, const OdeSystem* ode )
         epsAbs_ = ode->epsAbs;
         epsRel_ = ode->epsRel;
         method_ = ode->method;
+        resolveMethod();
     }
 
 #ifdef USE_GSL
@@ -99,69 +147,150 @@ void VoxelPools::setStoich( Stoich* s, const OdeSystem* ode )
     VoxelPoolsBase::reinit();
 }
 
+void VoxelPools::resolveMethod()
+{
+    if ( method_ == "lsoda" )
+        stepMethod_ = LSODA_STEP;
+    else if ( method_ == "trbdf2" )
+        stepMethod_ = TRBDF2_STEP;
+    else
+        stepMethod_ = ODE_LIB_STEP;
+
+#ifdef USE_BOOST_ODE
+    /*-----------------------------------------------------------------------------
+     * To make numerical results comparable with "gsl" solvers,
+     * by default, we pick adaptive step-size control. Use a suffix 'c' to
+     * force a constant step size. The numerical accuracy of constant step
+     * size solver is low.
+     * More details can be found here:
+     * https://www.boost.org/doc/libs/1_72_0/libs/numeric/odeint/doc/html/boost_numeric_odeint/odeint_in_detail/steppers.html
+     */
+    isFixedStep_ = true;
+    if ( method_ == "rk2" )
+        odeintStep_ = fixedStepper< rk_midpoint_stepper_type_ >();
+    else if ( method_ == "rk4c" )
+        odeintStep_ = fixedStepper< rk4_stepper_type_ >();
+    else if ( method_ == "rk5c" || method_ == "rk54c" )
+        odeintStep_ = fixedStepper< rk_karp_stepper_type_ >();
+    else if ( method_ == "rk8c" )
+        odeintStep_ = fixedStepper< rk_felhberg_stepper_type_ >();
+    else
+    {
+        isFixedStep_ = false;
+        if ( method_ == "rk5" || method_ == "gsl" )
+            odeintStep_ = controlledStepper< rk_dopri_stepper_type_ >(
+                    epsAbs_, epsRel_ );
+        else if ( method_ == "rk8" )
+            odeintStep_ = controlledStepper< rk_felhberg_stepper_type_ >(
+                    epsAbs_, epsRel_ );
+        else // rk5ck, rk54 and anything else.
+            odeintStep_ = controlledStepper< rk_karp_stepper_type_ >(
+                    epsAbs_, epsRel_ );
+    }
+#endif // USE_BOOST_ODE
+}
+
+const Stoich* VoxelPools::getStoich( )
+{
+    return stoichPtr_;
+}
+
 const string VoxelPools::getMethod( )
 {
-    Ksolve* k = reinterpret_cast<Ksolve*>( stoichPtr_->getKsolve().eref().data() );
-    return k->getMethod( );
+    return method_;
 }
 
 void VoxelPools::advance( const ProcInfo* p )
 {
-    double t = p->currTime - p->dt;
-    Ksolve* k = reinterpret_cast<Ksolve*>( stoichPtr_->getKsolve().eref().data() );
-
-    if( getMethod() == "lsoda" )
+    switch ( stepMethod_ )
     {
-		// True if first step or restart, or if diffusion. Tells LSODA to 
-		// recalculate using new pool n values, which slows it down a bit. 
-		if ( p->isStart() || (numVoxels_ > 1) ) 
-			lsodaState_ = 1;
-    	size_t totVar = stoichPtr_->getNumVarPools() + stoichPtr_->getNumProxyPools();
-        vector<double> yout(size()+1);
-        pLSODA->lsoda_update( &VoxelPools::lsodaSys, size()
-                , Svec(), yout , &t
-                , p->currTime, &lsodaState_, this
-                );
+    case LSODA_STEP:
+        advanceLsoda( p );
+        break;
+    case TRBDF2_STEP:
+        if ( !trbdf2_.advance( this, p->currTime - p->dt, p->currTime ) )
+        {
+            cerr << "Error: VoxelPools::advance: TR-BDF2 integration error "
+                 "at time " << p->currTime - p->dt << "\n";
+            assert( 0 );
+        }
+        break;
+    default:
+        advanceOdeLib( p );
+    }
+    clearNegatives();
+}
 
-        // Now update the y from yout. This is different thant normal GSL or
-        // BOOST based approach.
-		// totVar += stoichPtr_->getNumFuncPools();
-        for (size_t i = 0; i < totVar; i++)
-            varS()[i] = yout[i+1];
+bool VoxelPools::advanceImplicit( const ProcInfo* p )
+{
+    if ( !trbdf2_.advance( this, p->currTime - p->dt, p->currTime ) )
+        return false;
+    clearNegatives();
+    return true;
+}
 
-        if( lsodaState_ == 0 )
+void VoxelPools::clearNegatives()
+{
+    if ( !stoichPtr_->getAllowNegative() )   // clean out negatives
+    {
+        unsigned int nv = stoichPtr_->getNumVarPools();
+        double* vs = varS();
+        for ( unsigned int i = 0; i < nv; ++i )
         {
-            cerr << "Error: VoxelPools::advance: LSODA integration error at time "
-                 << t << "\n";
-            assert(0);
+            if ( std::signbit(vs[i]) )
+                vs[i] = 0.0;
         }
     }
-    else
+}
+
+void VoxelPools::advanceLsoda( const ProcInfo* p )
+{
+    double t = p->currTime - p->dt;
+    // True if first step or restart, or if diffusion. Tells LSODA to
+    // recalculate using new pool n values, which slows it down a bit.
+    if ( p->isStart() || (numVoxels_ > 1) )
+        lsodaState_ = 1;
+    size_t totVar = stoichPtr_->getNumVarPools() + stoichPtr_->getNumProxyPools();
+    pLSODA->lsoda_update( &VoxelPools::lsodaSys, size()
+            , Svec(), lsodaOut_, &t
+            , p->currTime, &lsodaState_, this
+            );
+
+    // Now update the y from yout. This is different thant normal GSL or
+    // BOOST based approach.
+    for (size_t i = 0; i < totVar; i++)
+        varS()[i] = lsodaOut_[i+1];
+
+    if( lsodaState_ == 0 )
     {
+        cerr << "Error: VoxelPools::advance: LSODA integration error at time "
+             << t << "\n";
+        assert(0);
+    }
+}
 
+void VoxelPools::advanceOdeLib( const ProcInfo* p )
+{
 #ifdef USE_GSL
-        int status = gsl_odeiv2_driver_apply( driver_, &t, p->currTime, varS());
-        if ( status != GSL_SUCCESS )
-        {
-            cerr << "Error: VoxelPools::advance: GSL integration error at time "
-                << t << "\n";
-            cerr << "Error info: " << status << ", " <<
-                gsl_strerror( status ) << endl;
-            if ( status == GSL_EMAXITER )
-                cerr << "Max number of steps exceeded\n";
-            else if ( status == GSL_ENOPROG )
-                cerr << "Timestep has gotten too small\n";
-            else if ( status == GSL_EBADFUNC )
-                cerr << "Internal error\n";
-            assert( 0 );
-        }
+    double t = p->currTime - p->dt;
+    int status = gsl_odeiv2_driver_apply( driver_, &t, p->currTime, varS());
+    if ( status != GSL_SUCCESS )
+    {
+        cerr << "Error: VoxelPools::advance: GSL integration error at time "
+            << t << "\n";
+        cerr << "Error info: " << status << ", " <<
+            gsl_strerror( status ) << endl;
+        if ( status == GSL_EMAXITER )
+            cerr << "Max number of steps exceeded\n";
+        else if ( status == GSL_ENOPROG )
+            cerr << "Timestep has gotten too small\n";
+        else if ( status == GSL_EBADFUNC )
+            cerr << "Internal error\n";
+        assert( 0 );
+    }
 
 #elif USE_BOOST_ODE
-        // NOTE: Make sure to assing vp to BoostSys vp. In next call, it will be used by
-        // updateRates func. Unlike gsl call, we can't pass extra void*  to gslFunc.
-        VoxelPools* vp = reinterpret_cast< VoxelPools* >( this );
-
-        /*-----------------------------------------------------------------------------
+    /*-----------------------------------------------------------------------------
 NOTE: 04/21/2016 11:31:42 AM
 
 We need to call updateFuncs  here (unlike in GSL solver) because there
@@ -169,145 +298,13 @@ is no way we can update const vector_type_& y in evalRatesUsingBoost
 function. In gsl implmentation one could do it, because const_cast can
 take away the constantness of double*. This probably makes the call bit
 cleaner.
-         *-----------------------------------------------------------------------------*/
-        stoichPtr_->updateFuncs( &Svec()[0], p->currTime );
-
-        /*-----------------------------------------------------------------------------
-         * Using integrate function works with with default stepper type.
-         *
-         *  NOTICE to developer:
-         *  If you are planning your own custom typdedef of stepper_type_ (see
-         *  file BoostSystem.h), the you may run into troble. Have a look at this
-         *  http://boostw.boost.org/doc/libs/1_56_0/boost/numeric/odeint/integrate/integrate.hpp
-         * 
-         * To make numerical results comparable with "gsl" solvers,
-         * by default, we pick adaptive step-size control. Use a suffix 'c' to
-         * force a constant step size. The numerical accuracy of constant step
-         * size solver is low.
-         * More details can be found here:
-         * https://www.boost.org/doc/libs/1_72_0/libs/numeric/odeint/doc/html/boost_numeric_odeint/odeint_in_detail/steppers.html
-         */
-
-        const double fixedDt = 0.1;
-
-        if( method_ == "rk2" )
-            odeint::integrate_const( rk_midpoint_stepper_type_()
-                    , [this](const vector_type_& dy, vector_type_& dydt, const double t) {
-                    VoxelPools::evalRates(this, dy, dydt ); 
-                    }
-                    , Svec()
-                    , p->currTime - p->dt, p->currTime, std::min( p->dt, fixedDt )
-                    );
-        else if( method_ == "rk4c" )
-            odeint::integrate_const( rk4_stepper_type_()
-                    , [this](const vector_type_& dy, vector_type_& dydt, const double t) { 
-                    VoxelPools::evalRates(this, dy, dydt );
-                    }
-                    , Svec()
-                    , p->currTime - p->dt, p->currTime, std::min( p->dt, fixedDt )
-                    );
-        else if( method_ == "rk5c")
-            odeint::integrate_const( rk_karp_stepper_type_()
-                    , [this](const vector_type_& dy, vector_type_& dydt, const double t) { 
-                    VoxelPools::evalRates(this, dy, dydt );
-                    }
-                    , Svec()
-                    , p->currTime - p->dt, p->currTime, std::min( p->dt, fixedDt )
-                    );
-        else if( method_ == "rk5ck" )
-            odeint::integrate_adaptive(
-                    odeint::make_controlled<rk_karp_stepper_type_>( epsAbs_, epsRel_ )
-                    , [this](const vector_type_& dy, vector_type_& dydt, const double t) { 
-                    VoxelPools::evalRates(this, dy, dydt );
-                    }
-                    , Svec()
-                    , p->currTime - p->dt
-                    , p->currTime
-                    , p->dt
-                    );
-        else if ("rk54c" == method_ )
-            odeint::integrate_const( rk_karp_stepper_type_()
-                    , [this](const vector_type_& dy, vector_type_& dydt, const double t) { 
-                    VoxelPools::evalRates(this, dy, dydt );
-                    }
-                    , Svec()
-                    , p->currTime - p->dt, p->currTime, std::min( p->dt, fixedDt )
-                    );
-        else if ("rk54" == method_ )
-            odeint::integrate_adaptive(
-                    odeint::make_controlled<rk_karp_stepper_type_>( epsAbs_, epsRel_ )
-                    , [this](const vector_type_& dy, vector_type_& dydt, const double t) { 
-                    VoxelPools::evalRates(this, dy, dydt );
-                    }
-                    , Svec()
-                    , p->currTime - p->dt
-                    , p->currTime
-                    , p->dt
-                    );
-        else if ("rk5c" == method_ )
-            odeint::integrate_const( rk_dopri_stepper_type_()
-                    , [this](const vector_type_& dy, vector_type_& dydt, const double t) { 
-                    VoxelPools::evalRates(this, dy, dydt );
-                    }
-                    , Svec()
-                    , p->currTime - p->dt
-                    , p->currTime
-                    , std::min( p->dt, fixedDt )
-                    );
-        else if ("rk5" == method_  || "gsl" == method_)
-            odeint::integrate_adaptive(
-                    odeint::make_controlled<rk_dopri_stepper_type_>( epsAbs_, epsRel_ )
-                    , [this](const vector_type_& dy, vector_type_& dydt, const double t) { 
-                    VoxelPools::evalRates(this, dy, dydt );
-                    }
-                    , Svec()
-                    , p->currTime - p->dt
-                    , p->currTime
-                    , p->dt
-                    );
-        else if( method_ == "rk8c" )
-            odeint::integrate_const( rk_felhberg_stepper_type_()
-                    , [this](const vector_type_& dy, vector_type_& dydt, const double t) { 
-                    VoxelPools::evalRates(this, dy, dydt );
-                    }
-                    , Svec()
-                    , p->currTime - p->dt, p->currTime, std::min( p->dt, fixedDt )
-                    );
-        else if( method_ == "rk8" )
-            odeint::integrate_adaptive(
-                    odeint::make_controlled<rk_felhberg_stepper_type_>( epsAbs_, epsRel_ )
-                    , [this](const vector_type_& dy, vector_type_& dydt, const double t) { 
-                    VoxelPools::evalRates(this, dy, dydt );
-                    }
-                    , Svec()
-                    , p->currTime - p->dt
-                    , p->currTime
-                    , p->dt
-                    );
-        else
-            odeint::integrate_adaptive(
-                    odeint::make_controlled<rk_karp_stepper_type_>( epsAbs_, epsRel_ )
-                    , [this](const vector_type_& dy, vector_type_& dydt, const double t) { 
-                    VoxelPools::evalRates(this, dy, dydt );
-                    }
-                    , Svec()
-                    , p->currTime - p->dt
-                    , p->currTime
-                    , p->dt
-                    );
-#endif   // USE_GSL
-    }
+     *-----------------------------------------------------------------------------*/
+    stoichPtr_->updateFuncs( &Svec()[0], p->currTime );
 
-    if ( !stoichPtr_->getAllowNegative() )   // clean out negatives
-    {
-        unsigned int nv = stoichPtr_->getNumVarPools();
-        double* vs = varS();
-        for ( unsigned int i = 0; i < nv; ++i )
-        {
-            if ( std::signbit(vs[i]) )
-                vs[i] = 0.0;
-        }
-    }
+    const double fixedDt = 0.1;
+    odeintStep_( this, p->currTime - p->dt, p->currTime,
+            isFixedStep_ ? std::min( p->dt, fixedDt ) : p->dt );
+#endif   // USE_GSL
 }
 
 void VoxelPools::setInitDt( double dt )
@@ -387,6 +384,7 @@ void VoxelPools::updateAllRateTerms( const vector< RateTerm* >& rates,
                 getXreacScaleProducts(i-numCoreRates) 
                 );
     }
+    ratesChanged_ = true;
 }
 
 void VoxelPools::updateRateTerms( const vector< RateTerm* >& rates,
@@ -406,13 +404,12 @@ void VoxelPools::updateRateTerms( const vector< RateTerm* >& rates,
     }
     else
         rates_[index] = rates[index]->copyWithVolScaling(getVolume(), 1.0, 1.0);
+    ratesChanged_ = true;
 }
 
 void VoxelPools::updateRates( const double* s, double* yprime ) const
 {
     const KinSparseMatrix& N = stoichPtr_->getStoichiometryMatrix();
-    vector< double > v( N.nColumns(), 0.0 );
-    vector< double >::iterator j = v.begin();
     // totVar should include proxyPools only if this voxel uses them
     unsigned int totVar = stoichPtr_->getNumVarPools() + stoichPtr_->getNumProxyPools();
     // totVar should include proxyPools if this voxel does not use them
@@ -420,11 +417,25 @@ void VoxelPools::updateRates( const double* s, double* yprime ) const
     assert( N.nColumns() == 0 || N.nRows() == stoichPtr_->getNumAllPools() );
     assert( N.nColumns() == rates_.size() );
 
-    for ( auto i = rates_.cbegin(); i != rates_.end(); i++)
-        *j++ = (**i)( s );
+    v_.resize( rates_.size() );
+    if ( useRateKernel_ )
+    {
+        getRateKernel().compute( s, v_.data() );
+    }
+    else
+    {
+        for ( unsigned int i = 0; i < rates_.size(); ++i )
+            v_[i] = (*rates_[i])( s );
+    }
+
     for (unsigned int i = 0; i < totVar; ++i)
     {
-        auto rate = N.computeRowRate( i, v );
+        const int* entry = 0;
+        const unsigned int* colIndex = 0;
+        unsigned int numEntries = N.getRow( i, &entry, &colIndex );
+        double rate = 0.0;
+        for ( unsigned int j = 0; j < numEntries; ++j )
+            rate += entry[j] * v_[ colIndex[j] ];
         assert(! std::isnan(rate));
         *yprime++ = rate;
     }
@@ -432,6 +443,43 @@ void VoxelPools::updateRates( const double* s, double* yprime ) const
         *yprime++ = 0.0;
 }
 
+void VoxelPools::setUseRateKernel( bool val )
+{
+    useRateKernel_ = val;
+}
+
+bool VoxelPools::getUseRateKernel() const
+{
+    return useRateKernel_;
+}
+
+const RateKernel& VoxelPools::getRateKernel() const
+{
+    if ( ratesChanged_ || kernel_.size() != rates_.size() )
+    {
+        kernel_.build( rates_ );
+        ratesChanged_ = false;
+        ++kernelVersion_;
+    }
+    return kernel_;
+}
+
+unsigned int VoxelPools::getRateKernelVersion() const
+{
+    return kernelVersion_;
+}
+
+void VoxelPools::setJacobian( const KinJacobian* jac, double epsAbs,
+        double epsRel )
+{
+    trbdf2_.setup( jac, size(), epsAbs, epsRel );
+}
+
+const TrBdf2& VoxelPools::getTrBdf2() const
+{
+    return trbdf2_;
+}
+
 /**
  * updateReacVelocities computes the velocity *v* of each reaction.
  * This is a utility function for programs like SteadyState that need
@@ -455,6 +503,30 @@ void VoxelPools::updateReacVelocities(const double* s, vector< double >& v) cons
     }
 }
 
+void VoxelPools::saveState( CheckpointWriter& w ) const
+{
+    VoxelPoolsBase::saveState( w );
+#ifdef USE_GSL
+    // The driver keeps its last step size from one advance to the next.
+    w.put< double >( driver_ ? driver_->h : 0.0 );
+#endif
+    getRateKernel(); // Rebuilds it, and the version, if rates have changed.
+    trbdf2_.saveState( w, kernelVersion_ );
+}
+
+bool VoxelPools::loadState( CheckpointReader& r )
+{
+    if ( !VoxelPoolsBase::loadState( r ) )
+        return false;
+#ifdef USE_GSL
+    double h = r.get< double >();
+    if ( driver_ && h > 0.0 )
+        driver_->h = h;
+#endif
+    getRateKernel();
+    return trbdf2_.loadState( r, kernelVersion_ );
+}
+
 /// For debugging: Print contents of voxel pool
 void VoxelPools::print() const
 {
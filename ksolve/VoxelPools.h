@@ -12,9 +12,12 @@
 
 #include "OdeSystem.h"
 #include "VoxelPoolsBase.h"
+#include "RateKernel.h"
+#include "TrBdf2.h"
 #include "../external/libsoda/LSODA.h"
 
 #ifdef USE_BOOST_ODE
+#include <functional>
 #include "BoostSys.h"
 #endif
 
@@ -45,11 +48,19 @@ public:
 
     const Stoich* getStoich( );
 
+    /// Integration method that this voxel was set up with.
     const string getMethod( );
 
     /// Do the numerical integration. Advance the simulation.
     void advance( const ProcInfo* p );
 
+    /**
+     * Advances with the TR-BDF2 integrator, whatever the method. The
+     * batch method falls back on this for a tick that is too stiff for
+     * it. Needs setJacobian. Returns false if this fails too.
+     */
+    bool advanceImplicit( const ProcInfo* p );
+
     /// Set initial timestep to use by the solver.
     void setInitDt( double dt );
 
@@ -94,24 +105,97 @@ public:
      */
     void updateReacVelocities( const double* s, vector< double >& v ) const;
 
+    /**
+     * Flag: use the flattened rate kernel in updateRates, rather than
+     * calling each RateTerm through its virtual operator(). On by
+     * default. Both give the same answer.
+     */
+    void setUseRateKernel( bool val );
+    bool getUseRateKernel() const;
+
+    /// Returns the flattened rate terms, rebuilt if rates_ has changed.
+    const RateKernel& getRateKernel() const;
+
+    /// Incremented every time the rate kernel is rebuilt.
+    unsigned int getRateKernelVersion() const;
+
+    /**
+     * Sets up the implicit integrator of the "trbdf2" method, using
+     * the Jacobian structure of the reaction system. The Ksolve owns
+     * jac, which is shared by all its voxels.
+     */
+    void setJacobian( const KinJacobian* jac, double epsAbs, double epsRel );
+
+    /// The implicit integrator, for its step and factorization counts.
+    const TrBdf2& getTrBdf2() const;
+
     /// Used for debugging.
     void print() const;
 
+    /**
+     * Saves and restores the pools and the integrator state that carries
+     * over from one step to the next, for checkpoints. LSODA is started
+     * afresh on every call to start, so it has none.
+     */
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
 private:
+    /**
+     * Works out the integrator for method_. This is done at setStoich
+     * and reinit, so that advance does not look at the method name, and
+     * the steppers and their buffers persist from one step to the next.
+     */
+    void resolveMethod();
+
+    void advanceLsoda( const ProcInfo* p );
+    /// Sets negative variable pools to zero, unless the Stoich allows them.
+    void clearNegatives();
+    void advanceOdeLib( const ProcInfo* p );
+
+    /// Integrators that advance can dispatch to.
+    enum StepMethod {
+        ODE_LIB_STEP,   // GSL driver, or the odeint stepper if using boost
+        LSODA_STEP,
+        TRBDF2_STEP
+    };
+    StepMethod stepMethod_;
 
     std::shared_ptr<LSODA> pLSODA;
     LSODA_ODE_SYSTEM_TYPE lsodaSystem;
     int lsodaState_;
 
+    /// Scratch for the solution from LSODA, which counts from 1.
+    vector< double > lsodaOut_;
+
 #ifdef USE_GSL
     gsl_odeiv2_driver* driver_;
     gsl_odeiv2_system sys_;
+#elif USE_BOOST_ODE
+    /**
+     * Advances the voxel from t0 to t1, with steps of dt or starting
+     * with dt. It holds its own odeint stepper.
+     */
+    std::function< void( VoxelPools*, double, double, double ) > odeintStep_;
+    bool isFixedStep_;
 #endif
 
     double epsAbs_;
     double epsRel_;
     string method_;
 
+    bool useRateKernel_;
+
+    /// Flattened rates_, rebuilt on first use after rates_ changes.
+    mutable RateKernel kernel_;
+    mutable unsigned int kernelVersion_;
+
+    /// Scratch vector of reaction velocities used by updateRates.
+    mutable vector< double > v_;
+
+    /// Integrator for the "trbdf2" method.
+    TrBdf2 trbdf2_;
+
 };
 
 #endif	// _VOXEL_POOLS_H
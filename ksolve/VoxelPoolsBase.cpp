@@ -16,6 +16,7 @@
 #include "../basecode/SparseMatrix.h"
 #include "KinSparseMatrix.h"
 #include "Stoich.h"
+#include "../basecode/Checkpoint.h"
 
 //////////////////////////////////////////////////////////////
 // Class definitions
@@ -23,6 +24,7 @@
 
 VoxelPoolsBase::VoxelPoolsBase() :
     stoichPtr_( 0 ),
+    ratesChanged_( true ),
     S_(1),
     Cinit_(1),
     volume_(1.0)
@@ -137,6 +139,7 @@ void VoxelPoolsBase::scaleVolsBufsRates(double ratio, const Stoich* stoichPtr)
                     getXreacScaleSubstrates(i - numCoreRates),
                     getXreacScaleProducts(i - numCoreRates ) );
     }
+    ratesChanged_ = true;
 }
 
 void VoxelPoolsBase::setNumVoxels( unsigned int n )
@@ -335,6 +338,7 @@ void VoxelPoolsBase::filterCrossRateTerms(
         {
             Id reacId = offSolverReacs[i];
             const Cinfo* reacCinfo = reacId.element()->cinfo();
+            ratesChanged_ = true;
             unsigned int k = stoichPtr_->convertIdToReacIndex( offSolverReacs[i] );
             // Start by replacing the immediate cross reaction term.
             if ( rates_[k] )
@@ -377,6 +381,18 @@ void VoxelPoolsBase::filterCrossRateTerms(
     }
 }
 
+////////////////////////////////////////////////////////////////////////
+void VoxelPoolsBase::saveState( CheckpointWriter& w ) const
+{
+    w.putVec( S_ );
+    w.putVec( Cinit_ );
+}
+
+bool VoxelPoolsBase::loadState( CheckpointReader& r )
+{
+    return r.getVecInPlace( S_ ) && r.getVecInPlace( Cinit_ );
+}
+
 ////////////////////////////////////////////////////////////////////////
 void VoxelPoolsBase::print() const
 {
@@ -18,6 +18,8 @@ using namespace std;
 class RateTerm;
 class Stoich;
 class Id;
+class CheckpointWriter;
+class CheckpointReader;
 
 /**
  * This is the base class for voxels used in reac-diffusion systems.
@@ -210,9 +212,19 @@ public:
     /// Debugging utility
     void print() const;
 
+    /// Saves and restores S_ and Cinit_, for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
 protected:
     const Stoich* stoichPtr_;
     vector< RateTerm* > rates_;
+
+    /**
+     * Set whenever rates_ is replaced or rescaled, so that derived
+     * classes know to rebuild anything they have compiled from it.
+     */
+    mutable bool ratesChanged_;
 	/**
 	 * Number of voxels. If > 1, set flag for LSODA to handle molecule
 	 * flux on each timestep during diffusion, which slows it down.
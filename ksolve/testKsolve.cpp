@@ -13,6 +13,10 @@
 #include "FuncTerm.h"
 #include "../basecode/SparseMatrix.h"
 #include "KinSparseMatrix.h"
+#include "PropensityTree.h"
+#include "IndexedPriorityQueue.h"
+#include "RateKernel.h"
+#include "SparseLU.h"
 #include "VoxelPoolsBase.h"
 #include "../mesh/VoxelJunction.h"
 #include "../builtins/MooseParser.h"
@@ -23,6 +27,7 @@
 
 #include "../builtins/MooseParser.h"
 #include "../utility/testing_macros.hpp"
+#include "../utility/ThreadPool.h"
 
 /**
  * Tab controlled by table
@@ -265,6 +270,113 @@ void testRunKsolve()
     cout << "." << flush;
 }
 
+/**
+ * A SolverRecorder reading the Ksolve state must record the same as the
+ * Tables that ask each pool for its conc.
+ */
+void testSolverRecorder()
+{
+    double simDt = 0.1;
+    Shell* s = reinterpret_cast< Shell* >( Id().eref().data() );
+    Id kin = makeReacTest();
+    Id ksolve = s->doCreate( "Ksolve", kin, "ksolve", 1 );
+    Id stoich = s->doCreate( "Stoich", ksolve, "stoich", 1 );
+    Field< Id >::set( stoich, "compartment", kin );
+    Field< Id >::set( stoich, "ksolve", ksolve );
+    Field< string >::set( stoich, "path", "/kinetics/##" );
+    s->doUseClock( "/kinetics/ksolve", "process", 4 );
+    s->doSetClock( 4, simDt );
+
+    const char* names[] = { "T", "A", "B", "C", "D", "E", "tot1" };
+    vector< ObjId > targets;
+    for ( unsigned int i = 0; i < 7; ++i )
+        targets.push_back( ObjId( string( "/kinetics/" ) + names[i] ) );
+    Id rec = s->doCreate( "SolverRecorder", kin, "rec", 1 );
+    Field< Id >::set( rec, "solver", ksolve );
+    Field< vector< ObjId > >::set( rec, "targets", targets );
+    s->doUseClock( "/kinetics/rec", "process", 18 );
+
+    s->doReinit();
+    s->doStart( 20.0 );
+    Id plots( "/kinetics/plots" );
+    unsigned int numSteps = Field< unsigned int >::get( rec, "numSteps" );
+    assert( numSteps > 100 );
+    for ( unsigned int i = 0; i < 7; ++i )
+    {
+        vector< double > tab = Field< vector< double > >::get(
+                ObjId( plots, i ), "vector" );
+        vector< double > vec = LookupField< unsigned int, vector< double > >::get( rec, "vec", i );
+        assert( vec.size() == numSteps );
+        assert( tab.size() == vec.size() );
+        for ( unsigned int j = 0; j < vec.size(); ++j )
+            ASSERT_DOUBLE_EQ( tab[j], vec[j], "testSolverRecorder" );
+    }
+    s->doDelete( kin );
+    cout << "." << flush;
+}
+
+/**
+ * Runs the reac test with the given solver, saving a checkpoint halfway.
+ * After a reinit and a load of the checkpoint, the second half must come
+ * out exactly as it did the first time.
+ */
+static void checkpointRun( const string& solverClass )
+{
+    double simDt = 0.1;
+    const char* fname = "testCheckpoint.ckp";
+    Shell* s = reinterpret_cast< Shell* >( Id().eref().data() );
+    Id kin = makeReacTest();
+    if ( solverClass == "Gsolve" )
+        Field< double >::set( kin, "volume", 1e-21 );
+    Id solver = s->doCreate( solverClass, kin, "solver", 1 );
+    Id stoich = s->doCreate( "Stoich", solver, "stoich", 1 );
+    Field< Id >::set( stoich, "compartment", kin );
+    Field< Id >::set( stoich, "ksolve", solver );
+    Field< string >::set( stoich, "path", "/kinetics/##" );
+    s->doUseClock( "/kinetics/solver", "process", 4 );
+    s->doSetClock( 4, simDt );
+
+    const char* names[] = { "T", "A", "B", "C", "D", "E", "tot1" };
+    Id plots( "/kinetics/plots" );
+    s->doReinit();
+    s->doStart( 10.0 );
+    bool ok = s->doSaveCheckpoint( fname );
+    assert( ok );
+    s->doStart( 10.0 );
+    vector< double > n;
+    vector< vector< double > > tabs;
+    for ( unsigned int i = 0; i < 7; ++i ) {
+        n.push_back( Field< double >::get(
+                    ObjId( string( "/kinetics/" ) + names[i] ), "n" ) );
+        tabs.push_back( Field< vector< double > >::get(
+                    ObjId( plots, i ), "vector" ) );
+    }
+
+    s->doReinit();
+    ok = s->doLoadCheckpoint( fname );
+    assert( ok );
+    double t = Field< double >::get( Id( 1 ), "currentTime" );
+    ASSERT_DOUBLE_EQ( t, 10.0, "testCheckpoint" );
+    s->doStart( 10.0 );
+    for ( unsigned int i = 0; i < 7; ++i ) {
+        double x = Field< double >::get(
+                ObjId( string( "/kinetics/" ) + names[i] ), "n" );
+        assert( x == n[i] );
+        vector< double > tab = Field< vector< double > >::get(
+                ObjId( plots, i ), "vector" );
+        assert( tab == tabs[i] );
+    }
+    remove( fname );
+    s->doDelete( kin );
+}
+
+void testCheckpoint()
+{
+    checkpointRun( "Ksolve" );
+    checkpointRun( "Gsolve" );
+    cout << "." << flush;
+}
+
 void testRunKsolveWithLSODA()
 {
     double simDt = 0.1;
@@ -367,13 +479,343 @@ void testFuncTerm()
     cout << "." << flush;
 }
 
+/**
+ * Checks that the propensity tree picks the same reaction as a linear
+ * scan over the cumulative propensities, before and after updates.
+ */
+void testPropensityTree()
+{
+    vector< double > v = { 1.0, 0.0, -2.0, 0.5, 3.0, 0.0, 0.25 };
+    PropensityTree tree;
+    tree.build( v );
+    ASSERT_EQ( tree.size(), v.size(), "testPropensityTree" );
+    ASSERT_DOUBLE_EQ( tree.total(), 6.75, "testPropensityTree" );
+
+    for ( unsigned int k = 0; k < 2; ++k )
+    {
+        double tot = 0.0;
+        for ( unsigned int i = 0; i < v.size(); ++i )
+            tot += fabs( v[i] );
+        for ( double r = 0.0; r < tot; r += tot / 97.0 )
+        {
+            double sum = 0.0;
+            unsigned int expected = v.size();
+            for ( unsigned int i = 0; i < v.size(); ++i )
+            {
+                if ( r < ( sum += fabs( v[i] ) ) )
+                {
+                    expected = i;
+                    break;
+                }
+            }
+            ASSERT_EQ( tree.find( r ), expected, "testPropensityTree" );
+        }
+        // Reactions with zero propensity must never be picked.
+        v[2] = 0.0;
+        v[5] = 4.0;
+        tree.update( 2, 0.0 );
+        tree.update( 5, 4.0 );
+        ASSERT_DOUBLE_EQ( tree.total(), 8.75, "testPropensityTree" );
+    }
+    ASSERT_EQ( tree.find( 100.0 ), v.size(), "testPropensityTree" );
+    cout << "." << flush;
+}
+
+/**
+ * Checks that the indexed priority queue always has the earliest
+ * reaction on top as the times of individual reactions change.
+ */
+void testIndexedPriorityQueue()
+{
+    vector< double > t = { 5.0, 3.0, 8.0, 1.0, 9.0, 4.0 };
+    IndexedPriorityQueue q;
+    q.build( t );
+    ASSERT_EQ( q.size(), t.size(), "testIndexedPriorityQueue" );
+    ASSERT_EQ( q.top(), 3u, "testIndexedPriorityQueue" );
+    ASSERT_DOUBLE_EQ( q.topTime(), 1.0, "testIndexedPriorityQueue" );
+
+    q.update( 4, 0.5 );
+    ASSERT_EQ( q.top(), 4u, "testIndexedPriorityQueue" );
+    q.update( 4, 10.0 );
+    q.update( 3, 7.0 );
+    ASSERT_EQ( q.top(), 1u, "testIndexedPriorityQueue" );
+    q.update( 1, numeric_limits< double >::infinity() );
+    ASSERT_EQ( q.top(), 5u, "testIndexedPriorityQueue" );
+    ASSERT_DOUBLE_EQ( q.time( 3 ), 7.0, "testIndexedPriorityQueue" );
+
+    // Pop everything in order by pushing each top out to infinity.
+    double prev = 0.0;
+    for ( unsigned int i = 0; i < t.size() - 1; ++i )
+    {
+        double tt = q.topTime();
+        ASSERT_TRUE( tt >= prev, "testIndexedPriorityQueue" );
+        prev = tt;
+        q.update( q.top(), numeric_limits< double >::infinity() );
+    }
+    cout << "." << flush;
+}
+
+void testRateKernel()
+{
+    vector< RateTerm* > rates;
+    rates.push_back( new ZeroOrder( 0.5 ) );
+    rates.push_back( new FirstOrder( 2.0, 1 ) );
+    rates.push_back( new SecondOrder( 3.0, 0, 2 ) );
+    rates.push_back( new NOrder( 0.1, { 0, 1, 2, 2 } ) );
+    rates.push_back( new BidirectionalReaction(
+                new FirstOrder( 1.5, 0 ), new SecondOrder( 0.25, 1, 2 ) ) );
+    rates.push_back( new BidirectionalReaction(
+                new NOrder( 0.3, { 1, 1, 2 } ), new ZeroOrder( 0.7 ) ) );
+    rates.push_back( new MMEnzyme1( 4.0, 6.0, 3, 1 ) );
+    rates.push_back( new ExternReac() );
+    rates.push_back( new StochSecondOrderSingleSubstrate( 0.2, 2 ) );
+
+    RateKernel kernel;
+    kernel.build( rates );
+    ASSERT_EQ( kernel.size(), rates.size(), "testRateKernel" );
+    ASSERT_EQ( kernel.numGeneric(), 1u, "testRateKernel" );
+
+    double S[] = { 1.25, 3.0, 7.5, 0.8 };
+    vector< double > v( rates.size(), -1.0 );
+    kernel.compute( S, &v[0] );
+    for ( unsigned int i = 0; i < rates.size(); ++i )
+        ASSERT_EQ( v[i], ( *rates[i] )( S ), "testRateKernel" );
+
+    // Derivatives with respect to every pool, against central differences.
+    const unsigned int numPools = 4;
+    vector< unsigned int > start( 1, 0 );
+    vector< unsigned int > col;
+    for ( unsigned int r = 0; r < rates.size(); ++r )
+    {
+        for ( unsigned int m = 0; m < numPools; ++m )
+            col.push_back( m );
+        start.push_back( col.size() );
+    }
+    vector< double > jv( col.size() );
+    vector< double > work( S, S + numPools );
+    kernel.derivatives( S, start, col, &jv[0], &work[0] );
+    for ( unsigned int m = 0; m < numPools; ++m )
+    {
+        ASSERT_EQ( work[m], S[m], "testRateKernel" );
+        double h = 1e-5;
+        vector< double > up( S, S + numPools );
+        vector< double > down( S, S + numPools );
+        up[m] += h;
+        down[m] -= h;
+        for ( unsigned int r = 0; r < rates.size(); ++r )
+        {
+            double fd = ( ( *rates[r] )( &up[0] ) -
+                    ( *rates[r] )( &down[0] ) ) / ( 2 * h );
+            ASSERT_DOUBLE_EQ( jv[ start[r] + m ], fd, "testRateKernel" );
+        }
+    }
+
+    for ( auto r : rates )
+        delete r;
+    cout << "." << flush;
+}
+
+/**
+ * Solves a sparse system with an arrow-shaped pattern, whose natural
+ * order fills in completely, and checks the residual.
+ */
+void testSparseLU()
+{
+    const unsigned int n = 12;
+    vector< vector< double > > A( n, vector< double >( n, 0.0 ) );
+    for ( unsigned int i = 0; i < n; ++i )
+    {
+        A[i][i] = 4.0 + i;
+        if ( i > 0 )
+        {
+            A[0][i] = 1.0 / i;
+            A[i][0] = -0.5 * i;
+        }
+        if ( i + 3 < n )
+            A[i][i + 3] = 0.25;
+    }
+    vector< vector< unsigned int > > pattern( n );
+    for ( unsigned int i = 0; i < n; ++i )
+        for ( unsigned int j = 0; j < n; ++j )
+            if ( A[i][j] != 0.0 && i != j )
+                pattern[i].push_back( j );
+
+    SparseLU lu;
+    lu.analyze( n, pattern );
+    ASSERT_EQ( lu.size(), n, "testSparseLU" );
+    // Eliminating the hub last avoids the dense fill-in.
+    ASSERT_TRUE( lu.numEntries() < n * 4, "testSparseLU" );
+
+    vector< double > a( lu.numEntries(), 0.0 );
+    for ( unsigned int i = 0; i < n; ++i )
+    {
+        ASSERT_EQ( lu.position( i, i ), lu.diagonal( i ), "testSparseLU" );
+        for ( unsigned int j = 0; j < n; ++j )
+        {
+            unsigned int pos = lu.position( i, j );
+            if ( A[i][j] != 0.0 )
+            {
+                ASSERT_TRUE( pos != ~0U, "testSparseLU" );
+                a[pos] = A[i][j];
+            }
+        }
+    }
+    vector< double > work( n );
+    ASSERT_TRUE( lu.factor( &a[0], &work[0] ), "testSparseLU" );
+
+    vector< double > b( n );
+    for ( unsigned int i = 0; i < n; ++i )
+        b[i] = sin( i + 1.0 );
+    vector< double > x = b;
+    lu.solve( &a[0], &x[0], &work[0] );
+    for ( unsigned int i = 0; i < n; ++i )
+    {
+        double sum = 0.0;
+        for ( unsigned int j = 0; j < n; ++j )
+            sum += A[i][j] * x[j];
+        ASSERT_DOUBLE_EQ( sum, b[i], "testSparseLU" );
+    }
+
+    // A zero pivot is reported rather than divided by.
+    vector< double > z( lu.numEntries(), 0.0 );
+    ASSERT_FALSE( lu.factor( &z[0], &work[0] ), "testSparseLU" );
+    cout << "." << flush;
+}
+
+void testThreadPool()
+{
+    moose::ThreadPool& pool = moose::ThreadPool::instance();
+    const size_t n = 1000;
+    vector< unsigned int > count( n, 0 );
+    // Many small jobs, as the solvers issue one per clock tick.
+    for ( unsigned int step = 0; step < 200; ++step )
+    {
+        size_t numThreads = 1 + step % 4;
+        pool.parallelFor( n, numThreads, [&count]( size_t i ) {
+                count[i]++;
+                } );
+    }
+    for ( size_t i = 0; i < n; ++i )
+        ASSERT_EQ( count[i], 200u, "testThreadPool" );
+    ASSERT_TRUE( pool.numWorkers() >= 3, "testThreadPool" );
+
+    // Nested calls run serially in the calling task.
+    vector< unsigned int > nested( 16 * 16, 0 );
+    pool.parallelFor( 16, 4, [&pool, &nested]( size_t i ) {
+            pool.parallelFor( 16, 4, [i, &nested]( size_t j ) {
+                nested[ i * 16 + j ]++;
+                } );
+            } );
+    for ( size_t i = 0; i < nested.size(); ++i )
+        ASSERT_EQ( nested[i], 1u, "testThreadPool" );
+
+    // Cost-weighted ranges: one expensive task at the start.
+    vector< double > cost( n, 1.0 );
+    cost[0] = 1000.0;
+    vector< size_t > stops;
+    moose::ThreadPool::splitRanges( n, 4, &cost, stops );
+    ASSERT_EQ( stops.size(), 4u, "testThreadPool" );
+    ASSERT_EQ( stops[0], 1u, "testThreadPool" );
+    ASSERT_EQ( stops[3], n, "testThreadPool" );
+    for ( size_t i = 1; i < 4; ++i )
+    {
+        size_t size = stops[i] - stops[i - 1];
+        ASSERT_TRUE( size >= 330 && size <= 336, "testThreadPool" );
+    }
+    moose::ThreadPool::splitRanges( n, 4, nullptr, stops );
+    ASSERT_EQ( stops[0], 250u, "testThreadPool" );
+
+    // Task 0 holds its thread till all the cheap ones are done, so the
+    // others must run them all on the remaining slots. Which slot gets
+    // task 0 is up to the scheduler, as a thief may take it, but its
+    // thread runs nothing once it has started on it.
+    vector< unsigned int > slotOf( n, ~0U );
+    vector< size_t > order( n, 0 );
+    std::atomic< size_t > numDone( 0 );
+    pool.parallelFor( n, 4, [&slotOf, &order, &numDone, n]( size_t i ) {
+            slotOf[i] = moose::ThreadPool::slot();
+            if ( i == 0 )
+            {
+                order[0] = numDone.load();
+                while ( numDone.load() < n - 1 )
+                    std::this_thread::yield();
+            }
+            else
+                order[i] = numDone++;
+            }, cost );
+    for ( size_t i = 1; i < n; ++i )
+    {
+        ASSERT_TRUE( slotOf[i] < 4, "testThreadPool" );
+        if ( slotOf[i] == slotOf[0] )
+            ASSERT_TRUE( order[i] < order[0], "testThreadPool" );
+    }
+
+    // More threads than tasks, and no tasks at all.
+    pool.parallelFor( 2, 8, [&count]( size_t i ) { count[i]++; } );
+    pool.parallelFor( 0, 8, [&count]( size_t i ) { count[i]++; } );
+    ASSERT_EQ( count[0], 201u, "testThreadPool" );
+    ASSERT_EQ( count[2], 200u, "testThreadPool" );
+    cout << "." << flush;
+}
+
+void testFuncTermThreads()
+{
+    // Many voxels evaluated at once through one FuncTerm, as the
+    // threaded Ksolve does. Each thread must use its own expression.
+    const unsigned int numThreads = 4;
+    const unsigned int numVoxels = 20000;
+    FuncTerm ft;
+    vector< unsigned int > mol( 2, 0 );
+    mol[1] = 1;
+    ft.setReactantIndex( mol );
+    ft.setExpr( "x0 * x1 + sin( x0 ) + t" );
+    ft.setTarget( 2 );
+    // Set after the expression, so the new evaluators must pick it up.
+    ft.setNumThreads( numThreads );
+    ASSERT_EQ( ft.getNumThreads(), numThreads, "testFuncTermThreads" );
+
+    vector< double > S( numVoxels * 3, 0.0 );
+    vector< double > val( numVoxels, 0.0 );
+    for ( unsigned int i = 0; i < numVoxels; ++i )
+    {
+        S[ 3 * i ] = 0.001 * i;
+        S[ 3 * i + 1 ] = 1.0 + i % 7;
+    }
+    for ( unsigned int rep = 0; rep < 20; ++rep )
+    {
+        double t = rep;
+        moose::ThreadPool::instance().parallelFor( numVoxels, numThreads,
+                [&ft, &S, &val, t]( size_t i ) {
+                    ft.evalPool( &S[ 3 * i ], t );
+                    val[i] = ft( &S[ 3 * i ], t );
+                } );
+        for ( unsigned int i = 0; i < numVoxels; ++i )
+        {
+            double x0 = S[ 3 * i ];
+            double x1 = S[ 3 * i + 1 ];
+            double expected = x0 * x1 + sin( x0 ) + t;
+            ASSERT_DOUBLE_EQ( S[ 3 * i + 2 ], expected, "testFuncTermThreads" );
+            ASSERT_DOUBLE_EQ( val[i], expected, "testFuncTermThreads" );
+        }
+    }
+    cout << "." << flush;
+}
+
 void testKsolve()
 {
     testSetupReac();
     testBuildStoich();
     testRunKsolve();
+    testSolverRecorder();
+    testCheckpoint();
     testRunGsolve();
     testFuncTerm();
+    testFuncTermThreads();
+    testPropensityTree();
+    testIndexedPriorityQueue();
+    testRateKernel();
+    testSparseLU();
+    testThreadPool();
 }
 
 void testKsolveProcess()
@@ -7,9 +7,12 @@
 ** See the file COPYING.LIB for the full notice.
 **********************************************************************/
 
+#include <limits>
 #include "../basecode/header.h"
 #include "PostMaster.h"
 #include "../shell/Shell.h"
+#include "../synapse/Synapse.h"
+#include "../synapse/SynHandlerBase.h"
 
 const unsigned int TgtInfo::headerSize =
 		1 + ( sizeof( TgtInfo ) - 1 )/sizeof( double );
@@ -35,7 +38,15 @@ PostMaster::PostMaster()
 				isSetSent_( 1 ), // Flag. Have any pending 'set' gone?
 				isSetRecv_( 0 ), // Flag. Has some data come in?
 				setSendSize_( 0 ),
-				numRecvDone_( 0 )
+				numRecvDone_( 0 ),
+				windowed_( false ),
+				minDelay_( 0.0 ),
+				windowSteps_( 1 ),
+				stepsInWindow_( 0 ),
+				sendCounts_( Shell::numNodes(), 0 ),
+				sendDispls_( Shell::numNodes(), 0 ),
+				recvCounts_( Shell::numNodes(), 0 ),
+				recvDispls_( Shell::numNodes(), 0 )
 {
 	for ( unsigned int i = 0; i < Shell::numNodes(); ++i ) {
 		sendBuf_[i].resize( reserveBufSize, 0 );
@@ -100,6 +111,29 @@ const Cinfo* PostMaster::initCinfo()
 			&PostMaster::setBufferSize,
 			&PostMaster::getBufferSize
 		);
+		static ValueFinfo< PostMaster, bool > windowedExchange(
+			"windowedExchange",
+			"Flag: when true, messages to other nodes are sent once per "
+			"window of the smallest synaptic delay, rather than on every "
+			"process call, and without a barrier. Spikes arrive in time "
+			"as long as the PostMaster dt is that of the network. Other "
+			"cross-node messages are held back by up to a window. "
+			"Takes effect at reinit. Must be set on all nodes.",
+			&PostMaster::setWindowedExchange,
+			&PostMaster::getWindowedExchange
+		);
+		static ReadOnlyValueFinfo< PostMaster, double > minDelay(
+			"minDelay",
+			"Smallest synaptic delay over all nodes, found at reinit "
+			"when windowedExchange is set.",
+			&PostMaster::getMinDelay
+		);
+		static ReadOnlyValueFinfo< PostMaster, unsigned int > exchangeInterval(
+			"exchangeInterval",
+			"Number of process calls between exchanges of messages. "
+			"This is 1 unless windowedExchange is set.",
+			&PostMaster::getExchangeInterval
+		);
 		//////////////////////////////////////////////////////////////
 		// MsgDest Definitions
 		//////////////////////////////////////////////////////////////
@@ -125,6 +159,9 @@ const Cinfo* PostMaster::initCinfo()
 		&numNodes,	// ReadOnlyValue
 		&myNode,	// ReadOnlyValue
 		&bufferSize,	// ReadOnlyValue
+		&windowedExchange,	// Value
+		&minDelay,	// ReadOnlyValue
+		&exchangeInterval,	// ReadOnlyValue
 		&proc		// SharedFinfo
 	};
 
@@ -163,6 +200,13 @@ void PostMaster::finalizeSends()
  */
 void PostMaster::reinit( const Eref& e, ProcPtr p )
 {
+	stepsInWindow_ = 0;
+	if ( windowed_ ) {
+		setupWindow( p->dt );
+		exchangeWindow();
+		return;
+	}
+	windowSteps_ = 1;
 #ifdef USE_MPI
 	// MPI_Barrier( MPI_COMM_WORLD );
 	unsigned int reqIndex = 0;
@@ -189,6 +233,13 @@ void PostMaster::reinit( const Eref& e, ProcPtr p )
 
 void PostMaster::process( const Eref& e, ProcPtr p )
 {
+	if ( windowed_ ) {
+		if ( ++stepsInWindow_ >= windowSteps_ ) {
+			stepsInWindow_ = 0;
+			exchangeWindow();
+		}
+		return;
+	}
 #ifdef USE_MPI
 	unsigned int reqIndex = 0;
 	for ( unsigned int i = 0; i < Shell::numNodes(); ++i )
@@ -396,7 +447,6 @@ void PostMaster::clearPendingRecv()
 			recvNode += 1; // Skip myNode
 		int recvSize = 0;
 		MPI_Get_count( &doneStatus_[i], MPI_DOUBLE, &recvSize );
-		int j = 0;
 		assert( recvSize <= static_cast< int >( recvBufSize_ ) );
 		double* buf = &recvBuf_[ recvNode ][0];
 		if ( report ) {
@@ -406,19 +456,7 @@ void PostMaster::clearPendingRecv()
 					   	buf[j+3] << endl;
 			}
 		}
-		while ( j < recvSize ) {
-			const TgtInfo* tgt = reinterpret_cast< const TgtInfo * >( buf );
-			const Eref& e = tgt->eref();
-			const Finfo *f =
-				e.element()->cinfo()->getSrcFinfo( tgt->bindIndex() );
-			buf += TgtInfo::headerSize;
-			const SrcFinfo* sf = dynamic_cast< const SrcFinfo* >( f );
-			assert( sf );
-			sf->sendBuffer( e, buf );
-			buf += tgt->dataSize();
-			j += TgtInfo::headerSize + tgt->dataSize();
-			assert( buf - &recvBuf_[recvNode][0] == j );
-		}
+		deliverRecvBuf( buf, recvSize );
 		// Post the next Irecv.
 		unsigned int k = recvNode;
 		if ( recvNode > Shell::myNode() )
@@ -435,6 +473,140 @@ void PostMaster::clearPendingRecv()
 #endif
 }
 
+void PostMaster::deliverRecvBuf( double* buf, int size )
+{
+	const double* start = buf;
+	int j = 0;
+	while ( j < size ) {
+		const TgtInfo* tgt = reinterpret_cast< const TgtInfo * >( buf );
+		const Eref& e = tgt->eref();
+		const Finfo *f =
+			e.element()->cinfo()->getSrcFinfo( tgt->bindIndex() );
+		buf += TgtInfo::headerSize;
+		const SrcFinfo* sf = dynamic_cast< const SrcFinfo* >( f );
+		assert( sf );
+		sf->sendBuffer( e, buf );
+		buf += tgt->dataSize();
+		j += TgtInfo::headerSize + tgt->dataSize();
+		assert( buf - start == j );
+	}
+}
+
+///////////////////////////////////////////////////////////////
+// Windowed exchange
+///////////////////////////////////////////////////////////////
+
+double PostMaster::localMinDelay() const
+{
+	double ret = numeric_limits< double >::max(); // No synapses yet.
+	for ( unsigned int i = 0; i < Id::numIds(); ++i ) {
+		if ( !Id::isValid( i ) )
+			continue;
+		Element* elm = Id( i ).element();
+		if ( !elm->cinfo()->isA( "SynHandlerBase" ) )
+			continue;
+		for ( unsigned int j = 0; j < elm->numLocalData(); ++j ) {
+			SynHandlerBase* sh =
+				reinterpret_cast< SynHandlerBase* >( elm->data( j ) );
+			unsigned int numSyn = sh->getNumSynapses();
+			for ( unsigned int k = 0; k < numSyn; ++k ) {
+				double d = sh->getSynapse( k )->getDelay();
+				if ( d < ret )
+					ret = d;
+			}
+		}
+	}
+	return ret;
+}
+
+/**
+ * The window is the largest whole number of PostMaster steps that fits
+ * in the smallest synaptic delay. A spike sent on the first step of a
+ * window is delivered at the end of its last step, and reaches the
+ * SynHandler before the step on which it is due.
+ */
+void PostMaster::setupWindow( double dt )
+{
+	double localMin = localMinDelay();
+	minDelay_ = localMin;
+#ifdef USE_MPI
+	MPI_Allreduce( &localMin, &minDelay_, 1, MPI_DOUBLE, MPI_MIN,
+					MPI_COMM_WORLD );
+#endif
+	windowSteps_ = 1;
+	if ( minDelay_ == numeric_limits< double >::max() ) {
+		minDelay_ = 0.0; // No synapses anywhere.
+		return;
+	}
+	if ( dt > 0.0 && minDelay_ > dt ) {
+		double n = floor( minDelay_ / dt + 1e-9 );
+		windowSteps_ = n > 1e6 ? 1000000 : static_cast< unsigned int >( n );
+	}
+}
+
+/**
+ * Waits for a non-blocking collective, while handling any set and get
+ * calls that come in, as the per-step exchange does.
+ */
+#ifdef USE_MPI
+static void waitServicing( MPI_Request* req, PostMaster* pm )
+{
+	int done = 0;
+	while ( !done ) {
+		MPI_Test( req, &done, MPI_STATUS_IGNORE );
+		if ( !done )
+			pm->clearPendingSetGet();
+	}
+}
+#endif // USE_MPI
+
+void PostMaster::exchangeWindow()
+{
+#ifdef USE_MPI
+	unsigned int numNodes = Shell::numNodes();
+	if ( numNodes == 1 )
+		return;
+	unsigned int myNode = Shell::myNode();
+	for ( unsigned int i = 0; i < numNodes; ++i )
+		sendCounts_[i] = ( i == myNode ) ? 0 : sendSize_[i];
+	MPI_Request req;
+	MPI_Ialltoall( &sendCounts_[0], 1, MPI_INT, &recvCounts_[0], 1, MPI_INT,
+					MPI_COMM_WORLD, &req );
+
+	// Pack the send buffers while the sizes are in flight.
+	int total = 0;
+	for ( unsigned int i = 0; i < numNodes; ++i ) {
+		sendDispls_[i] = total;
+		total += sendCounts_[i];
+	}
+	windowSendBuf_.resize( total + 1 );
+	for ( unsigned int i = 0; i < numNodes; ++i ) {
+		if ( sendCounts_[i] > 0 )
+			memcpy( &windowSendBuf_[ sendDispls_[i] ], &sendBuf_[i][0],
+							sendCounts_[i] * sizeof( double ) );
+		sendSize_[i] = 0;
+	}
+	waitServicing( &req, this );
+
+	total = 0;
+	for ( unsigned int i = 0; i < numNodes; ++i ) {
+		recvDispls_[i] = total;
+		total += recvCounts_[i];
+	}
+	windowRecvBuf_.resize( total + 1 );
+	MPI_Ialltoallv( &windowSendBuf_[0], &sendCounts_[0], &sendDispls_[0],
+					MPI_DOUBLE,
+					&windowRecvBuf_[0], &recvCounts_[0], &recvDispls_[0],
+					MPI_DOUBLE, MPI_COMM_WORLD, &req );
+	waitServicing( &req, this );
+
+	for ( unsigned int i = 0; i < numNodes; ++i )
+		if ( recvCounts_[i] > 0 )
+			deliverRecvBuf( &windowRecvBuf_[ recvDispls_[i] ],
+							recvCounts_[i] );
+#endif // USE_MPI
+}
+
 ///////////////////////////////////////////////////////////////
 // Data transfer and fillup operations.
 ///////////////////////////////////////////////////////////////
@@ -444,7 +616,13 @@ double* PostMaster::addToSendBuf( const Eref& e, unsigned int bindIndex,
 {
 	unsigned int node = e.fieldIndex(); // nasty evil wicked hack
 	unsigned int end = sendSize_[node];
-	if ( end + TgtInfo::headerSize + size > recvBufSize_ ) {
+	unsigned int needed = end + TgtInfo::headerSize + size;
+	if ( windowed_ ) {
+		// Windowed exchange sizes the receive buffers as it goes, so the
+		// send buffer can just grow.
+		if ( needed > sendBuf_[node].size() )
+			sendBuf_[node].resize( 2 * needed );
+	} else if ( needed > recvBufSize_ ) {
 		// Here we need to activate the fallback second send which will
 		// deal with the big block. Also various routines for tracking
 		// send size so we don't get too big or small.
@@ -724,3 +902,23 @@ void PostMaster::setBufferSize( unsigned int size )
 	for ( unsigned int i =0; i < sendBuf_.size(); ++i )
 		sendBuf_[i].resize( size );
 }
+
+void PostMaster::setWindowedExchange( bool v )
+{
+	windowed_ = v;
+}
+
+bool PostMaster::getWindowedExchange() const
+{
+	return windowed_;
+}
+
+double PostMaster::getMinDelay() const
+{
+	return minDelay_;
+}
+
+unsigned int PostMaster::getExchangeInterval() const
+{
+	return windowSteps_;
+}
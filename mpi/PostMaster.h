@@ -60,6 +60,21 @@
  * that was filled when the digestMessages detected that a majority of
  * target nodes received a given message. A setup time complication, not
  * a runtime problem.
+ *
+ * Windowed exchange.
+ * By default the send buffers go out on every process call, and each
+ * node waits for all the others and then hits a barrier. In network
+ * models nearly all cross-node traffic is spikes, and a spike need not
+ * arrive before its synaptic delay is up. With windowedExchange set, the
+ * PostMaster finds the smallest synaptic delay over all nodes at reinit,
+ * and sends the buffers only once per window of that length. The
+ * exchange is an MPI_Ialltoall of the buffer sizes and then an
+ * MPI_Ialltoallv of the contents, with no barrier. Set and get calls
+ * are serviced while these are in flight.
+ * Spikes are delivered on the same step as before, as long as the
+ * PostMaster dt is the dt of the spike sources and synapses. Any other
+ * cross-node messages are held back by up to a window, so this mode is
+ * only for models where spikes are all that cross nodes.
  */
 
 #ifndef _POST_MASTER_H
@@ -108,6 +123,10 @@ class PostMaster {
 		unsigned int getMyNode() const;
 		unsigned int getBufferSize() const;
 		void setBufferSize( unsigned int size );
+		void setWindowedExchange( bool v );
+		bool getWindowedExchange() const;
+		double getMinDelay() const;
+		unsigned int getExchangeInterval() const;
 		void reinit( const Eref& e, ProcPtr p );
 		void process( const Eref& e, ProcPtr p );
 
@@ -119,6 +138,15 @@ class PostMaster {
 		void clearPendingRecv();
 		/// Checks that all sends have gone out
 		void finalizeSends();
+		/// Despatches the messages in one arrived buffer.
+		void deliverRecvBuf( double* buf, int size );
+
+		/// Finds the global minimum synaptic delay and the window.
+		void setupWindow( double dt );
+		/// Smallest delay of any synapse on this node.
+		double localMinDelay() const;
+		/// Exchanges all send buffers at the end of a window.
+		void exchangeWindow();
 
 		/// Handles 'get' calls from another node, to an object on mynode.
 		void handleRemoteGet( const Eref& e,
@@ -177,6 +205,17 @@ class PostMaster {
 		int isSetRecv_;
 		int setSendSize_;
 		unsigned int numRecvDone_;
+
+		bool windowed_;
+		double minDelay_;
+		unsigned int windowSteps_; /// Process calls per exchange.
+		unsigned int stepsInWindow_;
+		vector< int > sendCounts_;
+		vector< int > sendDispls_;
+		vector< int > recvCounts_;
+		vector< int > recvDispls_;
+		vector< double > windowSendBuf_;
+		vector< double > windowRecvBuf_;
 };
 
 #endif	// _POST_MASTER_H
@@ -7,7 +7,218 @@
 ** See the file COPYING.LIB for the full notice.
 **********************************************************************/
 
+#ifdef DO_UNIT_TESTS
+
+#include "../basecode/header.h"
+#include "../shell/Shell.h"
+#include "../randnum/randnum.h"
+
+/**
+ * Runs a sparse network of IntFire cells, spread over all nodes, and
+ * returns the Vm of the cells at the end. All synaptic delays are at
+ * least minDelay. If balance is set, the cells are load balanced
+ * before reinit.
+ */
+static vector< double > runSparseNet( bool windowed, double minDelay,
+				bool balance = false )
+{
+	static const unsigned int size = 64;
+	static const double dt = 1e-3;
+	static const double runtime = 0.2;
+	static const double thresh = 0.2;
+	static const double refractoryPeriod = 0.005;
+	Eref sheller = Id().eref();
+	Shell* shell = reinterpret_cast< Shell* >( sheller.data() );
+
+	Id syns = shell->doCreate( "SimpleSynHandler", Id(), "syns", size );
+	Id synapse( syns.value() + 1 );
+	Id cells = shell->doCreate( "IntFire", Id(), "cells", size );
+	shell->doAddMsg( "OneToOne", syns, "activationOut", cells, "activation" );
+	ObjId mid = shell->doAddMsg( "Sparse", cells, "spikeOut",
+					synapse, "addSpike" );
+	assert( !mid.bad() );
+	SetGet2< double, long >::set( mid, "setRandomConnectivity", 0.2, 1234 );
+
+	moose::mtseed( 5489UL );
+	vector< double > temp( size );
+	for ( unsigned int i = 0; i < size; ++i )
+		temp[i] = moose::mtrand() * 0.3;
+	Field< double >::setVec( cells, "Vm", temp );
+	temp.assign( size, thresh );
+	Field< double >::setVec( cells, "thresh", temp );
+	temp.assign( size, refractoryPeriod );
+	Field< double >::setVec( cells, "refractoryPeriod", temp );
+	for ( unsigned int i = 0; i < size; ++i ) {
+		ObjId oi( syns, i );
+		unsigned int numSyn = Field< unsigned int >::get( oi, "numSynapses" );
+		for ( unsigned int j = 0; j < numSyn; ++j ) {
+			ObjId si( synapse, i, j );
+			Field< double >::set( si, "weight", moose::mtrand() * 0.1 );
+			Field< double >::set( si, "delay",
+					minDelay + moose::mtrand() * 4 * minDelay );
+		}
+	}
+
+	ObjId pm( 3 ); // The postmaster.
+	Field< bool >::set( pm, "windowedExchange", windowed );
+	shell->doUseClock( "/syns", "process", 0 );
+	shell->doUseClock( "/cells", "process", 1 );
+	shell->doSetClock( 0, dt );
+	shell->doSetClock( 1, dt );
+	shell->doSetClock( 9, dt );
+	if ( balance )
+		shell->doLoadBalance();
+	shell->doReinit();
+	if ( windowed && Shell::numNodes() > 1 ) {
+		assert( Field< double >::get( pm, "minDelay" ) > minDelay - 1e-12 );
+		assert( Field< unsigned int >::get( pm, "exchangeInterval" ) >= 4 );
+	}
+	shell->doStart( runtime );
+
+	vector< double > ret;
+	Field< double >::getVec( cells, "Vm", ret );
+	Field< bool >::set( pm, "windowedExchange", false );
+	shell->doSetClock( 9, 1.0 );
+	shell->doDelete( cells );
+	shell->doDelete( syns );
+	return ret;
+}
+
+/**
+ * Spikes must reach their synapses on the same steps whether they cross
+ * nodes on every step or once per window of the minimum delay.
+ */
+void testMpiWindowedExchange()
+{
+	const double minDelay = 5e-3;
+	vector< double > everyStep = runSparseNet( false, minDelay );
+	vector< double > windowed = runSparseNet( true, minDelay );
+	assert( everyStep.size() == windowed.size() );
+	for ( unsigned int i = 0; i < everyStep.size(); ++i )
+		assert( doubleEq( everyStep[i], windowed[i] ) );
+	cout << "." << flush;
+}
+
+/**
+ * Cells of different sizes must each go whole to one node, and the nodes
+ * must end up with about the same load. A network must run the same
+ * after its entries are moved around.
+ */
+void testMpiLoadBalance()
+{
+	static const unsigned int numCells = 8;
+	Eref sheller = Id().eref();
+	Shell* shell = reinterpret_cast< Shell* >( sheller.data() );
+	Id lib = shell->doCreate( "Neutral", Id(), "lbcells", 1 );
+	vector< vector< Id > > compts( numCells );
+	for ( unsigned int i = 0; i < numCells; ++i ) {
+		stringstream ss;
+		ss << "cell" << i;
+		Id cell = shell->doCreate( "Neutral", lib, ss.str(), 1 );
+		for ( unsigned int j = 0; j < 3 * ( i + 1 ); ++j ) {
+			stringstream cs;
+			cs << "compt" << j;
+			Id c = shell->doCreate( "Compartment", cell, cs.str(), 1 );
+			if ( j > 0 )
+				shell->doAddMsg( "Single", compts[i].back(), "raxial",
+								c, "axial" );
+			compts[i].push_back( c );
+		}
+	}
+	shell->doLoadBalance();
+	vector< double > load = Field< vector< double > >::get(
+					ObjId(), "nodeLoad" );
+	assert( load.size() == Shell::numNodes() );
+	double total = 0.0;
+	for ( unsigned int i = 0; i < load.size(); ++i )
+		total += load[i];
+	assert( *max_element( load.begin(), load.end() ) <
+					1.4 * total / load.size() );
+	for ( unsigned int i = 0; i < numCells; ++i ) {
+		unsigned int node = compts[i][0].element()->getNode( 0 );
+		for ( unsigned int j = 0; j < compts[i].size(); ++j ) {
+			assert( compts[i][j].element()->getNode( 0 ) == node );
+			Field< double >::set( compts[i][j], "Vm", 0.001 * ( i + j ) );
+		}
+	}
+	for ( unsigned int i = 0; i < numCells; ++i )
+		for ( unsigned int j = 0; j < compts[i].size(); ++j )
+			assert( doubleEq( Field< double >::get( compts[i][j], "Vm" ),
+							0.001 * ( i + j ) ) );
+	shell->doDelete( lib );
+
+	vector< double > plain = runSparseNet( false, 5e-3 );
+	vector< double > balanced = runSparseNet( false, 5e-3, true );
+	assert( plain.size() == balanced.size() );
+	for ( unsigned int i = 0; i < plain.size(); ++i )
+		assert( doubleEq( plain[i], balanced[i] ) );
+	cout << "." << flush;
+}
+
+/**
+ * The synapses of cells that change node must go with them. The first
+ * quarter of the SynHandlers get all the synapses, so on many nodes the
+ * balancer moves the block boundaries.
+ */
+void testMpiLoadBalanceSynapses()
+{
+	static const unsigned int size = 64;
+	static const unsigned int numTargets = size / 4;
+	Eref sheller = Id().eref();
+	Shell* shell = reinterpret_cast< Shell* >( sheller.data() );
+
+	Id syns = shell->doCreate( "SimpleSynHandler", Id(), "lbsyns", size );
+	Id synapse( syns.value() + 1 );
+	Id cells = shell->doCreate( "IntFire", Id(), "lbcells", size );
+	shell->doAddMsg( "OneToOne", syns, "activationOut", cells, "activation" );
+	ObjId mid = shell->doAddMsg( "Sparse", cells, "spikeOut",
+					synapse, "addSpike" );
+	assert( !mid.bad() );
+	vector< unsigned int > src;
+	vector< unsigned int > dest;
+	for ( unsigned int i = 0; i < size; ++i ) {
+		for ( unsigned int j = 0; j < numTargets; ++j ) {
+			src.push_back( i );
+			dest.push_back( j );
+		}
+	}
+	SetGet2< vector< unsigned int >, vector< unsigned int > >::set(
+					mid, "pairFill", src, dest );
+	for ( unsigned int i = 0; i < numTargets; ++i ) {
+		ObjId oi( syns, i );
+		assert( Field< unsigned int >::get( oi, "numSynapses" ) == size );
+		for ( unsigned int j = 0; j < size; ++j )
+			Field< double >::set( ObjId( synapse, i, j ), "weight",
+							i + 0.001 * j );
+	}
+	vector< unsigned int > before( size );
+	for ( unsigned int i = 0; i < size; ++i )
+		before[i] = syns.element()->getNode( i );
+
+	shell->doLoadBalance();
+	unsigned int numMoved = 0;
+	for ( unsigned int i = 0; i < size; ++i )
+		numMoved += syns.element()->getNode( i ) != before[i];
+	assert( Shell::numNodes() == 1 || numMoved > 0 );
+	for ( unsigned int i = 0; i < numTargets; ++i ) {
+		ObjId oi( syns, i );
+		assert( Field< unsigned int >::get( oi, "numSynapses" ) == size );
+		for ( unsigned int j = 0; j < size; ++j )
+			assert( doubleEq( Field< double >::get(
+							ObjId( synapse, i, j ), "weight" ), i + 0.001 * j ) );
+	}
+	shell->doDelete( cells );
+	shell->doDelete( syns );
+	cout << "." << flush;
+}
+
+#endif // DO_UNIT_TESTS
+
 void testMpi()
 {
-		;
+#ifdef DO_UNIT_TESTS
+	testMpiWindowedExchange();
+	testMpiLoadBalance();
+	testMpiLoadBalanceSynapses();
+#endif // DO_UNIT_TESTS
 }
@@ -55,6 +55,20 @@ class Msg
 		  */
 		 virtual void targets( vector< vector< Eref > >& v ) const = 0;
 
+		 /**
+		  * Lets the Msg take over the calls of func from e1 to e2 and
+		  * deliver them itself. If it does, it fills v like targets(),
+		  * but with the Erefs that the returned OpFunc expects, and
+		  * returns that OpFunc, which Element::digestMessages then
+		  * puts in the digest of e1 in place of func.
+		  * Returns 0, the default, to digest the Msg through targets().
+		  */
+		 virtual const OpFunc* batchTargets( const OpFunc* func,
+				vector< vector< Eref > >& v ) const
+		 {
+			 return 0;
+		 }
+
 		/**
 		 * Return the first element
 		 */
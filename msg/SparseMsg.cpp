@@ -12,11 +12,28 @@
 #include "../randnum/randnum.h"
 #include "../shell/Shell.h"
 #include "../basecode/SparseMatrix.h"
+#include "../utility/ThreadPool.h"
 #include "SparseMsg.h"
 
 // Initializing static variables
 Id SparseMsg::managerId_;
 vector< SparseMsg* > SparseMsg::msg_;
+vector< SparseMsg* > SparseMsg::pending_;
+
+/**
+ * The func that a source of a SparseMsg with batchSpikes sends its spikes
+ * to. The target Eref is the SparseMsg itself, with the source data index
+ * as field index, and the spike is only appended to the buffer of the Msg.
+ */
+class SpikeBufferFunc: public OpFunc1Base< double >
+{
+public:
+    void op( const Eref& e, double time ) const
+    {
+        reinterpret_cast< SparseMsg* >( SparseMsg::lookupMsg(
+                    e.dataIndex() ) )->bufferSpike( e.fieldIndex(), time );
+    }
+};
 
 //////////////////////////////////////////////////////////////////
 //    MOOSE wrapper functions for field access.
@@ -91,6 +108,26 @@ const Cinfo* SparseMsg::initCinfo()
         &SparseMsg::getSeed
     );
 
+    static ValueFinfo< SparseMsg, bool > batchSpikes(
+        "batchSpikes",
+        "Flag: when true, spikes going to Synapses are buffered on the "
+        "message, as (source index, time) pairs, and delivered in bulk "
+        "when the SynHandlers process on the next step, instead of being "
+        "sent to every synapse as they happen. The synapses get the same "
+        "spikes at the same times, as long as the delays are at least "
+        "one step. Only used on a single node. Default false.",
+        &SparseMsg::setBatchSpikes,
+        &SparseMsg::getBatchSpikes
+    );
+
+    static ValueFinfo< SparseMsg, unsigned int > numThreads(
+        "numThreads",
+        "Number of threads on which batched spikes are delivered. The "
+        "targets are split between threads by data index. Default 1.",
+        &SparseMsg::setNumThreads,
+        &SparseMsg::getNumThreads
+    );
+
 ////////////////////////////////////////////////////////////////////////
 // DestFinfos
 ////////////////////////////////////////////////////////////////////////
@@ -156,6 +193,8 @@ const Cinfo* SparseMsg::initCinfo()
         &rowStart,              // ReadOnlyValue
         &probability,           // value
         &seed,                  // value
+        &batchSpikes,           // value
+        &numThreads,            // value
         &setRandomConnectivity, // dest
         &setEntry,              // dest
         &unsetEntry,            // dest
@@ -205,6 +244,27 @@ int SparseMsg::getSeed () const
     return seed_;
 }
 
+void SparseMsg::setBatchSpikes( bool value )
+{
+    batchSpikes_ = value;
+    e1()->markRewired();
+}
+
+bool SparseMsg::getBatchSpikes() const
+{
+    return batchSpikes_;
+}
+
+void SparseMsg::setNumThreads( unsigned int value )
+{
+    numThreads_ = max( value, 1U );
+}
+
+unsigned int SparseMsg::getNumThreads() const
+{
+    return numThreads_;
+}
+
 unsigned int SparseMsg::getNumRows() const
 {
     return matrix_.nRows();
@@ -385,7 +445,9 @@ SparseMsg::SparseMsg( Element* e1, Element* e2, unsigned int msgIndex )
       numThreads_( 1 ),
       nrows_( 0 ),
       p_( 0.0 ),
-      seed_(-1)
+      seed_(-1),
+      batchSpikes_( false ),
+      batchFunc_( 0 )
 {
     unsigned int nrows = 0;
     unsigned int ncolumns = 0;
@@ -415,6 +477,8 @@ SparseMsg::~SparseMsg()
 {
     assert( mid_.dataIndex < msg_.size() );
     msg_[ mid_.dataIndex ] = 0; // ensure deleted ptr isn't reused.
+    pending_.erase( remove( pending_.begin(), pending_.end(), this ),
+                    pending_.end() );
 }
 
 unsigned int rowIndex( const Element* e, const DataId& d )
@@ -628,6 +692,115 @@ void SparseMsg::targets( vector< vector< Eref > >& v ) const
     fillErefsFromMatrix( matrix_, v, e1_, e2_ );
 }
 
+/**
+ * Sources on e1 send spikes to Synapses on e2 through a SpikeBufferFunc,
+ * with one target each: the Msg, and the index of the source. Only for
+ * a single node, as the buffer is delivered to local targets only.
+ */
+const OpFunc* SparseMsg::batchTargets( const OpFunc* func,
+                                       vector< vector< Eref > >& v ) const
+{
+    if ( !batchSpikes_ || Shell::numNodes() > 1 ||
+            !e2_->cinfo()->isA( "Synapse" ) )
+        return 0;
+    batchFunc_ = dynamic_cast< const OpFunc1Base< double >* >( func );
+    if ( !batchFunc_ )
+        return 0;
+
+    batchRowStart_.assign( 1, 0 );
+    batchColumn_.clear();
+    batchField_.clear();
+    vector< pair< unsigned int, unsigned int > > row;
+    for ( unsigned int i = 0; i < matrix_.nRows(); ++i )
+    {
+        const unsigned int* entry;
+        const unsigned int* colIndex;
+        unsigned int num = matrix_.getRow( i, &entry, &colIndex );
+        row.resize( num );
+        for ( unsigned int j = 0; j < num; ++j )
+            row[j] = make_pair( colIndex[j], entry[j] );
+        sort( row.begin(), row.end() );
+        for ( unsigned int j = 0; j < num; ++j )
+        {
+            batchColumn_.push_back( row[j].first );
+            batchField_.push_back( row[j].second );
+        }
+        batchRowStart_.push_back( batchColumn_.size() );
+    }
+
+    static SpikeBufferFunc bufferFunc;
+    v.clear();
+    v.resize( e1_->numData() );
+    for ( unsigned int i = 0; i < v.size() && i < matrix_.nRows(); ++i )
+        if ( batchRowStart_[i + 1] > batchRowStart_[i] )
+            v[i].push_back( Eref( managerId_.element(), mid_.dataIndex, i ) );
+    return &bufferFunc;
+}
+
+void SparseMsg::bufferSpike( unsigned int row, double time )
+{
+    if ( spikes_.empty() )
+        pending_.push_back( this );
+    spikes_.push_back( make_pair( row, time ) );
+}
+
+/**
+ * Each task takes a range of target data indices and goes through all
+ * the spikes, in the order they were sent, so every target gets its
+ * spikes in the same order as it would have without batching.
+ */
+void SparseMsg::deliverSpikes()
+{
+    if ( spikes_.empty() || !batchFunc_ )
+    {
+        spikes_.clear();
+        return;
+    }
+
+    const unsigned int numColumns = matrix_.nColumns();
+    const unsigned int numTasks = min( numColumns,
+            numThreads_ > 1 ? 4 * numThreads_ : 1U );
+    moose::ThreadPool::instance().parallelFor( numTasks, numThreads_,
+            [this, numColumns, numTasks]( size_t t )
+            {
+                unsigned int begin = numColumns * t / numTasks;
+                unsigned int end = numColumns * ( t + 1 ) / numTasks;
+                const unsigned int* column = batchColumn_.data();
+                for ( vector< pair< unsigned int, double > >::const_iterator
+                        i = spikes_.begin(); i != spikes_.end(); ++i )
+                {
+                    const unsigned int* j = lower_bound(
+                            column + batchRowStart_[ i->first ],
+                            column + batchRowStart_[ i->first + 1 ], begin );
+                    const unsigned int* last =
+                        column + batchRowStart_[ i->first + 1 ];
+                    for ( ; j != last && *j < end; ++j )
+                        batchFunc_->op( Eref( e2_, *j,
+                                    batchField_[ j - column ] ), i->second );
+                }
+            } );
+    spikes_.clear();
+}
+
+void SparseMsg::flushSpikes()
+{
+    if ( pending_.empty() )
+        return;
+    vector< SparseMsg* > temp;
+    temp.swap( pending_ );
+    for ( vector< SparseMsg* >::iterator i = temp.begin();
+            i != temp.end(); ++i )
+        ( *i )->deliverSpikes();
+}
+
+void SparseMsg::clearSpikes()
+{
+    for ( vector< SparseMsg* >::iterator i = pending_.begin();
+            i != pending_.end(); ++i )
+        ( *i )->spikes_.clear();
+    pending_.clear();
+}
+
 /// Static function for Msg access
 unsigned int SparseMsg::numMsg()
 {
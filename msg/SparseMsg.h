@@ -42,6 +42,13 @@
  * If you expect any significant backward data flow, please use
  * BiSparseMsg.
  * It can be modified after creation to add or remove message entries.
+ *
+ * With batchSpikes set, spikes to Synapses are not sent to each target
+ * as they happen. Each source only appends its index and the spike time
+ * to a buffer on the Msg, and the buffer is delivered in bulk, row by
+ * row of the matrix, when the first SynHandler processes on the next
+ * step. The targets are split over numThreads threads by data index,
+ * so each SynHandler is only touched by one thread.
  */
 
 class SparseMsg: public Msg
@@ -57,6 +64,8 @@ public:
 
     void sources( vector< vector< Eref > >& v ) const;
     void targets( vector< vector< Eref > >& v ) const;
+    const OpFunc* batchTargets( const OpFunc* func,
+                                vector< vector< Eref > >& v ) const;
 
     unsigned int randomConnect( double probability );
 
@@ -91,6 +100,26 @@ public:
     int getSeed() const;
     void setSeed( int value );
 
+    void setBatchSpikes( bool value );
+    bool getBatchSpikes() const;
+    void setNumThreads( unsigned int value );
+    unsigned int getNumThreads() const;
+
+    /// Appends a spike from source row to the buffer.
+    void bufferSpike( unsigned int row, double time );
+
+    /// Delivers the buffered spikes to their targets.
+    void deliverSpikes();
+
+    /**
+     * Delivers the buffered spikes of all SparseMsgs. Called by the
+     * SynHandlers before they process.
+     */
+    static void flushSpikes();
+
+    /// Drops the buffered spikes of all SparseMsgs, on reinit.
+    static void clearSpikes();
+
     vector< unsigned int > getEntryPairs() const;
     void setEntryPairs( vector< unsigned int > entries );
 
@@ -152,6 +181,25 @@ private:
     // RNG.
     int seed_;
     moose::RNG rng_;
+
+    bool batchSpikes_;
+
+    /**
+     * The func that the batched spikes are delivered with, and a copy
+     * of the matrix with each row sorted by column, so that a thread
+     * can find its targets in a row by bisection. Set up by
+     * batchTargets when the source digests its messages.
+     */
+    mutable const OpFunc1Base< double >* batchFunc_;
+    mutable vector< unsigned int > batchRowStart_;
+    mutable vector< unsigned int > batchColumn_;
+    mutable vector< unsigned int > batchField_;
+
+    /// Source row and time of each spike since the last delivery.
+    vector< pair< unsigned int, double > > spikes_;
+
+    /// SparseMsgs that have buffered spikes.
+    static vector< SparseMsg* > pending_;
 };
 
 #endif // _SPARSE_MSG_H
@@ -385,6 +385,16 @@ void mooseStop()
     getShellPtr()->doStop();
 }
 
+bool mooseSaveCheckpoint(const string& fileName)
+{
+    return getShellPtr()->doSaveCheckpoint(fileName);
+}
+
+bool mooseLoadCheckpoint(const string& fileName)
+{
+    return getShellPtr()->doLoadCheckpoint(fileName);
+}
+
 // Id is synonym with Id in previous binding.
 MooseVec mooseCopy(const py::object& elem, const py::object& newParent,
                    string newName, unsigned int n = 1, bool toGlobal = false,
@@ -213,6 +213,10 @@ void mooseStart(double runtime, bool notify);
 
 void mooseStop();
 
+bool mooseSaveCheckpoint(const string& fileName);
+
+bool mooseLoadCheckpoint(const string& fileName);
+
 py::cpp_function getPropertyDestFinfo(const ObjId& oid, const Finfo* finfo);
 
 vector<string> mooseGetFieldNames(const string& className,
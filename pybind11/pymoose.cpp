@@ -443,6 +443,8 @@ PYBIND11_MODULE(_moose, m)
     m.def("reinit", &mooseReinit);
     m.def("start", &mooseStart, "runtime"_a, "notify"_a = false);
     m.def("stop", &mooseStop);
+    m.def("saveCheckpoint", &mooseSaveCheckpoint, "filename"_a);
+    m.def("loadCheckpoint", &mooseLoadCheckpoint, "filename"_a);
 
     m.def("isRunning", &mooseIsRunning);
 
@@ -458,6 +458,54 @@ def stop():
     _moose.stop()
 
 
+def saveCheckpoint(filename):
+    """Save the running state of the simulation to a binary file.
+
+    The file holds the clock time, the field values of all objects and the
+    internal state of the solvers, so that the run can be carried on later
+    with moose.loadCheckpoint. When running on many nodes, each node writes
+    its own file, `filename.<node>`. Models with objects whose state cannot
+    be saved yet, such as SeqSynHandler, HHChannel2D and MarkovChannel, are
+    refused.
+
+    Parameters
+    ----------
+    filename : str
+        name of the checkpoint file.
+
+    See also
+    --------
+    moose.loadCheckpoint : Restore a checkpoint
+    """
+    if not _moose.saveCheckpoint(filename):
+        raise RuntimeError("Could not save checkpoint to %s" % filename)
+
+
+def loadCheckpoint(filename):
+    """Restore the state of a simulation saved by moose.saveCheckpoint.
+
+    The model must first be built again by the same script and reinited.
+    The next call to moose.start then carries on from the time at which the
+    checkpoint was saved, giving the same results as the run that saved it.
+
+    Parameters
+    ----------
+    filename : str
+        name of the checkpoint file.
+
+    Raises
+    ------
+    RuntimeError
+        if the file cannot be read or does not match the model.
+
+    See also
+    --------
+    moose.saveCheckpoint : Save a checkpoint
+    """
+    if not _moose.loadCheckpoint(filename):
+        raise RuntimeError("Could not load checkpoint from %s" % filename)
+
+
 def setCwe(arg):
     """Set the current working element.
 
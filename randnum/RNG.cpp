@@ -8,6 +8,7 @@
  *        License:  MIT License
  */
 
+#include <sstream>
 #include "RNG.h"
 
 namespace moose {
@@ -71,4 +72,33 @@ double RNG::uniform( void )
     return dist_( rng_ );
 }
 
+/**
+ * @brief Return a Poisson distributed random number with given mean.
+ *
+ * @param mean Mean of the distribution. Returns 0 if mean <= 0.
+ *
+ * @return random number, as a double since it is usually added to pool #.
+ */
+double RNG::poisson( const double mean )
+{
+    if( mean <= 0.0 )
+        return 0.0;
+    std::poisson_distribution<unsigned long> dist( mean );
+    return static_cast<double>( dist( rng_ ) );
+}
+
+std::string RNG::getState( ) const
+{
+    std::ostringstream ss;
+    ss.precision( 17 );
+    ss << seed_ << ' ' << rng_ << ' ' << dist_;
+    return ss.str();
+}
+
+void RNG::setState( const std::string& state )
+{
+    std::istringstream ss( state );
+    ss >> seed_ >> rng_ >> dist_;
+}
+
 }
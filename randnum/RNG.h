@@ -55,6 +55,13 @@ class RNG
         double uniform( const double a, const double b);
 
         double uniform( void );
+        double poisson( const double mean );
+
+        /// State of the engine and distribution, as text, for checkpoints.
+        std::string getState( ) const;
+
+        /// Restores a state from getState.
+        void setState( const std::string& state );
 
 
     private:
@@ -50,8 +50,11 @@
 
 #include "../basecode/header.h"
 #include "../utility/print_function.hpp"
+#include "../basecode/Checkpoint.h"
 #include "Clock.h"
 
+#include <chrono>
+
 #if PARALLELIZE_CLOCK_USING_CPP11_ASYNC
 #include <future>
 #endif
@@ -213,6 +216,65 @@ const Cinfo* Clock::initCinfo()
         "If nothing can be found returns 0 and emits a warning.",
         &Clock::getDefaultTick
     );
+
+    static ValueFinfo< Clock, bool > profile(
+        "profile",
+        "Flag: when true, the Clock times the process calls of each tick "
+        "and of each object it sends them to. The totals are cleared on "
+        "reinit and by clearProfile, and can be read from the profile "
+        "fields or written out by dumpProfile.",
+        &Clock::setProfile,
+        &Clock::getProfile
+    );
+    static ReadOnlyValueFinfo< Clock, vector< double > > profileTickTime(
+        "profileTickTime",
+        "Wall-clock time in seconds spent in the process calls of each "
+        "tick.",
+        &Clock::getProfileTickTime
+    );
+    static ReadOnlyValueFinfo< Clock, vector< double > > profileTickCalls(
+        "profileTickCalls",
+        "Number of times each tick has been run.",
+        &Clock::getProfileTickCalls
+    );
+    static ReadOnlyValueFinfo< Clock, vector< double > > profileTickItems(
+        "profileTickItems",
+        "Number of object entries whose process was called on each tick.",
+        &Clock::getProfileTickItems
+    );
+    static ReadOnlyValueFinfo< Clock, vector< string > > profileClasses(
+        "profileClasses",
+        "Classes of the objects that were timed, biggest time first.",
+        &Clock::getProfileClasses
+    );
+    static ReadOnlyValueFinfo< Clock, vector< double > > profileClassTime(
+        "profileClassTime",
+        "Wall-clock time in seconds spent in each of profileClasses.",
+        &Clock::getProfileClassTime
+    );
+    static ReadOnlyValueFinfo< Clock, vector< double > > profileClassItems(
+        "profileClassItems",
+        "Number of object entries of each of profileClasses whose "
+        "process was called.",
+        &Clock::getProfileClassItems
+    );
+    static ReadOnlyValueFinfo< Clock, vector< ObjId > > profileObjects(
+        "profileObjects",
+        "Objects that were timed, such as each solver, biggest time "
+        "first.",
+        &Clock::getProfileObjects
+    );
+    static ReadOnlyValueFinfo< Clock, vector< double > > profileObjectTime(
+        "profileObjectTime",
+        "Wall-clock time in seconds spent in each of profileObjects, "
+        "over all their entries.",
+        &Clock::getProfileObjectTime
+    );
+    static ReadOnlyValueFinfo< Clock, vector< double > > profileObjectCalls(
+        "profileObjectCalls",
+        "Number of process calls to each of profileObjects.",
+        &Clock::getProfileObjectCalls
+    );
     ///////////////////////////////////////////////////////
     // Shared definitions
     ///////////////////////////////////////////////////////
@@ -243,6 +305,18 @@ const Cinfo* Clock::initCinfo()
             , new EpFunc0< Clock >(&Clock::handleReinit )
             );
 
+    static DestFinfo dumpProfile( "dumpProfile"
+            , "Writes the profile totals of each tick, class and object to "
+            "the named file, as JSON if the name ends in .json and as CSV "
+            "otherwise."
+            , new OpFunc1< Clock, string >(&Clock::dumpProfile )
+            );
+
+    static DestFinfo clearProfile( "clearProfile"
+            , "Clears the profile totals."
+            , new OpFunc0< Clock >(&Clock::clearProfile )
+            );
+
     static Finfo* clockControlFinfos[] =
     {
         &start, &step, &stop, &reinit,
@@ -271,6 +345,18 @@ const Cinfo* Clock::initCinfo()
         &tickStep,              // LookupValue
         &tickDt,                // LookupValue
         &defaultTick,           // ReadOnlyLookupValue
+        &profile,               // Value
+        &profileTickTime,       // ReadOnlyValue
+        &profileTickCalls,      // ReadOnlyValue
+        &profileTickItems,      // ReadOnlyValue
+        &profileClasses,        // ReadOnlyValue
+        &profileClassTime,      // ReadOnlyValue
+        &profileClassItems,     // ReadOnlyValue
+        &profileObjects,        // ReadOnlyValue
+        &profileObjectTime,     // ReadOnlyValue
+        &profileObjectCalls,    // ReadOnlyValue
+        &dumpProfile,           // Dest
+        &clearProfile,          // Dest
         &clockControl,          // Shared
         finished(),             // Src
         procs[0],               // Src
@@ -402,8 +488,10 @@ const Cinfo* Clock::initCinfo()
         "    MarkovChannel       4       50e-6\n"        
         "    SpikeGen             5      50e-6\n"
         "    HSolve               6      50e-6\n"
+        "    HSolvePop            6      50e-6\n"
         "    SpikeStats           7      50e-6\n"
         "    Table                8      0.1e-3\n"
+        "    SolverRecorder       8      0.1e-3\n"
         "    TimeTable            8      0.1e-3\n"
 
         "    Dsolve               10     0.01\n"
@@ -446,6 +534,7 @@ const Cinfo* Clock::initCinfo()
 }
 
 static const Cinfo* clockCinfo = Clock::initCinfo();
+static const bool clockHook = addCheckpointHook< Clock >( "Clock" );
 
 ///////////////////////////////////////////////////
 // Constructor
@@ -460,7 +549,8 @@ Clock::Clock()
       isRunning_( false ),
       doingReinit_( false ),
       info_(),
-      ticks_( Clock::numTicks, 0 )
+      ticks_( Clock::numTicks, 0 ),
+      doProfile_( false )
 {
     buildDefaultTick();
     dt_ = defaultDt_[0];
@@ -625,6 +715,98 @@ unsigned int Clock::getDefaultTick( string s ) const
     return Clock::lookupDefaultTick( s );
 }
 
+void Clock::setProfile( bool v )
+{
+    doProfile_ = v;
+}
+
+bool Clock::getProfile() const
+{
+    return doProfile_;
+}
+
+/// One of the totals of each tick, with zeros for ticks not yet run.
+static vector< double > tickTotals( const vector< ProfileStat >& ticks,
+                                    double ProfileStat::*field )
+{
+    vector< double > ret( Clock::numTicks, 0.0 );
+    for ( unsigned int i = 0; i < ticks.size() && i < ret.size(); ++i )
+        ret[i] = ticks[i].*field;
+    return ret;
+}
+
+static vector< double > statTotals( const vector< ProfileStat >& stats,
+                                    double ProfileStat::*field )
+{
+    vector< double > ret( stats.size() );
+    for ( unsigned int i = 0; i < stats.size(); ++i )
+        ret[i] = stats[i].*field;
+    return ret;
+}
+
+vector< double > Clock::getProfileTickTime() const
+{
+    return tickTotals( profile_.ticks(), &ProfileStat::time );
+}
+
+vector< double > Clock::getProfileTickCalls() const
+{
+    return tickTotals( profile_.ticks(), &ProfileStat::calls );
+}
+
+vector< double > Clock::getProfileTickItems() const
+{
+    return tickTotals( profile_.ticks(), &ProfileStat::items );
+}
+
+vector< string > Clock::getProfileClasses() const
+{
+    vector< string > names;
+    vector< ProfileStat > stats;
+    profile_.byClass( names, stats );
+    return names;
+}
+
+vector< double > Clock::getProfileClassTime() const
+{
+    vector< string > names;
+    vector< ProfileStat > stats;
+    profile_.byClass( names, stats );
+    return statTotals( stats, &ProfileStat::time );
+}
+
+vector< double > Clock::getProfileClassItems() const
+{
+    vector< string > names;
+    vector< ProfileStat > stats;
+    profile_.byClass( names, stats );
+    return statTotals( stats, &ProfileStat::items );
+}
+
+vector< ObjId > Clock::getProfileObjects() const
+{
+    vector< Id > ids;
+    vector< ProfileStat > stats;
+    profile_.byObject( ids, stats );
+    return vector< ObjId >( ids.begin(), ids.end() );
+}
+
+vector< double > Clock::getProfileObjectTime() const
+{
+    vector< Id > ids;
+    vector< ProfileStat > stats;
+    profile_.byObject( ids, stats );
+    return statTotals( stats, &ProfileStat::time );
+}
+
+vector< double > Clock::getProfileObjectCalls() const
+{
+    vector< Id > ids;
+    vector< ProfileStat > stats;
+    profile_.byObject( ids, stats );
+    return statTotals( stats, &ProfileStat::calls );
+}
+
 ///////////////////////////////////////////////////
 // Dest function definitions
 ///////////////////////////////////////////////////
@@ -700,6 +882,63 @@ void Clock::handleStart( const Eref& e, double runtime, bool notify )
     handleStep( e, n );
 }
 
+void Clock::dumpProfile( string fileName )
+{
+    if ( !profile_.write( fileName, getDts() ) )
+        cout << "Warning: Clock::dumpProfile: could not write '" <<
+             fileName << "'\n";
+}
+
+void Clock::clearProfile()
+{
+    profile_.clear();
+}
+
+/**
+ * Does what processVec()[tick]->send does, timing the whole tick and
+ * the calls to each target Element.
+ */
+void Clock::profiledSend( const Eref& e, unsigned int tick )
+{
+    using std::chrono::steady_clock;
+    using std::chrono::duration;
+    steady_clock::time_point tickStart = steady_clock::now();
+    unsigned int tickItems = 0;
+    const vector< MsgDigest >& md =
+        e.msgDigest( processVec()[ tick ]->getBindIndex() );
+    for ( vector< MsgDigest >::const_iterator
+            i = md.begin(); i != md.end(); ++i )
+    {
+        const OpFunc1Base< ProcPtr >* f =
+            i->typedFunc< OpFunc1Base< ProcPtr > >();
+        for ( vector< Eref >::const_iterator
+                j = i->targets.begin(); j != i->targets.end(); ++j )
+        {
+            Element* tgt = j->element();
+            unsigned int items = 1;
+            steady_clock::time_point t0 = steady_clock::now();
+            if ( j->dataIndex() == ALLDATA )
+            {
+                unsigned int start = tgt->localDataStart();
+                items = tgt->numLocalData();
+                for ( unsigned int k = start; k < start + items; ++k )
+                    f->op( Eref( tgt, k ), &info_ );
+            }
+            else
+            {
+                f->op( *j, &info_ );
+            }
+            profile_.addCall( tgt,
+                    duration< double >( steady_clock::now() - t0 ).count(),
+                    items );
+            tickItems += items;
+        }
+    }
+    profile_.addTick( tick,
+            duration< double >( steady_clock::now() - tickStart ).count(),
+            tickItems );
+}
+
 void Clock::handleStep( const Eref& e, unsigned long numSteps )
 {
     numSteps *= stride_;
@@ -770,7 +1009,10 @@ void Clock::handleStep( const Eref& e, unsigned long numSteps )
             if ( endStep % *j == 0 )
             {
                 info_.dt = *j * dt_;
-                processVec()[*k]->send( e, &info_ );
+                if ( doProfile_ )
+                    profiledSend( e, *k );
+                else
+                    processVec()[*k]->send( e, &info_ );
             }
             ++k;
         }
@@ -813,6 +1055,7 @@ void Clock::handleReinit( const Eref& e )
     currentTime_ = 0.0;
     currentStep_ = 0;
     nSteps_ = 0;
+    profile_.clear();
     buildTicks( e );
     doingReinit_ = true;
     // Curr time is end of current step.
@@ -831,6 +1074,40 @@ void Clock::handleReinit( const Eref& e )
     doingReinit_ = false;
 }
 
+void Clock::saveState( CheckpointWriter& w ) const
+{
+    w.put( dt_ );
+    w.putVec( ticks_ );
+    w.put( currentTime_ );
+    w.put( currentStep_ );
+}
+
+bool Clock::loadState( CheckpointReader& r )
+{
+    double dt = r.get< double >();
+    vector< unsigned int > ticks;
+    r.getVec( ticks );
+    double currentTime = r.get< double >();
+    unsigned long currentStep = r.get< unsigned long >();
+    if ( !r.good() )
+        return false;
+    if ( isRunning_ || doingReinit_ )
+    {
+        cout << "Clock::loadState: Warning: simulation in progress.\n";
+        return false;
+    }
+    if ( dt != dt_ || ticks != ticks_ )
+    {
+        cout << "Clock::loadState: Warning: the clock ticks differ from "
+             "those in the checkpoint.\n";
+        return false;
+    }
+    currentTime_ = info_.currTime = currentTime;
+    currentStep_ = nSteps_ = currentStep;
+    runTime_ = nSteps_ * dt_;
+    return true;
+}
+
 /*
  * Useful function, only I don't need it yet. Was implemented for Dsolve
 double Dsolve::findDt( const Eref& e )
@@ -921,8 +1198,10 @@ void Clock::buildDefaultTick()
     defaultTick_["MarkovChannel"] = 4;
     defaultTick_["SpikeGen"] = 5;
     defaultTick_["HSolve"] = 6;
+    defaultTick_["HSolvePop"] = 6;
     defaultTick_["SpikeStats"] = 7;
     defaultTick_["Table"] = 8;
+    defaultTick_["SolverRecorder"] = 8;
     defaultTick_["TimeTable"] = 8;
     defaultTick_["Dsolve"] = 10;
     defaultTick_["Adaptor"] = 11;
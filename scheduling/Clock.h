@@ -22,6 +22,11 @@
  * The Reinit call goes through all Ticks in order.
  */
 
+#include "ClockProfile.h"
+
+class CheckpointWriter;
+class CheckpointReader;
+
 class Clock
 {
     friend void testClock();
@@ -48,6 +53,18 @@ class Clock
 
     vector< double > getDts() const;
 
+    void setProfile( bool v );
+    bool getProfile() const;
+    vector< double > getProfileTickTime() const;
+    vector< double > getProfileTickCalls() const;
+    vector< double > getProfileTickItems() const;
+    vector< string > getProfileClasses() const;
+    vector< double > getProfileClassTime() const;
+    vector< double > getProfileClassItems() const;
+    vector< ObjId > getProfileObjects() const;
+    vector< double > getProfileObjectTime() const;
+    vector< double > getProfileObjectCalls() const;
+
     //////////////////////////////////////////////////////////
     //  Dest functions
     //////////////////////////////////////////////////////////
@@ -66,6 +83,20 @@ class Clock
     /// dest function for message to trigger reinit.
     void handleReinit( const Eref& e );
 
+    /// Writes the profile totals to a JSON or CSV file.
+    void dumpProfile( string fileName );
+    void clearProfile();
+
+    /// Writes the base dt, ticks, time and step count to a checkpoint.
+    void saveState( CheckpointWriter& w ) const;
+
+    /**
+     * Restores the time and step count from a checkpoint, so that the
+     * next start carries on from there. Fails if the base dt or the
+     * ticks differ from those saved, or if the clock is busy.
+     */
+    bool loadState( CheckpointReader& r );
+
     ///////////////////////////////////////////////////////////////
     // Stuff for new scheduling.
     ///////////////////////////////////////////////////////////////
@@ -122,6 +153,8 @@ class Clock
 
     private:
     void buildTicks( const Eref& e );
+    /// Sends the process call of a tick, timing it into profile_.
+    void profiledSend( const Eref& e, unsigned int tick );
     double runTime_;
     double currentTime_;
     unsigned long nSteps_;
@@ -176,6 +209,12 @@ class Clock
      * over.
      */
     bool notify_;
+
+    /// True when the process calls are to be timed.
+    bool doProfile_;
+
+    /// Time spent in each tick and in each object.
+    ClockProfile profile_;
 };
 
 #endif // _CLOCK_H
@@ -0,0 +1,236 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2024 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include <fstream>
+#include <algorithm>
+#include "../basecode/header.h"
+#include "ClockProfile.h"
+
+ClockProfile::ClockProfile()
+{
+    ;
+}
+
+void ClockProfile::clear()
+{
+    ticks_.clear();
+    objects_.clear();
+    className_.clear();
+    path_.clear();
+}
+
+void ClockProfile::addTick( unsigned int tick, double time,
+                            unsigned int items )
+{
+    if ( tick >= ticks_.size() )
+        ticks_.resize( tick + 1 );
+    ProfileStat& s = ticks_[ tick ];
+    s.time += time;
+    s.calls += 1.0;
+    s.items += items;
+}
+
+void ClockProfile::addCall( const Element* e, double time,
+                            unsigned int items )
+{
+    unsigned int i = e->id().value();
+    if ( i >= objects_.size() )
+    {
+        objects_.resize( i + 1 );
+        className_.resize( i + 1 );
+        path_.resize( i + 1 );
+    }
+    ProfileStat& s = objects_[ i ];
+    if ( s.calls == 0.0 )
+    {
+        className_[ i ] = e->cinfo()->name();
+        path_[ i ] = e->id().path();
+    }
+    s.time += time;
+    s.calls += 1.0;
+    s.items += items;
+}
+
+const vector< ProfileStat >& ClockProfile::ticks() const
+{
+    return ticks_;
+}
+
+static bool laterTime( const pair< double, unsigned int >& a,
+                       const pair< double, unsigned int >& b )
+{
+    return a.first > b.first;
+}
+
+/// Order in which to list the entries of stats, biggest time first.
+static vector< unsigned int > byTime( const vector< ProfileStat >& stats )
+{
+    vector< pair< double, unsigned int > > order;
+    for ( unsigned int i = 0; i < stats.size(); ++i )
+        if ( stats[i].calls > 0.0 )
+            order.push_back( make_pair( stats[i].time, i ) );
+    stable_sort( order.begin(), order.end(), laterTime );
+    vector< unsigned int > ret;
+    for ( unsigned int i = 0; i < order.size(); ++i )
+        ret.push_back( order[i].second );
+    return ret;
+}
+
+void ClockProfile::byClass( vector< string >& names,
+                            vector< ProfileStat >& stats ) const
+{
+    map< string, unsigned int > index;
+    vector< string > allNames;
+    vector< ProfileStat > all;
+    for ( unsigned int i = 0; i < objects_.size(); ++i )
+    {
+        if ( objects_[i].calls == 0.0 )
+            continue;
+        map< string, unsigned int >::iterator k =
+            index.find( className_[i] );
+        if ( k == index.end() )
+        {
+            k = index.insert(
+                    make_pair( className_[i], all.size() ) ).first;
+            allNames.push_back( className_[i] );
+            all.push_back( ProfileStat() );
+        }
+        ProfileStat& s = all[ k->second ];
+        s.time += objects_[i].time;
+        s.calls += objects_[i].calls;
+        s.items += objects_[i].items;
+    }
+    names.clear();
+    stats.clear();
+    vector< unsigned int > order = byTime( all );
+    for ( unsigned int i = 0; i < order.size(); ++i )
+    {
+        names.push_back( allNames[ order[i] ] );
+        stats.push_back( all[ order[i] ] );
+    }
+}
+
+void ClockProfile::byObject( vector< Id >& ids,
+                             vector< ProfileStat >& stats ) const
+{
+    ids.clear();
+    stats.clear();
+    vector< unsigned int > order = byTime( objects_ );
+    for ( unsigned int i = 0; i < order.size(); ++i )
+    {
+        ids.push_back( Id( order[i] ) );
+        stats.push_back( objects_[ order[i] ] );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Output
+///////////////////////////////////////////////////////////////////////////
+
+static string jsonString( const string& s )
+{
+    string ret = "\"";
+    for ( string::const_iterator i = s.begin(); i != s.end(); ++i )
+    {
+        if ( *i == '"' || *i == '\\' )
+            ret += '\\';
+        ret += *i;
+    }
+    return ret + "\"";
+}
+
+static void jsonStat( ostream& os, const ProfileStat& s )
+{
+    os << "\"time\": " << s.time << ", \"calls\": " << s.calls <<
+       ", \"items\": " << s.items << "}";
+}
+
+bool ClockProfile::writeJson( ostream& os,
+                              const vector< double >& dts ) const
+{
+    os << "{\n  \"ticks\": [";
+    const char* sep = "\n";
+    for ( unsigned int i = 0; i < ticks_.size(); ++i )
+    {
+        if ( ticks_[i].calls == 0.0 )
+            continue;
+        os << sep << "    {\"tick\": " << i << ", \"dt\": " <<
+           ( i < dts.size() ? dts[i] : 0.0 ) << ", ";
+        jsonStat( os, ticks_[i] );
+        sep = ",\n";
+    }
+    os << "\n  ],\n  \"classes\": [";
+    vector< string > names;
+    vector< ProfileStat > stats;
+    byClass( names, stats );
+    sep = "\n";
+    for ( unsigned int i = 0; i < names.size(); ++i )
+    {
+        os << sep << "    {\"class\": " << jsonString( names[i] ) << ", ";
+        jsonStat( os, stats[i] );
+        sep = ",\n";
+    }
+    os << "\n  ],\n  \"objects\": [";
+    sep = "\n";
+    vector< unsigned int > order = byTime( objects_ );
+    for ( unsigned int i = 0; i < order.size(); ++i )
+    {
+        unsigned int k = order[i];
+        os << sep << "    {\"path\": " << jsonString( path_[k] ) <<
+           ", \"class\": " << jsonString( className_[k] ) << ", ";
+        jsonStat( os, objects_[k] );
+        sep = ",\n";
+    }
+    os << "\n  ]\n}\n";
+    return os.good();
+}
+
+bool ClockProfile::writeCsv( ostream& os,
+                             const vector< double >& dts ) const
+{
+    os << "kind,name,class,dt,time,calls,items\n";
+    for ( unsigned int i = 0; i < ticks_.size(); ++i )
+    {
+        const ProfileStat& s = ticks_[i];
+        if ( s.calls > 0.0 )
+            os << "tick," << i << ",," <<
+               ( i < dts.size() ? dts[i] : 0.0 ) << "," << s.time <<
+               "," << s.calls << "," << s.items << "\n";
+    }
+    vector< string > names;
+    vector< ProfileStat > stats;
+    byClass( names, stats );
+    for ( unsigned int i = 0; i < names.size(); ++i )
+        os << "class," << names[i] << "," << names[i] << ",," <<
+           stats[i].time << "," << stats[i].calls << "," <<
+           stats[i].items << "\n";
+    vector< unsigned int > order = byTime( objects_ );
+    for ( unsigned int i = 0; i < order.size(); ++i )
+    {
+        const ProfileStat& s = objects_[ order[i] ];
+        os << "object," << path_[ order[i] ] << "," <<
+           className_[ order[i] ] << ",," << s.time << "," << s.calls <<
+           "," << s.items << "\n";
+    }
+    return os.good();
+}
+
+bool ClockProfile::write( const string& fileName,
+                          const vector< double >& dts ) const
+{
+    ofstream os( fileName.c_str() );
+    if ( !os.good() )
+        return false;
+    os.precision( 9 );
+    bool isJson = fileName.size() >= 5 &&
+                  fileName.compare( fileName.size() - 5, 5, ".json" ) == 0;
+    bool ret = isJson ? writeJson( os, dts ) : writeCsv( os, dts );
+    os.close();
+    return ret && !os.fail();
+}
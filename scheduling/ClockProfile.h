@@ -0,0 +1,87 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2024 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#ifndef _CLOCK_PROFILE_H
+#define _CLOCK_PROFILE_H
+
+/**
+ * Totals for one tick, class or object. Counts are kept as doubles so
+ * that they do not overflow on long runs.
+ */
+struct ProfileStat
+{
+    ProfileStat()
+        : time( 0.0 ), calls( 0.0 ), items( 0.0 )
+    {;}
+
+    /// Wall-clock time in the process calls, in seconds.
+    double time;
+
+    /// Number of process calls.
+    double calls;
+
+    /// Number of data entries handled by these calls.
+    double items;
+};
+
+/**
+ * Wall-clock time spent in the process calls that the Clock sends out,
+ * gathered when the profile field of the Clock is set. Each tick is
+ * timed as a whole, and within it each target Element. The time of a
+ * target that gets the call on all its entries at once, as most do, is
+ * taken once for the lot, so the cost is two clock reads per target
+ * Element per step. The totals per Element are also summed by class.
+ */
+class ClockProfile
+{
+    public:
+        ClockProfile();
+
+        void clear();
+
+        /// Adds one run of tick, which took time seconds on items entries.
+        void addTick( unsigned int tick, double time, unsigned int items );
+
+        /// Adds one process call to items entries of e.
+        void addCall( const Element* e, double time, unsigned int items );
+
+        /// Totals of each tick, indexed by tick.
+        const vector< ProfileStat >& ticks() const;
+
+        /// Totals of each class, biggest time first.
+        void byClass( vector< string >& names,
+                      vector< ProfileStat >& stats ) const;
+
+        /// Totals of each target Element, biggest time first.
+        void byObject( vector< Id >& ids,
+                       vector< ProfileStat >& stats ) const;
+
+        /**
+         * Writes the totals of ticks, classes and objects to fileName,
+         * as JSON if it ends in .json and as CSV otherwise. dts are the
+         * dt of each tick. Returns false if the file cannot be written.
+         */
+        bool write( const string& fileName,
+                    const vector< double >& dts ) const;
+
+    private:
+        bool writeJson( ostream& os, const vector< double >& dts ) const;
+        bool writeCsv( ostream& os, const vector< double >& dts ) const;
+
+        vector< ProfileStat > ticks_;
+
+        /// Totals of each target, indexed by Id.
+        vector< ProfileStat > objects_;
+
+        /// Class and path of each target, kept in case it is deleted.
+        vector< string > className_;
+        vector< string > path_;
+};
+
+#endif // _CLOCK_PROFILE_H
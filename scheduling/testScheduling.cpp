@@ -180,10 +180,60 @@ void testClockMessaging()
 	cout << "." << flush;
 }
 
+/**
+ * Check that the profile counts the process calls of each tick and of
+ * each object, and is cleared on reinit.
+ */
+void testClockProfile()
+{
+	Shell* shell = reinterpret_cast< Shell* >( Id().eref().data() );
+	Id clock( 1 );
+	Id compts = shell->doCreate( "Compartment", Id(), "profCompts", 10 );
+	shell->doUseClock( "/profCompts", "process", 0 );
+	Field< bool >::set( clock, "profile", true );
+	shell->doReinit();
+	shell->doStart( 1e-3 );
+
+	vector< double > tickCalls =
+		Field< vector< double > >::get( clock, "profileTickCalls" );
+	vector< double > tickItems =
+		Field< vector< double > >::get( clock, "profileTickItems" );
+	assert( tickCalls.size() == Clock::numTicks );
+	assert( tickCalls[0] > 0 );
+	vector< ObjId > objs =
+		Field< vector< ObjId > >::get( clock, "profileObjects" );
+	vector< double > calls =
+		Field< vector< double > >::get( clock, "profileObjectCalls" );
+	vector< double > time =
+		Field< vector< double > >::get( clock, "profileObjectTime" );
+	assert( objs.size() == calls.size() && objs.size() == time.size() );
+	unsigned int i = find( objs.begin(), objs.end(), ObjId( compts ) ) -
+		objs.begin();
+	assert( i < objs.size() );
+	assert( doubleEq( calls[i], tickCalls[0] ) );
+	assert( tickItems[0] >= 10 * tickCalls[0] );
+	for ( unsigned int j = 1; j < time.size(); ++j )
+		assert( time[j] <= time[j - 1] );
+
+	vector< string > classes =
+		Field< vector< string > >::get( clock, "profileClasses" );
+	assert( find( classes.begin(), classes.end(), "Compartment" ) !=
+		classes.end() );
+
+	shell->doReinit();
+	objs = Field< vector< ObjId > >::get( clock, "profileObjects" );
+	assert( objs.size() == 0 );
+
+	Field< bool >::set( clock, "profile", false );
+	shell->doDelete( compts );
+	cout << "." << flush;
+}
+
 void testScheduling()
 {
 	testClockMessaging();
 	testClock();
+	testClockProfile();
 }
 
 void testSchedulingProcess()
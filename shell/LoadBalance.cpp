@@ -0,0 +1,540 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2013 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+/**
+ * This file contains the load balancer, which reassigns the data entries
+ * of LocalDataElements to nodes once the model is built.
+ *
+ * Each data entry is given an estimated cost per process step, from its
+ * class: about one for a compartment or channel, less for an IntFire or
+ * a SynHandler, plus a little per synapse, and voxels times pools for
+ * the chemical solvers. The Elements are then gathered into families
+ * which must go to nodes together:
+ * - Elements with the same numData that are parent and child, unless the
+ *   parent is a plain Neutral container.
+ * - Elements with the same numData that are joined by a SingleMsg or a
+ *   OneToOneMsg which is not a spike msg. This keeps a cell together,
+ *   as its compartments are joined by axial msgs.
+ * Spike msgs, that is, msgs onto Synapses, are not followed. These are
+ * the edges that the balancer tries not to cut.
+ *
+ * A family whose entries are single objects, such as a cell, goes whole
+ * to one node. These are handed out biggest first to the least loaded
+ * node, and then moved one at a time to the node that holds most of
+ * their synaptic partners, as long as that node does not get overloaded.
+ * A family of arrays, such as a population of IntFires and their
+ * SynHandlers, is cut into contiguous blocks of about equal cost, one
+ * per node.
+ * Solvers, zombies and chemical compartments keep their nodes, since
+ * their state cannot be rebuilt from their fields. Their cost still
+ * counts toward the load of their nodes.
+ *
+ * The entries that change node are read off their old nodes field by
+ * field, the new blocks are sent to all nodes, and the fields are
+ * written back onto the new nodes. With the environment variable
+ * MOOSE_SHOW_LOAD_BALANCE set, the loads and cut synapses are printed.
+ */
+
+#include "../basecode/header.h"
+#include "../msg/SingleMsg.h"
+#include "../msg/OneToOneMsg.h"
+#include "../msg/SparseMsg.h"
+#include "Neutral.h"
+#include "Shell.h"
+
+/// Extra cost per synapse, on the entry that owns the synapse.
+static const double SynapseCost = 0.02;
+
+/// Load that a node may go over the mean, to save on cut synapses.
+static const double LoadTolerance = 0.05;
+
+/// Passes of moving cells toward their synaptic partners.
+static const unsigned int NumRefinePasses = 4;
+
+/**
+ * Estimated cost of one data entry of e on each process step, in units
+ * of about one compartment.
+ */
+static double entryCost( const Element* e )
+{
+	const Cinfo* c = e->cinfo();
+	if ( c->isA( "CompartmentBase" ) || c->isA( "ChanBase" ) )
+		return 1.0;
+	if ( c->isA( "CaConcBase" ) || c->isA( "IntFireBase" ) )
+		return 0.5;
+	if ( c->isA( "SynHandlerBase" ) || c->isA( "SpikeGen" ) )
+		return 0.1;
+	if ( c->isA( "Ksolve" ) || c->isA( "Gsolve" ) || c->isA( "Dsolve" ) ) {
+		ObjId oid( e->id(), 0 );
+		return 0.1 * Field< unsigned int >::get( oid, "numAllVoxels" ) *
+			Field< unsigned int >::get( oid, "numPools" );
+	}
+	if ( c->name() == "Neutral" )
+		return 0.0;
+	return 0.05;
+}
+
+/**
+ * True if the entries of e must stay where they are.
+ */
+static bool isPinned( const Element* e )
+{
+	const Cinfo* c = e->cinfo();
+	const string& name = c->name();
+	return name.compare( 0, 6, "Zombie" ) == 0 ||
+		c->isA( "HSolve" ) || c->isA( "Ksolve" ) || c->isA( "Gsolve" ) ||
+		c->isA( "Dsolve" ) || c->isA( "Stoich" ) || c->isA( "ChemCompt" );
+}
+
+/// A synapse, from entry srcIndex of family src to tgtIndex of tgt.
+struct SpikeEdge
+{
+	unsigned int src;
+	unsigned int srcIndex;
+	unsigned int tgt;
+	unsigned int tgtIndex;
+};
+
+/// A field to be carried over to the new node of an entry.
+struct SavedField
+{
+	ObjId oid;
+	string field;
+	string rtti;
+	double value;
+	vector< double > vec;
+	string str;
+};
+
+static unsigned int findFamily( vector< unsigned int >& family,
+		unsigned int i )
+{
+	while ( family[i] != i ) {
+		family[i] = family[ family[i] ];
+		i = family[i];
+	}
+	return i;
+}
+
+/// Node that holds entry i of a family with the given block starts.
+static unsigned int nodeOf( const vector< unsigned int >& starts,
+		unsigned int i )
+{
+	return upper_bound( starts.begin(), starts.end() - 1, i ) -
+		starts.begin() - 1;
+}
+
+/// Current block starts of e, as for LocalDataElement::setNodeStart.
+static vector< unsigned int > currentStarts( const Element* e )
+{
+	vector< unsigned int > ret( Shell::numNodes() + 1, e->numData() );
+	for ( unsigned int i = 0; i < Shell::numNodes(); ++i )
+		ret[i] = e->startDataIndex( i );
+	ret[0] = 0;
+	return ret;
+}
+
+/**
+ * Cuts n entries with costs w into numNodes contiguous blocks of about
+ * equal cost. Returns the block starts.
+ */
+static vector< unsigned int > sliceByCost( vector< double > w )
+{
+	unsigned int numNodes = Shell::numNodes();
+	vector< unsigned int > ret( numNodes + 1, w.size() );
+	double total = 0.0;
+	for ( unsigned int i = 0; i < w.size(); ++i )
+		total += w[i];
+	if ( total <= 0.0 ) { // Nothing to go by, so cut into equal blocks.
+		w.assign( w.size(), 1.0 );
+		total = w.size();
+	}
+	ret[0] = 0;
+	double sum = 0.0;
+	unsigned int node = 1;
+	for ( unsigned int i = 0; i < w.size() && node < numNodes; ++i ) {
+		// Cut before entry i if that is closer to the target than after.
+		double target = total * node / numNodes;
+		while ( node < numNodes && sum + w[i] / 2.0 >= target ) {
+			ret[ node++ ] = i;
+			target = total * node / numNodes;
+		}
+		sum += w[i];
+	}
+	return ret;
+}
+
+/**
+ * Reads the value fields of oid that can be written back, other than
+ * those of Neutral. Doubles are carried as doubles, since the string
+ * conversion would round them.
+ */
+static void saveFields( ObjId oid, vector< SavedField >& ret )
+{
+	const Cinfo* c = oid.element()->cinfo();
+	const Cinfo* neutral = Neutral::initCinfo();
+	for ( unsigned int i = 0; i < c->getNumValueFinfo(); ++i ) {
+		const Finfo* f = c->getValueFinfo( i );
+		if ( f->innerDest().size() < 2 || neutral->findFinfo( f->name() ) )
+			continue;
+		SavedField sf;
+		sf.oid = oid;
+		sf.field = f->name();
+		sf.rtti = f->rttiType();
+		sf.value = 0.0;
+		if ( sf.rtti == "double" )
+			sf.value = Field< double >::get( oid, sf.field );
+		else if ( sf.rtti == "vector<double>" )
+			sf.vec = Field< vector< double > >::get( oid, sf.field );
+		else if ( !SetGet::strGet( oid, sf.field, sf.str ) )
+			continue;
+		ret.push_back( sf );
+	}
+}
+
+static void restoreFields( const vector< SavedField >& saved )
+{
+	for ( vector< SavedField >::const_iterator
+			i = saved.begin(); i != saved.end(); ++i ) {
+		if ( i->field == "numField" )
+			Field< unsigned int >::set( i->oid, i->field, i->value );
+		else if ( i->rtti == "double" )
+			Field< double >::set( i->oid, i->field, i->value );
+		else if ( i->rtti == "vector<double>" )
+			Field< vector< double > >::set( i->oid, i->field, i->vec );
+		else
+			SetGet::strSet( i->oid, i->field, i->str );
+	}
+}
+
+/**
+ * Saves entry i of e, and the fields of its FieldElements, such as its
+ * synapses. The entry is made afresh on its new node, so the number of
+ * fields goes first, to make room for them.
+ */
+static void saveEntry( Element* e, unsigned int i,
+		vector< SavedField >& ret )
+{
+	saveFields( ObjId( e->id(), i ), ret );
+	vector< Id > kids;
+	Neutral::children( Eref( e, 0 ), kids );
+	for ( vector< Id >::iterator k = kids.begin(); k != kids.end(); ++k ) {
+		if ( !k->element()->hasFields() )
+			continue;
+		unsigned int n = Field< unsigned int >::get(
+				ObjId( *k, i ), "numField" );
+		SavedField sf;
+		sf.oid = ObjId( *k, i );
+		sf.field = "numField";
+		sf.rtti = "unsigned int";
+		sf.value = n;
+		ret.push_back( sf );
+		for ( unsigned int j = 0; j < n; ++j )
+			saveFields( ObjId( *k, i, j ), ret );
+	}
+}
+
+void Shell::doLoadBalance()
+{
+	unsigned int numNodes = Shell::numNodes();
+
+	// The LocalDataElements, apart from FieldElements, which go with
+	// their parents. slot maps an Id value to its index in elms.
+	vector< Element* > elms;
+	vector< int > slot( Id::numIds(), -1 );
+	for ( unsigned int i = 0; i < Id::numIds(); ++i ) {
+		Element* e = Id( i ).element();
+		if ( e && dynamic_cast< LocalDataElement* >( e ) &&
+				e->numData() > 0 ) {
+			slot[i] = elms.size();
+			elms.push_back( e );
+		}
+	}
+	vector< unsigned int > family( elms.size() );
+	for ( unsigned int i = 0; i < elms.size(); ++i )
+		family[i] = i;
+
+	// Parents and children go together, unless the parent is just a
+	// container.
+	for ( unsigned int i = 0; i < elms.size(); ++i ) {
+		Id pa = Neutral::parent( ObjId( elms[i]->id() ) ).id;
+		int j = slot[ pa.value() ];
+		if ( j >= 0 && elms[j]->cinfo()->name() != "Neutral" &&
+				elms[j]->numData() == elms[i]->numData() )
+			family[ findFamily( family, i ) ] = findFamily( family, j );
+	}
+
+	// Go through the msgs, each from its e1. Spike msgs give edges, the
+	// rest join families.
+	vector< SpikeEdge > edges;
+	for ( unsigned int i = 0; i < Id::numIds(); ++i ) {
+		Element* e = Id( i ).element();
+		if ( !e )
+			continue;
+		const vector< ObjId >& mids = e->msgIn();
+		for ( vector< ObjId >::const_iterator
+				m = mids.begin(); m != mids.end(); ++m ) {
+			const Msg* msg = Msg::getMsg( *m );
+			if ( !msg || msg->e1() != e )
+				continue;
+			Element* e2 = msg->e2();
+			bool isSpike = e2->cinfo()->isA( "Synapse" );
+			Id id1 = e->id();
+			Id id2 = e2->id();
+			if ( e->hasFields() )
+				id1 = Neutral::parent( ObjId( id1 ) ).id;
+			if ( e2->hasFields() )
+				id2 = Neutral::parent( ObjId( id2 ) ).id;
+			int s1 = slot[ id1.value() ];
+			int s2 = slot[ id2.value() ];
+			if ( s1 < 0 || s2 < 0 )
+				continue;
+			const SparseMsg* sm = dynamic_cast< const SparseMsg* >( msg );
+			const SingleMsg* single = dynamic_cast< const SingleMsg* >( msg );
+			const OneToOneMsg* o2o = dynamic_cast< const OneToOneMsg* >( msg );
+			if ( isSpike ) {
+				SpikeEdge se = { unsigned( s1 ), 0, unsigned( s2 ), 0 };
+				if ( sm ) {
+					SparseMatrix< unsigned int >& mat =
+						const_cast< SparseMsg* >( sm )->getMatrix();
+					for ( unsigned int r = 0; r < mat.nRows(); ++r ) {
+						const unsigned int* entry;
+						const unsigned int* colIndex;
+						unsigned int n = mat.getRow( r, &entry, &colIndex );
+						se.srcIndex = r;
+						for ( unsigned int k = 0; k < n; ++k ) {
+							se.tgtIndex = colIndex[k];
+							edges.push_back( se );
+						}
+					}
+				} else if ( single ) {
+					se.srcIndex = single->getI1();
+					se.tgtIndex = single->getI2();
+					edges.push_back( se );
+				} else if ( o2o ) {
+					unsigned int n = min( e->numData(), e2->numData() );
+					for ( unsigned int k = 0; k < n; ++k ) {
+						se.srcIndex = se.tgtIndex = k;
+						edges.push_back( se );
+					}
+				}
+			} else if ( ( single || o2o ) &&
+					elms[s1]->numData() == elms[s2]->numData() ) {
+				family[ findFamily( family, s1 ) ] = findFamily( family, s2 );
+			}
+		}
+	}
+
+	// Gather the families, and their costs per entry.
+	vector< unsigned int > root( elms.size() );
+	vector< unsigned int > fams; // The root slot of each family.
+	vector< int > famIndex( elms.size(), -1 );
+	for ( unsigned int i = 0; i < elms.size(); ++i ) {
+		root[i] = findFamily( family, i );
+		if ( famIndex[ root[i] ] < 0 ) {
+			famIndex[ root[i] ] = fams.size();
+			fams.push_back( root[i] );
+		}
+	}
+	unsigned int numFams = fams.size();
+	vector< vector< double > > cost( numFams );
+	vector< bool > pinned( numFams, false );
+	vector< vector< unsigned int > > starts( numFams );
+	for ( unsigned int f = 0; f < numFams; ++f ) {
+		cost[f].assign( elms[ fams[f] ]->numData(), 0.0 );
+		starts[f] = currentStarts( elms[ fams[f] ] );
+	}
+	for ( unsigned int i = 0; i < elms.size(); ++i ) {
+		unsigned int f = famIndex[ root[i] ];
+		double c = entryCost( elms[i] );
+		for ( unsigned int k = 0; k < cost[f].size(); ++k )
+			cost[f][k] += c;
+		if ( isPinned( elms[i] ) )
+			pinned[f] = true;
+	}
+	for ( vector< SpikeEdge >::iterator
+			i = edges.begin(); i != edges.end(); ++i ) {
+		i->src = famIndex[ root[ i->src ] ];
+		i->tgt = famIndex[ root[ i->tgt ] ];
+		if ( i->tgtIndex < cost[ i->tgt ].size() )
+			cost[ i->tgt ][ i->tgtIndex ] += SynapseCost;
+	}
+	unsigned int cutBefore = 0;
+	for ( vector< SpikeEdge >::iterator
+			i = edges.begin(); i != edges.end(); ++i )
+		cutBefore += nodeOf( starts[ i->src ], i->srcIndex ) !=
+			nodeOf( starts[ i->tgt ], i->tgtIndex );
+
+	// Pinned families stay put, arrays are cut into equal blocks.
+	vector< double > load( numNodes, 0.0 );
+	vector< unsigned int > units; // Families that go whole to a node.
+	for ( unsigned int f = 0; f < numFams; ++f ) {
+		if ( !pinned[f] && cost[f].size() == 1 ) {
+			units.push_back( f );
+			continue;
+		}
+		if ( !pinned[f] )
+			starts[f] = sliceByCost( cost[f] );
+		for ( unsigned int k = 0; k < cost[f].size(); ++k )
+			load[ nodeOf( starts[f], k ) ] += cost[f][k];
+	}
+
+	// The whole units, biggest first, each to the least loaded node.
+	vector< pair< double, unsigned int > > order;
+	for ( unsigned int u = 0; u < units.size(); ++u )
+		order.push_back( pair< double, unsigned int >(
+					-cost[ units[u] ][0], u ) );
+	sort( order.begin(), order.end() );
+	vector< unsigned int > unitNode( units.size() );
+	for ( unsigned int i = 0; i < order.size(); ++i ) {
+		unsigned int u = order[i].second;
+		unitNode[u] = min_element( load.begin(), load.end() ) - load.begin();
+		load[ unitNode[u] ] += cost[ units[u] ][0];
+	}
+
+	// Then move them toward their synaptic partners. The synapses onto
+	// array entries and pinned families pull toward fixed nodes.
+	vector< int > unitOf( numFams, -1 );
+	for ( unsigned int u = 0; u < units.size(); ++u )
+		unitOf[ units[u] ] = u;
+	vector< vector< double > > fixedPull( units.size(),
+			vector< double >( numNodes, 0.0 ) );
+	vector< vector< unsigned int > > partners( units.size() );
+	for ( vector< SpikeEdge >::iterator
+			i = edges.begin(); i != edges.end(); ++i ) {
+		int us = unitOf[ i->src ];
+		int ut = unitOf[ i->tgt ];
+		if ( us >= 0 && ut >= 0 ) {
+			if ( us != ut ) {
+				partners[us].push_back( ut );
+				partners[ut].push_back( us );
+			}
+		} else if ( us >= 0 ) {
+			fixedPull[us][ nodeOf( starts[ i->tgt ], i->tgtIndex ) ] += 1.0;
+		} else if ( ut >= 0 ) {
+			fixedPull[ut][ nodeOf( starts[ i->src ], i->srcIndex ) ] += 1.0;
+		}
+	}
+	double totalLoad = 0.0;
+	for ( unsigned int n = 0; n < numNodes; ++n )
+		totalLoad += load[n];
+	double limit = max( ( 1.0 + LoadTolerance ) * totalLoad / numNodes,
+			*max_element( load.begin(), load.end() ) );
+	for ( unsigned int pass = 0; pass < NumRefinePasses; ++pass ) {
+		unsigned int numMoved = 0;
+		for ( unsigned int u = 0; u < units.size(); ++u ) {
+			vector< double > pull = fixedPull[u];
+			for ( vector< unsigned int >::iterator
+					p = partners[u].begin(); p != partners[u].end(); ++p )
+				pull[ unitNode[ *p ] ] += 1.0;
+			unsigned int cur = unitNode[u];
+			double c = cost[ units[u] ][0];
+			unsigned int best = cur;
+			for ( unsigned int n = 0; n < numNodes; ++n )
+				if ( pull[n] > pull[best] && load[n] + c <= limit )
+					best = n;
+			if ( best != cur ) {
+				load[cur] -= c;
+				load[best] += c;
+				unitNode[u] = best;
+				++numMoved;
+			}
+		}
+		if ( numMoved == 0 )
+			break;
+	}
+	for ( unsigned int u = 0; u < units.size(); ++u ) {
+		vector< unsigned int >& s = starts[ units[u] ];
+		for ( unsigned int n = 0; n <= numNodes; ++n )
+			s[n] = ( n <= unitNode[u] ) ? 0 : 1;
+	}
+
+	unsigned int cutAfter = 0;
+	for ( vector< SpikeEdge >::iterator
+			i = edges.begin(); i != edges.end(); ++i )
+		cutAfter += nodeOf( starts[ i->src ], i->srcIndex ) !=
+			nodeOf( starts[ i->tgt ], i->tgtIndex );
+
+	// Find what changes, and save the entries that change node.
+	vector< unsigned int > ids;
+	vector< unsigned int > newStarts;
+	vector< SavedField > saved;
+	unsigned int numMovedEntries = 0;
+	for ( unsigned int i = 0; i < elms.size(); ++i ) {
+		const vector< unsigned int >& s = starts[ famIndex[ root[i] ] ];
+		vector< unsigned int > old = currentStarts( elms[i] );
+		if ( s == old )
+			continue;
+		ids.push_back( elms[i]->id().value() );
+		newStarts.insert( newStarts.end(), s.begin(), s.end() );
+		for ( unsigned int k = 0; k < elms[i]->numData(); ++k ) {
+			if ( nodeOf( old, k ) != nodeOf( s, k ) ) {
+				saveEntry( elms[i], k, saved );
+				++numMovedEntries;
+			}
+		}
+	}
+
+	// Send the new blocks out in pieces that fit into the set buffer.
+	const unsigned int chunk = 65536 / ( numNodes + 1 );
+	for ( unsigned int i = 0; i < ids.size(); i += chunk ) {
+		unsigned int end = min( unsigned( ids.size() ), i + chunk );
+		SetGet2< vector< unsigned int >, vector< unsigned int > >::set(
+			ObjId(), "rebalance",
+			vector< unsigned int >( ids.begin() + i, ids.begin() + end ),
+			vector< unsigned int >( newStarts.begin() + i * ( numNodes + 1 ),
+				newStarts.begin() + end * ( numNodes + 1 ) ) );
+	}
+	restoreFields( saved );
+
+	nodeLoad_ = load;
+	if ( getenv( "MOOSE_SHOW_LOAD_BALANCE" ) && Shell::myNode() == 0 ) {
+		cout << "Shell::doLoadBalance: moved " << numMovedEntries <<
+			" entries. Synapses between nodes: " << cutBefore << " -> " <<
+			cutAfter << " of " << edges.size() << ".\n";
+		for ( unsigned int n = 0; n < numNodes; ++n )
+			cout << "	node " << n << ": load " << load[n] << endl;
+	}
+}
+
+void Shell::handleRebalance( vector< unsigned int > ids,
+		vector< unsigned int > nodeStart )
+{
+	unsigned int numStarts = Shell::numNodes() + 1;
+	assert( nodeStart.size() == ids.size() * numStarts );
+	for ( unsigned int i = 0; i < ids.size(); ++i ) {
+		LocalDataElement* e =
+			dynamic_cast< LocalDataElement* >( Id( ids[i] ).element() );
+		assert( e );
+		e->setNodeStart( vector< unsigned int >(
+			nodeStart.begin() + i * numStarts,
+			nodeStart.begin() + ( i + 1 ) * numStarts ) );
+	}
+	// Every msg digest that reaches these entries must be redone.
+	for ( unsigned int i = 0; i < Id::numIds(); ++i ) {
+		Element* e = Id( i ).element();
+		if ( e )
+			e->markRewired();
+	}
+}
+
+void Shell::setBalanceOnReinit( bool v )
+{
+	balanceOnReinit_ = v;
+}
+
+bool Shell::getBalanceOnReinit() const
+{
+	return balanceOnReinit_;
+}
+
+vector< double > Shell::getNodeLoad() const
+{
+	return nodeLoad_;
+}
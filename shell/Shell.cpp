@@ -45,6 +45,9 @@ unsigned int Shell::numAcks_ = 0;
 vector<unsigned int> Shell::acked_(1, 0);
 bool Shell::doReinit_(0);
 bool Shell::isParserIdle_(0);
+bool Shell::balanceOnReinit_(0);
+vector<double> Shell::nodeLoad_;
+bool Shell::checkpointOk_(0);
 double Shell::runtime_(0.0);
 
 const Cinfo* Shell::initCinfo()
@@ -60,6 +63,19 @@ const Cinfo* Shell::initCinfo()
     static ValueFinfo<Shell, ObjId> cwe("cwe", "Current working Element",
                                         &Shell::setCwe, &Shell::getCwe);
 
+    static ValueFinfo<Shell, bool> balanceOnReinit(
+        "balanceOnReinit",
+        "Flag: when running on more than one node, reassign the data "
+        "entries to nodes by estimated cost and spike traffic on every "
+        "reinit. Off by default.",
+        &Shell::setBalanceOnReinit, &Shell::getBalanceOnReinit);
+
+    static ReadOnlyValueFinfo<Shell, vector<double> > nodeLoad(
+        "nodeLoad",
+        "Estimated load on each node, as found by the last load balancing. "
+        "In arbitrary units, roughly one per compartment or channel.",
+        &Shell::getNodeLoad);
+
     // Dest Finfos: Functions handled by Shell
     static DestFinfo handleUseClock(
         "useClock",
@@ -120,9 +136,33 @@ const Cinfo* Shell::initCinfo()
         "setclock", "Assigns clock ticks. Args: tick#, dt",
         new OpFunc2<Shell, unsigned int, double>(&Shell::doSetClock));
 
+    static DestFinfo handleRebalance(
+        "rebalance",
+        "handleRebalance( vector< unsigned int > ids, "
+        "vector< unsigned int > nodeStart ): "
+        "Assigns new blocks of data entries to nodes, for each of the "
+        "Elements in ids. nodeStart holds numNodes + 1 block starts for "
+        "each of them.",
+        new OpFunc2<Shell, vector<unsigned int>, vector<unsigned int> >(
+            &Shell::handleRebalance));
+
+    static DestFinfo saveCheckpoint(
+        "saveCheckpoint",
+        "saveCheckpoint( string fileName ): "
+        "Saves the running state of the simulation on this node.",
+        new EpFunc1<Shell, string>(&Shell::handleSaveCheckpoint));
+
+    static DestFinfo loadCheckpoint(
+        "loadCheckpoint",
+        "loadCheckpoint( string fileName ): "
+        "Restores the running state of the simulation on this node.",
+        new EpFunc1<Shell, string>(&Shell::handleLoadCheckpoint));
+
     static Finfo* shellFinfos[] = {&setclock,   &handleCreate,   &handleDelete,
                                    &handleCopy, &handleMove,     &handleAddMsg,
-                                   &handleQuit, &handleUseClock, };
+                                   &handleQuit, &handleUseClock, &handleRebalance,
+                                   &saveCheckpoint, &loadCheckpoint,
+                                   &balanceOnReinit, &nodeLoad, };
 
     static Dinfo<Shell> d;
     static Cinfo shellCinfo("Shell", Neutral::initCinfo(), shellFinfos,
@@ -322,6 +362,12 @@ void Shell::doStart(double runtime, bool notify)
         pStreamer->cleanUp();
     }
 
+    // Tables streaming to their own files hold back rows in memory and in
+    // the writer's buffers. Hand them over and wait till all the files,
+    // npy headers included, are complete.
+    Table::flushStreams();
+    AsyncWriter::instance().syncAll();
+
     // Print the stats collected by profiling map.
     char* p = getenv("MOOSE_SHOW_SOLVER_PERF");
     if (p != NULL) moose::printSolverProfMap();
@@ -337,6 +383,8 @@ bool isDoingReinit()
 
 void Shell::doReinit()
 {
+    if (balanceOnReinit_ && numNodes() > 1)
+        doLoadBalance();
     Id clockId(1);
     SetGet0::set(clockId, "reinit");
 }
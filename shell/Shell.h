@@ -140,6 +140,15 @@ public:
      */
     void doReinit();
 
+    /**
+     * Reassigns the data entries of the model to nodes, so that each
+     * node has about the same amount of work and few spikes have to
+     * cross between nodes. Does nothing useful on one node, other than
+     * to report the load. Call before reinit, once the model is set up.
+     * See LoadBalance.cpp for how it is done.
+     */
+    void doLoadBalance();
+
     /**
      * Cleanly stops simulation, ready to take up again from where
      * the stop occurred. Waits till current operations are done.
@@ -208,6 +217,30 @@ public:
      */
     void doSaveModel( Id model, const string& fileName, bool qflag = 0 ) const;
 
+    /**
+     * Saves the running state of the simulation to a binary checkpoint
+     * file: the clock, the field values of all objects, and the internal
+     * state of the solvers and of objects that hold state between steps.
+     * On many nodes each node writes its own part to fileName.<node>.
+     * Refuses models with classes whose state is not saved yet, such as
+     * SeqSynHandler, HHChannel2D and MarkovChannel, and names them.
+     * Returns true on success.
+     */
+    bool doSaveCheckpoint( const string& fileName );
+
+    /**
+     * Restores a checkpoint into the model, which must have been built
+     * again in the same way and reinited. The next start then carries
+     * on from the time of the checkpoint, just as the run that saved it
+     * would have. Returns false, and leaves the model alone, if the
+     * model does not match the file.
+     */
+    bool doLoadCheckpoint( const string& fileName );
+
+    /// Handlers for the checkpoint calls, run on every node.
+    void handleSaveCheckpoint( const Eref& e, string fileName );
+    void handleLoadCheckpoint( const Eref& e, string fileName );
+
     /**
      * This function synchronizes fieldDimension on the DataHandler
      * across nodes. Used after function calls that might alter the
@@ -287,6 +320,21 @@ public:
                        NodeBalance nb, unsigned int parentMsgIndex );
     void destroy( const Eref& e, ObjId oid);
 
+    /**
+     * Handles the new assignment of data entries to nodes, on all nodes.
+     * ids holds the Id values of the LocalDataElements that change,
+     * and nodeStart has numNodes + 1 block starts for each of them.
+     */
+    void handleRebalance( vector< unsigned int > ids,
+                          vector< unsigned int > nodeStart );
+
+    /// Flag: run doLoadBalance from doReinit when on many nodes.
+    void setBalanceOnReinit( bool v );
+    bool getBalanceOnReinit() const;
+
+    /// Estimated load on each node, from the last doLoadBalance.
+    vector< double > getNodeLoad() const;
+
     /**
      * Function that does the actual work of creating a new Element.
      * The Class of the Moose objects formed is specified by type.
@@ -393,8 +441,9 @@ public:
     static unsigned int numProcessThreads();
 
     /**
-     * Stub for eventual function to handle load balancing. This must
-     * be called to set up default groups.
+     * Startup hook for load balancing, called on each node before
+     * there is any model. The data entries are balanced later, once
+     * the model is built, by doLoadBalance.
      */
     static void loadBalance();
 
@@ -603,6 +652,15 @@ private:
 
     static bool isParserIdle_;
 
+    /// Flag: run doLoadBalance from doReinit when on many nodes.
+    static bool balanceOnReinit_;
+
+    /// Estimated load on each node, from the last doLoadBalance.
+    static vector< double > nodeLoad_;
+
+    /// Result of the last checkpoint save or load on this node.
+    static bool checkpointOk_;
+
     /// Current working Element
     ObjId cwe_;
 };
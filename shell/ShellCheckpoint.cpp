@@ -0,0 +1,630 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2024 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+/**
+ * This file contains the checkpoint save and restore of a running
+ * simulation.
+ *
+ * A checkpoint is meant to be loaded into a model that has been built
+ * again by the same script and reinited, so the Elements and msgs are
+ * not written out. Instead the file starts with a list of all the
+ * Elements: their Id, path, class, number of entries and number of msgs
+ * coming in. On loading this is checked against the model before
+ * anything is touched, and the load is refused if they differ.
+ *
+ * After the list come
+ * - A schema of the fields saved for each class, also checked first.
+ * - The state of the Clock, so that the next start carries on from the
+ *   time of the checkpoint.
+ * - The state of the global random number generator.
+ * - The writable value fields of every entry of every Element, of types
+ *   double, unsigned int, int, bool and vector< double >. A field is
+ *   only set on loading if it differs from the present value, so that
+ *   fields computed from others, such as the conc of a pool, do not
+ *   upset the ones they come from.
+ * - The hidden state of objects that have registered a checkpoint hook,
+ *   such as the solvers and the synaptic event queues. This is written
+ *   last, so that on loading it overrides anything set through zombie
+ *   fields.
+ * Values are written as they are in memory, so that the run carries on
+ * bit for bit as it would have done without the break.
+ *
+ * Some classes keep state that neither their fields nor a hook cover yet.
+ * A model with any of them is not saved at all, rather than saved in a
+ * form that cannot carry on exactly.
+ *
+ * On many nodes, each node writes and reads its own part of the model
+ * in its own file, fileName.<node>.
+ */
+
+#include <cstring>
+#include <set>
+#include "../basecode/header.h"
+#include "../basecode/Checkpoint.h"
+#include "../randnum/randnum.h"
+#include "Neutral.h"
+#include "Shell.h"
+
+static const char CheckpointMagic[] = "MOOSECKP";
+static const unsigned int CheckpointVersion = 1;
+static const unsigned int EndMarker = ~0U;
+
+/// Types of the fields that are saved. Written out as a byte.
+enum CheckpointFieldType {
+	FieldDouble, FieldUint, FieldInt, FieldBool, FieldVecDouble
+};
+
+struct CheckpointField
+{
+	string name;
+	unsigned char type;
+	const OpFunc* get;
+	const OpFunc* set;
+};
+
+/**
+ * Elements that are left alone: the Shell, the Clock, which is handled on
+ * its own, the PostMaster, and the class and msg Elements, which are
+ * fixed by the code.
+ */
+static bool hasState( const Element* e )
+{
+	const string& c = e->cinfo()->name();
+	if ( c == "Shell" || c == "Clock" || c == "PostMaster" )
+		return false;
+	string path = e->id().path();
+	return !( path.compare( 0, 8, "/classes" ) == 0 ||
+		path.compare( 0, 5, "/Msgs" ) == 0 );
+}
+
+template< class T > static bool typedField( const OpFunc* get,
+	const OpFunc* set )
+{
+	return dynamic_cast< const GetOpFuncBase< T >* >( get ) != 0 &&
+		dynamic_cast< const OpFunc1Base< T >* >( set ) != 0;
+}
+
+/**
+ * The writable value fields of class c, other than those of Neutral, that
+ * are of a type we save. Worked out once per class.
+ */
+static const vector< CheckpointField >& checkpointFields( const Cinfo* c )
+{
+	static map< const Cinfo*, vector< CheckpointField > > fields;
+	map< const Cinfo*, vector< CheckpointField > >::iterator i =
+		fields.find( c );
+	if ( i != fields.end() )
+		return i->second;
+
+	vector< CheckpointField >& ret = fields[ c ];
+	const Cinfo* neutral = Neutral::initCinfo();
+	for ( unsigned int j = 0; j < c->getNumValueFinfo(); ++j ) {
+		const Finfo* f = c->getValueFinfo( j );
+		if ( f->innerDest().size() < 2 || neutral->findFinfo( f->name() ) )
+			continue;
+		const DestFinfo* sf = dynamic_cast< const DestFinfo* >(
+			c->findFinfo( f->innerDest()[0] ) );
+		const DestFinfo* gf = dynamic_cast< const DestFinfo* >(
+			c->findFinfo( f->innerDest()[1] ) );
+		if ( !sf || !gf )
+			continue;
+		CheckpointField cf;
+		cf.name = f->name();
+		cf.set = sf->getOpFunc();
+		cf.get = gf->getOpFunc();
+		if ( typedField< double >( cf.get, cf.set ) )
+			cf.type = FieldDouble;
+		else if ( typedField< unsigned int >( cf.get, cf.set ) )
+			cf.type = FieldUint;
+		else if ( typedField< int >( cf.get, cf.set ) )
+			cf.type = FieldInt;
+		else if ( typedField< bool >( cf.get, cf.set ) )
+			cf.type = FieldBool;
+		else if ( typedField< vector< double > >( cf.get, cf.set ) )
+			cf.type = FieldVecDouble;
+		else
+			continue;
+		ret.push_back( cf );
+	}
+	return ret;
+}
+
+/// The Elements with state, in Id order.
+static vector< Element* > stateElements()
+{
+	vector< Element* > ret;
+	for ( unsigned int i = 0; i < Id::numIds(); ++i ) {
+		Element* e = Id( i ).element();
+		if ( e && hasState( e ) )
+			ret.push_back( e );
+	}
+	return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Structure of the model
+///////////////////////////////////////////////////////////////////////////
+
+static void saveStructure( CheckpointWriter& w )
+{
+	for ( unsigned int i = 0; i < Id::numIds(); ++i ) {
+		Element* e = Id( i ).element();
+		if ( !e )
+			continue;
+		w.put< unsigned int >( i );
+		w.putString( e->id().path() );
+		w.putString( e->cinfo()->name() );
+		w.put< unsigned int >( e->numData() );
+		w.put< unsigned int >( e->numLocalData() );
+		w.put< unsigned int >( e->msgIn().size() );
+	}
+	w.put< unsigned int >( EndMarker );
+}
+
+static bool checkStructure( CheckpointReader& r )
+{
+	unsigned int i = 0;
+	while ( 1 ) {
+		unsigned int id = r.get< unsigned int >();
+		if ( !r.good() )
+			return false;
+		// Elements of the model that are not in the file.
+		for ( ; i < Id::numIds() && i < id; ++i ) {
+			if ( Id( i ).element() ) {
+				cout << "Error: Shell::doLoadCheckpoint: '" <<
+					Id( i ).path() << "' is not in the checkpoint\n";
+				return false;
+			}
+		}
+		if ( id == EndMarker )
+			return true;
+		string path = r.getString();
+		string className = r.getString();
+		unsigned int numData = r.get< unsigned int >();
+		unsigned int numLocalData = r.get< unsigned int >();
+		unsigned int numMsgIn = r.get< unsigned int >();
+		if ( !r.good() )
+			return false;
+		Element* e = ( id < Id::numIds() ) ? Id( id ).element() : 0;
+		if ( !e || e->id().path() != path ) {
+			cout << "Error: Shell::doLoadCheckpoint: '" << path <<
+				"' is not in the model, or has another Id\n";
+			return false;
+		}
+		if ( e->cinfo()->name() != className ||
+				e->numData() != numData ||
+				e->numLocalData() != numLocalData ||
+				e->msgIn().size() != numMsgIn ) {
+			cout << "Error: Shell::doLoadCheckpoint: '" << path <<
+				"' differs in class, size or msgs from the checkpoint\n";
+			return false;
+		}
+		i = id + 1;
+	}
+}
+
+/**
+ * The field schema of each class that has Elements with state, in the
+ * order in which the classes first turn up.
+ */
+static vector< const Cinfo* > stateClasses( const vector< Element* >& elms )
+{
+	vector< const Cinfo* > ret;
+	set< const Cinfo* > seen;
+	for ( vector< Element* >::const_iterator
+			i = elms.begin(); i != elms.end(); ++i ) {
+		const Cinfo* c = ( *i )->cinfo();
+		if ( seen.insert( c ).second && checkpointFields( c ).size() > 0 )
+			ret.push_back( c );
+	}
+	return ret;
+}
+
+static void saveSchema( CheckpointWriter& w, const vector< Element* >& elms )
+{
+	vector< const Cinfo* > classes = stateClasses( elms );
+	w.put< unsigned int >( classes.size() );
+	for ( vector< const Cinfo* >::iterator
+			i = classes.begin(); i != classes.end(); ++i ) {
+		const vector< CheckpointField >& fields = checkpointFields( *i );
+		w.putString( ( *i )->name() );
+		w.put< unsigned int >( fields.size() );
+		for ( vector< CheckpointField >::const_iterator
+				j = fields.begin(); j != fields.end(); ++j ) {
+			w.putString( j->name );
+			w.put< unsigned char >( j->type );
+		}
+	}
+}
+
+static bool checkSchema( CheckpointReader& r, const vector< Element* >& elms )
+{
+	vector< const Cinfo* > classes = stateClasses( elms );
+	unsigned int numClasses = r.get< unsigned int >();
+	if ( !r.good() || numClasses != classes.size() )
+		return false;
+	for ( vector< const Cinfo* >::iterator
+			i = classes.begin(); i != classes.end(); ++i ) {
+		const vector< CheckpointField >& fields = checkpointFields( *i );
+		bool ok = ( r.getString() == ( *i )->name() );
+		ok = ok && ( r.get< unsigned int >() == fields.size() );
+		for ( vector< CheckpointField >::const_iterator
+				j = fields.begin(); ok && j != fields.end(); ++j ) {
+			ok = ( r.getString() == j->name );
+			ok = ok && ( r.get< unsigned char >() == j->type );
+		}
+		if ( !ok || !r.good() ) {
+			cout << "Error: Shell::doLoadCheckpoint: the fields of class " <<
+				( *i )->name() << " differ from those in the checkpoint\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Field values
+///////////////////////////////////////////////////////////////////////////
+
+template< class T > static void saveValue( CheckpointWriter& w,
+	const Eref& er, const OpFunc* get )
+{
+	w.put< T >( static_cast< const GetOpFuncBase< T >* >( get )->
+		returnOp( er ) );
+}
+
+template< class T > static void loadValue( CheckpointReader& r,
+	const Eref& er, const CheckpointField& f )
+{
+	T v = r.get< T >();
+	if ( !r.good() )
+		return;
+	T now = static_cast< const GetOpFuncBase< T >* >( f.get )->returnOp( er );
+	if ( memcmp( &v, &now, sizeof( T ) ) != 0 )
+		static_cast< const OpFunc1Base< T >* >( f.set )->op( er, v );
+}
+
+static void saveVecValue( CheckpointWriter& w,
+	const Eref& er, const OpFunc* get )
+{
+	w.putVec( static_cast< const GetOpFuncBase< vector< double > >* >(
+		get )->returnOp( er ) );
+}
+
+static void loadVecValue( CheckpointReader& r,
+	const Eref& er, const CheckpointField& f )
+{
+	vector< double > v;
+	if ( !r.getVec( v ) )
+		return;
+	vector< double > now = static_cast<
+		const GetOpFuncBase< vector< double > >* >( f.get )->returnOp( er );
+	if ( v.size() != now.size() || ( v.size() > 0 &&
+			memcmp( &v[0], &now[0], sizeof( double ) * v.size() ) != 0 ) )
+		static_cast< const OpFunc1Base< vector< double > >* >( f.set )->
+			op( er, v );
+}
+
+/// The entries of e on this node, and their fields for a FieldElement.
+static void localErefs( Element* e, vector< Eref >& ret )
+{
+	unsigned int start = e->localDataStart();
+	for ( unsigned int i = 0; i < e->numLocalData(); ++i ) {
+		if ( e->hasFields() ) {
+			for ( unsigned int j = 0; j < e->numField( i ); ++j )
+				ret.push_back( Eref( e, start + i, j ) );
+		} else {
+			ret.push_back( Eref( e, start + i ) );
+		}
+	}
+}
+
+/// Number of fields on each local entry of a FieldElement.
+static vector< unsigned int > localNumFields( Element* e )
+{
+	vector< unsigned int > ret( e->numLocalData() );
+	for ( unsigned int i = 0; i < ret.size(); ++i )
+		ret[i] = e->numField( i );
+	return ret;
+}
+
+static void saveFields( CheckpointWriter& w, const vector< Element* >& elms )
+{
+	for ( vector< Element* >::const_iterator
+			i = elms.begin(); i != elms.end(); ++i ) {
+		Element* e = *i;
+		const vector< CheckpointField >& fields =
+			checkpointFields( e->cinfo() );
+		if ( fields.size() == 0 )
+			continue;
+		w.put< unsigned int >( e->id().value() );
+		if ( e->hasFields() )
+			w.putVec( localNumFields( e ) );
+		w.beginBlock();
+		vector< Eref > erefs;
+		localErefs( e, erefs );
+		for ( vector< Eref >::iterator
+				er = erefs.begin(); er != erefs.end(); ++er ) {
+			for ( vector< CheckpointField >::const_iterator
+					f = fields.begin(); f != fields.end(); ++f ) {
+				switch ( f->type ) {
+					case FieldDouble:
+						saveValue< double >( w, *er, f->get );
+						break;
+					case FieldUint:
+						saveValue< unsigned int >( w, *er, f->get );
+						break;
+					case FieldInt:
+						saveValue< int >( w, *er, f->get );
+						break;
+					case FieldBool:
+						saveValue< bool >( w, *er, f->get );
+						break;
+					case FieldVecDouble:
+						saveVecValue( w, *er, f->get );
+						break;
+				}
+			}
+		}
+		w.endBlock();
+	}
+	w.put< unsigned int >( EndMarker );
+}
+
+static bool loadFields( CheckpointReader& r, const vector< Element* >& elms )
+{
+	for ( vector< Element* >::const_iterator
+			i = elms.begin(); i != elms.end(); ++i ) {
+		Element* e = *i;
+		const vector< CheckpointField >& fields =
+			checkpointFields( e->cinfo() );
+		if ( fields.size() == 0 )
+			continue;
+		if ( r.get< unsigned int >() != e->id().value() || !r.good() )
+			return false;
+		if ( e->hasFields() ) {
+			vector< unsigned int > numFields;
+			if ( !r.getVec( numFields ) || numFields != localNumFields( e ) ){
+				cout << "Error: Shell::doLoadCheckpoint: '" <<
+					e->id().path() << "' has a different number of fields\n";
+				return false;
+			}
+		}
+		r.beginBlock();
+		vector< Eref > erefs;
+		localErefs( e, erefs );
+		for ( vector< Eref >::iterator
+				er = erefs.begin(); er != erefs.end() && r.good(); ++er ) {
+			for ( vector< CheckpointField >::const_iterator
+					f = fields.begin(); f != fields.end(); ++f ) {
+				switch ( f->type ) {
+					case FieldDouble:
+						loadValue< double >( r, *er, *f );
+						break;
+					case FieldUint:
+						loadValue< unsigned int >( r, *er, *f );
+						break;
+					case FieldInt:
+						loadValue< int >( r, *er, *f );
+						break;
+					case FieldBool:
+						loadValue< bool >( r, *er, *f );
+						break;
+					case FieldVecDouble:
+						loadVecValue( r, *er, *f );
+						break;
+				}
+			}
+		}
+		if ( !r.endBlock() )
+			return false;
+	}
+	return r.get< unsigned int >() == EndMarker && r.good();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Hidden state
+///////////////////////////////////////////////////////////////////////////
+
+static void saveHooks( CheckpointWriter& w, const vector< Element* >& elms )
+{
+	for ( vector< Element* >::const_iterator
+			i = elms.begin(); i != elms.end(); ++i ) {
+		Element* e = *i;
+		const CheckpointHook* hook = findCheckpointHook( e->cinfo() );
+		if ( !hook || e->hasFields() )
+			continue;
+		w.put< unsigned int >( e->id().value() );
+		unsigned int start = e->localDataStart();
+		for ( unsigned int j = 0; j < e->numLocalData(); ++j ) {
+			w.beginBlock();
+			hook->save( Eref( e, start + j ), w );
+			w.endBlock();
+		}
+	}
+	w.put< unsigned int >( EndMarker );
+}
+
+static bool loadHooks( CheckpointReader& r, const vector< Element* >& elms )
+{
+	for ( vector< Element* >::const_iterator
+			i = elms.begin(); i != elms.end(); ++i ) {
+		Element* e = *i;
+		const CheckpointHook* hook = findCheckpointHook( e->cinfo() );
+		if ( !hook || e->hasFields() )
+			continue;
+		if ( r.get< unsigned int >() != e->id().value() || !r.good() )
+			return false;
+		unsigned int start = e->localDataStart();
+		for ( unsigned int j = 0; j < e->numLocalData(); ++j ) {
+			r.beginBlock();
+			bool ok = hook->load( Eref( e, start + j ), r );
+			if ( !r.endBlock() || !ok ) {
+				cout << "Error: Shell::doLoadCheckpoint: could not restore "
+					"the state of '" << e->id().path() << "'\n";
+				return false;
+			}
+		}
+	}
+	return r.get< unsigned int >() == EndMarker && r.good();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Whole file
+///////////////////////////////////////////////////////////////////////////
+
+/// Classes, and those derived from them, whose hidden state is not saved.
+static const char* const uncoveredClasses[] = {
+	"SeqSynHandler", "HHChannel2D", "HHChannelF2D", "MarkovChannel",
+	"MarkovSolverBase", "MarkovOdeSolver", "MarkovRateTable", "PyRun"
+};
+
+/**
+ * Names the classes in elms that cannot be saved, and returns false if
+ * there are any.
+ */
+static bool checkCovered( const vector< Element* >& elms )
+{
+	set< string > bad;
+	for ( vector< Element* >::const_iterator
+			i = elms.begin(); i != elms.end(); ++i ) {
+		const Cinfo* c = ( *i )->cinfo();
+		for ( unsigned int j = 0; j < sizeof( uncoveredClasses ) /
+				sizeof( uncoveredClasses[0] ); ++j )
+			if ( c->isA( uncoveredClasses[j] ) )
+				bad.insert( c->name() );
+	}
+	if ( bad.empty() )
+		return true;
+	cout << "Error: Shell::doSaveCheckpoint: the state of these classes "
+		"cannot be saved yet:";
+	for ( set< string >::iterator i = bad.begin(); i != bad.end(); ++i )
+		cout << " " << *i;
+	cout << "\n";
+	return false;
+}
+
+static string nodeFileName( const string& fileName )
+{
+	if ( Shell::numNodes() > 1 )
+		return fileName + "." + std::to_string( Shell::myNode() );
+	return fileName;
+}
+
+static bool writeCheckpoint( const string& fileName )
+{
+	vector< Element* > elms = stateElements();
+	if ( !checkCovered( elms ) )
+		return false;
+	CheckpointWriter w( fileName );
+	if ( !w.good() ) {
+		cout << "Error: Shell::doSaveCheckpoint: could not open '" <<
+			fileName << "'\n";
+		return false;
+	}
+	w.write( CheckpointMagic, 8 );
+	w.put< unsigned int >( CheckpointVersion );
+	w.put< unsigned int >( Shell::myNode() );
+	w.put< unsigned int >( Shell::numNodes() );
+	saveStructure( w );
+	saveSchema( w, elms );
+
+	Eref clock = Id( 1 ).eref();
+	w.beginBlock();
+	findCheckpointHook( clock.element()->cinfo() )->save( clock, w );
+	w.endBlock();
+	w.putString( moose::rng.getState() );
+	saveFields( w, elms );
+	saveHooks( w, elms );
+	if ( !w.close() ) {
+		cout << "Error: Shell::doSaveCheckpoint: could not write '" <<
+			fileName << "'\n";
+		return false;
+	}
+	return true;
+}
+
+static bool readCheckpoint( const string& fileName )
+{
+	CheckpointReader r( fileName );
+	if ( !r.good() ) {
+		cout << "Error: Shell::doLoadCheckpoint: could not open '" <<
+			fileName << "'\n";
+		return false;
+	}
+	char magic[8];
+	r.read( magic, 8 );
+	if ( !r.good() || memcmp( magic, CheckpointMagic, 8 ) != 0 ||
+			r.get< unsigned int >() != CheckpointVersion ) {
+		cout << "Error: Shell::doLoadCheckpoint: '" << fileName <<
+			"' is not a checkpoint file of this version\n";
+		return false;
+	}
+	unsigned int node = r.get< unsigned int >();
+	unsigned int numNodes = r.get< unsigned int >();
+	if ( node != Shell::myNode() || numNodes != Shell::numNodes() ) {
+		cout << "Error: Shell::doLoadCheckpoint: '" << fileName <<
+			"' was saved on another set of nodes\n";
+		return false;
+	}
+	vector< Element* > elms = stateElements();
+	if ( !checkStructure( r ) || !checkSchema( r, elms ) )
+		return false;
+
+	// The clock checks that it is set up as it was before it changes.
+	Eref clock = Id( 1 ).eref();
+	r.beginBlock();
+	if ( !findCheckpointHook( clock.element()->cinfo() )->load( clock, r ) ||
+			!r.endBlock() ) {
+		cout << "Error: Shell::doLoadCheckpoint: could not restore the "
+			"clock\n";
+		return false;
+	}
+	moose::rng.setState( r.getString() );
+
+	if ( !loadFields( r, elms ) || !loadHooks( r, elms ) ) {
+		cout << "Error: Shell::doLoadCheckpoint: '" << fileName <<
+			"' is damaged. The model is only partly restored, and "
+			"should be reinited\n";
+		return false;
+	}
+	return true;
+}
+
+void Shell::handleSaveCheckpoint( const Eref& e, string fileName )
+{
+	checkpointOk_ = writeCheckpoint( nodeFileName( fileName ) );
+}
+
+void Shell::handleLoadCheckpoint( const Eref& e, string fileName )
+{
+	checkpointOk_ = readCheckpoint( nodeFileName( fileName ) );
+}
+
+bool Shell::doSaveCheckpoint( const string& fileName )
+{
+	if ( isRunning() ) {
+		cout << "Error: Shell::doSaveCheckpoint: cannot save while the "
+			"simulation is running\n";
+		return false;
+	}
+	SetGet1< string >::set( ObjId(), "saveCheckpoint", fileName );
+	return checkpointOk_;
+}
+
+bool Shell::doLoadCheckpoint( const string& fileName )
+{
+	if ( isRunning() ) {
+		cout << "Error: Shell::doLoadCheckpoint: cannot load while the "
+			"simulation is running\n";
+		return false;
+	}
+	SetGet1< string >::set( ObjId(), "loadCheckpoint", fileName );
+	return checkpointOk_;
+}
@@ -60,11 +60,10 @@ void Shell::setHardware( unsigned int numCores, unsigned int numNodes,
 void Shell::loadBalance()
 {
 	// Need more info here on how to set up groups distributed over
-	// nodes. In fact this will have to be computed _after_ the
-	// simulation is loaded. Will also need quite a bit of juggling between
-	// nodes when things get really scaled up.
+	// nodes. The data entries themselves can only be assigned _after_
+	// the simulation is loaded, which is done by doLoadBalance in
+	// LoadBalance.cpp.
 	//
-	// Note that the messages have to be rebuilt after this call.
 	// Note that this function is called independently on each node.
 }
 
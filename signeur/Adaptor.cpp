@@ -9,6 +9,7 @@
 
 #include "../basecode/header.h"
 #include "Adaptor.h"
+#include "../basecode/Checkpoint.h"
 
 /**
  * This is the adaptor class. It is used in interfacing different kinds
@@ -287,6 +288,8 @@ const Cinfo* Adaptor::initCinfo()
 
 static const Cinfo* adaptorCinfo = Adaptor::initCinfo();
 
+static const bool adaptorHook = addCheckpointHook< Adaptor >( "Adaptor" );
+
 ////////////////////////////////////////////////////////////////////
 // Here we set up Adaptor class functions
 ////////////////////////////////////////////////////////////////////
@@ -379,6 +382,21 @@ void Adaptor::process( const Eref& e, ProcPtr p )
 	output()->send( e, output_ );
 }
 
+void Adaptor::saveState( CheckpointWriter& w ) const
+{
+	w.put( output_ );
+	w.put( sum_ );
+	w.put( counter_ );
+}
+
+bool Adaptor::loadState( CheckpointReader& r )
+{
+	r.get( output_ );
+	r.get( sum_ );
+	r.get( counter_ );
+	return r.good();
+}
+
 void Adaptor::reinit( const Eref& e, ProcPtr p )
 {
 	numRequestOut_ = e.element()->getMsgTargets( e.dataIndex(),
@@ -1,6 +1,9 @@
 #ifndef _Adaptor_h
 #define _Adaptor_h
 
+class CheckpointWriter;
+class CheckpointReader;
+
 /**********************************************************************
 ** This program is part of 'MOOSE', the
 ** Messaging Object Oriented Simulation Environment.
@@ -158,6 +161,11 @@ class Adaptor
 		static void build( const Eref& e, const Qinfo* q);
 		*/
 
+		/// Saves and restores the summed input and the output,
+		/// for checkpoints.
+		void saveState( CheckpointWriter& w ) const;
+		bool loadState( CheckpointReader& r );
+
 		////////////////////////////////////////////////////////////
 		static const Cinfo* initCinfo();
 
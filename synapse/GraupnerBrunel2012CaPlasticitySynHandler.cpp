@@ -15,6 +15,7 @@
 #include "SynEvent.h" // only using the SynEvent class from this
 #include "SynHandlerBase.h"
 #include "GraupnerBrunel2012CaPlasticitySynHandler.h"
+#include "../basecode/Checkpoint.h"
 
 #include <queue>
 
@@ -150,6 +151,15 @@ const Cinfo* GraupnerBrunel2012CaPlasticitySynHandler::initCinfo()
         &GraupnerBrunel2012CaPlasticitySynHandler::getNoisy
     );
 
+    static ValueFinfo< GraupnerBrunel2012CaPlasticitySynHandler, bool > useRingBuffer(
+        "useRingBuffer",
+        "If true, pending pre, delayed pre and post spikes are kept in rings "
+        "of bins, one per time step, instead of in priority queues. "
+        "They are delivered on the same steps. Takes effect fully at reinit.",
+        &GraupnerBrunel2012CaPlasticitySynHandler::setUseRingBuffer,
+        &GraupnerBrunel2012CaPlasticitySynHandler::getUseRingBuffer
+    );
+
     static ValueFinfo< GraupnerBrunel2012CaPlasticitySynHandler, double > noiseSD(
         "noiseSD",
         "Standard deviation of noise added to Ca",
@@ -215,7 +225,8 @@ const Cinfo* GraupnerBrunel2012CaPlasticitySynHandler::initCinfo()
         &weightScale,  // Field
         &noisy,        // Field
         &noiseSD,      // Field
-        &bistable      // Field
+        &bistable,     // Field
+        &useRingBuffer // Field
     };
 
     static Dinfo< GraupnerBrunel2012CaPlasticitySynHandler > dinfo;
@@ -235,6 +246,10 @@ const Cinfo* GraupnerBrunel2012CaPlasticitySynHandler::initCinfo()
 static const Cinfo* GraupnerBrunel2012CaPlasticitySynHandlerCinfo =\
         GraupnerBrunel2012CaPlasticitySynHandler::initCinfo();
 
+static const bool synHandlerHook =
+    addCheckpointHook< GraupnerBrunel2012CaPlasticitySynHandler >(
+        "GraupnerBrunel2012CaPlasticitySynHandler" );
+
 GraupnerBrunel2012CaPlasticitySynHandler::GraupnerBrunel2012CaPlasticitySynHandler()
 {
     Ca_          = 0.0;
@@ -275,6 +290,32 @@ void GraupnerBrunel2012CaPlasticitySynHandler::reinitSeed( void )
     rng_.seed( seed_ );
 }
 
+void GraupnerBrunel2012CaPlasticitySynHandler::saveState(
+        CheckpointWriter& w ) const
+{
+    events_.saveState( w );
+    delayDPreEvents_.saveState( w );
+    postEvents_.saveState( w );
+    w.put( Ca_ );
+    w.put( lastCaUpdateTime_ );
+    std::ostringstream ss;
+    ss << rng_;
+    w.putString( ss.str() );
+}
+
+bool GraupnerBrunel2012CaPlasticitySynHandler::loadState(
+        CheckpointReader& r )
+{
+    if ( !events_.loadState( r ) || !delayDPreEvents_.loadState( r ) ||
+            !postEvents_.loadState( r ) )
+        return false;
+    r.get( Ca_ );
+    r.get( lastCaUpdateTime_ );
+    std::istringstream ss( r.getString() );
+    ss >> rng_;
+    return r.good() && !ss.fail();
+}
+
 GraupnerBrunel2012CaPlasticitySynHandler&
     GraupnerBrunel2012CaPlasticitySynHandler::operator=(
             const GraupnerBrunel2012CaPlasticitySynHandler& ssh
@@ -285,13 +326,10 @@ GraupnerBrunel2012CaPlasticitySynHandler&
             i = synapses_.begin(); i != synapses_.end(); ++i )
         i->setHandler( this );
 
-    // For no apparent reason, priority queues don't have a clear operation.
-    while( !events_.empty() )
-        events_.pop();
-    while( !delayDPreEvents_.empty() )
-        events_.pop();
-    while( !postEvents_.empty() )
-        postEvents_.pop();
+    events_.clear();
+    delayDPreEvents_.clear();
+    postEvents_.clear();
+    setUseRingBuffer( ssh.getUseRingBuffer() );
 
     return *this;
 }
@@ -330,9 +368,7 @@ void GraupnerBrunel2012CaPlasticitySynHandler::addSpike(
 double GraupnerBrunel2012CaPlasticitySynHandler::getTopSpike(
     unsigned int index ) const
 {
-    if ( events_.empty() )
-        return 0.0;
-    return events_.top().time;
+    return events_.topTime();
 }
 
 
@@ -492,10 +528,8 @@ void GraupnerBrunel2012CaPlasticitySynHandler::vProcess( const Eref& e, ProcPtr
     weightFactors wFacs;
 
     // process pre-synaptic spike events for activation, Ca and weight update
-    while( !events_.empty() && events_.top().time <= currTime )
+    events_.popDue( currTime, [&]( const PreSynEvent& currEvent )
     {
-        PreSynEvent currEvent = events_.top();
-
         unsigned int synIndex = currEvent.synIndex;
         // Warning, coder! 'STDPSynapse currSyn = synapses_[synIndex];' is wrong,
         // it creates a new, shallow-copied object.
@@ -532,15 +566,13 @@ void GraupnerBrunel2012CaPlasticitySynHandler::vProcess( const Eref& e, ProcPtr
             wFacs = updateCaWeightFactors( currTime );
             CaFactorsUpdated = true;
         }
-
-        events_.pop();
-    }
+    } );
     if ( activation != 0.0 )
         SynHandlerBase::activationOut()->send( e, activation );
 
     // process delayed pre-synaptic spike events for Ca and weight update
     // delayD after pre-spike accounts for NMDA rise time
-    while( !delayDPreEvents_.empty() && delayDPreEvents_.top().time <= currTime )
+    delayDPreEvents_.popDue( currTime, [&]( const PreSynEvent& )
     {
         // Update Ca, and add CaPre
         // update only once for this time-step if an event occurs
@@ -551,12 +583,10 @@ void GraupnerBrunel2012CaPlasticitySynHandler::vProcess( const Eref& e, ProcPtr
             CaFactorsUpdated = true;
         }
         Ca_ += CaPre_;
-
-        delayDPreEvents_.pop();
-    }
+    } );
 
     // process post-synaptic spike events for Ca and weight update
-    while( !postEvents_.empty() && postEvents_.top().time <= currTime )
+    postEvents_.popDue( currTime, [&]( const PostSynEvent& )
     {
         // update Ca, then add CaPost
         // update only once for this time-step if an event occurs
@@ -567,9 +597,7 @@ void GraupnerBrunel2012CaPlasticitySynHandler::vProcess( const Eref& e, ProcPtr
             CaFactorsUpdated = true;
         }
         Ca_ += CaPost_;
-
-        postEvents_.pop();
-    }
+    } );
 
     // If any event has happened, update all pre-synaptic weights
     // If you want individual Ca for each pre-synapse
@@ -591,13 +619,10 @@ void GraupnerBrunel2012CaPlasticitySynHandler::vProcess( const Eref& e, ProcPtr
 
 void GraupnerBrunel2012CaPlasticitySynHandler::vReinit( const Eref& e, ProcPtr p )
 {
-    // For no apparent reason, priority queues don't have a clear operation.
-    while( !events_.empty() )
-        events_.pop();
-    while( !delayDPreEvents_.empty() )
-        events_.pop();
-    while( !postEvents_.empty() )
-        postEvents_.pop();
+    double maxDelay = maxSynapseDelay( synapses_ );
+    events_.reinit( p->currTime, p->dt, maxDelay );
+    delayDPreEvents_.reinit( p->currTime, p->dt, maxDelay + delayD_ );
+    postEvents_.reinit( p->currTime, p->dt, 0.0 );
     Ca_ = CaInit_;
 }
 
@@ -733,6 +758,18 @@ void GraupnerBrunel2012CaPlasticitySynHandler::setNoisy( const bool v )
     noisy_ = v;
 }
 
+void GraupnerBrunel2012CaPlasticitySynHandler::setUseRingBuffer( bool v )
+{
+    events_.setUseRing( v );
+    delayDPreEvents_.setUseRing( v );
+    postEvents_.setUseRing( v );
+}
+
+bool GraupnerBrunel2012CaPlasticitySynHandler::getUseRingBuffer() const
+{
+    return events_.getUseRing();
+}
+
 bool GraupnerBrunel2012CaPlasticitySynHandler::getNoisy() const
 {
     return noisy_;
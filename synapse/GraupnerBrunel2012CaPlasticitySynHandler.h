@@ -14,9 +14,13 @@
 #include "../randnum/RNG.h"
 
 #include <queue>
+#include "SynEventQueue.h"
 
 using namespace std;
 
+class CheckpointWriter;
+class CheckpointReader;
+
 // see pg 13 of Higgins et al | October 2014 | Volume 10 | Issue 10 | e1003834 | PLOS Comp Biol
 // tP and tD are times spent above potentiation and depression thresholds
 // Depending on tP and tD, I return A,B,C factors for weight update (see pg 13 ref above)
@@ -78,6 +82,8 @@ public:
     bool getNoisy() const;
     void setBistable( bool v );
     bool getBistable() const;
+    void setUseRingBuffer( bool v );
+    bool getUseRingBuffer() const;
 
     void setCaPre( double v );
     double getCaPre() const;
@@ -107,15 +113,19 @@ public:
 
     void reinitSeed( );
 
+    /// Pending events, Ca and the noise generator, for checkpoints.
+    void saveState( CheckpointWriter& w ) const;
+    bool loadState( CheckpointReader& r );
+
     static const Cinfo* initCinfo();
 
 private:
 
     vector< Synapse > synapses_;
 
-    priority_queue< PreSynEvent, vector< PreSynEvent >, CompareSynEvent > events_;
-    priority_queue< PreSynEvent, vector< PreSynEvent >, CompareSynEvent > delayDPreEvents_;
-    priority_queue< PostSynEvent, vector< PostSynEvent >, ComparePostSynEvent > postEvents_;
+    SynEventQueue< PreSynEvent > events_;
+    SynEventQueue< PreSynEvent > delayDPreEvents_;
+    SynEventQueue< PostSynEvent > postEvents_;
 
     double Ca_;
     double CaInit_;
@@ -14,6 +14,7 @@
 #include "SynHandlerBase.h"
 #include "STDPSynapse.h"
 #include "STDPSynHandler.h"
+#include "../basecode/Checkpoint.h"
 
 const Cinfo* STDPSynHandler::initCinfo()
 {
@@ -77,6 +78,16 @@ const Cinfo* STDPSynHandler::initCinfo()
 		&STDPSynHandler::getWeightMin
     );
 
+    static ValueFinfo< STDPSynHandler, bool > useRingBuffer(
+        "useRingBuffer",
+        "Flag: when true, pending pre and post spikes are kept in rings of "
+        "bins, one per time step, spanning the longest synaptic delay, "
+        "instead of in priority queues. They are delivered on the same "
+        "steps. Takes effect fully at reinit.",
+		&STDPSynHandler::setUseRingBuffer,
+		&STDPSynHandler::getUseRingBuffer
+    );
+
     static DestFinfo addPostSpike( "addPostSpike",
         "Handles arriving spike messages from post-synaptic neuron, inserts into postEvent queue.",
         new EpFunc1< STDPSynHandler, double >( &STDPSynHandler::addPostSpike ) );
@@ -110,7 +121,8 @@ const Cinfo* STDPSynHandler::initCinfo()
 		&aPlus0,	        // Field
 		&tauPlus,	        // Field
         &weightMax,         // Field
-        &weightMin          // Field
+        &weightMin,         // Field
+        &useRingBuffer      // Field
 	};
 
 	static Dinfo< STDPSynHandler > dinfo;
@@ -129,6 +141,9 @@ const Cinfo* STDPSynHandler::initCinfo()
 
 static const Cinfo* STDPSynHandlerCinfo = STDPSynHandler::initCinfo();
 
+static const bool STDPSynHandlerHook =
+	addCheckpointHook< STDPSynHandler >( "STDPSynHandler" );
+
 STDPSynHandler::STDPSynHandler()
 {
     aMinus_ = 0.0;
@@ -150,12 +165,9 @@ STDPSynHandler& STDPSynHandler::operator=( const STDPSynHandler& ssh)
 					i = synapses_.begin(); i != synapses_.end(); ++i )
 			i->setHandler( this );
 
-	// For no apparent reason, priority queues don't have a clear operation.
-	while( !events_.empty() )
-		events_.pop();
-
-	while( !postEvents_.empty() )
-		postEvents_.pop();
+	events_.clear();
+	postEvents_.clear();
+	setUseRingBuffer( ssh.getUseRingBuffer() );
 
 	return *this;
 }
@@ -192,9 +204,7 @@ void STDPSynHandler::addSpike(
 
 double STDPSynHandler::getTopSpike( unsigned int index ) const
 {
-	if ( events_.empty() )
-		return 0.0;
-	return events_.top().time;
+	return events_.topTime();
 }
 
 void STDPSynHandler::addPostSpike( const Eref& e, double time )
@@ -207,9 +217,7 @@ void STDPSynHandler::vProcess( const Eref& e, ProcPtr p )
 	double activation = 0.0;
 
     // process pre-synaptic spike events for activation and STDP
-	while( !events_.empty() && events_.top().time <= p->currTime ) {
-        PreSynEvent currEvent = events_.top();
-
+	events_.popDue( p->currTime, [&]( const PreSynEvent& currEvent ) {
         unsigned int synIndex = currEvent.synIndex;
         // Warning, coder! 'STDPSynapse currSyn = synapses_[synIndex];' is wrong,
         // it creates a new, shallow-copied object.
@@ -243,14 +251,12 @@ void STDPSynHandler::vProcess( const Eref& e, ProcPtr p )
         double newWeight = currEvent.weight + aMinus_;
         newWeight = std::max(weightMin_, std::min(newWeight, weightMax_));
         currSynPtr->setWeight( newWeight );
-
-		events_.pop();
-	}
+	} );
 	if ( activation != 0.0 )
 		SynHandlerBase::activationOut()->send( e, activation );
 
     // process post-synaptic spike events for STDP
-	while( !postEvents_.empty() && postEvents_.top().time <= p->currTime ) {
+	postEvents_.popDue( p->currTime, [&]( const PostSynEvent& ) {
         // Add aMinus0 to the aMinus for this synapse
         aMinus_ += aMinus0_;
 
@@ -267,9 +273,7 @@ void STDPSynHandler::vProcess( const Eref& e, ProcPtr p )
             newWeight = std::max(weightMin_, std::min(newWeight, weightMax_));
             currSynPtr->setWeight( newWeight );
         }
-
-		postEvents_.pop();
-	}
+	} );
 
     // modify aPlus and aMinus at every time step
     // Future: I could make this event-driven. Would be faster.
@@ -294,11 +298,9 @@ void STDPSynHandler::vProcess( const Eref& e, ProcPtr p )
 
 void STDPSynHandler::vReinit( const Eref& e, ProcPtr p )
 {
-	// For no apparent reason, priority queues don't have a clear operation.
-	while( !events_.empty() )
-		events_.pop();
-	while( !postEvents_.empty() )
-		postEvents_.pop();
+	events_.reinit( p->currTime, p->dt, maxSynapseDelay( synapses_ ) );
+	// Post spikes come straight from the soma, without delay.
+	postEvents_.reinit( p->currTime, p->dt, 0.0 );
 }
 
 unsigned int STDPSynHandler::addSynapse()
@@ -316,6 +318,28 @@ void STDPSynHandler::dropSynapse( unsigned int msgLookup )
 	synapses_[msgLookup].setWeight( -1.0 );
 }
 
+void STDPSynHandler::setUseRingBuffer( bool v )
+{
+	events_.setUseRing( v );
+	postEvents_.setUseRing( v );
+}
+
+bool STDPSynHandler::getUseRingBuffer() const
+{
+	return events_.getUseRing();
+}
+
+void STDPSynHandler::saveState( CheckpointWriter& w ) const
+{
+	events_.saveState( w );
+	postEvents_.saveState( w );
+}
+
+bool STDPSynHandler::loadState( CheckpointReader& r )
+{
+	return events_.loadState( r ) && postEvents_.loadState( r );
+}
+
 void STDPSynHandler::setAMinus0( const double v )
 {
 	aMinus0_ = v;
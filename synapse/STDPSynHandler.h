@@ -10,6 +10,11 @@
 #ifndef _STDP_SYN_HANDLER_H
 #define _STDP_SYN_HANDLER_H
 
+#include "SynEventQueue.h"
+
+class CheckpointWriter;
+class CheckpointReader;
+
 /*
 class PreSynEvent: public SynEvent
 {
@@ -81,6 +86,13 @@ class STDPSynHandler: public SynHandlerBase
 		////////////////////////////////////////////////////////////////
 		void addPostSpike( const Eref& e, double time );
 
+		void setUseRingBuffer( bool v );
+		bool getUseRingBuffer() const;
+
+		/// Saves and restores the pending events, for checkpoints.
+		void saveState( CheckpointWriter& w ) const;
+		bool loadState( CheckpointReader& r );
+
 		void setAPlus0( double v );
 		double getAPlus0() const;
 		void setTauPlus( double v );
@@ -104,8 +116,8 @@ class STDPSynHandler: public SynHandlerBase
 		static const Cinfo* initCinfo();
 	private:
 		vector< STDPSynapse > synapses_;
-		priority_queue< PreSynEvent, vector< PreSynEvent >, CompareSynEvent > events_;
-		priority_queue< PostSynEvent, vector< PostSynEvent >, ComparePostSynEvent > postEvents_;
+		SynEventQueue< PreSynEvent > events_;
+		SynEventQueue< PostSynEvent > postEvents_;
 		double aMinus_;
 		double aMinus0_;
         double tauMinus_;
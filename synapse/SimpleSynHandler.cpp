@@ -13,6 +13,7 @@
 #include "SynEvent.h"
 #include "SynHandlerBase.h"
 #include "SimpleSynHandler.h"
+#include "../basecode/Checkpoint.h"
 
 const Cinfo* SimpleSynHandler::initCinfo()
 {
@@ -21,12 +22,24 @@ const Cinfo* SimpleSynHandler::initCinfo()
         "The SimpleSynHandler handles simple synapses without plasticity. "
         "It uses a priority queue to manage them."};
 
+    static ValueFinfo<SimpleSynHandler, bool> useRingBuffer(
+        "useRingBuffer",
+        "Flag: when true, pending spikes are kept in a ring of bins, one "
+        "per time step, spanning the longest synaptic delay. This is "
+        "cheaper than the default priority queue when there are many "
+        "spikes in flight, and delivers them on the same steps. "
+        "Takes effect fully at reinit.",
+        &SimpleSynHandler::setUseRingBuffer,
+        &SimpleSynHandler::getUseRingBuffer);
+
     static FieldElementFinfo<SynHandlerBase, Synapse> synFinfo(
         "synapse", "Sets up field Elements for synapse", Synapse::initCinfo(),
         &SynHandlerBase::getSynapse, &SynHandlerBase::setNumSynapses,
         &SynHandlerBase::getNumSynapses);
 
-    static Finfo* synHandlerFinfos[] = {&synFinfo  // FieldElement
+    static Finfo* synHandlerFinfos[] = {
+        &synFinfo,      // FieldElement
+        &useRingBuffer  // Field
     };
 
     static Dinfo<SimpleSynHandler> dinfo;
@@ -40,6 +53,9 @@ const Cinfo* SimpleSynHandler::initCinfo()
 
 static const Cinfo* synHandlerCinfo = SimpleSynHandler::initCinfo();
 
+static const bool synHandlerHook =
+    addCheckpointHook< SimpleSynHandler >( "SimpleSynHandler" );
+
 SimpleSynHandler::SimpleSynHandler()
 {
     ;
@@ -56,8 +72,8 @@ SimpleSynHandler& SimpleSynHandler::operator=(const SimpleSynHandler& ssh)
     for (auto i = synapses_.begin(); i != synapses_.end(); ++i)
         i->setHandler(this);
 
-    // For no apparent reason, priority queues don't have a clear operation.
-    while (!events_.empty()) events_.pop();
+    events_.clear();
+    events_.setUseRing(ssh.events_.getUseRing());
 
     return *this;
 }
@@ -91,31 +107,28 @@ void SimpleSynHandler::addSpike(unsigned int index, double time, double weight)
 
 double SimpleSynHandler::getTopSpike(unsigned int index) const
 {
-    if (events_.empty()) return 0.0;
-    return events_.top().time;
+    return events_.topTime();
 }
 
 void SimpleSynHandler::vProcess(const Eref& e, ProcPtr p)
 {
     double activation = 0.0;
-    while (!events_.empty() && events_.top().time <= p->currTime) {
-        // Send out weight / dt for every spike
-        //      Since it is an impulse active only for one dt,
-        //      need to send it divided by dt.
-        // Can connect activation to SynChan (double exp)
-        //      or to LIF as an impulse to voltage.
-        // See:
-        // http://www.genesis-sim.org/GENESIS/Hyperdoc/Manual-26.html#synchan
-        activation += events_.top().weight / p->dt;
-        events_.pop();
-    }
+    // Send out weight / dt for every spike
+    //      Since it is an impulse active only for one dt,
+    //      need to send it divided by dt.
+    // Can connect activation to SynChan (double exp)
+    //      or to LIF as an impulse to voltage.
+    // See:
+    // http://www.genesis-sim.org/GENESIS/Hyperdoc/Manual-26.html#synchan
+    events_.popDue(p->currTime, [&activation, p](const SynEvent& ev) {
+        activation += ev.weight / p->dt;
+    });
     if (activation != 0.0) SynHandlerBase::activationOut()->send(e, activation);
 }
 
 void SimpleSynHandler::vReinit(const Eref& e, ProcPtr p)
 {
-    // For no apparent reason, priority queues don't have a clear operation.
-    while (!events_.empty()) events_.pop();
+    events_.reinit(p->currTime, p->dt, maxSynapseDelay(synapses_));
 }
 
 unsigned int SimpleSynHandler::addSynapse()
@@ -126,6 +139,26 @@ unsigned int SimpleSynHandler::addSynapse()
     return newSynIndex;
 }
 
+void SimpleSynHandler::setUseRingBuffer(bool v)
+{
+    events_.setUseRing(v);
+}
+
+bool SimpleSynHandler::getUseRingBuffer() const
+{
+    return events_.getUseRing();
+}
+
+void SimpleSynHandler::saveState(CheckpointWriter& w) const
+{
+    events_.saveState(w);
+}
+
+bool SimpleSynHandler::loadState(CheckpointReader& r)
+{
+    return events_.loadState(r);
+}
+
 void SimpleSynHandler::dropSynapse(unsigned int msgLookup)
 {
     assert(msgLookup < synapses_.size());
@@ -11,6 +11,10 @@
 #define _SIMPLE_SYN_HANDLER_H
 
 #include <queue>
+#include "SynEventQueue.h"
+
+class CheckpointWriter;
+class CheckpointReader;
 
 /*
 class SynEvent
@@ -42,7 +46,8 @@ struct CompareSynEvent
 /**
  * This handles simple synapses without plasticity. It uses a priority
  * queue to manage them. This gets inefficient for large numbers of
- * synapses but is pretty robust.
+ * synapses but is pretty robust. With useRingBuffer set it uses a ring
+ * of buckets, one per step, spanning the longest synaptic delay.
  */
 class SimpleSynHandler: public SynHandlerBase
 {
@@ -65,10 +70,16 @@ class SimpleSynHandler: public SynHandlerBase
 		void addSpike( unsigned int index, double time, double weight );
 		double getTopSpike( unsigned int index ) const;
 		////////////////////////////////////////////////////////////////
+		void setUseRingBuffer( bool v );
+		bool getUseRingBuffer() const;
+		/// Saves and restores the pending events, for checkpoints.
+		void saveState( CheckpointWriter& w ) const;
+		bool loadState( CheckpointReader& r );
+		////////////////////////////////////////////////////////////////
 		static const Cinfo* initCinfo();
 	private:
 		vector< Synapse > synapses_;
-		priority_queue< SynEvent, vector< SynEvent >, CompareSynEvent > events_;
+		SynEventQueue< SynEvent > events_;
 };
 
 #endif // _SIMPLE_SYN_HANDLER_H
@@ -0,0 +1,285 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2013 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#ifndef _SYN_EVENT_QUEUE_H
+#define _SYN_EVENT_QUEUE_H
+
+#include <queue>
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Queue of pending synaptic events for a SynHandler. The event class T
+ * needs a 'time' field, which is the time at which it is due.
+ *
+ * By default the events go into a priority queue, as before. With the
+ * ring buffer on, they go into a ring of buckets, one per process step,
+ * as in biophysics/SpikeRingBuffer. Pushing an event is then O(1) and
+ * does not allocate once the buckets have grown. The ring spans the
+ * longest delay, as given to reinit. Events further off than that wait
+ * in the priority queue until they come within reach of the ring.
+ *
+ * The two modes deliver the same events on the same steps. An event is
+ * put into the bucket of the step on which it is due, erring early. At
+ * each step the bucket is sorted by time, and any event in it that is
+ * not yet due is carried to the next bucket. Events with equal times
+ * come out in order of arrival with the ring, and in no set order from
+ * the priority queue.
+ */
+template< class T > class SynEventQueue
+{
+	public:
+		SynEventQueue()
+			: useRing_( false ),
+			dt_( 1.0 ),
+			lastTime_( 0.0 ),
+			cur_( 0 ),
+			numInRing_( 0 ),
+			buckets_( 2 )
+		{;}
+
+		/// Switches between the ring buffer and the priority queue.
+		void setUseRing( bool v )
+		{
+			if ( useRing_ && !v ) {
+				for ( unsigned int i = 0; i < buckets_.size(); ++i ) {
+					for ( unsigned int j = 0; j < buckets_[i].size(); ++j )
+						heap_.push( buckets_[i][j] );
+					buckets_[i].clear();
+				}
+				numInRing_ = 0;
+			}
+			// Going the other way, the events move from the priority
+			// queue into the ring as they come within reach of it.
+			useRing_ = v;
+		}
+
+		bool getUseRing() const
+		{
+			return useRing_;
+		}
+
+		/**
+		 * Clears the queue at time currTime, and sizes the ring for
+		 * process steps of dt and delays up to maxDelay.
+		 */
+		void reinit( double currTime, double dt, double maxDelay )
+		{
+			clear();
+			dt_ = dt;
+			lastTime_ = currTime;
+			if ( !useRing_ || dt <= 0.0 )
+				return;
+			double numSteps = ceil( maxDelay / dt );
+			unsigned int size = 2;
+			if ( numSteps > 0.0 )
+				size += static_cast< unsigned int >(
+						std::min( numSteps, double( MAXBUCKETS ) ) );
+			buckets_.resize( size );
+		}
+
+		void clear()
+		{
+			// For no apparent reason, priority queues don't have a clear
+			// operation.
+			while ( !heap_.empty() )
+				heap_.pop();
+			for ( unsigned int i = 0; i < buckets_.size(); ++i )
+				buckets_[i].clear();
+			cur_ = 0;
+			numInRing_ = 0;
+		}
+
+		bool empty() const
+		{
+			return numInRing_ == 0 && heap_.empty();
+		}
+
+		void push( const T& ev )
+		{
+			if ( useRing_ ) {
+				unsigned int i = bucketOffset( ev.time );
+				if ( i < buckets_.size() ) {
+					buckets_[ ( cur_ + i ) % buckets_.size() ].push_back( ev );
+					++numInRing_;
+					return;
+				}
+			}
+			heap_.push( ev );
+		}
+
+		/// Returns the time of the earliest pending event, 0 if none.
+		double topTime() const
+		{
+			double ret = heap_.empty() ? 0.0 : heap_.top().time;
+			bool found = !heap_.empty();
+			for ( unsigned int i = 0; i < buckets_.size() && numInRing_ > 0; ++i ) {
+				for ( unsigned int j = 0; j < buckets_[i].size(); ++j ) {
+					if ( !found || buckets_[i][j].time < ret ) {
+						ret = buckets_[i][j].time;
+						found = true;
+					}
+				}
+			}
+			return ret;
+		}
+
+		/**
+		 * Calls f( ev ) on every event due by currTime, earliest first,
+		 * and removes it from the queue. With the ring buffer this must
+		 * be called once on every process step.
+		 */
+		template< class F > void popDue( double currTime, F f )
+		{
+			if ( !useRing_ ) {
+				while ( !heap_.empty() && heap_.top().time <= currTime ) {
+					T ev = heap_.top();
+					heap_.pop();
+					f( ev );
+				}
+				return;
+			}
+
+			// Bring the far events that are now within reach into the ring.
+			while ( !heap_.empty() &&
+					bucketOffset( heap_.top().time ) < buckets_.size() ) {
+				const T& ev = heap_.top();
+				buckets_[ ( cur_ + bucketOffset( ev.time ) ) %
+					buckets_.size() ].push_back( ev );
+				++numInRing_;
+				heap_.pop();
+			}
+
+			// Take the current bucket out, so that f may push new events.
+			due_.swap( buckets_[ cur_ ] );
+			cur_ = ( cur_ + 1 ) % buckets_.size();
+			lastTime_ = currTime;
+			// Mostly the bucket is in order already, often all at one time.
+			if ( !std::is_sorted( due_.begin(), due_.end(), earlier ) )
+				std::stable_sort( due_.begin(), due_.end(), earlier );
+			for ( typename vector< T >::const_iterator
+					i = due_.begin(); i != due_.end(); ++i ) {
+				if ( i->time <= currTime ) {
+					--numInRing_;
+					f( *i );
+				} else {
+					buckets_[ cur_ ].push_back( *i );
+				}
+			}
+			due_.clear();
+		}
+
+		/**
+		 * Saves and restores the pending events, for checkpoints. The
+		 * heap goes out in its internal order so that events with equal
+		 * times come out of it as they would have. W and R are
+		 * CheckpointWriter and CheckpointReader.
+		 */
+		template< class W > void saveState( W& w ) const
+		{
+			w.put( useRing_ );
+			w.put( dt_ );
+			w.put( lastTime_ );
+			w.put( cur_ );
+			w.put( numInRing_ );
+			w.template put< unsigned int >( buckets_.size() );
+			for ( unsigned int i = 0; i < buckets_.size(); ++i )
+				w.putVec( buckets_[i] );
+			w.putVec( heap_.container() );
+		}
+
+		template< class R > bool loadState( R& r )
+		{
+			r.get( useRing_ );
+			r.get( dt_ );
+			r.get( lastTime_ );
+			r.get( cur_ );
+			r.get( numInRing_ );
+			unsigned int numBuckets = r.template get< unsigned int >();
+			if ( !r.good() || numBuckets == 0 || cur_ >= numBuckets ) {
+				r.fail();
+				return false;
+			}
+			buckets_.resize( numBuckets );
+			for ( unsigned int i = 0; i < numBuckets; ++i )
+				if ( !r.getVec( buckets_[i] ) )
+					return false;
+			return r.getVec( heap_.container() );
+		}
+
+	private:
+		/**
+		 * Bucket for an event due at time t, counted from the one that
+		 * is emptied on the next process step. Errs early, never late.
+		 */
+		unsigned int bucketOffset( double t ) const
+		{
+			double x = ( t - lastTime_ ) / dt_;
+			if ( x <= 1.0 )
+				return 0;
+			x = ceil( x - 1.0e-6 ) - 1.0;
+			if ( x >= double( MAXBUCKETS ) )
+				return MAXBUCKETS;
+			return static_cast< unsigned int >( x );
+		}
+
+		static bool earlier( const T& a, const T& b )
+		{
+			return a.time < b.time;
+		}
+
+		struct Later
+		{
+			bool operator()( const T& a, const T& b ) const
+			{
+				return a.time > b.time;
+			}
+		};
+
+		/// Priority queue that lets its container be saved as it is.
+		struct Heap: public priority_queue< T, vector< T >, Later >
+		{
+			vector< T >& container()
+			{
+				return this->c;
+			}
+
+			const vector< T >& container() const
+			{
+				return this->c;
+			}
+		};
+
+		/// Longest delay that the ring will span, in steps.
+		static const unsigned int MAXBUCKETS = 1 << 16;
+
+		bool useRing_;
+		double dt_;
+		double lastTime_; /// Time of the last process step.
+		unsigned int cur_; /// Bucket emptied on the next process step.
+		unsigned int numInRing_;
+		vector< vector< T > > buckets_;
+		vector< T > due_;
+		Heap heap_;
+};
+
+/**
+ * Longest delay over a vector of synapses, used to size the ring of a
+ * SynEventQueue.
+ */
+template< class S > double maxSynapseDelay( const vector< S >& synapses )
+{
+	double ret = 0.0;
+	for ( typename vector< S >::const_iterator
+			i = synapses.begin(); i != synapses.end(); ++i )
+		ret = std::max( ret, i->getDelay() );
+	return ret;
+}
+
+#endif // _SYN_EVENT_QUEUE_H
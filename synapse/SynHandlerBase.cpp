@@ -8,6 +8,7 @@
 **********************************************************************/
 
 #include "../basecode/header.h"
+#include "../msg/SparseMsg.h"
 #include "Synapse.h"
 #include "SynHandlerBase.h"
 
@@ -118,11 +119,14 @@ Synapse* SynHandlerBase::getSynapse( unsigned int i )
 
 void SynHandlerBase::process( const Eref& e, ProcPtr p )
 {
+    // Spikes batched on SparseMsgs since the last step.
+    SparseMsg::flushSpikes();
     vProcess( e, p );
 }
 
 void SynHandlerBase::reinit( const Eref& e, ProcPtr p )
 {
+    SparseMsg::clearSpikes();
     vReinit( e, p );
 }
 
@@ -15,9 +15,11 @@
 #include "SynEvent.h"
 #include "SynHandlerBase.h"
 #include "SimpleSynHandler.h"
+#include "SynEventQueue.h"
 #include "RollingMatrix.h"
 #include "SeqSynHandler.h"
 #include "../shell/Shell.h"
+#include "../randnum/randnum.h"
 
 double doCorrel( RollingMatrix& rm, vector< vector< double >> & kernel )
 {
@@ -199,6 +201,87 @@ void testSeqSynapse()
 	shell->doDelete( sid );
 }
 
+// Runs the same stream of spikes through the priority queue and the ring
+// buffer, and checks that each step delivers the same events.
+void testSynEventQueue()
+{
+	const double dt = 1e-4;
+	const double maxDelay = 20 * dt;
+	const unsigned int numSteps = 2000;
+	SynEventQueue< PreSynEvent > heap;
+	SynEventQueue< PreSynEvent > ring;
+	ring.setUseRing( true );
+	heap.reinit( 0.0, dt, maxDelay );
+	ring.reinit( 0.0, dt, maxDelay );
+	moose::mtseed( 5489UL );
+
+	unsigned int numEvents = 0;
+	unsigned int numDelivered = 0;
+	for ( unsigned int step = 1; step <= numSteps; ++step ) {
+		double currTime = dt * step;
+		// Spikes as sent by a source on this step. Most delays are whole
+		// steps, some fall between steps, some are beyond the ring, and
+		// some arrive too late to be delivered on time.
+		unsigned int n = moose::mtrand() * 8;
+		for ( unsigned int i = 0; i < n; ++i ) {
+			double r = moose::mtrand();
+			double delay;
+			if ( r < 0.6 )
+				delay = dt * floor( moose::mtrand() * 20 );
+			else if ( r < 0.85 )
+				delay = maxDelay * moose::mtrand();
+			else if ( r < 0.95 )
+				delay = maxDelay * ( 1.0 + 5.0 * moose::mtrand() );
+			else
+				delay = -dt * moose::mtrand() * 3;
+			PreSynEvent ev( numEvents++, currTime + delay, moose::mtrand() );
+			heap.push( ev );
+			ring.push( ev );
+		}
+		assert( doubleEq( heap.topTime(), ring.topTime() ) );
+
+		vector< PreSynEvent > fromHeap;
+		vector< PreSynEvent > fromRing;
+		heap.popDue( currTime, [&fromHeap]( const PreSynEvent& ev ) {
+			fromHeap.push_back( ev );
+		} );
+		ring.popDue( currTime, [&fromRing]( const PreSynEvent& ev ) {
+			fromRing.push_back( ev );
+		} );
+		assert( fromHeap.size() == fromRing.size() );
+		for ( unsigned int i = 0; i < fromRing.size(); ++i ) {
+			assert( fromRing[i].time <= currTime );
+			assert( fromRing[i].time == fromHeap[i].time );
+			if ( i > 0 )
+				assert( fromRing[i-1].time <= fromRing[i].time );
+		}
+		// Ties may come out of the heap in any order.
+		vector< unsigned int > hi;
+		vector< unsigned int > ri;
+		for ( unsigned int i = 0; i < fromRing.size(); ++i ) {
+			hi.push_back( fromHeap[i].synIndex );
+			ri.push_back( fromRing[i].synIndex );
+		}
+		sort( hi.begin(), hi.end() );
+		sort( ri.begin(), ri.end() );
+		assert( hi == ri );
+		numDelivered += fromRing.size();
+		assert( heap.empty() == ring.empty() );
+
+		// Switch the ring off and on again part way through.
+		if ( step == numSteps / 2 ) {
+			ring.setUseRing( false );
+			ring.setUseRing( true );
+		}
+	}
+	assert( numDelivered > numEvents / 2 );
+
+	ring.reinit( 0.0, dt, maxDelay );
+	assert( ring.empty() );
+	assert( doubleEq( ring.topTime(), 0.0 ) );
+	cout << "." << flush;
+}
+
 #endif // DO_UNIT_TESTS
 
 // This tests stuff without using the messaging.
@@ -207,6 +290,7 @@ void testSynapse()
 #ifdef DO_UNIT_TESTS
 	testRollingMatrix();
 	testRollingMatrix2();
+	testSynEventQueue();
 	testSeqSynapse();
 #endif // DO_UNIT_TESTS
 }
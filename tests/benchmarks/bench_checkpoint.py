@@ -0,0 +1,63 @@
+# -*- coding: utf-8 -*-
+# Time to save and restore a checkpoint of a large model, and a check that
+# the restored run carries on exactly as the original one. A passive
+# compartment array with a spread of injections is run for half the steps,
+# saved, and run for the rest. The model is then reinited, the checkpoint
+# loaded and the second half run again. Reports the file size, the save and
+# load times, and checks that the final Vm is the same bit for bit.
+# Usage: python3 bench_checkpoint.py [numCompartments [numSteps]]
+
+import os
+import sys
+import time
+import tempfile
+import numpy as np
+import moose
+
+DT = 1e-4
+
+def build(n):
+    if moose.exists('/model'):
+        moose.delete('/model')
+    moose.Neutral('/model')
+    compts = moose.Compartment('/model/compts', n)
+    compts.vec.Rm = 1e9
+    compts.vec.Cm = 1e-11
+    compts.vec.Em = -0.065
+    compts.vec.initVm = np.linspace(-0.08, -0.05, n)
+    compts.vec.inject = np.linspace(0, 1e-11, n)
+    for i in range(10):
+        moose.setClock(i, DT)
+    return compts
+
+def main():
+    n = int(sys.argv[1]) if len(sys.argv) > 1 else 100000
+    steps = int(sys.argv[2]) if len(sys.argv) > 2 else 1000
+    fd, path = tempfile.mkstemp(suffix='.ckp')
+    os.close(fd)
+    try:
+        compts = build(n)
+        moose.reinit()
+        moose.start(steps * DT / 2)
+        t0 = time.time()
+        moose.saveCheckpoint(path)
+        tSave = time.time() - t0
+        moose.start(steps * DT / 2)
+        ref = np.array(compts.vec.Vm)
+
+        moose.reinit()
+        t0 = time.time()
+        moose.loadCheckpoint(path)
+        tLoad = time.time() - t0
+        moose.start(steps * DT / 2)
+        vm = np.array(compts.vec.Vm)
+        print('%d compartments, %d steps' % (n, steps))
+        print('file %.1f MB, save %.3f s, load %.3f s' % (
+            os.path.getsize(path) / 1e6, tSave, tLoad))
+        assert np.array_equal(ref, vm), 'restored run differs'
+    finally:
+        os.remove(path)
+        moose.delete('/model')
+
+if __name__ == '__main__':
+    main()
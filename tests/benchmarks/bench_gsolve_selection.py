@@ -0,0 +1,52 @@
+# -*- coding: utf-8 -*-
+# Benchmark of Gsolve reaction selection: linear scan vs propensity tree.
+# Usage: python3 bench_gsolve_selection.py [numReacs ...]
+
+import sys
+import time
+import moose
+
+def makeRing(path, numPools):
+    compt = moose.CubeMesh(path)
+    compt.volume = 1e-18
+    pools = [moose.Pool('%s/a%d' % (path, i)) for i in range(numPools)]
+    for i, p in enumerate(pools):
+        p.nInit = 100
+        r = moose.Reac('%s/r%d' % (path, i))
+        moose.connect(r, 'sub', p, 'reac')
+        moose.connect(r, 'prd', pools[(i + 1) % numPools], 'reac')
+        r.numKf = 0.1
+        r.numKb = 0.05
+    return compt
+
+def bench(method, numReacs, runtime=10.0):
+    moose.seed(1)
+    path = '/bench_%s_%d' % (method, numReacs)
+    compt = makeRing(path, numReacs)
+    gsolve = moose.Gsolve('%s/gsolve' % path)
+    gsolve.selectionMethod = method
+    stoich = moose.Stoich('%s/stoich' % path)
+    stoich.compartment = compt
+    stoich.ksolve = gsolve
+    stoich.reacSystemPath = '%s/##' % path
+    moose.reinit()
+    t0 = time.time()
+    moose.start(runtime)
+    dt = time.time() - t0
+    events = sum(gsolve.numFire[0])
+    moose.delete(compt)
+    return dt, events
+
+def main():
+    sizes = [int(x) for x in sys.argv[1:]] or [100, 500, 1000, 2000, 5000]
+    print('%8s %8s %12s %12s %10s' % ('reacs', 'method', 'events', 'ns/event', 'speedup'))
+    for n in sizes:
+        res = {}
+        for method in ('linear', 'tree'):
+            dt, events = bench(method, n)
+            res[method] = dt / max(events, 1)
+            print('%8d %8s %12d %12.1f' % (n, method, events, 1e9 * res[method]))
+        print('%8d %8s %12s %12s %10.2f' % (n, '', '', '', res['linear'] / res['tree']))
+
+if __name__ == '__main__':
+    main()
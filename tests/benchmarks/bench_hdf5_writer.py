@@ -0,0 +1,78 @@
+# -*- coding: utf-8 -*-
+# Simulation speed while recording many compartments to HDF5. A passive
+# compartment array is recorded every step by an HDF5DataWriter, which
+# writes one dataset per compartment. The buffer is written out by a
+# background thread, so the recorded run should be close to the plain one.
+# Reports steps per second with and without the writer, and checks the
+# dataset of the last compartment.
+# Usage: python3 bench_hdf5_writer.py [numCompts [numSteps [compression]]]
+
+import os
+import sys
+import time
+import tempfile
+import numpy as np
+import moose
+
+DT = 1e-4
+
+def build(n):
+    if moose.exists('/model'):
+        moose.delete('/model')
+    moose.Neutral('/model')
+    compts = moose.Compartment('/model/compts', n)
+    compts.vec.Rm = 1e9
+    compts.vec.Cm = 1e-11
+    compts.vec.Em = -0.065
+    compts.vec.initVm = np.linspace(-0.08, -0.05, n)
+    for i in range(10):
+        moose.setClock(i, DT)
+    return compts
+
+def run(n, steps, path, compression):
+    compts = build(n)
+    if path:
+        w = moose.HDF5DataWriter('/model/writer')
+        w.filename = path
+        w.mode = 2
+        w.compression = compression
+        moose.connect(w, 'requestOut', compts, 'getVm', 'OneToAll')
+        moose.setClock(w.tick, DT)
+    moose.reinit()
+    t0 = time.time()
+    moose.start(steps * DT)
+    if path:
+        w.close()
+    elapsed = time.time() - t0
+    last = moose.element(moose.vec(compts)[n - 1]).Vm
+    moose.delete('/model')
+    return steps / elapsed, last
+
+def main():
+    n = int(sys.argv[1]) if len(sys.argv) > 1 else 10000
+    steps = int(sys.argv[2]) if len(sys.argv) > 2 else 2000
+    compression = int(sys.argv[3]) if len(sys.argv) > 3 else 0
+    fd, path = tempfile.mkstemp(suffix='.h5')
+    os.close(fd)
+    os.remove(path)
+    print('%d compartments, %d steps' % (n, steps))
+    print('%10s %14s' % ('mode', 'steps per s'))
+    try:
+        rate, _ = run(n, steps, None, compression)
+        print('%10s %14.1f' % ('plain', rate))
+        rate, last = run(n, steps, path, compression)
+        print('%10s %14.1f' % ('hdf5', rate))
+        try:
+            import h5py
+        except ImportError:
+            return
+        with h5py.File(path, 'r') as f:
+            ds = f['model[0]/compts[%d]/vm' % (n - 1)]
+            assert abs(ds.shape[0] - steps) <= 1, ds.shape
+            assert np.isclose(ds[-1], last)
+    finally:
+        if os.path.exists(path):
+            os.remove(path)
+
+if __name__ == '__main__':
+    main()
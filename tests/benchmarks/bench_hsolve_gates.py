@@ -0,0 +1,116 @@
+# -*- coding: utf-8 -*-
+# Microbenchmark of the HSolve gate update. The cell is an unbranched cable
+# of 10000 compartments, each with HH Na and K, an A-type K channel, a Ca
+# channel feeding a CaConc pool, and a Ca-dependent K channel, all copied
+# from prototypes as in most models. The same cable is run once with the
+# channels and once without, and the difference in time per step is divided
+# by the number of gates. This counts the gate update as well as the sum of
+# channel currents, which the solver does right after it. Run it with
+# builds from before and after a change to compare.
+# Usage: python3 bench_hsolve_gates.py [numCompartments [runtime]]
+
+import sys
+import time
+import moose
+
+EREST = -0.07
+DT = 50e-6
+
+def gate(chan, xyz):
+    return moose.element('%s/gate%s' % (chan.path, xyz))
+
+def makePrototypes():
+    lib = moose.Neutral('/library')
+    na = moose.HHChannel('/library/Na')
+    na.Ek, na.Xpower, na.Ypower = EREST + 0.115, 3, 1
+    gate(na, 'X').setupAlpha([0.1e6 * (EREST + 0.025), -0.1e6, -1,
+        -(EREST + 0.025), -0.01, 4e3, 0, 0, -EREST, 0.018, 3000, -0.1, 0.05])
+    gate(na, 'Y').setupAlpha([70, 0, 0, -EREST, 0.02,
+        1e3, 0, 1, -(EREST + 0.03), -0.01, 3000, -0.1, 0.05])
+
+    k = moose.HHChannel('/library/K')
+    k.Ek, k.Xpower = EREST - 0.012, 4
+    gate(k, 'X').setupAlpha([1e4 * (0.01 + EREST), -1e4, -1, -(EREST + 0.01),
+        -0.01, 0.125e3, 0, 0, -EREST, 0.08, 3000, -0.1, 0.05])
+
+    ka = moose.HHChannel('/library/KA')
+    ka.Ek, ka.Xpower, ka.Ypower = EREST - 0.012, 3, 1
+    gate(ka, 'X').setupAlpha([2e4 * (0.013 + EREST), -2e4, -1, -(EREST + 0.013),
+        -0.01, 0.2e3, 0, 0, -EREST, 0.05, 3000, -0.1, 0.05])
+    gate(ka, 'Y').setupAlpha([50, 0, 0, -EREST, 0.02,
+        500, 0, 1, -(EREST + 0.03), -0.01, 3000, -0.1, 0.05])
+
+    ca = moose.HHChannel('/library/Ca')
+    ca.Ek, ca.Xpower = 0.128, 2
+    gate(ca, 'X').setupAlpha([1.6e3, 0, 1, -(0.005 + EREST), -0.0139,
+        20e3 * (0.0011 + EREST), 20e3, -1, -(EREST + 0.0011), 0.005,
+        3000, -0.1, 0.05])
+
+    pool = moose.CaConc('/library/Ca_conc')
+    pool.tau, pool.B, pool.CaBasal = 0.013, 1e9, 5e-5
+
+    # alpha = 2e4 * Ca, beta = 10, for Ca in mM.
+    kahp = moose.HHChannel('/library/KAHP')
+    kahp.Ek, kahp.Zpower, kahp.useConcentration = EREST - 0.012, 1, 1
+    gate(kahp, 'Z').setupAlpha([0, 2e4, 0, 0, 1e9,
+        10, 0, 0, 0, 1e9, 3000, 0, 0.01])
+    return lib
+
+def makeCable(numCompts, withChannels):
+    cell = moose.Neutral('/cell')
+    # In S/m^2.
+    gbar = {'Na': 1200, 'K': 360, 'KA': 100, 'Ca': 20, 'KAHP': 50}
+    prev = None
+    for i in range(numCompts):
+        c = moose.Compartment('/cell/c%d' % i)
+        c.Cm, c.Rm, c.Ra = 1e-11, 1e9, 1e6
+        c.Em = c.initVm = EREST
+        if i % 50 == 0:
+            c.inject = 1e-10
+        if prev:
+            moose.connect(prev, 'axial', c, 'raxial')
+        prev = c
+        if not withChannels:
+            continue
+        chans = {}
+        for name in gbar:
+            chan = moose.copy('/library/' + name, c, name)
+            chan.Gbar = gbar[name] * 1e-9    # Area is 1e-9 m^2.
+            moose.connect(c, 'channel', chan, 'channel')
+            chans[name] = chan
+        pool = moose.copy('/library/Ca_conc', c, 'Ca_conc')
+        moose.connect(chans['Ca'], 'IkOut', pool, 'current')
+        moose.connect(pool, 'concOut', chans['KAHP'], 'concen')
+    hsolve = moose.HSolve('/cell/hsolve')
+    hsolve.dt = DT
+    hsolve.caMin, hsolve.caMax = 0.0, 0.01
+    hsolve.target = '/cell'
+    return cell
+
+def secondsPerStep(numCompts, runtime, withChannels):
+    cell = makeCable(numCompts, withChannels)
+    moose.reinit()
+    moose.start(2e-3)    # Warm up.
+    t0 = time.time()
+    moose.start(runtime)
+    elapsed = time.time() - t0
+    moose.delete(cell)
+    return elapsed / (runtime / DT)
+
+def main():
+    numCompts = int(sys.argv[1]) if len(sys.argv) > 1 else 10000
+    runtime = float(sys.argv[2]) if len(sys.argv) > 2 else 0.05
+    for i in range(10):
+        moose.setClock(i, DT)
+    makePrototypes()
+    # Na: m, h. K: n. KA: a, b. Ca: s. KAHP: q.
+    numGates = 7 * numCompts
+    active = secondsPerStep(numCompts, runtime, True)
+    passive = secondsPerStep(numCompts, runtime, False)
+    print('%12s %10s %14s %14s' % ('compartments', 'gates',
+        'us per step', 'ns per gate'))
+    print('%12d %10d %14.1f %14.2f' % (numCompts, numGates, active * 1e6,
+        (active - passive) * 1e9 / numGates))
+
+if __name__ == '__main__':
+    main()
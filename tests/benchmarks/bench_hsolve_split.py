@@ -0,0 +1,90 @@
+# -*- coding: utf-8 -*-
+# Strong scaling of the HSolve matrix solve on one large cell. The cell is
+# read by ReadSwc from an SWC file: either the one given on the command line,
+# or a synthetic one of about 30000 segments, with a soma, a handful of
+# primary dendrites and random branching every few segments, as in a
+# reconstructed pyramidal cell. The cell is passive, so that the time per
+# step is mostly the Hines elimination. It is run with HSolve.numThreads
+# from 1 up, and the voltages are compared with those on one thread.
+# Usage: python3 bench_hsolve_split.py [maxThreads [file.swc|numSegments [runtime]]]
+
+import os
+import sys
+import time
+import random
+import tempfile
+import moose
+
+DT = 50e-6
+
+def writeSwc(fname, numSegs, seed=1):
+    # index type x y z radius parent, in microns.
+    rng = random.Random(seed)
+    lines = ['1 1 0 0 0 10 -1']
+    tips = []
+    for d in range(6):
+        tips.append((1, 10.0 * rng.uniform(-1, 1), 10.0 * rng.uniform(-1, 1),
+            10.0 * rng.uniform(-1, 1), 2.0))
+    i = 1
+    while i < numSegs:
+        k = rng.randrange(len(tips))
+        parent, x, y, z, r = tips[k]
+        i += 1
+        x += 5.0 * rng.uniform(-1, 1)
+        y += 5.0 * rng.uniform(-1, 1)
+        z += 5.0
+        r = max(0.1, 0.995 * r)
+        lines.append('%d 3 %.3f %.3f %.3f %.3f %d' % (i, x, y, z, r, parent))
+        tips[k] = (i, x, y, z, r)
+        if rng.random() < 0.05:
+            tips.append((i, x, y, z, r))
+    with open(fname, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+
+def run(swc, numThreads, runtime):
+    cell = moose.loadModel(swc, '/cell')
+    compts = moose.wildcardFind('/cell/##[ISA=CompartmentBase]')
+    for i, c in enumerate(compts):
+        c.initVm = c.Em - 0.01 * (i % 7) / 7.0
+        if i % 100 == 0:
+            c.inject = 1e-11
+    hsolve = moose.HSolve('/hsolve')
+    hsolve.dt = DT
+    hsolve.numThreads = numThreads
+    hsolve.target = '/cell'
+    moose.reinit()
+    moose.start(2e-3)    # Warm up.
+    t0 = time.time()
+    moose.start(runtime)
+    elapsed = time.time() - t0
+    vm = [c.Vm for c in compts]
+    numSubtrees = hsolve.numSubtrees
+    moose.delete(hsolve)
+    moose.delete(cell)
+    return elapsed / (runtime / DT), numSubtrees, vm
+
+def main():
+    maxThreads = int(sys.argv[1]) if len(sys.argv) > 1 else (os.cpu_count() or 1)
+    source = sys.argv[2] if len(sys.argv) > 2 else '30000'
+    runtime = float(sys.argv[3]) if len(sys.argv) > 3 else 0.02
+    for i in range(10):
+        moose.setClock(i, DT)
+    if source.endswith('.swc'):
+        swc = source
+    else:
+        swc = os.path.join(tempfile.mkdtemp(), 'cell.swc')
+        writeSwc(swc, int(source))
+
+    print('%8s %10s %14s %8s %12s' % ('threads', 'subtrees', 'us per step',
+        'speedup', 'max |dVm|'))
+    t1, vm1 = None, None
+    for n in range(1, maxThreads + 1):
+        t, numSubtrees, vm = run(swc, n, runtime)
+        t1 = t1 or t
+        vm1 = vm1 or vm
+        err = max(abs(a - b) for a, b in zip(vm, vm1))
+        print('%8d %10d %14.1f %8.2f %12.3g' % (n, numSubtrees, t * 1e6,
+            t1 / t, err))
+
+if __name__ == '__main__':
+    main()
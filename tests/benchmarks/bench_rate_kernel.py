@@ -0,0 +1,65 @@
+# -*- coding: utf-8 -*-
+# Benchmark of Ksolve reaction velocity evaluation: flattened rate kernel vs
+# virtual RateTerm calls. Both must give the same trajectory.
+# Usage: python3 bench_rate_kernel.py [numPools ...]
+
+import sys
+import time
+import numpy as np
+import moose
+
+def makeNetwork(path, numPools):
+    """ A ring of reversible first and second order reactions, with an
+    MM enzyme on every fourth pool. """
+    compt = moose.CubeMesh(path)
+    compt.volume = 1e-18
+    pools = [moose.Pool('%s/a%d' % (path, i)) for i in range(numPools)]
+    for i, p in enumerate(pools):
+        p.concInit = 1e-3 * (1 + i % 3)
+        nxt = pools[(i + 1) % numPools]
+        r = moose.Reac('%s/r%d' % (path, i))
+        moose.connect(r, 'sub', p, 'reac')
+        moose.connect(r, 'prd', nxt, 'reac')
+        if i % 2:
+            moose.connect(r, 'sub', pools[(i + 2) % numPools], 'reac')
+            r.Kf = 10.0
+        else:
+            r.Kf = 0.1
+        r.Kb = 0.05
+        if i % 4 == 0:
+            e = moose.MMenz('%s/e%d' % (path, i))
+            moose.connect(p, 'nOut', e, 'enzDest')
+            moose.connect(e, 'sub', nxt, 'reac')
+            moose.connect(e, 'prd', pools[(i + 3) % numPools], 'reac')
+            e.Km = 1e-3
+            e.kcat = 1.0
+    return compt, pools
+
+def bench(useKernel, numPools, runtime=100.0):
+    path = '/bench_%d_%d' % (useKernel, numPools)
+    compt, pools = makeNetwork(path, numPools)
+    ksolve = moose.Ksolve('%s/ksolve' % path)
+    ksolve.useRateKernel = useKernel
+    stoich = moose.Stoich('%s/stoich' % path)
+    stoich.compartment = compt
+    stoich.ksolve = ksolve
+    stoich.reacSystemPath = '%s/##' % path
+    moose.reinit()
+    t0 = time.time()
+    moose.start(runtime)
+    dt = time.time() - t0
+    n = np.array([p.n for p in pools])
+    moose.delete(compt)
+    return dt, n
+
+def main():
+    sizes = [int(x) for x in sys.argv[1:]] or [20, 100, 500, 2000]
+    print('%8s %12s %12s %10s %12s' % ('pools', 'virtual(s)', 'kernel(s)', 'speedup', 'max diff'))
+    for n in sizes:
+        tv, nv = bench(False, n)
+        tk, nk = bench(True, n)
+        print('%8d %12.3f %12.3f %10.2f %12.3g' % (
+            n, tv, tk, tv / tk, np.max(np.abs(nv - nk))))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,100 @@
+# -*- coding: utf-8 -*-
+# Cost of recording many solver-handled objects every step, with one Table
+# per object versus one SolverRecorder. The chemical case is a reaction
+# A <==> B in every voxel of a CylMesh, solved by a Ksolve, recording conc
+# of A in each voxel. The electrical case is a passive cable of
+# compartments solved by HSolve, recording Vm of each. Tables send a get
+# request to each zombie on every step, while the SolverRecorder copies
+# the values out of the solver arrays. Reports microseconds per step for no
+# recording, Tables and the SolverRecorder, and checks that the last
+# recorded values agree.
+# Usage: python3 bench_solver_recorder.py [numObjects [numSteps]]
+
+import sys
+import time
+import numpy as np
+import moose
+
+def buildChem(n):
+    cyl = moose.CylMesh('/model/cyl')
+    cyl.x1 = n * 1e-6
+    cyl.diffLength = 1e-6
+    a = moose.Pool('/model/cyl/A')
+    b = moose.Pool('/model/cyl/B')
+    r = moose.Reac('/model/cyl/r')
+    moose.connect(r, 'sub', a, 'reac')
+    moose.connect(r, 'prd', b, 'reac')
+    r.Kf = 0.1
+    r.Kb = 0.05
+    a.vec.concInit = np.linspace(0.1, 1.0, n)
+    ksolve = moose.Ksolve('/model/cyl/ksolve')
+    stoich = moose.Stoich('/model/cyl/stoich')
+    stoich.compartment = cyl
+    stoich.ksolve = ksolve
+    stoich.reacSystemPath = '/model/cyl/##'
+    return ksolve, [moose.element(x) for x in a.vec], 'getConc', 1e-3
+
+def buildElec(n):
+    compts = []
+    for i in range(n):
+        c = moose.Compartment('/model/cable/c%d' % i if i else '/model/cable')
+        c.Rm = 1e9
+        c.Ra = 1e6
+        c.Cm = 1e-11
+        c.Em = -0.065
+        c.initVm = -0.065 + 0.01 * (i % 5) / 5.0
+        if compts:
+            moose.connect(compts[-1], 'raxial', c, 'axial')
+        compts.append(c)
+    compts[0].inject = 1e-10
+    hsolve = moose.HSolve('/model/hsolve')
+    hsolve.dt = 50e-6
+    hsolve.target = '/model/cable'
+    return hsolve, compts, 'getVm', 50e-6
+
+def run(build, n, steps, mode):
+    if moose.exists('/model'):
+        moose.delete('/model')
+    moose.Neutral('/model')
+    solver, targets, getter, dt = build(n)
+    for i in range(32):
+        moose.setClock(i, dt)
+    rec = None
+    if mode == 'tables':
+        tabs = [moose.Table('/model/tab%d' % i) for i in range(n)]
+        for t, x in zip(tabs, targets):
+            moose.connect(t, 'requestOut', x, getter)
+    elif mode == 'recorder':
+        rec = moose.SolverRecorder('/model/rec')
+        rec.solver = solver
+        rec.targets = targets
+    moose.reinit()
+    t0 = time.time()
+    moose.start(steps * dt)
+    elapsed = time.time() - t0
+    if mode == 'tables':
+        last = [t.vector[-1] for t in tabs]
+    elif mode == 'recorder':
+        last = [rec.vec[i][-1] for i in range(n)]
+    else:
+        last = None
+    moose.delete('/model')
+    return 1e6 * elapsed / steps, last
+
+def main():
+    n = int(sys.argv[1]) if len(sys.argv) > 1 else 5000
+    steps = int(sys.argv[2]) if len(sys.argv) > 2 else 1000
+    print('%d objects, %d steps' % (n, steps))
+    print('%6s %10s %14s' % ('model', 'mode', 'us per step'))
+    for name, build in [('chem', buildChem), ('elec', buildElec)]:
+        ref = None
+        for mode in ['none', 'tables', 'recorder']:
+            us, last = run(build, n, steps, mode)
+            print('%6s %10s %14.1f' % (name, mode, us))
+            if mode == 'tables':
+                ref = last
+            elif mode == 'recorder':
+                assert np.allclose(ref, last), name
+
+if __name__ == '__main__':
+    main()
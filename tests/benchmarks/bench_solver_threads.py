@@ -0,0 +1,62 @@
+# -*- coding: utf-8 -*-
+# Thread scaling of Ksolve and Gsolve over many cheap voxels, where the cost
+# of dispatching voxels to threads on every tick matters most.
+# Usage: python3 bench_solver_threads.py [maxThreads [numVoxels [numSteps]]]
+
+import os
+import sys
+import time
+import moose
+
+def makeModel(path, numVoxels, solver, numThreads):
+    compt = moose.CylMesh(path)
+    compt.r0 = compt.r1 = 1e-6
+    compt.x1 = numVoxels * 1e-6
+    compt.diffLength = 1e-6
+    a = moose.Pool('%s/A' % path)
+    b = moose.Pool('%s/B' % path)
+    c = moose.Pool('%s/C' % path)
+    for i, (s, p) in enumerate([(a, b), (b, c), (c, a)]):
+        r = moose.Reac('%s/r%d' % (path, i))
+        moose.connect(r, 'sub', s, 'reac')
+        moose.connect(r, 'prd', p, 'reac')
+        r.Kf = 1.0
+        r.Kb = 0.5
+    ksolve = solver('%s/ksolve' % path)
+    ksolve.numThreads = numThreads
+    stoich = moose.Stoich('%s/stoich' % path)
+    stoich.compartment = compt
+    stoich.ksolve = ksolve
+    stoich.reacSystemPath = '%s/##' % path
+    a.vec.concInit = 0.01
+    return compt
+
+def bench(solver, numThreads, numVoxels, numSteps, dt=1e-3):
+    moose.seed(1)
+    path = '/bench_%s_%d' % (solver.__name__, numThreads)
+    compt = makeModel(path, numVoxels, solver, numThreads)
+    for i in range(10):
+        moose.setClock(i, dt)
+    moose.reinit()
+    t0 = time.time()
+    moose.start(numSteps * dt)
+    elapsed = time.time() - t0
+    moose.delete(compt)
+    return elapsed
+
+def main():
+    maxThreads = int(sys.argv[1]) if len(sys.argv) > 1 else (os.cpu_count() or 1)
+    numVoxels = int(sys.argv[2]) if len(sys.argv) > 2 else 2000
+    numSteps = int(sys.argv[3]) if len(sys.argv) > 3 else 2000
+    print('%d voxels, %d steps' % (numVoxels, numSteps))
+    print('%8s %8s %10s %12s %8s' % ('solver', 'threads', 'time(s)', 'us/step', 'speedup'))
+    for solver in (moose.Ksolve, moose.Gsolve):
+        t1 = None
+        for n in range(1, maxThreads + 1):
+            t = bench(solver, n, numVoxels, numSteps)
+            t1 = t1 or t
+            print('%8s %8d %10.3f %12.1f %8.2f' % (
+                solver.__name__, n, t, 1e6 * t / numSteps, t1 / t))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,83 @@
+# -*- coding: utf-8 -*-
+# Spike delivery on a recurrent network of LIF cells, connected by one
+# SparseMsg with setRandomConnectivity, as in most large IF network models.
+# With 10000 cells and a connection probability of 0.01 there are about
+# a million synapses. The network is run with spikes sent to every synapse
+# as they happen, and with SparseMsg.batchSpikes on 1 .. maxThreads
+# threads. Reports the time per step and the synaptic events per second.
+# Usage: python3 bench_sparse_spikes.py [maxThreads [numCells [prob [runtime]]]]
+
+import os
+import sys
+import time
+import numpy as np
+import moose
+
+DT = 1e-4
+
+def makeNetwork(n, prob, batch, nthreads, seed=1234):
+    if moose.exists('/net'):
+        moose.delete('/net')
+    moose.Neutral('/net')
+    cells = moose.LIF('/net/cells', n)
+    syns = moose.SimpleSynHandler('/net/cells/syns', n)
+    moose.connect(syns, 'activationOut', cells, 'activation', 'OneToOne')
+    m = moose.connect(cells, 'spikeOut', moose.vec(syns.path + '/synapse'),
+            'addSpike', 'Sparse')
+    m = moose.element(m)
+    m.setRandomConnectivity(prob, seed)
+    m.batchSpikes = batch
+    m.numThreads = nthreads
+
+    rng = np.random.RandomState(seed)
+    for s in moose.vec(syns):
+        k = s.synapse.num
+        if k > 0:
+            s.synapse.weight = rng.uniform(-0.2e-3, 0.25e-3, k)
+            s.synapse.delay = DT * rng.randint(5, 50, k)
+    cells.vec.Rm = 1e8
+    cells.vec.Cm = 1e-10
+    cells.vec.Em = -0.065
+    cells.vec.vReset = -0.065
+    cells.vec.thresh = -0.05
+    cells.vec.refractoryPeriod = 2e-3
+    cells.vec.initVm = rng.uniform(-0.065, -0.05, n)
+    cells.vec.inject = rng.uniform(1.3e-10, 1.7e-10, n)
+    for i in range(10):
+        moose.setClock(i, DT)
+    return cells, m
+
+def bench(n, prob, batch, nthreads, runtime):
+    cells, m = makeNetwork(n, prob, batch, nthreads)
+    moose.reinit()
+    moose.start(0.01)    # Warm up.
+    numSpikes = 0
+    steps = int(round(runtime / DT))
+    t = 0.0
+    # Count spikes in short chunks, from the cells that fired last.
+    chunk = 1e-3
+    for k in range(int(round(runtime / chunk))):
+        t0 = time.time()
+        moose.start(chunk)
+        t += time.time() - t0
+        last = np.array(cells.vec.lastEventTime)
+        numSpikes += np.sum(last > moose.element('/clock').currentTime - chunk)
+    events = numSpikes * m.numEntries / float(n)
+    return t / steps, events / t, numSpikes
+
+def main():
+    maxThreads = int(sys.argv[1]) if len(sys.argv) > 1 else (os.cpu_count() or 1)
+    n = int(sys.argv[2]) if len(sys.argv) > 2 else 10000
+    prob = float(sys.argv[3]) if len(sys.argv) > 3 else 0.01
+    runtime = float(sys.argv[4]) if len(sys.argv) > 4 else 0.1
+    print('%d cells, p = %g' % (n, prob))
+    print('%8s %8s %12s %16s %10s' % ('batch', 'threads', 'us per step',
+        'events per s', 'spikes'))
+    for batch, nthreads in [(False, 1)] + [(True, k)
+            for k in range(1, maxThreads + 1)]:
+        t, rate, numSpikes = bench(n, prob, batch, nthreads, runtime)
+        print('%8s %8d %12.1f %16.3g %10d' % (batch, nthreads, t * 1e6,
+            rate, numSpikes))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,85 @@
+# -*- coding: utf-8 -*-
+# Simulation speed with many recorded tables, streamed to disk. A passive
+# compartment array is recorded by an array of Tables, one per compartment,
+# every step. The tables are kept in memory, streamed by one Streamer into a
+# single npy file, and streamed each to their own file with
+# Table.useStreamer. The files are written on a background thread, so the
+# streamed runs should be close to the one in memory. Reports steps per
+# second for each, and checks the Streamer file against the memory run.
+# Usage: python3 bench_table_streaming.py [numTables [numSteps [format]]]
+
+import os
+import sys
+import time
+import shutil
+import tempfile
+import numpy as np
+import moose
+
+DT = 1e-4
+
+def build(n):
+    if moose.exists('/model'):
+        moose.delete('/model')
+    moose.Neutral('/model')
+    compts = moose.Compartment('/model/compts', n)
+    compts.vec.Rm = 1e9
+    compts.vec.Cm = 1e-11
+    compts.vec.Em = -0.065
+    compts.vec.initVm = np.linspace(-0.08, -0.05, n)
+    compts.vec.inject = np.linspace(0, 1e-11, n)
+    tabs = moose.Table('/model/tabs', n)
+    moose.connect(tabs, 'requestOut', compts, 'getVm', 'OneToOne')
+    for i in range(10):
+        moose.setClock(i, DT)
+    moose.setClock(tabs.tick, DT)
+    return tabs
+
+def run(n, steps, mode, fmt, outdir):
+    tabs = build(n)
+    path = None
+    if mode == 'streamer':
+        s = moose.Streamer('/model/streamer')
+        path = os.path.join(outdir, 'all.' + fmt)
+        s.datafile = path
+        s.addTables([moose.element(t) for t in moose.vec(tabs)])
+        moose.setClock(s.tick, DT)
+    elif mode == 'tables':
+        for i, t in enumerate(moose.vec(tabs)):
+            t.datafile = os.path.join(outdir, 't%d.csv' % i)
+    moose.reinit()
+    t0 = time.time()
+    moose.start(steps * DT)
+    elapsed = time.time() - t0
+    if mode == 'memory':
+        data = np.array([t.vector for t in moose.vec(tabs)])
+    elif mode == 'streamer' and fmt == 'npy':
+        d = np.load(path)
+        data = np.array([d[c] for c in d.dtype.names[1:]])
+    else:
+        data = None
+    moose.delete('/model')
+    return steps / elapsed, data
+
+def main():
+    n = int(sys.argv[1]) if len(sys.argv) > 1 else 10000
+    steps = int(sys.argv[2]) if len(sys.argv) > 2 else 2000
+    fmt = sys.argv[3] if len(sys.argv) > 3 else 'npy'
+    outdir = tempfile.mkdtemp()
+    print('%d tables, %d steps' % (n, steps))
+    print('%10s %14s' % ('mode', 'steps per s'))
+    ref = None
+    try:
+        for mode in ['memory', 'streamer', 'tables']:
+            rate, data = run(n, steps, mode, fmt, outdir)
+            print('%10s %14.1f' % (mode, rate))
+            if mode == 'memory':
+                ref = data
+            elif data is not None:
+                k = min(ref.shape[1], data.shape[1])
+                assert np.allclose(ref[:, :k], data[:, :k]), mode
+    finally:
+        shutil.rmtree(outdir)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,51 @@
+# -*- coding: utf-8 -*-
+# Microbenchmark of the per-step overhead of VoxelPools::advance. The model
+# is a single reversible reaction in each of 10000 voxels, held at steady
+# state, so the time per voxel-step is mostly the cost of dispatching to the
+# integrator and setting it up rather than of the chemistry. Run it with
+# builds from before and after a change to compare.
+# Usage: python3 bench_voxel_advance.py [numVoxels [method ...]]
+
+import sys
+import time
+import moose
+
+def bench(method, numVoxels, runtime=100.0, dt=0.1):
+    compt = moose.CylMesh('/bench')
+    compt.x1 = numVoxels * 1e-6
+    compt.r0 = compt.r1 = 1e-6
+    compt.diffLength = 1e-6
+    A = moose.Pool('/bench/A')
+    B = moose.Pool('/bench/B')
+    r = moose.Reac('/bench/r')
+    moose.connect(r, 'sub', A, 'reac')
+    moose.connect(r, 'prd', B, 'reac')
+    r.Kf, r.Kb = 0.1, 0.05
+    A.concInit = 1e-3
+    ksolve = moose.Ksolve('/bench/ksolve')
+    ksolve.method = method
+    stoich = moose.Stoich('/bench/stoich')
+    stoich.compartment = compt
+    stoich.ksolve = ksolve
+    stoich.reacSystemPath = '/bench/##'
+    for i in range(10, 18):
+        moose.setClock(i, dt)
+    moose.reinit()
+    moose.start(10.0)    # Settle to steady state.
+    t0 = time.time()
+    moose.start(runtime)
+    elapsed = time.time() - t0
+    n = len(A.vec)
+    moose.delete(compt)
+    return elapsed * 1e6 / (n * runtime / dt), n
+
+def main():
+    numVoxels = int(sys.argv[1]) if len(sys.argv) > 1 else 10000
+    methods = sys.argv[2:] or ['rk5', 'rk4', 'lsoda', 'trbdf2']
+    print('%10s %8s %18s' % ('method', 'voxels', 'us per voxel-step'))
+    for m in methods:
+        us, n = bench(m, numVoxels)
+        print('%10s %8d %18.3f' % (m, n, us))
+
+if __name__ == '__main__':
+    main()
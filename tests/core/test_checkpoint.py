@@ -0,0 +1,157 @@
+# Checkpoint and restore of the hidden state of objects other than the
+# chemical solvers. The model has a cell taken over by HSolve, a ring of LIF
+# cells with SimpleSynHandlers fed by a SpikeGen, a TimeTable and each
+# other, and a compartment held by a PIDController. It is run for half the
+# time, saved, and run for the rest. It is then reinited, the checkpoint
+# loaded and the second half run again, which must give the same results
+# bit for bit. A model with a MarkovChannel must be refused.
+
+import os
+import tempfile
+import numpy as np
+import moose
+print('Using moose from %s' % moose.__file__)
+
+EREST = -0.07
+DT = 50e-6
+RUNTIME = 0.04
+NUM_CELLS = 20
+
+def makeHsolveCell():
+    c = moose.Compartment('/model/cell/soma')
+    c.Cm, c.Rm, c.Ra = 1e-11, 1e9, 1e6
+    c.Em = c.initVm = EREST
+    c.inject = 1e-10
+    k = moose.HHChannel(c.path + '/K')
+    k.Gbar, k.Ek, k.Xpower = 0.36e-6, EREST - 0.012, 4
+    n = moose.element(k.path + '/gateX')
+    n.setupAlpha([-599, -1e4, -1.0, 0.0599, -0.01,
+                  125, 0, 0, 0.07, 0.08, 3000, -0.1, 0.05])
+    moose.connect(c, 'channel', k, 'channel')
+    hsolve = moose.HSolve('/model/cell/hsolve')
+    hsolve.dt = DT
+    hsolve.target = c.path
+    tab = moose.Table('/model/somaVm')
+    moose.connect(tab, 'requestOut', c, 'getVm')
+    return tab
+
+def makeSpikeSource():
+    c = moose.Compartment('/model/stim')
+    c.Cm, c.Rm = 1e-11, 1e8
+    c.Em = c.initVm = EREST
+    pulse = moose.PulseGen('/model/pulse')
+    pulse.firstLevel = 1e-9
+    pulse.firstWidth = 2e-3
+    pulse.firstDelay = 3e-3
+    moose.connect(pulse, 'output', c, 'injectMsg')
+    sg = moose.SpikeGen('/model/stim/spike')
+    sg.threshold = -0.03
+    sg.refractT = 1e-3
+    moose.connect(c, 'VmOut', sg, 'Vm')
+    return sg
+
+def makeRing(sg):
+    cells = moose.LIF('/model/cells', NUM_CELLS)
+    syns = moose.SimpleSynHandler('/model/cells/syns', NUM_CELLS)
+    moose.connect(syns, 'activationOut', cells, 'activation', 'OneToOne')
+    tt = moose.TimeTable('/model/tt')
+    tt.vector = np.arange(1e-3, RUNTIME, 3.7e-3)
+    rng = np.random.RandomState(42)
+    for i in range(NUM_CELLS):
+        s = syns.vec[i]
+        s.numSynapses = 3
+        moose.connect(sg, 'spikeOut', s.synapse[0], 'addSpike')
+        moose.connect(tt, 'eventOut', s.synapse[1], 'addSpike')
+        moose.connect(cells.vec[(i + 1) % NUM_CELLS], 'spikeOut',
+                s.synapse[2], 'addSpike')
+        s.synapse.weight = rng.uniform(0.5e-3, 2e-3, 3)
+        s.synapse.delay = DT * rng.randint(1, 100, 3)
+    cells.vec.Rm = 1e8
+    cells.vec.Cm = 1e-10
+    cells.vec.Em = -0.065
+    cells.vec.vReset = -0.065
+    cells.vec.thresh = -0.05
+    cells.vec.refractoryPeriod = 2e-3
+    cells.vec.initVm = rng.uniform(-0.065, -0.05, NUM_CELLS)
+    cells.vec.inject = rng.uniform(1.2e-10, 1.8e-10, NUM_CELLS)
+    return cells
+
+def makePid():
+    c = moose.Compartment('/model/clamped')
+    c.Cm, c.Rm = 1e-11, 1e9
+    c.Em = c.initVm = EREST
+    pid = moose.PIDController('/model/pid')
+    pid.gain = 1e-8
+    pid.tauI = 5e-3
+    pid.tauD = DT / 4
+    pid.command = -0.05
+    pid.saturation = 1e-9
+    moose.connect(c, 'VmOut', pid, 'sensedIn')
+    moose.connect(pid, 'output', c, 'injectMsg')
+    tab = moose.Table('/model/pidOut')
+    moose.connect(tab, 'requestOut', pid, 'getOutputValue')
+    return tab
+
+def build():
+    if moose.exists('/model'):
+        moose.delete('/model')
+    moose.Neutral('/model')
+    moose.Neutral('/model/cell')
+    somaVm = makeHsolveCell()
+    cells = makeRing(makeSpikeSource())
+    pidOut = makePid()
+    for i in range(10):
+        moose.setClock(i, DT)
+    return somaVm, cells, pidOut
+
+def results(somaVm, cells, pidOut):
+    return [np.array(somaVm.vector), np.array(cells.vec.Vm),
+            np.array(cells.vec.lastEventTime), np.array(pidOut.vector),
+            np.array(moose.element('/model/stim/spike').lastSpikeTime)]
+
+def test_checkpoint_restore():
+    fd, path = tempfile.mkstemp(suffix='.ckp')
+    os.close(fd)
+    try:
+        somaVm, cells, pidOut = build()
+        moose.reinit()
+        moose.start(RUNTIME / 2)
+        moose.saveCheckpoint(path)
+        moose.start(RUNTIME / 2)
+        ref = results(somaVm, cells, pidOut)
+        assert np.sum(ref[2] > RUNTIME / 2) > NUM_CELLS / 2, ref[2]
+        assert ref[4] > RUNTIME / 2, ref[4]
+
+        moose.reinit()
+        moose.loadCheckpoint(path)
+        moose.start(RUNTIME / 2)
+        got = results(somaVm, cells, pidOut)
+        for r, g in zip(ref, got):
+            assert np.array_equal(r, g), np.max(abs(r - g))
+    finally:
+        os.remove(path)
+        moose.delete('/model')
+
+def test_checkpoint_refused():
+    fd, path = tempfile.mkstemp(suffix='.ckp')
+    os.close(fd)
+    try:
+        moose.Neutral('/model')
+        moose.MarkovChannel('/model/markov')
+        moose.reinit()
+        try:
+            moose.saveCheckpoint(path)
+        except RuntimeError:
+            pass
+        else:
+            assert False, 'MarkovChannel should not be saved'
+    finally:
+        os.remove(path)
+        moose.delete('/model')
+
+def main():
+    test_checkpoint_restore()
+    test_checkpoint_refused()
+
+if __name__ == '__main__':
+    main()
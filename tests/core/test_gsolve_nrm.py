@@ -0,0 +1,71 @@
+# -*- coding: utf-8 -*-
+# Compares the distributions produced by the Gillespie direct method and the
+# Gibson-Bruck next reaction method in Gsolve.
+
+import numpy as np
+import moose
+
+print('[INFO] Using moose from %s' % moose.__file__)
+
+NUM_VOXELS = 500
+NUM_MOLS = 20
+
+def runIsomerization(method, times):
+    """ A <===> B with kf = kb = 1 in each of NUM_VOXELS independent voxels.
+    Starting with all molecules as A, the number of A at time t is binomial
+    with mean N(1 + exp(-2t))/2.
+    """
+    moose.seed(100)
+    path = '/iso_%s' % method
+    compt = moose.CylMesh(path)
+    compt.r0 = compt.r1 = 1e-6
+    compt.x1 = NUM_VOXELS * 1e-6
+    compt.diffLength = 1e-6
+    assert compt.numDiffCompts == NUM_VOXELS
+    a = moose.Pool('%s/A' % path)
+    b = moose.Pool('%s/B' % path)
+    r = moose.Reac('%s/r' % path)
+    moose.connect(r, 'sub', a, 'reac')
+    moose.connect(r, 'prd', b, 'reac')
+    r.Kf = 1.0
+    r.Kb = 1.0
+    gsolve = moose.Gsolve('%s/gsolve' % path)
+    gsolve.method = method
+    assert gsolve.method == method
+    stoich = moose.Stoich('%s/stoich' % path)
+    stoich.compartment = compt
+    stoich.ksolve = gsolve
+    stoich.reacSystemPath = '%s/##' % path
+    a.vec.nInit = NUM_MOLS
+    b.vec.nInit = 0
+    moose.reinit()
+    res = []
+    t = 0.0
+    for tt in times:
+        moose.start(tt - t)
+        t = tt
+        nA = np.array(a.vec.n)
+        nB = np.array(b.vec.n)
+        assert (nA + nB == NUM_MOLS).all()
+        res.append(nA)
+    moose.delete(compt)
+    return res
+
+def test_gsolve_nrm():
+    times = [0.25, 0.5, 5.0]
+    direct = runIsomerization('direct', times)
+    nrm = runIsomerization('nrm', times)
+    for t, d, n in zip(times, direct, nrm):
+        p = (1.0 + np.exp(-2.0 * t)) / 2.0
+        mean, var = NUM_MOLS * p, NUM_MOLS * p * (1.0 - p)
+        sem = np.sqrt(var / NUM_VOXELS)
+        print('t=%g expected %.3f/%.3f direct %.3f/%.3f nrm %.3f/%.3f' % (
+            t, mean, var, d.mean(), d.var(), n.mean(), n.var()))
+        assert abs(d.mean() - mean) < 5 * sem, (t, d.mean(), mean)
+        assert abs(n.mean() - mean) < 5 * sem, (t, n.mean(), mean)
+        assert abs(d.mean() - n.mean()) < 7 * sem, (t, d.mean(), n.mean())
+        assert abs(n.var() - var) < 0.25 * var, (t, n.var(), var)
+        assert abs(d.var() - n.var()) < 0.35 * var, (t, d.var(), n.var())
+
+if __name__ == '__main__':
+    test_gsolve_nrm()
@@ -0,0 +1,56 @@
+# -*- coding: utf-8 -*-
+# Compares the linear-scan and propensity-tree reaction selection methods
+# of Gsolve on a ring of reversible reactions.
+
+import numpy as np
+import moose
+
+print('[INFO] Using moose from %s' % moose.__file__)
+
+def makeRing(path, numPools, nInit=100.0):
+    compt = moose.CubeMesh(path)
+    compt.volume = 1e-18
+    pools = [moose.Pool('%s/a%d' % (path, i)) for i in range(numPools)]
+    for i, p in enumerate(pools):
+        p.nInit = nInit
+        r = moose.Reac('%s/r%d' % (path, i))
+        moose.connect(r, 'sub', p, 'reac')
+        moose.connect(r, 'prd', pools[(i + 1) % numPools], 'reac')
+        r.numKf = 1.0 + (i % 3)
+        r.numKb = 0.5
+    return compt, pools
+
+def runRing(method, numPools=200, runtime=20.0):
+    moose.seed(42)
+    path = '/ring_%s' % method
+    compt, pools = makeRing(path, numPools)
+    gsolve = moose.Gsolve('%s/gsolve' % path)
+    gsolve.selectionMethod = method
+    assert gsolve.selectionMethod == method
+    stoich = moose.Stoich('%s/stoich' % path)
+    stoich.compartment = compt
+    stoich.ksolve = gsolve
+    stoich.reacSystemPath = '%s/##' % path
+    moose.reinit()
+    moose.start(runtime)
+    n = np.array([p.n for p in pools])
+    numFire = np.sum(gsolve.numFire[0])
+    moose.delete(compt)
+    return n, numFire
+
+def test_gsolve_selection():
+    numPools = 200
+    nLinear, fireLinear = runRing('linear', numPools)
+    nTree, fireTree = runRing('tree', numPools)
+    # Both methods must conserve molecules exactly.
+    assert np.sum(nLinear) == 100.0 * numPools, np.sum(nLinear)
+    assert np.sum(nTree) == 100.0 * numPools, np.sum(nTree)
+    # Same seed and same cumulative ordering, so the event counts and the
+    # resulting distributions should agree closely.
+    assert abs(fireLinear - fireTree) < 0.05 * fireLinear, (fireLinear, fireTree)
+    assert abs(np.std(nLinear) - np.std(nTree)) < 0.25 * np.std(nLinear), \
+            (np.std(nLinear), np.std(nTree))
+    print('linear: %d events, tree: %d events' % (fireLinear, fireTree))
+
+if __name__ == '__main__':
+    test_gsolve_selection()
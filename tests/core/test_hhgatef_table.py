@@ -0,0 +1,147 @@
+# Filename: test_hhgatef_table.py
+# Description: Checks the interpolation tables of HHGateF and HHGateF2D
+# against direct evaluation of their expressions.
+
+"""Tests the useTable mode of HHGateF and HHGateF2D.
+
+Usage: pytest test_hhgatef_table.py
+"""
+import numpy as np
+import moose
+import pytest
+
+ALPHA_M = '1e5*(-0.045 - v)/(exp((-0.045 - v)/0.01) - 1)'
+BETA_M = '4e3*exp(-(v + 0.07)/0.018)'
+ALPHA_KCA = '2500 / (1 + 1.5e-3 * exp(-85*v)/(c*1e-3))'
+BETA_KCA = '1500 / (1 + c*1e-3 / (1.5e-4 * exp(-77*v)))'
+
+
+@pytest.fixture
+def container():
+    ret = moose.Neutral('/test')
+    moose.ce(ret)
+    yield ret
+    moose.ce('..')
+    moose.delete(ret)
+
+
+def lookup(gate, x):
+    return np.array([[gate.A[v], gate.B[v]] for v in x])
+
+
+def test_table_1d(container):
+    chan = moose.HHChannelF('Na')
+    chan.Xpower = 3
+    gate = moose.element(chan.path + '/gateX')
+    gate.alphaExpr = ALPHA_M
+    gate.betaExpr = BETA_M
+    # The singular point of alpha, -0.045, falls on a table point.
+    v = np.linspace(-0.1, 0.05, 1237)
+    exact = lookup(gate, v)
+    assert gate.tableError == 0.0
+
+    gate.useTable = True
+    # The divisions are picked to meet the default tolerance.
+    assert gate.divs >= 100
+    assert 0 < gate.tableError <= 1e-4
+    table = lookup(gate, v)
+    scale = np.max(np.abs(exact), axis=0)
+    err = np.max(np.abs(table - exact), axis=0) / scale
+    # The estimate is taken halfway between the table points, where the
+    # error of linear interpolation peaks.
+    assert np.all(err <= 1.1 * gate.tableError), (err, gate.tableError)
+
+    # Fewer divisions give a larger error estimate.
+    gate.divs = 50
+    assert gate.divs == 50
+    assert gate.tableError > 1e-4
+    # Outside the range the table gives its end values.
+    assert np.allclose(lookup(gate, [-0.2, 0.1]), lookup(gate, [-0.1, 0.05]))
+
+    # The exact path is still there.
+    gate.useTable = False
+    assert np.array_equal(lookup(gate, v), exact)
+
+
+def test_table_shared(container):
+    chan = moose.HHChannelF('K')
+    chan.Xpower = 4
+    gate = moose.element(chan.path + '/gateX')
+    gate.alphaExpr = '1e4*(-0.06 - v)/(exp((-0.06 - v)/0.01) - 1)'
+    gate.betaExpr = '125*exp(-(v + 0.07)/0.08)'
+    gate.useTable = True
+    copy = moose.copy(chan, container, 'K2')
+    copyGate = moose.element(copy.path + '/gateX')
+    assert copyGate.useTable
+    assert copyGate.divs == gate.divs
+    assert copyGate.A[-0.03] == gate.A[-0.03]
+
+
+def test_table_2d(container):
+    chan = moose.HHChannelF2D('KCa')
+    chan.Xpower = 1
+    gate = moose.element(chan.path + '/gateX')
+    gate.alphaExpr = ALPHA_KCA
+    gate.betaExpr = BETA_KCA
+    points = [[v, c] for v in np.linspace(-0.1, 0.05, 37)
+              for c in np.linspace(0.01, 1.0, 23)]
+    exact = np.array([[gate.A[p], gate.B[p]] for p in points])
+
+    gate.cmin, gate.cmax = 0.01, 1.0
+    gate.divs, gate.cdivs = 200, 100
+    gate.useTable = True
+    assert gate.divs == 200 and gate.cdivs == 100
+    table = np.array([[gate.A[p], gate.B[p]] for p in points])
+    scale = np.max(np.abs(exact), axis=0)
+    err = np.max(np.abs(table - exact), axis=0) / scale
+    assert 0 < gate.tableError < 0.1
+    assert np.all(err <= gate.tableError), (err, gate.tableError)
+
+    gate.useTable = False
+    assert np.array_equal(
+        np.array([[gate.A[p], gate.B[p]] for p in points]), exact)
+
+
+def run_cell(useTable):
+    if moose.exists('/cell'):
+        moose.delete('/cell')
+    moose.Neutral('/cell')
+    c = moose.Compartment('/cell/c')
+    c.Cm, c.Rm, c.Em, c.initVm = 1e-11, 1e9, -0.07, -0.07
+    c.inject = 2e-10
+    for name, gbar, ek, xpower, ypower, exprs in (
+            ('Na', 1.2e-6, 0.045, 3, 1,
+             [(ALPHA_M, BETA_M), ('70*exp(-(v + 0.07)/0.02)',
+                                  '1e3/(exp(-(v + 0.04)/0.01) + 1)')]),
+            ('K', 0.36e-6, -0.082, 4, 0,
+             [('1e4*(-0.06 - v)/(exp((-0.06 - v)/0.01) - 1)',
+               '125*exp(-(v + 0.07)/0.08)')])):
+        chan = moose.HHChannelF(c.path + '/' + name)
+        chan.Gbar, chan.Ek = gbar, ek
+        chan.Xpower, chan.Ypower = xpower, ypower
+        for xy, (alpha, beta) in zip('XY', exprs):
+            gate = moose.element('%s/gate%s' % (chan.path, xy))
+            gate.alphaExpr, gate.betaExpr = alpha, beta
+            gate.useTable = useTable
+        moose.connect(c, 'channel', chan, 'channel')
+    tab = moose.Table('/cell/vm')
+    moose.connect(tab, 'requestOut', c, 'getVm')
+    for i in range(10):
+        moose.setClock(i, 10e-6)
+    moose.reinit()
+    moose.start(0.05)
+    return tab.vector.copy()
+
+
+def spikeTimes(vm, dt=10e-6):
+    return np.flatnonzero((vm[:-1] < 0) & (vm[1:] >= 0)) * dt
+
+
+def test_table_run():
+    exact = spikeTimes(run_cell(False))
+    table = spikeTimes(run_cell(True))
+    # The cell fires repeatedly, and the spikes stay in step.
+    assert len(exact) >= 3, exact
+    assert len(table) == len(exact), (table, exact)
+    assert np.max(np.abs(table - exact)) <= 1e-4, (table, exact)
+    moose.delete('/cell')
@@ -0,0 +1,129 @@
+# Checks that HSolve takes over formula (HHChannelF), 2-D (HHChannel2D,
+# HHChannelF2D) and Markov channels, and gives the same Vm as the model run
+# without the solver. The 2-D channels read a CaConc pool that stays at its
+# basal level, so both runs see the same concentration. The formula gates
+# are sampled onto the solver's tables, so the match is not exact.
+
+import numpy as np
+import moose
+print('Using moose from %s' % moose.__file__)
+
+EREST = -0.07
+DT = 20e-6
+NUM_COMPTS = 4
+
+def makeMarkov(compt):
+    # Two states: 1 is open, 2 is closed.
+    chan = moose.MarkovChannel(compt.path + '/M')
+    chan.numStates, chan.numOpenStates = 2, 1
+    chan.gbar = [0.05e-6]
+    chan.initialState = [0.0, 1.0]
+    chan.Ek = EREST - 0.012
+    rates = moose.MarkovRateTable(chan.path + '/rates')
+    rates.init(2)
+    v = np.linspace(-0.1, 0.05, 151)
+    for (i, j), table in (((2, 1), 200.0 / (1 + np.exp(-(v + 0.05) / 0.01))),
+                          ((1, 2), np.full(len(v), 30.0))):
+        vt = moose.VectorTable('%s/vt%d%d' % (chan.path, i, j))
+        vt.xmin, vt.xmax, vt.xdivs = -0.1, 0.05, 150
+        vt.table = table
+        rates.set1d(i, j, vt, 0)
+    solver = moose.MarkovSolver(chan.path + '/solver')
+    solver.xmin, solver.xmax, solver.xdivs = -0.1, 0.05, 150
+    solver.initialState = [0.0, 1.0]
+    solver.init(rates, DT)
+    moose.connect(compt, 'channel', chan, 'channel')
+    moose.connect(compt, 'VmOut', solver, 'handleVm')
+    moose.connect(solver, 'stateOut', chan, 'handleState')
+    return chan
+
+def makeCompt(path, i):
+    c = moose.Compartment(path)
+    c.Cm, c.Rm, c.Ra = 1e-11, 1e9, 1e6
+    c.Em = c.initVm = EREST
+    if i == 0:
+        c.inject = 2e-10
+
+    na = moose.HHChannelF(c.path + '/Na')
+    na.Gbar, na.Ek, na.Xpower, na.Ypower = 1.2e-6, EREST + 0.115, 3, 1
+    m = moose.element(na.path + '/gateX')
+    m.alphaExpr = '1e5*(-0.0449 - v)/(exp((-0.0449 - v)/0.01) - 1)'
+    m.betaExpr = '4e3*exp(-(v + 0.07)/0.018)'
+    h = moose.element(na.path + '/gateY')
+    h.alphaExpr = '70*exp(-(v + 0.07)/0.02)'
+    h.betaExpr = '1e3/(exp(-(v + 0.04)/0.01) + 1)'
+    k = moose.HHChannelF(c.path + '/K')
+    k.Gbar, k.Ek, k.Xpower = 0.36e-6, EREST - 0.012, 4
+    n = moose.element(k.path + '/gateX')
+    n.alphaExpr = '1e4*(-0.0599 - v)/(exp((-0.0599 - v)/0.01) - 1)'
+    n.betaExpr = '125*exp(-(v + 0.07)/0.08)'
+
+    pool = moose.CaConc(c.path + '/Ca')
+    pool.tau, pool.B, pool.CaBasal, pool.Ca = 0.013, 1.0, 0.5, 0.5
+
+    kc = moose.HHChannel2D(c.path + '/KC')
+    kc.Gbar, kc.Ek, kc.Xpower = 0.1e-6, EREST - 0.012, 1
+    kc.Xindex = 'VOLT_C1_INDEX'
+    g = moose.element(kc.path + '/gateX')
+    g.xmin, g.xmax, g.xdivs = -0.1, 0.05, 30
+    g.ymin, g.ymax, g.ydivs = 0.0, 1.0, 20
+    vv, cc = np.meshgrid(np.linspace(-0.1, 0.05, 31), np.linspace(0, 1, 21),
+            indexing='ij')
+    alpha = 100 * cc * (1 + 10 * (vv + 0.1))
+    g.tableA = alpha
+    g.tableB = alpha + 50
+
+    kf = moose.HHChannelF2D(c.path + '/KF')
+    kf.Gbar, kf.Ek, kf.Xpower = 0.1e-6, EREST - 0.012, 1
+    kf.Xindex = 'VOLT_C1_INDEX'
+    g = moose.element(kf.path + '/gateX')
+    g.alphaExpr = '2500 / (1 + 1.5e-3 * exp(-85*v)/(c*1e-3))'
+    g.betaExpr = '1500 / (1 + c*1e-3 / (1.5e-4 * exp(-77*v)))'
+
+    for chan in (na, k, kc, kf):
+        moose.connect(c, 'channel', chan, 'channel')
+    moose.connect(pool, 'concOut', kc, 'concen')
+    moose.connect(pool, 'concOut', kf, 'concen')
+    makeMarkov(c)
+    return c
+
+def run(useSolver):
+    if moose.exists('/cell'):
+        moose.delete('/cell')
+    moose.Neutral('/cell')
+    compts = [makeCompt('/cell/c%d' % i, i) for i in range(NUM_COMPTS)]
+    for a, b in zip(compts[:-1], compts[1:]):
+        moose.connect(a, 'axial', b, 'raxial')
+    tabs = []
+    for c in compts:
+        tab = moose.Table(c.path + '/vm')
+        moose.connect(tab, 'requestOut', c, 'getVm')
+        tabs.append(tab)
+    for i in range(10):
+        moose.setClock(i, DT)
+    if useSolver:
+        hsolve = moose.HSolve('/cell/hsolve')
+        hsolve.dt = DT
+        hsolve.caMin, hsolve.caMax = 0.0, 1.0
+        hsolve.target = '/cell'
+        # The solver now holds all of the channels.
+        for c in compts:
+            for name in ('Na', 'K', 'KC', 'KF'):
+                assert moose.element(c.path + '/' + name).className == \
+                        'ZombieHHChannel', (c.path, name)
+            assert moose.element(c.path + '/M').tick == -2
+    moose.reinit()
+    moose.start(0.05)
+    return np.array([t.vector for t in tabs])
+
+def test_hsolve_channel_types():
+    ref = run(False)
+    vm = run(True)
+    assert vm.shape == ref.shape
+    assert np.allclose(vm, ref, rtol=0, atol=2e-5), np.max(abs(vm - ref))
+
+def main():
+    test_hsolve_channel_types()
+
+if __name__ == '__main__':
+    main()
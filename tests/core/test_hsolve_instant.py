@@ -0,0 +1,59 @@
+# Checks that setting the instant flag of a channel after HSolve has taken
+# it over changes how the solver updates its gates. The solver runs its
+# gates in batches built at setup, which must be built again when the flag
+# changes. The run with the flag set after setup must match the model run
+# without the solver, and differ from the one where the flag is left off.
+
+import numpy as np
+import moose
+print('Using moose from %s' % moose.__file__)
+
+EREST = -0.07
+DT = 20e-6
+
+def makeCell():
+    if moose.exists('/cell'):
+        moose.delete('/cell')
+    moose.Neutral('/cell')
+    c = moose.Compartment('/cell/soma')
+    c.Cm, c.Rm, c.Ra = 1e-11, 1e9, 1e6
+    c.Em = c.initVm = EREST
+    c.inject = 1e-10
+    k = moose.HHChannel(c.path + '/K')
+    k.Gbar, k.Ek, k.Xpower = 0.36e-6, EREST - 0.012, 4
+    n = moose.element(k.path + '/gateX')
+    n.setupAlpha([-599, -1e4, -1.0, 0.0599, -0.01,
+                  125, 0, 0, 0.07, 0.08, 3000, -0.1, 0.05])
+    moose.connect(c, 'channel', k, 'channel')
+    tab = moose.Table('/cell/vm')
+    moose.connect(tab, 'requestOut', c, 'getVm')
+    for i in range(10):
+        moose.setClock(i, DT)
+    return k, tab
+
+def run(useSolver, instant):
+    k, tab = makeCell()
+    if useSolver:
+        hsolve = moose.HSolve('/cell/hsolve')
+        hsolve.dt = DT
+        hsolve.target = '/cell/soma'
+        k = moose.element('/cell/soma/K')
+        assert k.className == 'ZombieHHChannel'
+    k.instant = instant
+    assert k.instant == instant
+    moose.reinit()
+    moose.start(0.02)
+    return np.array(tab.vector)
+
+def test_hsolve_instant():
+    ref = run(False, 1)
+    vm = run(True, 1)
+    slow = run(True, 0)
+    assert np.allclose(vm, ref, rtol=0, atol=1e-6), np.max(abs(vm - ref))
+    assert np.max(abs(vm - slow)) > 1e-4, np.max(abs(vm - slow))
+
+def main():
+    test_hsolve_instant()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,129 @@
+# Checks that HSolvePop, which advances a population of cells together,
+# gives the same result as a separate HSolve on each cell. The cells come
+# in two topologies, have HH channels in every compartment, and drive
+# each other in a ring through SpikeGens and SynChans, so the spikes have
+# to get through the usual messages.
+
+import numpy as np
+import moose
+print('Using moose from %s' % moose.__file__)
+
+EREST = -0.07
+NUM_CELLS = 24
+
+def makeGates(chan, isNa):
+    if isNa:
+        chan.Xpower, chan.Ypower = 3, 1
+        moose.element(chan.path + '/gateX').setupAlpha([
+            0.1e6 * (EREST + 0.025), -0.1e6, -1, -(EREST + 0.025), -0.01,
+            4e3, 0, 0, -EREST, 0.018, 150, -0.1, 0.05])
+        moose.element(chan.path + '/gateY').setupAlpha([
+            70, 0, 0, -EREST, 0.02,
+            1e3, 0, 1, -(EREST + 0.03), -0.01, 150, -0.1, 0.05])
+    else:
+        chan.Xpower = 4
+        moose.element(chan.path + '/gateX').setupAlpha([
+            1e4 * (0.01 + EREST), -1e4, -1, -(EREST + 0.01), -0.01,
+            0.125e3, 0, 0, -EREST, 0.08, 150, -0.1, 0.05])
+
+def makeCompt(path, scale):
+    c = moose.Compartment(path)
+    c.Cm = 7.854e-9 * scale
+    c.Rm = 424.4e3 / scale
+    c.Ra = 763.944e3
+    c.Em = EREST + 0.010613
+    c.initVm = EREST
+    for name, gbar, ek, isNa in (('Na', 0.94248e-3, EREST + 0.115, True),
+            ('K', 0.282743e-3, EREST - 0.012, False)):
+        chan = moose.HHChannel(c.path + '/' + name)
+        chan.Gbar = gbar * scale
+        chan.Ek = ek
+        makeGates(chan, isNa)
+        moose.connect(c, 'channel', chan, 'channel')
+    return c
+
+def makeNetwork():
+    if moose.exists('/net'):
+        moose.delete('/net')
+    moose.Neutral('/net')
+    spikes = []
+    handlers = []
+    for i in range(NUM_CELLS):
+        cell = moose.Neutral('/net/cell%d' % i)
+        soma = makeCompt(cell.path + '/soma', 1.0)
+        if i % 3 == 0:
+            soma.inject = 0.1e-6 + 1e-9 * i
+        d = [makeCompt(cell.path + '/d%d' % j, s)
+                for j, s in enumerate((0.5, 0.3, 0.3, 0.2))]
+        moose.connect(soma, 'axial', d[0], 'raxial')
+        if i % 4 == 3:    # An unbranched cable..
+            pairs = ((0, 1), (1, 2), (2, 3))
+        else:             # ..or a branch at d0.
+            pairs = ((0, 1), (0, 2), (2, 3))
+        for a, b in pairs:
+            moose.connect(d[a], 'axial', d[b], 'raxial')
+
+        sg = moose.SpikeGen(soma.path + '/spike')
+        sg.threshold = 0.0
+        sg.refractT = 2e-3
+        moose.connect(soma, 'VmOut', sg, 'Vm')
+        syn = moose.SynChan(d[3].path + '/syn')
+        syn.Gbar, syn.Ek, syn.tau1, syn.tau2 = 5e-6, 0.0, 1e-3, 2e-3
+        moose.connect(d[3], 'channel', syn, 'channel')
+        sh = moose.SimpleSynHandler(syn.path + '/sh')
+        sh.synapse.num = 1
+        moose.connect(sh, 'activationOut', syn, 'activation')
+        spikes.append(sg)
+        handlers.append(sh)
+
+    # Each cell excites the next one around the ring.
+    for i in range(NUM_CELLS):
+        synapse = handlers[(i + 1) % NUM_CELLS].synapse[0]
+        synapse.weight = 1.0
+        synapse.delay = 1e-3
+        moose.connect(spikes[i], 'spikeOut', synapse, 'addSpike')
+
+    vmTabs = []
+    for i in range(NUM_CELLS):
+        tab = moose.Table('/net/cell%d/vm' % i)
+        moose.connect(tab, 'requestOut', '/net/cell%d/soma' % i, 'getVm')
+        vmTabs.append(tab)
+    return vmTabs
+
+def run(numThreads=None):
+    vmTabs = makeNetwork()
+    if numThreads is None:
+        for i in range(NUM_CELLS):
+            hsolve = moose.HSolve('/net/cell%d/hsolve' % i)
+            hsolve.dt = 50e-6
+            hsolve.target = '/net/cell%d' % i
+    else:
+        pop = moose.HSolvePop('/net/pop')
+        pop.dt = 50e-6
+        pop.numThreads = numThreads
+        pop.target = '/net/cell#'
+        assert pop.numCells == NUM_CELLS, pop.numCells
+        assert pop.numGroups == 2, pop.numGroups
+    moose.reinit()
+    moose.start(0.1)
+    vm = np.array([t.vector for t in vmTabs])
+    # Upward crossings of 0 V.
+    numSpikes = np.sum((vm[:, :-1] < 0) & (vm[:, 1:] >= 0), axis=1)
+    return vm, numSpikes
+
+def test_hsolve_population():
+    ref, refSpikes = run()
+    # Cells without current injection only fire if spikes reach them.
+    assert np.all(refSpikes > 0), refSpikes
+    for numThreads in (1, 2, 4):
+        vm, numSpikes = run(numThreads)
+        assert vm.shape == ref.shape
+        assert np.allclose(vm, ref, rtol=1e-10, atol=1e-12), \
+                (numThreads, np.max(abs(vm - ref)))
+        assert np.array_equal(numSpikes, refSpikes), (numThreads, numSpikes)
+
+def main():
+    test_hsolve_population()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,143 @@
+# Checks that the batch and batchc Ksolve methods, which advance several
+# voxels in lockstep, agree with the per-voxel integrators.
+
+import numpy as np
+import moose
+print('Using moose from %s' % moose.__file__)
+
+def makeModel(method, nthreads=1, width=8, epsRel=1e-6):
+    if moose.exists('/model'):
+        moose.delete('/model')
+    model = moose.Neutral('/model')
+    # A tapered cylinder, so that the voxels differ in volume and so do
+    # the volume-scaled rates of the second order reactions.
+    compt = moose.CylMesh('/model/cyl')
+    compt.x1 = 20e-6
+    compt.r0 = 1e-6
+    compt.r1 = 3e-6
+    compt.diffLength = 1e-6
+    A = moose.Pool('/model/cyl/A')
+    B = moose.Pool('/model/cyl/B')
+    C = moose.Pool('/model/cyl/C')
+    D = moose.Pool('/model/cyl/D')
+    E = moose.Pool('/model/cyl/E')
+    buf = moose.BufPool('/model/cyl/buf')
+
+    # A + B <==> C, buf <==> A
+    r1 = moose.Reac('/model/cyl/r1')
+    moose.connect(r1, 'sub', A, 'reac')
+    moose.connect(r1, 'sub', B, 'reac')
+    moose.connect(r1, 'prd', C, 'reac')
+    r1.Kf, r1.Kb = 1000.0, 0.1
+    r2 = moose.Reac('/model/cyl/r2')
+    moose.connect(r2, 'sub', buf, 'reac')
+    moose.connect(r2, 'prd', A, 'reac')
+    r2.Kf, r2.Kb = 0.5, 0.2
+
+    # C --E--> D by Michaelis-Menten, D --E--> B by mass action.
+    e1 = moose.MMenz('/model/cyl/E/e1')
+    moose.connect(e1, 'sub', C, 'reac')
+    moose.connect(E, 'nOut', e1, 'enzDest')
+    moose.connect(e1, 'prd', D, 'reac')
+    e1.Km, e1.kcat = 1e-3, 2.0
+    e2 = moose.Enz('/model/cyl/E/e2')
+    cplx = moose.Pool('/model/cyl/E/e2/cplx')
+    moose.connect(e2, 'sub', D, 'reac')
+    moose.connect(e2, 'enz', E, 'reac')
+    moose.connect(e2, 'cplx', cplx, 'reac')
+    moose.connect(e2, 'prd', B, 'reac')
+    e2.Km, e2.kcat = 5e-4, 1.0
+
+    A.concInit = 1e-3
+    B.concInit = 2e-3
+    E.concInit = 1e-4
+    buf.concInit = 5e-4
+
+    ksolve = moose.Ksolve('/model/cyl/ksolve')
+    ksolve.method = method
+    ksolve.numThreads = nthreads
+    ksolve.batchWidth = width
+    ksolve.epsRel = epsRel
+    ksolve.epsAbs = epsRel * 1e-3
+    stoich = moose.Stoich('/model/cyl/stoich')
+    stoich.compartment = compt
+    stoich.ksolve = ksolve
+    stoich.reacSystemPath = '/model/cyl/##'
+    for i in range(10, 18):
+        moose.setClock(i, 0.1)
+    return ksolve
+
+def run(method, **kwargs):
+    makeModel(method, **kwargs)
+    moose.reinit()
+    moose.start(20.0)
+    return np.concatenate([moose.element('/model/cyl/%s' % p).vec.conc
+        for p in ('A', 'C', 'D', 'E/e2/cplx')])
+
+def test_batch_matches_per_voxel():
+    ref = run('rk5', epsRel=1e-9)
+    y = run('batch')
+    assert np.allclose(y, ref, rtol=1e-4, atol=0), np.max(abs(y-ref)/ref)
+    y = run('batchc')
+    assert np.allclose(y, ref, rtol=1e-4, atol=0), np.max(abs(y-ref)/ref)
+    # lsoda runs with its own loose internal tolerance.
+    y = run('lsoda')
+    assert np.allclose(y, ref, rtol=1e-2, atol=0), np.max(abs(y-ref)/ref)
+
+def test_batch_width_and_threads():
+    # Width and threading only change how voxels are grouped, and the
+    # fixed step method then does identical arithmetic per voxel.
+    ref = run('batchc', width=1)
+    for width in (3, 8, 32):
+        for nthreads in (1, 4):
+            y = run('batchc', width=width, nthreads=nthreads)
+            assert np.allclose(y, ref, rtol=1e-12, atol=0), (width, nthreads)
+    ksolve = moose.element('/model/cyl/ksolve')
+    assert ksolve.method == 'batchc'
+    assert ksolve.batchWidth == 32
+
+def runStiff(method):
+    # A <==> B so fast that the explicit step would have to shrink below
+    # 1e-12 of the tick. The batch method then has to redo each tick
+    # with trbdf2, rather than keep a partial step.
+    if moose.exists('/model'):
+        moose.delete('/model')
+    moose.Neutral('/model')
+    compt = moose.CylMesh('/model/cyl')
+    compt.x1 = 10e-6
+    compt.diffLength = 1e-6
+    A = moose.Pool('/model/cyl/A')
+    B = moose.Pool('/model/cyl/B')
+    r = moose.Reac('/model/cyl/r')
+    moose.connect(r, 'sub', A, 'reac')
+    moose.connect(r, 'prd', B, 'reac')
+    r.Kf, r.Kb = 1e14, 3e14
+    A.concInit = 1e-3
+    ksolve = moose.Ksolve('/model/cyl/ksolve')
+    ksolve.method = method
+    stoich = moose.Stoich('/model/cyl/stoich')
+    stoich.compartment = compt
+    stoich.ksolve = ksolve
+    stoich.reacSystemPath = '/model/cyl/##'
+    for i in range(10, 18):
+        moose.setClock(i, 0.1)
+    moose.reinit()
+    moose.start(1.0)
+    return ksolve, np.array(A.vec.conc), np.array(B.vec.conc)
+
+def test_batch_stiff_falls_back():
+    ksolve, a, b = runStiff('batch')
+    assert ksolve.numJacobians > 0
+    assert np.allclose(a, 0.75e-3, rtol=1e-6), a
+    assert np.allclose(b, 0.25e-3, rtol=1e-6), b
+    ksolve, aRef, bRef = runStiff('trbdf2')
+    assert np.allclose(a, aRef, rtol=1e-9), (a, aRef)
+    assert np.allclose(b, bRef, rtol=1e-9), (b, bRef)
+
+def main():
+    test_batch_matches_per_voxel()
+    test_batch_width_and_threads()
+    test_batch_stiff_falls_back()
+
+if __name__ == '__main__':
+    main()
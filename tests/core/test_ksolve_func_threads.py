@@ -0,0 +1,87 @@
+# Stress test of Functions in a multithreaded Ksolve. Each of the three
+# ways a Function can act on the reaction system (setting a pool, setting
+# the rate of change of a pool, and setting a reaction rate) is evaluated
+# in many voxels at once. Every thread count must give the same result as
+# the serial run.
+
+import numpy as np
+import moose
+print('Using moose from %s' % moose.__file__)
+
+def makeModel(nthreads, numVoxels=2000):
+    if moose.exists('/model'):
+        moose.delete('/model')
+    moose.Neutral('/model')
+    compt = moose.CylMesh('/model/cyl')
+    compt.x1 = numVoxels * 1e-6
+    compt.r0 = compt.r1 = 1e-6
+    compt.diffLength = 1e-6
+    A = moose.Pool('/model/cyl/A')
+    B = moose.Pool('/model/cyl/B')
+    C = moose.BufPool('/model/cyl/C')
+    D = moose.Pool('/model/cyl/D')
+    S = moose.BufPool('/model/cyl/S')
+
+    # C is set by a function of A and time.
+    fc = moose.Function('/model/cyl/C/func')
+    fc.x.num = 1
+    fc.expr = 'x0 * (1 + 0.5 * sin(t)) + 1'
+    moose.connect(A, 'nOut', fc.x[0], 'input')
+    moose.connect(fc, 'valueOut', C, 'setN')
+
+    # The rate of A to B is set by C.
+    reac = moose.Reac('/model/cyl/reac')
+    moose.connect(reac, 'sub', A, 'reac')
+    moose.connect(reac, 'prd', B, 'reac')
+    reac.Kb = 0.1
+    fr = moose.Function('/model/cyl/reac/func')
+    fr.x.num = 1
+    fr.expr = '0.01 * x0 / (x0 + 100)'
+    moose.connect(C, 'nOut', fr.x[0], 'input')
+    moose.connect(fr, 'valueOut', reac, 'setNumKf')
+
+    # D grows at a rate set by B and the per-voxel stimulus S.
+    fd = moose.Function('/model/cyl/D/func')
+    fd.x.num = 2
+    fd.expr = '0.001 * x0 * x1 / (1 + x1)'
+    moose.connect(B, 'nOut', fd.x[0], 'input')
+    moose.connect(S, 'nOut', fd.x[1], 'input')
+    moose.connect(fd, 'valueOut', D, 'increment')
+
+    ksolve = moose.Ksolve('/model/cyl/ksolve')
+    ksolve.numThreads = nthreads
+    stoich = moose.Stoich('/model/cyl/stoich')
+    stoich.compartment = compt
+    stoich.ksolve = ksolve
+    stoich.reacSystemPath = '/model/cyl/##'
+    for i in range(10, 18):
+        moose.setClock(i, 0.1)
+
+    # Distinct values in every voxel, so that a thread reading another
+    # thread's arguments gives a visibly wrong answer.
+    n = len(A.vec)
+    A.vec.nInit = 1000 + 500 * np.sin(np.arange(n) / 7.0)
+    S.vec.nInit = np.arange(n) % 13
+    return n
+
+def run(nthreads):
+    makeModel(nthreads)
+    moose.reinit()
+    moose.start(20.0)
+    return np.concatenate([moose.element('/model/cyl/%s' % p).vec.n
+        for p in ('A', 'B', 'C', 'D')])
+
+def test_func_threads():
+    ref = run(1)
+    assert np.all(np.isfinite(ref))
+    for nthreads in (2, 4, 8):
+        for rep in range(3):
+            y = run(nthreads)
+            assert np.allclose(y, ref, rtol=1e-10, atol=0), \
+                    (nthreads, rep, np.max(abs(y - ref)))
+
+def main():
+    test_func_threads()
+
+if __name__ == '__main__':
+    main()
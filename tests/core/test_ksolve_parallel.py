@@ -94,7 +94,20 @@ def test_ksolver_parallel( nthreads = 4 ):
         u1, m1 = np.mean(yvec), np.std(yvec)
         print(u1, m1)
         np.isclose( (u1,m1), expected[i+1], atol=1e-5 ).all(), expected[i+1]
-    return time.time() - t1
+    t2 = time.time() - t1
+
+    # Per-thread load: every thread should have done some work.
+    busy = np.array(ksolve.threadBusyTime)
+    idle = np.array(ksolve.threadIdleTime)
+    print('Busy time per thread', busy, 'idle', idle)
+    assert len(busy) == ksolve.numThreads, (busy, ksolve.numThreads)
+    assert len(idle) == len(busy)
+    assert (busy > 0).all(), busy
+    if ksolve.numThreads > 1:
+        cost = np.array(ksolve.voxelCost)
+        assert len(cost) == compt.numDiffCompts
+        assert (cost > 0).all()
+    return t2
 
 def main(nT):
     return test_ksolver_parallel(nT)
@@ -0,0 +1,105 @@
+# Checks the implicit trbdf2 Ksolve method on a stiff reaction system
+# against the explicit default method, and that it reuses its Jacobian
+# and LU factors across steps.
+
+import numpy as np
+import moose
+print('Using moose from %s' % moose.__file__)
+
+def makeModel(method, epsRel=1e-6):
+    if moose.exists('/model'):
+        moose.delete('/model')
+    moose.Neutral('/model')
+    compt = moose.CylMesh('/model/cyl')
+    compt.x1 = 10e-6
+    compt.r0 = 1e-6
+    compt.r1 = 2e-6
+    compt.diffLength = 1e-6
+    A = moose.Pool('/model/cyl/A')
+    B = moose.Pool('/model/cyl/B')
+    C = moose.Pool('/model/cyl/C')
+    D = moose.Pool('/model/cyl/D')
+    E = moose.Pool('/model/cyl/E')
+
+    # Fast binding A + B <==> C, with a time constant around 1 ms,
+    # drives slow conversion of C to D over seconds.
+    r1 = moose.Reac('/model/cyl/r1')
+    moose.connect(r1, 'sub', A, 'reac')
+    moose.connect(r1, 'sub', B, 'reac')
+    moose.connect(r1, 'prd', C, 'reac')
+    r1.Kf, r1.Kb = 1e6, 1e3
+    r2 = moose.Reac('/model/cyl/r2')
+    moose.connect(r2, 'sub', D, 'reac')
+    moose.connect(r2, 'prd', A, 'reac')
+    r2.Kf, r2.Kb = 0.05, 0.0
+    enz = moose.MMenz('/model/cyl/E/enz')
+    moose.connect(enz, 'sub', C, 'reac')
+    moose.connect(E, 'nOut', enz, 'enzDest')
+    moose.connect(enz, 'prd', D, 'reac')
+    enz.Km, enz.kcat = 1e-3, 0.5
+    A.concInit = 1e-3
+    B.concInit = 2e-3
+    E.concInit = 1e-4
+
+    ksolve = moose.Ksolve('/model/cyl/ksolve')
+    ksolve.method = method
+    ksolve.epsRel = epsRel
+    ksolve.epsAbs = epsRel * 1e-3
+    stoich = moose.Stoich('/model/cyl/stoich')
+    stoich.compartment = compt
+    stoich.ksolve = ksolve
+    stoich.reacSystemPath = '/model/cyl/##'
+    for i in range(10, 18):
+        moose.setClock(i, 0.1)
+    return ksolve
+
+def run(method, runtime=20.0, **kwargs):
+    ksolve = makeModel(method, **kwargs)
+    moose.reinit()
+    moose.start(runtime)
+    conc = np.concatenate([moose.element('/model/cyl/%s' % p).vec.conc
+        for p in ('A', 'B', 'C', 'D')])
+    return conc, ksolve
+
+def test_trbdf2():
+    ref, _ = run('rk5', epsRel=1e-9)
+    y, ksolve = run('trbdf2')
+    assert ksolve.method == 'trbdf2'
+    assert np.allclose(y, ref, rtol=1e-4, atol=1e-12), \
+            np.max(abs(y-ref)/ref)
+
+    numVoxels = len(moose.element('/model/cyl/A').vec)
+    numTicks = int(round(20.0 / 0.1))
+    print('Jacobians', ksolve.numJacobians, 'factorizations',
+            ksolve.numFactorizations, 'ticks x voxels', numTicks*numVoxels)
+    assert ksolve.numJacobians >= numVoxels
+    # The factors of I - hJ are reused across steps and ticks.
+    assert ksolve.numFactorizations < numTicks * numVoxels
+    assert ksolve.numJacobians < ksolve.numFactorizations
+
+    # Counts start again at reinit.
+    moose.reinit()
+    assert ksolve.numJacobians == 0
+    assert ksolve.numFactorizations == 0
+
+def test_trbdf2_rate_change():
+    # A change of rate constant during the run reaches the Jacobian.
+    ref, _ = run('rk5', runtime=10.0, epsRel=1e-9)
+    moose.element('/model/cyl/r2').Kf = 0.5
+    moose.start(10.0)
+    ref = moose.element('/model/cyl/D').vec.conc
+
+    _, ksolve = run('trbdf2', runtime=10.0)
+    before = ksolve.numJacobians
+    moose.element('/model/cyl/r2').Kf = 0.5
+    moose.start(10.0)
+    y = moose.element('/model/cyl/D').vec.conc
+    assert ksolve.numJacobians > before
+    assert np.allclose(y, ref, rtol=1e-4), np.max(abs(y-ref)/ref)
+
+def main():
+    test_trbdf2()
+    test_trbdf2_rate_change()
+
+if __name__ == '__main__':
+    main()
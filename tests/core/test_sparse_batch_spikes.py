@@ -0,0 +1,64 @@
+# Batched spike delivery on SparseMsg. A recurrent network of LIF cells is
+# run with spikes sent to every synapse as they happen, and with
+# batchSpikes on 1 and several threads. The synapses must get the same
+# spikes at the same times, so the cells must fire identically.
+
+import numpy as np
+import moose
+print('Using moose from %s' % moose.__file__)
+
+DT = 1e-4
+
+def makeNetwork(n, prob, batch, nthreads, seed=1234):
+    if moose.exists('/net'):
+        moose.delete('/net')
+    moose.Neutral('/net')
+    cells = moose.LIF('/net/cells', n)
+    syns = moose.SimpleSynHandler('/net/cells/syns', n)
+    moose.connect(syns, 'activationOut', cells, 'activation', 'OneToOne')
+    m = moose.connect(cells, 'spikeOut', moose.vec(syns.path + '/synapse'),
+            'addSpike', 'Sparse')
+    m = moose.element(m)
+    m.setRandomConnectivity(prob, seed)
+    m.batchSpikes = batch
+    m.numThreads = nthreads
+
+    rng = np.random.RandomState(seed)
+    for s in moose.vec(syns):
+        k = s.synapse.num
+        if k > 0:
+            s.synapse.weight = rng.uniform(-0.4e-3, 0.6e-3, k)
+            s.synapse.delay = DT * rng.randint(1, 30, k)
+    cells.vec.Rm = 1e8
+    cells.vec.Cm = 1e-10
+    cells.vec.Em = -0.065
+    cells.vec.vReset = -0.065
+    cells.vec.thresh = -0.05
+    cells.vec.refractoryPeriod = 2e-3
+    cells.vec.initVm = rng.uniform(-0.065, -0.05, n)
+    cells.vec.inject = rng.uniform(1.2e-10, 1.8e-10, n)
+    for i in range(10):
+        moose.setClock(i, DT)
+    return cells, m
+
+def run(batch, nthreads, n=400, prob=0.05, runtime=0.1):
+    cells, m = makeNetwork(n, prob, batch, nthreads)
+    moose.reinit()
+    moose.start(runtime)
+    return np.array(cells.vec.Vm), np.array(cells.vec.lastEventTime), \
+            m.numEntries
+
+def test_batch_spikes():
+    vm, last, numEntries = run(False, 1)
+    assert numEntries > 0
+    assert np.sum(last > 0.05) > 10, 'network should keep firing'
+    for nthreads in (1, 2, 4):
+        bvm, blast, _ = run(True, nthreads)
+        assert np.array_equal(blast, last), nthreads
+        assert np.array_equal(bvm, vm), (nthreads, np.max(abs(bvm - vm)))
+
+def main():
+    test_batch_spikes()
+
+if __name__ == '__main__':
+    main()
@@ -142,9 +142,35 @@ def test_large_system():
         assert (a == b).all(), (a-b)
 
 
+def test_file_complete_after_start():
+    # The file of a streaming table must be whole, header included, as soon
+    # as start returns, while the table is still there.
+    if moose.exists('/comptC'):
+        moose.delete('/comptC')
+    moose.CubeMesh('/comptC')
+    a = moose.Pool('/comptC/a')
+    a.concInit = 1.5
+    tab = moose.Table2('/comptC/tab')
+    tab.datafile = 'table_start.npy'
+    moose.connect(tab, 'requestOut', a, 'getConc')
+    moose.reinit()
+    moose.start(10)
+    data = np.load('table_start.npy')
+    assert len(data) == 11, len(data)
+    assert np.allclose(data['time'], np.arange(11)), data['time']
+    assert np.allclose(data[data.dtype.names[1]], 1.5)
+
+    moose.start(10)
+    data = np.load('table_start.npy')
+    assert len(data) == 21, len(data)
+    assert np.allclose(data['time'], np.arange(21)), data['time']
+    moose.delete('/comptC')
+    os.remove('table_start.npy')
+
 def main( ):
     test_small( )
     test_large_system()
+    test_file_complete_after_start()
     print( '[INFO] All tests passed' )
 
 if __name__ == '__main__':
@@ -0,0 +1,205 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#include <cassert>
+#include "ThreadPool.h"
+
+namespace moose
+{
+
+/// True on the pool's own worker threads, and on a caller inside a job.
+static thread_local bool inPoolJob_ = false;
+
+/// Range index of this thread in the current job.
+static thread_local size_t slot_ = 0;
+
+ThreadPool& ThreadPool::instance()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::ThreadPool()
+    : fn_( nullptr ), maxSlots_( 0 ), numSlots_( 0 ),
+      generation_( 0 ), busyWorkers_( 0 ), stop_( false )
+{;}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for ( auto& w : workers_ )
+        w.join();
+}
+
+size_t ThreadPool::slot()
+{
+    return slot_;
+}
+
+size_t ThreadPool::numWorkers() const
+{
+    return workers_.size();
+}
+
+void ThreadPool::reserve( size_t n )
+{
+    unsigned long generation;
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        generation = generation_;
+    }
+    // The worker is told the current generation so that it waits for
+    // the next job rather than racing for one it was not counted in.
+    while ( workers_.size() < n )
+        workers_.push_back( std::thread( &ThreadPool::workerLoop, this,
+                    workers_.size(), generation ) );
+}
+
+void ThreadPool::workerLoop( size_t id, unsigned long generation )
+{
+    inPoolJob_ = true;
+    size_t slot = id + 1; // Slot 0 belongs to the caller.
+    slot_ = slot;
+    std::unique_lock< std::mutex > lock( mutex_ );
+    while ( true )
+    {
+        wake_.wait( lock,
+                [this, generation]{ return stop_ || generation_ != generation; } );
+        if ( stop_ )
+            return;
+        generation = generation_;
+        if ( slot >= numSlots_ )
+            continue;
+        lock.unlock();
+        runSlot( slot );
+        lock.lock();
+        if ( --busyWorkers_ == 0 )
+            done_.notify_one();
+    }
+}
+
+void ThreadPool::runSlot( size_t slot )
+{
+    const std::function< void( size_t ) >& fn = *fn_;
+    for ( size_t k = 0; k < numSlots_; ++k )
+    {
+        Range& r = ranges_[ ( slot + k ) % numSlots_ ];
+        while ( true )
+        {
+            size_t i = r.next.fetch_add( 1, std::memory_order_relaxed );
+            if ( i >= r.end )
+                break;
+            fn( i );
+        }
+    }
+}
+
+void ThreadPool::parallelFor( size_t numTasks, size_t numThreads,
+        const std::function< void( size_t ) >& fn )
+{
+    run( numTasks, numThreads, fn, nullptr );
+}
+
+void ThreadPool::parallelFor( size_t numTasks, size_t numThreads,
+        const std::function< void( size_t ) >& fn,
+        const std::vector< double >& cost )
+{
+    run( numTasks, numThreads, fn, cost.size() >= numTasks ? &cost : nullptr );
+}
+
+void ThreadPool::splitRanges( size_t numTasks, size_t numThreads,
+        const std::vector< double >* cost, std::vector< size_t >& stops )
+{
+    double totalCost = 0.0;
+    if ( cost )
+        for ( size_t i = 0; i < numTasks; ++i )
+            totalCost += ( *cost )[i];
+
+    stops.clear();
+    size_t start = 0;
+    double sum = 0.0;
+    for ( size_t i = 0; i < numThreads; ++i )
+    {
+        size_t stop;
+        if ( totalCost > 0.0 )
+        {
+            // Cut where the running cost passes an equal share of what
+            // is left, splitting each task at its midpoint.
+            double target = sum + ( totalCost - sum ) / ( numThreads - i );
+            stop = start;
+            while ( stop < numTasks && sum + 0.5 * ( *cost )[stop] < target )
+                sum += ( *cost )[ stop++ ];
+            if ( stop == start && stop < numTasks )
+                sum += ( *cost )[ stop++ ];
+            if ( i == numThreads - 1 )
+                stop = numTasks;
+        }
+        else
+        {
+            stop = start + ( numTasks - start ) / ( numThreads - i );
+        }
+        stops.push_back( stop );
+        start = stop;
+    }
+    assert( start == numTasks );
+}
+
+void ThreadPool::run( size_t numTasks, size_t numThreads,
+        const std::function< void( size_t ) >& fn,
+        const std::vector< double >* cost )
+{
+    if ( numThreads > numTasks )
+        numThreads = numTasks;
+    if ( numThreads <= 1 || inPoolJob_ )
+    {
+        for ( size_t i = 0; i < numTasks; ++i )
+            fn( i );
+        return;
+    }
+
+    std::lock_guard< std::mutex > jobLock( jobMutex_ );
+    reserve( numThreads - 1 );
+    if ( numThreads > maxSlots_ )
+    {
+        ranges_.reset( new Range[ numThreads ] );
+        maxSlots_ = numThreads;
+    }
+    splitRanges( numTasks, numThreads, cost, stops_ );
+    size_t start = 0;
+    for ( size_t i = 0; i < numThreads; ++i )
+    {
+        ranges_[i].next.store( start, std::memory_order_relaxed );
+        ranges_[i].end = stops_[i];
+        start = stops_[i];
+    }
+
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        fn_ = &fn;
+        numSlots_ = numThreads;
+        busyWorkers_ = numThreads - 1;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    inPoolJob_ = true;
+    slot_ = 0;
+    runSlot( 0 );
+    inPoolJob_ = false;
+
+    std::unique_lock< std::mutex > lock( mutex_ );
+    done_.wait( lock, [this]{ return busyWorkers_ == 0; } );
+    fn_ = nullptr;
+}
+
+} // namespace moose
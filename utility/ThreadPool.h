@@ -0,0 +1,148 @@
+/**********************************************************************
+** This program is part of 'MOOSE', the
+** Messaging Object Oriented Simulation Environment.
+**           Copyright (C) 2003-2014 Upinder S. Bhalla. and NCBS
+** It is made available under the terms of the
+** GNU Lesser General Public License version 2.1
+** See the file COPYING.LIB for the full notice.
+**********************************************************************/
+
+#ifndef _MOOSE_THREAD_POOL_H
+#define _MOOSE_THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <functional>
+
+namespace moose
+{
+
+/**
+ * Process-wide pool of persistent worker threads, used by the solvers
+ * to advance voxels in parallel on every clock tick without creating
+ * and joining threads each time.
+ *
+ * parallelFor splits the tasks into one contiguous range per
+ * participating thread, the caller being one of them. Each thread works
+ * through its own range and then steals the remaining tasks of the
+ * others, so that uneven task costs are balanced out. The call returns
+ * once all tasks are done, so on each tick the only synchronization is
+ * a wakeup and a barrier.
+ *
+ * Workers are created on demand, up to the largest number of threads
+ * ever requested, and sleep between jobs. Only one job runs at a time;
+ * a parallelFor issued from inside a task runs serially.
+ */
+class ThreadPool
+{
+public:
+    /// Returns the single pool shared by the whole process.
+    static ThreadPool& instance();
+
+    /**
+     * Calls fn( i ) for every i in [0, numTasks), using up to
+     * numThreads threads including the calling one. Blocks until all
+     * calls have returned.
+     */
+    void parallelFor( size_t numTasks, size_t numThreads,
+            const std::function< void( size_t ) >& fn );
+
+    /**
+     * As above, but the initial ranges are chosen so that each thread
+     * gets about the same total cost, given the expected cost of each
+     * task. Stealing still evens out any remaining imbalance.
+     */
+    void parallelFor( size_t numTasks, size_t numThreads,
+            const std::function< void( size_t ) >& fn,
+            const std::vector< double >& cost );
+
+    /**
+     * Index of the calling thread within the current job: 0 for the
+     * thread that called parallelFor, 1 .. numThreads-1 for workers.
+     * Lets tasks accumulate per-thread data without locking.
+     */
+    static size_t slot();
+
+    /**
+     * Fills stops with the end of the initial range of each of
+     * numThreads threads. Without cost the ranges have equal numbers of
+     * tasks. With it, each range gets an equal share of the cost left
+     * over by the ranges before it, and at least one task while there
+     * are tasks left, so that a single costly task has a range of its
+     * own.
+     */
+    static void splitRanges( size_t numTasks, size_t numThreads,
+            const std::vector< double >* cost, std::vector< size_t >& stops );
+
+    /// Number of worker threads created so far.
+    size_t numWorkers() const;
+
+    ~ThreadPool();
+
+private:
+    ThreadPool();
+    ThreadPool( const ThreadPool& ) = delete;
+    ThreadPool& operator=( const ThreadPool& ) = delete;
+
+    /// Makes sure there are at least n worker threads.
+    void reserve( size_t n );
+
+    void workerLoop( size_t id, unsigned long generation );
+
+    /// Sets up the job, with ranges split evenly or by cost.
+    void run( size_t numTasks, size_t numThreads,
+            const std::function< void( size_t ) >& fn,
+            const std::vector< double >* cost );
+
+    /// Runs the tasks of range 'slot', then steals from the others.
+    void runSlot( size_t slot );
+
+    /**
+     * Tasks [next, end) of one participant. Owner and thieves both take
+     * tasks with an atomic increment of next. Padded to a cache line so
+     * that the counters of different threads do not share one.
+     */
+    struct Range
+    {
+        std::atomic< size_t > next;
+        size_t end;
+        char pad[ 64 - sizeof( std::atomic< size_t > ) - sizeof( size_t ) ];
+    };
+
+    std::vector< std::thread > workers_;
+
+    /// Serializes jobs submitted from different threads.
+    std::mutex jobMutex_;
+
+    /// Guards the job description, generation_ and busyWorkers_.
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+
+    /// Function of the current job.
+    const std::function< void( size_t ) >* fn_;
+
+    /// Task ranges of the current job, one per participating thread.
+    std::unique_ptr< Range[] > ranges_;
+
+    /// Ends of the ranges of the current job, kept to avoid allocation.
+    std::vector< size_t > stops_;
+    size_t maxSlots_;
+    size_t numSlots_;
+
+    /// Incremented for every job. Workers wait for it to change.
+    unsigned long generation_;
+
+    /// Workers that have not yet finished the current job.
+    size_t busyWorkers_;
+
+    bool stop_;
+};
+
+} // namespace moose
+
+#endif // _MOOSE_THREAD_POOL_H
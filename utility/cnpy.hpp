@@ -72,7 +72,7 @@ void findHeader(std::fstream& fp, string& header );
  * @param data_len
  * @param
  */
-void changeHeaderShape(std::ofstream& fs, const size_t data_len, const size_t numcols);
+void changeHeaderShape(std::fstream& fs, const size_t data_len, const size_t numcols);
 
 // Use version 2.0 of npy fommat.
 // https://numpy.org/devdocs/reference/generated/numpy.lib.format.html